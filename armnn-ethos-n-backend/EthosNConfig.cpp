@@ -75,6 +75,7 @@ constexpr char EthosNConfig::DUMP_RAM_VAR[];
 constexpr char EthosNConfig::PERF_WEIGHT_COMPRESSION_SAVING[];
 constexpr char EthosNConfig::PERF_ACTIVATION_COMPRESSION_SAVING[];
 constexpr char EthosNConfig::PERF_CURRENT[];
+constexpr char EthosNConfig::PERF_BATCH_SIZE[];
 constexpr char EthosNConfig::COMPILER_ALGORITHM[];
 constexpr char EthosNConfig::INTERMEDIATE_COMPRESSION[];
 
@@ -110,6 +111,7 @@ std::ostream& operator<<(std::ostream& configFile, const armnn::EthosNConfig& co
     configFile << armnn::EthosNConfig::PERF_ACTIVATION_COMPRESSION_SAVING << " = "
                << config.m_PerfActivationCompressionSaving << std::endl;
     configFile << armnn::EthosNConfig::PERF_CURRENT << " = " << config.m_PerfCurrent << std::endl;
+    configFile << armnn::EthosNConfig::PERF_BATCH_SIZE << " = " << config.m_PerfBatchSize << std::endl;
     if (config.m_CompilerAlgorithm != ethosn::support_library::CompilerAlgorithm::Auto)
     {
         configFile << armnn::EthosNConfig::COMPILER_ALGORITHM << " = "
@@ -199,6 +201,10 @@ std::istream& operator>>(std::istream& configFile, armnn::EthosNConfig& config)
                 {
                     config.m_PerfCurrent = TryConvertToBool(m[2], line, lineNo);
                 }
+                else if (m[1] == armnn::EthosNConfig::PERF_BATCH_SIZE)
+                {
+                    config.m_PerfBatchSize = TryConvertToUnsigned(m[2], line, lineNo);
+                }
                 else if (m[1] == armnn::EthosNConfig::COMPILER_ALGORITHM)
                 {
                     try
@@ -30,6 +30,7 @@ struct EthosNConfig
     static constexpr char PERF_WEIGHT_COMPRESSION_SAVING[]      = "PERFORMANCE_WEIGHT_COMPRESSION_SAVING";        // float
     static constexpr char PERF_ACTIVATION_COMPRESSION_SAVING[]  = "PERFORMANCE_ACTIVATION_COMPRESSION_SAVING";    // float
     static constexpr char PERF_CURRENT[]                        = "PERFORMANCE_CURRENT";                          // boolean
+    static constexpr char PERF_BATCH_SIZE[]                     = "PERFORMANCE_BATCH_SIZE";                       // uint32
     static constexpr char COMPILER_ALGORITHM[]                  = "COMPILER_ALGORITHM";                           // enum
     static constexpr char INTERMEDIATE_COMPRESSION[]            = "INTERMEDIATE_COMPRESSION";                     // boolean
     // clang-format on
@@ -45,6 +46,7 @@ struct EthosNConfig
     bool m_PerfUseWeightCompressionOverride              = false;
     float m_PerfWeightCompressionSaving                  = 0.0f;
     bool m_PerfCurrent                                   = false;
+    uint32_t m_PerfBatchSize                             = 1;
     ethosn::support_library::CompilerAlgorithm m_CompilerAlgorithm =
         ethosn::support_library::CompilerAlgorithm::NonCascadingOnly;
     bool m_IntermediateCompression = true;
@@ -701,6 +701,7 @@ std::vector<CompiledBlobPtr>
     ethosnEstimationOpts.m_UseWeightCompressionOverride = m_EthosNConfig.m_PerfUseWeightCompressionOverride;
     ethosnEstimationOpts.m_WeightCompressionSaving      = m_EthosNConfig.m_PerfWeightCompressionSaving;
     ethosnEstimationOpts.m_Current                      = m_EthosNConfig.m_PerfCurrent;
+    ethosnEstimationOpts.m_BatchSize                    = m_EthosNConfig.m_PerfBatchSize;
     EthosNPreCompiledObject::PerfData perfData;
 
     perfData.m_PerfOutFile               = ethosnCompilationOpts.m_DebugInfo.m_DebugDir + "/report.json";
@@ -197,7 +197,8 @@ BOOST_AUTO_TEST_CASE(EstimationOnlyWorkload)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -375,7 +376,8 @@ BOOST_AUTO_TEST_CASE(EstimationOnlyExistingWorkload)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -546,7 +548,8 @@ BOOST_AUTO_TEST_CASE(EstimationOnlyUnsupportedWithMapping)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -714,7 +717,8 @@ BOOST_AUTO_TEST_CASE(EstimationOnlyStandInMapping)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -820,7 +824,8 @@ BOOST_AUTO_TEST_CASE(CreateEstimationWorkload)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -924,7 +929,8 @@ BOOST_AUTO_TEST_CASE(EstimationCompressionOverride)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0.6,
 		"WeightCompressionSavings": 0.8,
-		"Current": 0
+		"Current": 0,
+		"BatchSize": 1
 	},
 )";
     BOOST_TEST(result.find(golden) != std::string::npos);
@@ -1044,7 +1050,8 @@ BOOST_AUTO_TEST_CASE(CreateEstimationWorkloadSplit)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
@@ -1113,7 +1120,8 @@ BOOST_AUTO_TEST_CASE(CreateEstimationWorkloadSplit)
 		"SramSizeBytesOverride": 0,
 		"ActivationCompressionSavings": 0,
 		"WeightCompressionSavings": "Not Specified",
-		"Current": 1
+		"Current": 1,
+		"BatchSize": 1
 	},
 	"OperationNames":
 	{
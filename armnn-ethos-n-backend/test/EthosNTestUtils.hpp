@@ -68,6 +68,7 @@ inline void CreateConfigFile(const std::string& configFile, const armnn::EthosNC
            << "\n";
     }
     os << armnn::EthosNConfig::PERF_CURRENT << " = " << config.m_PerfCurrent << "\n";
+    os << armnn::EthosNConfig::PERF_BATCH_SIZE << " = " << config.m_PerfBatchSize << "\n";
 }
 
 inline std::string ReadFile(const std::string& file)
@@ -470,7 +470,8 @@ void EthosNPreCompiledWorkload::SavePerformanceJson() const
         os << indent << JsonField("WeightCompressionSavings") << ' ' << Quoted("Not Specified") << ",\n";
     }
 
-    os << indent << JsonField("Current") << ' ' << perfData.m_EstimationOptions.m_Current << "\n";
+    os << indent << JsonField("Current") << ' ' << perfData.m_EstimationOptions.m_Current << ",\n";
+    os << indent << JsonField("BatchSize") << ' ' << perfData.m_EstimationOptions.m_BatchSize << "\n";
 
     indent--;
     os << indent << "},\n";
@@ -56,6 +56,15 @@ public:
     // Returns a pointer to the mapped kernel buffer.
     uint8_t* GetMappedBuffer();
 
+    // Begins a CPU access to the buffer and returns a pointer to the mapped kernel buffer.
+    // Data written by the NPU is made visible to the CPU.
+    // Once a buffer has been mapped, the kernel only does cache maintenance in Map() and Unmap(),
+    // so every later CPU access must happen between the two.
+    uint8_t* Map();
+
+    // Ends the CPU access begun by Map(). Data written by the CPU is made visible to the NPU.
+    void Unmap();
+
 private:
     class BufferImpl;
     std::unique_ptr<BufferImpl> bufferImpl;
@@ -0,0 +1,52 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "Inference.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ethosn
+{
+namespace driver_library
+{
+
+/// A finished inference, as reported by a CompletionQueue.
+struct Completion
+{
+    /// The file descriptor of the inference, see Inference::GetFileDescriptor().
+    int m_InferenceFd;
+    /// Either InferenceResult::Completed or InferenceResult::Error.
+    InferenceResult m_Result;
+};
+
+/// Collects the completions of every inference scheduled on the networks attached to it
+/// (see Network::SetCompletionQueue), so that many in-flight inferences can be waited for and
+/// reaped with a single system call rather than one poll and one read per inference.
+/// An Inference must not be destroyed before its completion has been reaped.
+class CompletionQueue
+{
+public:
+    CompletionQueue();
+    ~CompletionQueue();
+
+    /// Get a file descriptor which can be polled to wait until completions are available.
+    int GetFileDescriptor() const;
+
+    /// Returns up to maxCompletions completions, oldest first.
+    /// Waits for at least one completion for up to timeoutMs milliseconds. A negative timeout waits forever and
+    /// a timeout of zero returns immediately. Returns an empty vector if the timeout expires.
+    std::vector<Completion> Reap(uint32_t maxCompletions, int timeoutMs);
+
+private:
+    class CompletionQueueImpl;
+    std::unique_ptr<CompletionQueueImpl> m_CompletionQueueImpl;
+};
+
+}    // namespace driver_library
+}    // namespace ethosn
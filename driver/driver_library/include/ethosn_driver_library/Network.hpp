@@ -6,10 +6,14 @@
 #pragma once
 
 #include "Buffer.hpp"
+#include "CompletionQueue.hpp"
 #include "Inference.hpp"
 
 #include <ethosn_support_library/Support.hpp>
 
+#include <array>
+#include <cstdint>
+
 // Version information
 #define ETHOSN_DRIVER_LIBRARY_VERSION_MAJOR 0
 #define ETHOSN_DRIVER_LIBRARY_VERSION_MINOR 1
@@ -22,6 +26,49 @@ namespace driver_library
 
 class NetworkImpl;
 
+/// Stages of an inference's life, timed by the kernel driver for every inference.
+/// Note this must be kept in-sync with the kernel driver's definitions.
+enum class LatencyStage
+{
+    /// Inference scheduled until queued for a core.
+    Submit,
+    /// Queued until dequeued to a core.
+    Queue,
+    /// Binding table update and cache maintenance of the input/output buffers.
+    Bind,
+    /// Posting the inference to the firmware's mailbox.
+    Post,
+    /// Posted until the core raised the interrupt reporting completion.
+    Execute,
+    /// Interrupt until the inference was completed by the kernel driver.
+    Irq,
+    /// Completed until the inference's status was read, e.g. by Inference::Wait.
+    Wakeup,
+    /// Inference scheduled until completed.
+    Total,
+    /// The number of stages in this enum.
+    NumValues,
+};
+
+/// Number of buckets of a StageLatency histogram. Bucket 0 counts durations below 2 us, bucket i counts durations
+/// in [2^i, 2^(i+1)) us and the last bucket also counts everything longer.
+constexpr uint32_t g_NumLatencyBuckets = 20;
+
+/// Latency of one stage, aggregated over the completed inferences of a network.
+struct StageLatency
+{
+    uint64_t m_Count   = 0;
+    uint64_t m_TotalNs = 0;
+    uint64_t m_MaxNs   = 0;
+    std::array<uint32_t, g_NumLatencyBuckets> m_Histogram{};
+};
+
+/// Per-stage latencies of a network's inferences, indexed by LatencyStage.
+struct LatencyStats
+{
+    std::array<StageLatency, static_cast<size_t>(LatencyStage::NumValues)> m_Stages;
+};
+
 struct Version
 {
     Version();
@@ -54,6 +101,14 @@ public:
                                  Buffer* const outputBuffers[],
                                  uint32_t numOutputBuffers) const;
 
+    // Report the completion of every inference subsequently scheduled with this network to the given queue,
+    // in addition to the inference's own file descriptor. The queue must outlive those inferences.
+    void SetCompletionQueue(CompletionQueue& completionQueue);
+
+    // Get the per-stage latencies of the inferences of this network completed so far.
+    // These are always collected, independently of profiling being enabled.
+    LatencyStats GetLatencyStats() const;
+
     void SetDebugName(const char* name);
 
 private:
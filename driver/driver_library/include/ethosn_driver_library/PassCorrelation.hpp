@@ -0,0 +1,76 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+
+#include "Profiling.hpp"
+
+#include <ethosn_support_library/Support.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <set>
+#include <vector>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+/// The estimated performance of a single pass of a compiled network alongside its measured performance.
+struct PassCorrelation
+{
+    /// Index of the pass in support_library::CompiledNetwork::GetPassCommandInfos().
+    uint32_t m_PassIdx = 0;
+    /// The (inclusive) range of command indices that were generated for this pass.
+    /// @{
+    uint32_t m_FirstCommandIdx = 0;
+    uint32_t m_LastCommandIdx  = 0;
+    /// @}
+    /// The operations from the input Network that are associated with this pass.
+    std::set<uint32_t> m_OperationIds;
+
+    /// Estimated number of bytes of input, output and weights transferred to and from DRAM.
+    uint64_t m_EstimatedDramBytes = 0;
+    /// Estimated number of MCE cycles.
+    uint64_t m_EstimatedMceCycles = 0;
+    /// Estimated number of cycles for the pass, assuming it is limited by whichever is slower of the MCE and
+    /// the DRAM transfers at the bandwidth given to CorrelatePassPerformance.
+    uint64_t m_EstimatedCycles = 0;
+
+    /// Number of inferences in which the commands of this pass were seen in the profiling data.
+    uint32_t m_NumMeasurements = 0;
+    /// Mean time from the start of the first command of this pass to the end of its last command.
+    double m_MeasuredNs = 0.0;
+    /// Measured time divided by the estimate, once the estimates have been scaled so that their total over all
+    /// the measured passes matches the total measured time. Values far from 1 are the biggest mispredictions:
+    /// above 1 means the pass is slower than its share of the estimate. Zero if the pass has no estimate or was
+    /// not measured.
+    double m_MispredictionRatio = 0.0;
+};
+
+/// Maps the FirmwareInference and FirmwareCommand events in the given profiling entries back to the passes of the
+/// given compiled network, using the command indices recorded for each pass during compilation.
+/// The entries can be those reported at run time (ReportNewProfilingData) or a recording converted offline
+/// (ConvertRecordedFirmwareProfile), and the compiled network can be de-serialized from a file, so this doesn't
+/// need an NPU.
+/// Only the entries reported by the given core are used, as the inferences and commands of different cores
+/// interleave in time and can't be told apart otherwise.
+/// Returns one entry per pass, in command stream order.
+std::vector<PassCorrelation> CorrelatePassPerformance(const support_library::CompiledNetwork& compiledNetwork,
+                                                      const std::vector<ProfilingEntry>& entries,
+                                                      uint32_t dramBytesPerCycle =
+                                                          support_library::g_NominalDramBytesPerCycle,
+                                                      uint32_t coreId = 0);
+
+/// Prints the result of CorrelatePassPerformance as a table, marking the numWorstToFlag biggest mispredictions.
+void PrintPassCorrelation(const std::vector<PassCorrelation>& passes,
+                          std::ostream& outStream,
+                          uint32_t numWorstToFlag = 5);
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
@@ -9,6 +9,7 @@
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <iosfwd>
 #include <vector>
 
 namespace ethosn
@@ -18,7 +19,8 @@ namespace driver_library
 namespace profiling
 {
 
-/// A set of counters which only a maximum of 6 can be activated at once
+/// A set of counters which only a maximum of 6 can be activated at once, unless multiplexed
+/// (see Configuration::m_MultiplexPeriod).
 enum class HardwareCounters
 {
     FirmwareBusAccessRdTransfers,
@@ -45,6 +47,13 @@ struct Configuration
     uint32_t m_FirmwareBufferSize  = 0;
     uint32_t m_NumHardwareCounters = 0;
     HardwareCounters m_HardwareCounters[6];
+
+    /// If non-zero, the hardware counters in m_MultiplexedHardwareCounters, which may be more than 6, are split into
+    /// sets of at most 6 and the set being sampled by the firmware changes every m_MultiplexPeriod inferences.
+    /// Each time the set changes, a ScaledCounterValue sample is reported for every counter observed so far, which
+    /// extrapolates its count to all the inferences. m_HardwareCounters is ignored.
+    uint32_t m_MultiplexPeriod = 0;
+    std::vector<HardwareCounters> m_MultiplexedHardwareCounters;
 };
 
 /// Re-configures the profiling options for the ethosn driver stack based on the given Configuration object.
@@ -94,6 +103,12 @@ enum class PollCounterName
     KernelDriverNumMailboxMessagesSent,
     /// The number of mailbox messages received by the kernel driver.
     KernelDriverNumMailboxMessagesReceived,
+    /// The number of inferences which completed successfully.
+    KernelDriverNumInferencesCompleted,
+    /// The time in milliseconds during which at least one inference was in flight.
+    KernelDriverBusyTimeMs,
+    /// The number of inferences dispatched to the core which last ran the same network.
+    KernelDriverNumAffinityHits,
 
     /// The number of counter types in this enum.
     NumValues,
@@ -105,6 +120,10 @@ enum class PollCounterName
 /// This function is thread-safe.
 uint64_t GetCounterValue(PollCounterName counter);
 
+/// As GetCounterValue(PollCounterName), but kernel driver counters are read from the given NPU core
+/// rather than core 0. Driver library counters are not per-core and ignore coreId.
+uint64_t GetCounterValue(PollCounterName counter, uint32_t coreId);
+
 /// A single entry in the vector returned by ReportNewProfilingData.
 /// This can represent a timeline event or a counter sample.
 /// It contains a timestamp, the type of event, the Id of the event and the metadata associated with the event
@@ -163,7 +182,8 @@ public:
         // Non-firmware related categories go here.
         InferenceLifetime,
         BufferLifetime,
-        CounterValue
+        CounterValue,
+        ScaledCounterValue
     };
     MetadataCategory m_MetadataCategory;
     /// @}
@@ -175,6 +195,10 @@ public:
     /// for example identifying a command number or stripe index.
     uint64_t m_MetadataValue;
 
+    /// The NPU core which reported a firmware entry. Entries from ReportNewProfilingData are read from the profiling
+    /// buffer of core 0 and those from ConvertRecordedFirmwareProfile are given the core of the recording.
+    uint32_t m_CoreId = 0;
+
     /// Functions to retrieve metadata. Only some of these will be applicable based on the metadata category
     /// (m_MetadataCategory).
     /// E.g. BufferLifetime doesn't have any metadata and GetCounterValue is only applicable with CounterValue
@@ -185,6 +209,19 @@ public:
         assert(m_MetadataCategory == MetadataCategory::CounterValue);
         return impl::GetCounterValue(m_MetadataValue);
     }
+    /// Estimated count of a multiplexed hardware counter over all the inferences so far.
+    uint64_t GetScaledCounterValue() const
+    {
+        assert(m_MetadataCategory == MetadataCategory::ScaledCounterValue);
+        return impl::GetScaledCounterValue(m_MetadataValue);
+    }
+    /// Fraction of the inferences, between 0 and 1, during which a multiplexed hardware counter was sampled.
+    /// The closer to 1, the more the scaled value can be trusted.
+    float GetScaledCounterConfidence() const
+    {
+        assert(m_MetadataCategory == MetadataCategory::ScaledCounterValue);
+        return impl::GetScaledCounterConfidence(m_MetadataValue);
+    }
     /// @}
 };
 
@@ -194,6 +231,18 @@ const char* MetadataCategoryToCString(ProfilingEntry::MetadataCategory category)
 
 const char* MetadataTypeToCString(ProfilingEntry::Type type);
 
+/// Writes the given entries (e.g. from ReportNewProfilingData) in the Chrome trace event format, which can be
+/// opened with the Perfetto UI or chrome://tracing. Driver and firmware events are shown on separate named tracks
+/// (inferences, buffers, firmware, DMA, MCE, PLE, agents and agent stripes) and counter samples as counter tracks.
+void DumpChromeTrace(const std::vector<ProfilingEntry>& entries, std::ostream& outStream);
+
+/// Converts a recording of the firmware profiling buffer, i.e. the raw bytes read from the kernel driver's firmware
+/// profiling node, to profiling entries. The timestamps are converted to host time using the time sync events
+/// in the recording and the NPU clock frequency. This doesn't need an NPU, so can be used offline.
+/// The entries are marked as reported by the given core, which the recording was read from.
+std::vector<ProfilingEntry>
+    ConvertRecordedFirmwareProfile(std::istream& binaryProfile, uint32_t clockFrequencyMhz, uint32_t coreId = 0);
+
 }    // namespace profiling
 }    // namespace driver_library
 }    // namespace ethosn
@@ -18,4 +18,17 @@ inline uint64_t GetCounterValue(uint64_t metadataValue)
     return metadataValue;
 }
 
+/// The scaled counter value is stored in the low 48 bits and the confidence, in 1/65535ths, in the high 16 bits.
+constexpr uint32_t g_ScaledCounterConfidenceShift = 48;
+
+inline uint64_t GetScaledCounterValue(uint64_t metadataValue)
+{
+    return metadataValue & ((uint64_t(1) << g_ScaledCounterConfidenceShift) - 1);
+}
+
+inline float GetScaledCounterConfidence(uint64_t metadataValue)
+{
+    return static_cast<float>(metadataValue >> g_ScaledCounterConfidenceShift) / 65535.0f;
+}
+
 }    // namespace impl
\ No newline at end of file
@@ -71,5 +71,15 @@ uint8_t* Buffer::GetMappedBuffer()
     return bufferImpl->GetMappedBuffer();
 }
 
+uint8_t* Buffer::Map()
+{
+    return bufferImpl->Map();
+}
+
+void Buffer::Unmap()
+{
+    bufferImpl->Unmap();
+}
+
 }    // namespace driver_library
 }    // namespace ethosn
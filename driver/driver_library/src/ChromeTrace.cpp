@@ -0,0 +1,307 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Exports profiling entries in the Chrome trace event format, see
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+
+#include "../include/ethosn_driver_library/Profiling.hpp"
+
+#include "ProfilingInternal.hpp"
+
+#include <cassert>
+#include <cctype>
+#include <cinttypes>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+namespace
+{
+
+// All the tracks are threads of one of these two processes.
+constexpr uint32_t g_DriverPid   = 1;
+constexpr uint32_t g_FirmwarePid = 2;
+
+struct Track
+{
+    uint32_t m_Pid;
+    uint32_t m_Tid;
+    const char* m_Name;
+};
+
+const Track g_Tracks[] = {
+    { g_DriverPid, 1, "Inferences" },      { g_DriverPid, 2, "Buffers" },      { g_DriverPid, 3, "Counters" },
+    { g_FirmwarePid, 10, "Firmware" },     { g_FirmwarePid, 11, "DMA" },       { g_FirmwarePid, 12, "MCE" },
+    { g_FirmwarePid, 13, "PLE" },          { g_FirmwarePid, 14, "Agents" },    { g_FirmwarePid, 15, "Agent stripes" },
+};
+
+enum TrackIdx
+{
+    Track_Inferences,
+    Track_Buffers,
+    Track_Counters,
+    Track_Firmware,
+    Track_Dma,
+    Track_Mce,
+    Track_Ple,
+    Track_Agents,
+    Track_AgentStripes,
+};
+
+TrackIdx GetTrack(ProfilingEntry::MetadataCategory category)
+{
+    switch (category)
+    {
+        case ProfilingEntry::MetadataCategory::InferenceLifetime:
+            return Track_Inferences;
+        case ProfilingEntry::MetadataCategory::BufferLifetime:
+            return Track_Buffers;
+        case ProfilingEntry::MetadataCategory::CounterValue:
+        case ProfilingEntry::MetadataCategory::ScaledCounterValue:
+            return Track_Counters;
+        case ProfilingEntry::MetadataCategory::FirmwareDma:
+        case ProfilingEntry::MetadataCategory::FirmwareDmaSetup:
+            return Track_Dma;
+        case ProfilingEntry::MetadataCategory::FirmwareMceStripeSetup:
+        case ProfilingEntry::MetadataCategory::FirmwareTsu:
+            return Track_Mce;
+        case ProfilingEntry::MetadataCategory::FirmwarePleStripeSetup:
+            return Track_Ple;
+        case ProfilingEntry::MetadataCategory::FirmwareAgent:
+            return Track_Agents;
+        case ProfilingEntry::MetadataCategory::FirmwareAgentStripe:
+            return Track_AgentStripes;
+        default:
+            return Track_Firmware;
+    }
+}
+
+const char* CounterToCString(uint64_t id)
+{
+    if (id < static_cast<uint64_t>(CollatedCounterName::NumValues))
+    {
+        static const char* const names[] = {
+            "FirmwareDwtSleepCycleCount",
+            "FirmwareEventQueueSize",
+            "FirmwareDmaNumReads",
+            "FirmwareDmaNumWrites",
+            "FirmwareDmaReadBytes",
+            "FirmwareDmaWriteBytes",
+            "FirmwareBusAccessRdTransfers",
+            "FirmwareBusRdCompleteTransfers",
+            "FirmwareBusReadBeats",
+            "FirmwareBusReadTxfrStallCycles",
+            "FirmwareBusAccessWrTransfers",
+            "FirmwareBusWrCompleteTransfers",
+            "FirmwareBusWriteBeats",
+            "FirmwareBusWriteTxfrStallCycles",
+            "FirmwareBusWriteStallCycles",
+            "FirmwareBusErrorCount",
+            "FirmwareNcuMcuIcacheMiss",
+            "FirmwareNcuMcuDcacheMiss",
+            "FirmwareNcuMcuBusReadBeats",
+            "FirmwareNcuMcuBusWriteBeats",
+        };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(CollatedCounterName::NumValues),
+                      "Counter names not in sync with CollatedCounterName");
+        return names[id];
+    }
+    if (id < static_cast<uint64_t>(PollCounterName::NumValues))
+    {
+        static const char* const names[] = {
+            "DriverLibraryNumLiveBuffers",
+            "DriverLibraryNumLiveInferences",
+            "KernelDriverNumMailboxMessagesSent",
+            "KernelDriverNumMailboxMessagesReceived",
+            "KernelDriverNumInferencesCompleted",
+            "KernelDriverBusyTimeMs",
+            "KernelDriverNumAffinityHits",
+        };
+        static_assert(sizeof(names) / sizeof(names[0]) ==
+                          static_cast<size_t>(PollCounterName::NumValues) -
+                              static_cast<size_t>(PollCounterName::DriverLibraryNumLiveBuffers),
+                      "Counter names not in sync with PollCounterName");
+        return names[id - static_cast<uint64_t>(PollCounterName::DriverLibraryNumLiveBuffers)];
+    }
+    return "UnknownCounter";
+}
+
+/// Decodes the fields of a firmware timeline entry's metadata into trace event arguments.
+std::string GetFirmwareArgs(const ProfilingEntry& entry)
+{
+    DataUnion data = {};
+    data.m_Raw     = static_cast<EntryData>(entry.m_MetadataValue);
+
+    char args[128];
+    switch (entry.m_MetadataCategory)
+    {
+        case ProfilingEntry::MetadataCategory::FirmwareCommand:
+            snprintf(args, sizeof(args), R"({"command": %u})", data.m_CommandFields.m_CommandIdx);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareDma:
+            snprintf(args, sizeof(args), R"({"command": %u, "stripe": %u, "dma_category": %u, "hardware_id": %u})",
+                     data.m_DmaFields.m_CommandIdx, data.m_DmaFields.m_StripeIdx, data.m_DmaFields.m_DmaCategory,
+                     data.m_DmaFields.m_DmaHardwareId);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareTsu:
+            snprintf(args, sizeof(args), R"({"command": %u, "stripe": %u, "bank": %u})", data.m_TsuFields.m_CommandIdx,
+                     data.m_TsuFields.m_StripeIdx, data.m_TsuFields.m_BankId);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareMceStripeSetup:
+            snprintf(args, sizeof(args), R"({"command": %u, "stripe": %u})", data.m_MceStripeSetupFields.m_CommandIdx,
+                     data.m_MceStripeSetupFields.m_StripeIdx);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwarePleStripeSetup:
+            snprintf(args, sizeof(args), R"({"command": %u, "stripe": %u})", data.m_PleStripeSetupFields.m_CommandIdx,
+                     data.m_PleStripeSetupFields.m_StripeIdx);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareDmaSetup:
+            snprintf(args, sizeof(args), R"({"command": %u, "stripe": %u, "dma_category": %u})",
+                     data.m_DmaStripeSetupFields.m_CommandIdx, data.m_DmaStripeSetupFields.m_StripeIdx,
+                     data.m_DmaStripeSetupFields.m_DmaCategory);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareAgent:
+            snprintf(args, sizeof(args), R"({"type": %u, "command": %u})", data.m_AgentFields.m_Type,
+                     data.m_AgentFields.m_CommandIdx);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareAgentStripe:
+            snprintf(args, sizeof(args), R"({"type": %u, "command": %u, "stripe": %u})",
+                     data.m_AgentStripeFields.m_AgentStripeType, data.m_AgentStripeFields.m_CommandIdx,
+                     data.m_AgentStripeFields.m_StripeIdx);
+            break;
+        case ProfilingEntry::MetadataCategory::FirmwareLabel:
+        {
+            // Labels are up to 3 characters, padded with zeros. Drop anything which would need escaping.
+            std::string label;
+            for (uint8_t c : data.m_LabelFields.m_Chars)
+            {
+                if (isprint(c) && c != '"' && c != '\\')
+                {
+                    label += static_cast<char>(c);
+                }
+            }
+            snprintf(args, sizeof(args), R"({"label": "%s"})", label.c_str());
+            break;
+        }
+        default:
+            snprintf(args, sizeof(args), R"({"value": %)" PRIu64 "}", entry.m_MetadataValue);
+            break;
+    }
+    return args;
+}
+
+}    // namespace
+
+void DumpChromeTrace(const std::vector<ProfilingEntry>& entries, std::ostream& outStream)
+{
+    if (!outStream.good())
+    {
+        return;
+    }
+
+    outStream << R"({"displayTimeUnit": "ns", "traceEvents": [)"
+              << "\n";
+
+    // Name the processes and tracks.
+    outStream << R"({"ph": "M", "name": "process_name", "pid": )" << g_DriverPid
+              << R"(, "args": {"name": "Ethos-N driver"}},)"
+              << "\n";
+    outStream << R"({"ph": "M", "name": "process_name", "pid": )" << g_FirmwarePid
+              << R"(, "args": {"name": "Ethos-N firmware"}})";
+    for (const Track& track : g_Tracks)
+    {
+        outStream << ",\n"
+                  << R"({"ph": "M", "name": "thread_name", "pid": )" << track.m_Pid << R"(, "tid": )" << track.m_Tid
+                  << R"(, "args": {"name": ")" << track.m_Name << R"("}})";
+    }
+
+    for (const ProfilingEntry& entry : entries)
+    {
+        const Track& track = g_Tracks[GetTrack(entry.m_MetadataCategory)];
+
+        // Timestamps are in microseconds, with nanosecond precision.
+        char ts[32];
+        snprintf(ts, sizeof(ts), "%.3f", static_cast<double>(entry.m_Timestamp.time_since_epoch().count()) / 1000.0);
+
+        outStream << ",\n{";
+        switch (entry.m_Type)
+        {
+            case ProfilingEntry::Type::CounterSample:
+            {
+                bool isScaled = entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::ScaledCounterValue;
+                outStream << R"("ph": "C", "name": ")" << CounterToCString(entry.m_Id) << (isScaled ? " (scaled)" : "")
+                          << R"(", "args": {"value": )"
+                          << (isScaled ? entry.GetScaledCounterValue() : entry.GetCounterValue()) << "}";
+                break;
+            }
+            case ProfilingEntry::Type::TimelineEventStart:    // Deliberate fallthrough
+            case ProfilingEntry::Type::TimelineEventEnd:
+            {
+                // Events of the same track can overlap (e.g. concurrent DMA transfers), so they are emitted as
+                // async events matched by id rather than as nested begin/end pairs.
+                bool isStart = entry.m_Type == ProfilingEntry::Type::TimelineEventStart;
+                outStream << R"("ph": ")" << (isStart ? "b" : "e") << R"(", "name": ")"
+                          << MetadataCategoryToCString(entry.m_MetadataCategory) << R"(", "cat": ")" << track.m_Name
+                          << R"(", "id": )" << entry.m_Id;
+                if (isStart && track.m_Pid == g_FirmwarePid)
+                {
+                    outStream << R"(, "args": )" << GetFirmwareArgs(entry);
+                }
+                break;
+            }
+            case ProfilingEntry::Type::TimelineEventInstant:
+            {
+                outStream << R"("ph": "i", "s": "t", "name": ")" << MetadataCategoryToCString(entry.m_MetadataCategory)
+                          << R"(", "args": )" << GetFirmwareArgs(entry);
+                break;
+            }
+            default:
+            {
+                // Still write an event so that the trace remains valid JSON
+                assert(!"Invalid profiling entry type");
+                outStream << R"("ph": "i", "s": "t", "name": "Unknown")";
+                break;
+            }
+        }
+        outStream << R"(, "ts": )" << ts << R"(, "pid": )" << track.m_Pid << R"(, "tid": )" << track.m_Tid << "}";
+    }
+
+    outStream << "\n]}\n";
+}
+
+std::vector<ProfilingEntry>
+    ConvertRecordedFirmwareProfile(std::istream& binaryProfile, uint32_t clockFrequencyMhz, uint32_t coreId)
+{
+    std::vector<ProfilingEntry> entries;
+    ethosn_profiling_entry kernelEntry;
+    while (binaryProfile.read(reinterpret_cast<char*>(&kernelEntry), sizeof(kernelEntry)))
+    {
+        entries.push_back(ConvertProfilingEntry(kernelEntry));
+        entries.back().m_CoreId = coreId;
+    }
+
+    if (clockFrequencyMhz == 0)
+    {
+        return entries;
+    }
+
+    // Without a time sync in the recording, the timestamps are relative to the start of the firmware clock.
+    TimeSync timeDelta = GetTimeDelta(entries, static_cast<int>(clockFrequencyMhz));
+    ApplyTimeDelta(entries, static_cast<int>(clockFrequencyMhz), timeDelta.m_Valid ? timeDelta.m_Delta : 0);
+    return entries;
+}
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
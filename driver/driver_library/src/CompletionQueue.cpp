@@ -0,0 +1,58 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_driver_library/CompletionQueue.hpp"
+
+#ifdef TARGET_KMOD
+#include "KmodCompletionQueue.hpp"
+#else
+#include <stdexcept>
+#endif
+
+namespace ethosn
+{
+namespace driver_library
+{
+
+#ifndef TARGET_KMOD
+/// Completion queues are a kernel driver feature, so are not available with other backends.
+class CompletionQueue::CompletionQueueImpl
+{
+public:
+    CompletionQueueImpl()
+    {
+        throw std::runtime_error("Completion queues are only supported by the kernel driver backend");
+    }
+
+    int GetFileDescriptor() const
+    {
+        return -1;
+    }
+
+    std::vector<Completion> Reap(uint32_t, int)
+    {
+        return {};
+    }
+};
+#endif
+
+CompletionQueue::CompletionQueue()
+    : m_CompletionQueueImpl{ std::make_unique<CompletionQueueImpl>() }
+{}
+
+CompletionQueue::~CompletionQueue() = default;
+
+int CompletionQueue::GetFileDescriptor() const
+{
+    return m_CompletionQueueImpl->GetFileDescriptor();
+}
+
+std::vector<Completion> CompletionQueue::Reap(uint32_t maxCompletions, int timeoutMs)
+{
+    return m_CompletionQueueImpl->Reap(maxCompletions, timeoutMs);
+}
+
+}    // namespace driver_library
+}    // namespace ethosn
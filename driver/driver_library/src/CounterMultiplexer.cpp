@@ -0,0 +1,124 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "CounterMultiplexer.hpp"
+
+#include "ProfilingInternal.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+CollatedCounterName ConvertHwCounterToCollated(HardwareCounters counter)
+{
+    // The hardware counters are listed in the same order at the end of CollatedCounterName.
+    constexpr uint32_t offset = static_cast<uint32_t>(CollatedCounterName::FirmwareBusAccessRdTransfers);
+    static_assert(static_cast<uint32_t>(CollatedCounterName::FirmwareNcuMcuBusWriteBeats) ==
+                      offset + static_cast<uint32_t>(HardwareCounters::FirmwareNcuMcuBusWriteBeats),
+                  "HardwareCounters not in sync with CollatedCounterName");
+    return static_cast<CollatedCounterName>(offset + static_cast<uint32_t>(counter));
+}
+
+CounterMultiplexer::CounterMultiplexer(const std::vector<HardwareCounters>& counters,
+                                       uint32_t period,
+                                       uint32_t maxCountersPerSet)
+    : m_Period(period)
+    , m_ActiveSet(0)
+    , m_NumInferencesInPeriod(0)
+    , m_NumInferences(0)
+{
+    if (counters.empty() || period == 0 || maxCountersPerSet == 0)
+    {
+        throw std::invalid_argument("Counter multiplexing needs counters, a period and a set size");
+    }
+
+    for (HardwareCounters counter : counters)
+    {
+        CounterState state;
+        state.m_Counter = counter;
+        m_Counters.push_back(state);
+    }
+
+    // Deal the counters round-robin so that the sets are balanced.
+    size_t numSets = (m_Counters.size() + maxCountersPerSet - 1) / maxCountersPerSet;
+    m_Sets.resize(numSets);
+    m_SetCounters.resize(numSets);
+    for (size_t i = 0; i < m_Counters.size(); ++i)
+    {
+        m_Sets[i % numSets].push_back(i);
+        m_SetCounters[i % numSets].push_back(m_Counters[i].m_Counter);
+    }
+}
+
+const std::vector<HardwareCounters>& CounterMultiplexer::GetActiveSet() const
+{
+    return m_SetCounters[m_ActiveSet];
+}
+
+bool CounterMultiplexer::AddInference(std::vector<ProfilingEntry>::const_iterator begin,
+                                      std::vector<ProfilingEntry>::const_iterator end)
+{
+    for (size_t idx : m_Sets[m_ActiveSet])
+    {
+        CounterState& state = m_Counters[idx];
+        uint64_t id         = static_cast<uint64_t>(ConvertHwCounterToCollated(state.m_Counter));
+        for (auto it = begin; it != end; ++it)
+        {
+            if (it->m_Type == ProfilingEntry::Type::CounterSample &&
+                it->m_MetadataCategory == ProfilingEntry::MetadataCategory::CounterValue && it->m_Id == id)
+            {
+                state.m_Sum += it->GetCounterValue();
+            }
+        }
+        ++state.m_NumInferencesActive;
+    }
+    ++m_NumInferences;
+
+    if (++m_NumInferencesInPeriod < m_Period || m_Sets.size() == 1)
+    {
+        return false;
+    }
+
+    m_NumInferencesInPeriod = 0;
+    m_ActiveSet             = (m_ActiveSet + 1) % m_Sets.size();
+    return true;
+}
+
+std::vector<ProfilingEntry>
+    CounterMultiplexer::GetScaledSamples(std::chrono::time_point<std::chrono::high_resolution_clock> timestamp) const
+{
+    std::vector<ProfilingEntry> samples;
+    for (const CounterState& state : m_Counters)
+    {
+        if (state.m_NumInferencesActive == 0)
+        {
+            continue;
+        }
+
+        double scale     = static_cast<double>(m_NumInferences) / static_cast<double>(state.m_NumInferencesActive);
+        float confidence = static_cast<float>(1.0 / scale);
+
+        ProfilingEntry entry;
+        entry.m_Timestamp        = timestamp;
+        entry.m_Type             = ProfilingEntry::Type::CounterSample;
+        entry.m_Id               = static_cast<uint64_t>(ConvertHwCounterToCollated(state.m_Counter));
+        entry.m_MetadataCategory = ProfilingEntry::MetadataCategory::ScaledCounterValue;
+        entry.m_MetadataValue    = metadata::CreateScaledCounterValue(
+            static_cast<uint64_t>(static_cast<double>(state.m_Sum) * scale + 0.5), confidence);
+        samples.push_back(entry);
+    }
+    return samples;
+}
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
@@ -0,0 +1,70 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+#pragma once
+
+#include "../include/ethosn_driver_library/Profiling.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+/// Converts a hardware counter to the collated counter its samples are reported as.
+CollatedCounterName ConvertHwCounterToCollated(HardwareCounters counter);
+
+/// Rotates which hardware counters the firmware samples, so that more counters can be observed than the hardware
+/// can count at once, and extrapolates the samples of each counter to the inferences it was not sampled for.
+/// This only processes profiling entries and has no side effects, so that it can be driven by recorded entries.
+///
+/// The counters are split into sets of at most maxCountersPerSet, with sizes differing by at most one.
+/// The active set changes every `period` inferences. The firmware's counter samples are counts since the previous
+/// sample, so the count of a counter is the sum of its samples over the inferences its set was active for,
+/// which is then scaled by (total inferences / sampled inferences).
+class CounterMultiplexer
+{
+public:
+    CounterMultiplexer(const std::vector<HardwareCounters>& counters, uint32_t period, uint32_t maxCountersPerSet = 6);
+
+    /// The set of counters the firmware should currently be configured with.
+    const std::vector<HardwareCounters>& GetActiveSet() const;
+
+    /// Accounts the entries reported for one inference, which was run with GetActiveSet() configured.
+    /// Returns true if the active set has changed as a result, in which case the firmware must be reconfigured.
+    bool AddInference(std::vector<ProfilingEntry>::const_iterator begin,
+                      std::vector<ProfilingEntry>::const_iterator end);
+
+    /// Returns a ScaledCounterValue sample for each counter which has been sampled for at least one inference.
+    std::vector<ProfilingEntry>
+        GetScaledSamples(std::chrono::time_point<std::chrono::high_resolution_clock> timestamp) const;
+
+private:
+    struct CounterState
+    {
+        HardwareCounters m_Counter;
+        uint64_t m_Sum                 = 0;
+        uint64_t m_NumInferencesActive = 0;
+    };
+
+    /// Indices into m_Counters of the counters of each set.
+    std::vector<std::vector<size_t>> m_Sets;
+    /// The counters of each set, in the same order as m_Sets.
+    std::vector<std::vector<HardwareCounters>> m_SetCounters;
+    std::vector<CounterState> m_Counters;
+
+    uint32_t m_Period;
+    size_t m_ActiveSet;
+    uint32_t m_NumInferencesInPeriod;
+    uint64_t m_NumInferences;
+};
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
@@ -19,7 +19,7 @@ namespace driver_library
 namespace profiling
 {
 
-void DumpAllProfilingData(std::ostream& outStream)
+std::vector<ProfilingEntry> GetAllProfilingData()
 {
     std::vector<ProfilingEntry> entries = profiling::g_ProfilingEntries;
     // As well as dumping the currently queued profiling events, include a sample of every pollable counter.
@@ -35,7 +35,12 @@ void DumpAllProfilingData(std::ostream& outStream)
 
         entries.push_back(entry);
     }
-    DumpProfilingData(entries, outStream);
+    return entries;
+}
+
+void DumpAllProfilingData(std::ostream& outStream)
+{
+    DumpProfilingData(GetAllProfilingData(), outStream);
 }
 
 void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::ostream& outStream)
@@ -169,6 +174,14 @@ void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::os
                   << R"("counter_value": )" << std::to_string(entry.GetCounterValue()) << "\n";
                 break;
             }
+            case ProfilingEntry::MetadataCategory::ScaledCounterValue:
+            {
+                o << "\t\t\t"
+                  << R"("counter_value": )" << std::to_string(entry.GetScaledCounterValue()) << ",\n";
+                o << "\t\t\t"
+                  << R"("counter_confidence": )" << std::to_string(entry.GetScaledCounterConfidence()) << "\n";
+                break;
+            }
             default:
             {
                 // Some Metadata categories don't have metadata
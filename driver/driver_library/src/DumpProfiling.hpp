@@ -17,6 +17,8 @@ namespace driver_library
 namespace profiling
 {
 
+/// Returns the queued profiling entries, plus a sample of every pollable counter.
+std::vector<ProfilingEntry> GetAllProfilingData();
 void DumpAllProfilingData(std::ostream& outStream);
 void DumpProfilingData(const std::vector<ProfilingEntry>& profilingData, std::ostream& outStream);
 
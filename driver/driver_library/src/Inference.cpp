@@ -62,7 +62,9 @@ Inference::~Inference()
                             profiling::ProfilingEntry::MetadataCategory::InferenceLifetime);
 
         // Include profiling entries from the firmware if any.
+        size_t firstNewEntry = profiling::g_ProfilingEntries.size();
         profiling::AppendKernelDriverEntries();
+        profiling::UpdateCounterMultiplexing(firstNewEntry);
         // Dumping profiling data at inference destruction is convenient because
         // this is called frequently enough such that there is a good amount of data dumped
         // but not frequently enough to cause performance regressions.
@@ -71,6 +73,11 @@ Inference::~Inference()
             std::ofstream file(profiling::g_DumpFile.c_str(), std::ios_base::out | std::ofstream::binary);
             profiling::DumpAllProfilingData(file);
         }
+        if (profiling::g_TraceFile.size() > 0)
+        {
+            std::ofstream file(profiling::g_TraceFile.c_str(), std::ios_base::out | std::ofstream::binary);
+            profiling::DumpChromeTrace(profiling::GetAllProfilingData(), file);
+        }
     }
 }
 
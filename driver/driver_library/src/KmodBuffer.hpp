@@ -35,6 +35,7 @@ public:
         : m_Data(nullptr)
         , m_Size(size)
         , m_Format(format)
+        , m_IsMapped(false)
     {
         const ethosn_buffer_req outputBufReq = {
             size,
@@ -98,11 +99,48 @@ public:
         return m_Data;
     }
 
+    uint8_t* Map()
+    {
+        if (m_IsMapped)
+        {
+            throw std::runtime_error("Buffer is already mapped");
+        }
+
+        CpuAccess(ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN, ETHOSN_CPU_ACCESS_READ | ETHOSN_CPU_ACCESS_WRITE);
+        m_IsMapped = true;
+
+        return m_Data;
+    }
+
+    void Unmap()
+    {
+        if (!m_IsMapped)
+        {
+            throw std::runtime_error("Buffer is not mapped");
+        }
+
+        // The caller may have written to the buffer, so it is cleaned before the next inference uses it.
+        CpuAccess(ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END, ETHOSN_CPU_ACCESS_WRITE);
+        m_IsMapped = false;
+    }
+
 private:
+    void CpuAccess(unsigned long cmd, uint32_t flags)
+    {
+        ethosn_buffer_cpu_access access = {};
+        access.flags                    = flags;
+
+        if (ioctl(m_BufferFd, cmd, &access) < 0)
+        {
+            throw std::runtime_error(std::string("Failed to synchronise buffer: ") + strerror(errno));
+        }
+    }
+
     int m_BufferFd;
     uint8_t* m_Data;
     uint32_t m_Size;
     DataFormat m_Format;
+    bool m_IsMapped;
 };
 
 }    // namespace driver_library
@@ -0,0 +1,108 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "../include/ethosn_driver_library/CompletionQueue.hpp"
+#include "Utils.hpp"
+
+#include <uapi/ethosn.h>
+
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+namespace ethosn
+{
+namespace driver_library
+{
+
+class CompletionQueue::CompletionQueueImpl
+{
+public:
+    CompletionQueueImpl()
+    {
+        int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
+        if (ethosnFd < 0)
+        {
+            throw std::runtime_error(std::string("Unable to open ") +
+                                     std::string(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE)) + std::string(": ") +
+                                     strerror(errno));
+        }
+
+        m_Fd    = ioctl(ethosnFd, ETHOSN_IOCTL_CREATE_COMPLETION_QUEUE);
+        int err = errno;
+        close(ethosnFd);
+        if (m_Fd < 0)
+        {
+            throw std::runtime_error(std::string("Failed to create completion queue: ") + strerror(err));
+        }
+
+        // Reads never block, waiting is done with poll so that it can time out.
+        fcntl(m_Fd, F_SETFL, fcntl(m_Fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    ~CompletionQueueImpl()
+    {
+        close(m_Fd);
+    }
+
+    int GetFileDescriptor() const
+    {
+        return m_Fd;
+    }
+
+    std::vector<Completion> Reap(uint32_t maxCompletions, int timeoutMs)
+    {
+        std::vector<Completion> result;
+        if (maxCompletions == 0)
+        {
+            return result;
+        }
+
+        pollfd pollFd = { m_Fd, POLLIN, 0 };
+        int ret       = poll(&pollFd, 1, timeoutMs);
+        if (ret < 0)
+        {
+            throw std::runtime_error(std::string("Failed to wait for completions: ") + strerror(errno));
+        }
+        if (ret == 0)
+        {
+            return result;
+        }
+
+        std::vector<ethosn_completion> records(maxCompletions);
+        ssize_t numBytes = read(m_Fd, records.data(), records.size() * sizeof(ethosn_completion));
+        if (numBytes < 0)
+        {
+            if (errno == EAGAIN)
+            {
+                return result;
+            }
+            throw std::runtime_error(std::string("Failed to read completions: ") + strerror(errno));
+        }
+
+        size_t numRecords = static_cast<size_t>(numBytes) / sizeof(ethosn_completion);
+        result.reserve(numRecords);
+        for (size_t i = 0; i < numRecords; ++i)
+        {
+            result.push_back({ records[i].inference_fd, static_cast<InferenceResult>(records[i].status) });
+        }
+        return result;
+    }
+
+private:
+    int m_Fd;
+};
+
+}    // namespace driver_library
+}    // namespace ethosn
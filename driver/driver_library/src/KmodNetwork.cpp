@@ -13,6 +13,7 @@
 #include <ethosn_utils/Strings.hpp>
 #include <uapi/ethosn.h>
 
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <fstream>
@@ -202,6 +203,40 @@ Inference* KmodNetworkImpl::ScheduleInference(Buffer* const inputBuffers[],
     return new Inference(inference_fd);
 }
 
+void KmodNetworkImpl::SetCompletionQueue(CompletionQueue& completionQueue)
+{
+    int completionQueueFd = completionQueue.GetFileDescriptor();
+    if (ioctl(m_NetworkFd, ETHOSN_IOCTL_SET_COMPLETION_QUEUE, &completionQueueFd) < 0)
+    {
+        throw std::runtime_error(std::string("Failed to set completion queue: ") + strerror(errno));
+    }
+}
+
+LatencyStats KmodNetworkImpl::GetLatencyStats() const
+{
+    static_assert(static_cast<size_t>(LatencyStage::NumValues) == ETHOSN_LATENCY_STAGE_MAX,
+                  "LatencyStage out of sync with the kernel");
+    static_assert(g_NumLatencyBuckets == ETHOSN_LATENCY_NUM_BUCKETS, "Latency buckets out of sync with the kernel");
+
+    ethosn_latency_stats kernelStats;
+    if (ioctl(m_NetworkFd, ETHOSN_IOCTL_GET_LATENCY_STATS, &kernelStats) < 0)
+    {
+        throw std::runtime_error(std::string("Failed to get latency stats: ") + strerror(errno));
+    }
+
+    LatencyStats stats;
+    for (size_t i = 0; i < stats.m_Stages.size(); ++i)
+    {
+        const ethosn_stage_latency& kernelStage = kernelStats.stages[i];
+        StageLatency& stage                     = stats.m_Stages[i];
+        stage.m_Count                           = kernelStage.count;
+        stage.m_TotalNs                         = kernelStage.total_ns;
+        stage.m_MaxNs                           = kernelStage.max_ns;
+        std::copy(std::begin(kernelStage.histogram), std::end(kernelStage.histogram), stage.m_Histogram.begin());
+    }
+    return stats;
+}
+
 void KmodNetworkImpl::DumpIntermediateBuffers()
 {
     std::cout << "Dumping intermediate buffers..." << std::endl;
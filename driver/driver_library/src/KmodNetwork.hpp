@@ -24,6 +24,10 @@ public:
                                  Buffer* const outputBuffers[],
                                  uint32_t numOutputBuffers) const override;
 
+    void SetCompletionQueue(CompletionQueue& completionQueue) override;
+
+    LatencyStats GetLatencyStats() const override;
+
 private:
     void DumpIntermediateBuffers();
 
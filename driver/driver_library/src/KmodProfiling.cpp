@@ -24,25 +24,6 @@ namespace driver_library
 namespace profiling
 {
 
-namespace
-{
-
-struct TimeSync
-{
-    TimeSync()
-        : m_Valid(false)
-        , m_Delta(0)
-    {}
-
-    // True if the time delta is a valid value
-    bool m_Valid;
-    // Time delta between the host reference clock and the accelerator clock.
-    // We are disregarding any clock drift.
-    int64_t m_Delta;
-};
-
-}    // namespace
-
 int g_FirmwareBufferFd = 0;
 // Clock frequency expressed in MHz (it is provided by the kernel module).
 int g_ClockFrequencyMhz = 0;
@@ -102,7 +83,7 @@ bool ConfigureKernelDriver(Configuration config)
     return true;
 }
 
-uint64_t GetKernelDriverCounterValue(PollCounterName counter)
+uint64_t GetKernelDriverCounterValue(PollCounterName counter, uint32_t coreId)
 {
     int ethosnFd = open(ETHOSN_STRINGIZE_VALUE_OF(DEVICE_NODE), O_RDONLY);
     if (ethosnFd < 0)
@@ -120,112 +101,48 @@ uint64_t GetKernelDriverCounterValue(PollCounterName counter)
         case PollCounterName::KernelDriverNumMailboxMessagesReceived:
             kernelCounterName = ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED;
             break;
+        case PollCounterName::KernelDriverNumInferencesCompleted:
+            kernelCounterName = ETHOSN_POLL_COUNTER_NAME_INFERENCES_COMPLETED;
+            break;
+        case PollCounterName::KernelDriverBusyTimeMs:
+            kernelCounterName = ETHOSN_POLL_COUNTER_NAME_BUSY_TIME_MS;
+            break;
+        case PollCounterName::KernelDriverNumAffinityHits:
+            kernelCounterName = ETHOSN_POLL_COUNTER_NAME_AFFINITY_HITS;
+            break;
         default:
             assert(!"Invalid counter");
     }
 
-    int result = ioctl(ethosnFd, ETHOSN_IOCTL_GET_COUNTER_VALUE, &kernelCounterName);
+    // The core is selected by the upper bits of the counter name.
+    ethosn_counter_value counterValue = {};
+    counterValue.counter_name         = ETHOSN_POLL_COUNTER_FOR_CORE(static_cast<uint32_t>(kernelCounterName), coreId);
 
-    close(ethosnFd);
+    int result = ioctl(ethosnFd, ETHOSN_IOCTL_GET_COUNTER_VALUE_U64, &counterValue);
 
-    if (result < 0)
+    // Kernel modules without the 64-bit ioctl reject it, with EINVAL rather than ENOTTY before it was added.
+    // Fall back to the 32-bit ioctl, which returns the counter saturated at INT_MAX.
+    if (result < 0 && (errno == ENOTTY || errno == EINVAL))
     {
-        throw std::runtime_error(std::string("Unable to retrieve counter value. errno: ") + strerror(errno));
-    }
-
-    return result;
-}
-
-namespace
-{
-
-using EntryId = decltype(ethosn_profiling_entry::id);
-
-// Get time delta between firmware profiling and global profiling
-TimeSync GetTimeDelta(const std::vector<ProfilingEntry>& entries)
-{
-    using namespace std::chrono;
-    static_assert(sizeof(uint64_t) == sizeof(time_point<high_resolution_clock>), "Timestamp size does not match");
-
-    TimeSync retVal;
-    time_point<high_resolution_clock> timestamp = {};
-    uint64_t sync                               = 0;
-    uint8_t index                               = 0;
-    EntryId lastTimelineEventId                 = 0;
-
-    auto ResetSearchIndex = [&]() -> void {
-        sync                = 0;
-        index               = 0;
-        lastTimelineEventId = 0;
-    };
-
-    auto HandleTimelineEventInstant = [&](const ProfilingEntry& entry) -> void {
-        if (entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::FirmwareTimeSync)
+        uint32_t counterName = counterValue.counter_name;
+        result               = ioctl(ethosnFd, ETHOSN_IOCTL_GET_COUNTER_VALUE, &counterName);
+        if (result >= 0)
         {
-            DataUnion temp = {};
-            temp.m_Raw     = static_cast<uint32_t>(entry.m_MetadataValue);
-            if (index == 0)
-            {
-                timestamp           = entry.m_Timestamp;
-                lastTimelineEventId = static_cast<EntryId>(entry.m_Id);
-            }
-            else
-            {
-                ++lastTimelineEventId;
-                if (entry.m_Id != lastTimelineEventId)
-                {
-                    // The Ids of the four events containing part of the host CPU timestamp must be consecutive.
-                    ResetSearchIndex();
-                    return;
-                }
-            }
-
-            for (uint8_t i = 0; i < 2; ++i)
-            {
-                // The ETHOSN_MESSAGE_TIME_SYNC message is sent by the host CPU to the accelerator CPU.
-                // It contains the timestamp taken by the host CPU using the reference monotonic clock.
-                // This value is 64 bits long and it does not fit in the current data field of the
-                // ethosn_profiling_entry which is 32 bits long (note that the firmware uses 8 bits of
-                // the data field for the category).
-                // This value is split in two bytes chunks and spread across four events of type
-                // TIMELINE_EVENT_INSTANT.
-                sync |= static_cast<uint64_t>(temp.m_TimeSyncFields.m_TimeSyncData[i])
-                        << (8 * (sizeof(uint64_t) - 1 - index));
-                ++index;
-            }
-
-            if (index == sizeof(uint64_t))
-            {
-                // Time sync fully retrieved from 4 consecutive messages
-                // The timestamp of the message (i.e. PMU cycle count) is stored as the number of nanoseconds since the
-                // high_resolution_clock epoch. Convert this to actual nanoseconds based on the clock frequency
-                // before calculating the difference with the host CPU (also measured in nanoseconds).
-                retVal.m_Delta = sync - (1000 / g_ClockFrequencyMhz) * timestamp.time_since_epoch().count();
-                retVal.m_Valid = true;
-                ResetSearchIndex();
-                return;
-            }
+            counterValue.value = static_cast<uint64_t>(result);
         }
-    };
+    }
+    int ioctlErrno = errno;
+
+    close(ethosnFd);
 
-    // Update the global profiling entries
-    for (const ProfilingEntry& entry : entries)
+    if (result < 0)
     {
-        switch (entry.m_Type)
-        {
-            case ProfilingEntry::Type::TimelineEventInstant:
-                HandleTimelineEventInstant(entry);
-                break;
-            default:
-                break;
-        }
+        throw std::runtime_error(std::string("Unable to retrieve counter value. errno: ") + strerror(ioctlErrno));
     }
 
-    return retVal;
+    return counterValue.value;
 }
 
-}    // namespace
-
 int64_t g_ProfilingDelta = 0;
 
 // Append all firmware profiling entry to the global profiling.
@@ -260,7 +177,7 @@ bool AppendKernelDriverEntries()
         }
     }
 
-    TimeSync timeDelta = GetTimeDelta(entries);
+    TimeSync timeDelta = GetTimeDelta(entries, g_ClockFrequencyMhz);
     if (timeDelta.m_Valid)
     {
         g_ProfilingDelta = timeDelta.m_Delta;
@@ -268,16 +185,8 @@ bool AppendKernelDriverEntries()
 
     // Sync up firmware entries using g_ProfilingDelta and update global profiling entries with
     // correct timestamps
-    for (ProfilingEntry& entry : entries)
-    {
-        // The timestamp of the message (i.e. PMU cycle count) is stored as the number of nanoseconds since the
-        // high_resolution_clock epoch. Convert this to actual nanoseconds based on the clock frequency
-        // before calculating the difference with the host CPU (also measured in nanoseconds).
-        entry.m_Timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(
-            (1000 / g_ClockFrequencyMhz) * entry.m_Timestamp.time_since_epoch().count() + g_ProfilingDelta));
-
-        g_ProfilingEntries.push_back(entry);
-    }
+    ApplyTimeDelta(entries, g_ClockFrequencyMhz, g_ProfilingDelta);
+    g_ProfilingEntries.insert(g_ProfilingEntries.end(), entries.begin(), entries.end());
 
     return true;
 }
@@ -59,6 +59,16 @@ Inference* Network::ScheduleInference(Buffer* const inputBuffers[],
     return m_NetworkImpl->ScheduleInference(inputBuffers, numInputBuffers, outputBuffers, numOutputBuffers);
 }
 
+void Network::SetCompletionQueue(CompletionQueue& completionQueue)
+{
+    m_NetworkImpl->SetCompletionQueue(completionQueue);
+}
+
+LatencyStats Network::GetLatencyStats() const
+{
+    return m_NetworkImpl->GetLatencyStats();
+}
+
 void Network::SetDebugName(const char* name)
 {
     m_NetworkImpl->SetDebugName(name);
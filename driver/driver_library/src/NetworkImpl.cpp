@@ -19,6 +19,7 @@
 #include <iostream>
 #include <map>
 #include <numeric>
+#include <stdexcept>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -141,6 +142,16 @@ Inference* NetworkImpl::ScheduleInference(Buffer* const inputBuffers[],
     return new Inference(fileno(tempFile));
 }
 
+void NetworkImpl::SetCompletionQueue(CompletionQueue&)
+{
+    throw std::runtime_error("Completion queues are only supported by the kernel driver backend");
+}
+
+LatencyStats NetworkImpl::GetLatencyStats() const
+{
+    return LatencyStats();
+}
+
 void NetworkImpl::SetDebugName(const char* name)
 {
     m_DebugName = name;
@@ -6,7 +6,9 @@
 #pragma once
 
 #include "../include/ethosn_driver_library/Buffer.hpp"
+#include "../include/ethosn_driver_library/CompletionQueue.hpp"
 #include "../include/ethosn_driver_library/Inference.hpp"
+#include "../include/ethosn_driver_library/Network.hpp"
 
 #include <ethosn_support_library/Support.hpp>
 
@@ -33,6 +35,12 @@ public:
                                          Buffer* const outputBuffers[],
                                          uint32_t numOutputBuffers) const;
 
+    /// Completion queues need kernel support, so this base implementation throws.
+    virtual void SetCompletionQueue(CompletionQueue& completionQueue);
+
+    /// Latencies are measured by the kernel, so this base implementation returns empty statistics.
+    virtual LatencyStats GetLatencyStats() const;
+
     void SetDebugName(const char* name);
 
 protected:
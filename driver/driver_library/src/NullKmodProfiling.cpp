@@ -26,7 +26,7 @@ bool ConfigureKernelDriver(Configuration)
     return true;
 }
 
-uint64_t GetKernelDriverCounterValue(PollCounterName)
+uint64_t GetKernelDriverCounterValue(PollCounterName, uint32_t)
 {
     return 0;
 }
@@ -0,0 +1,259 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_driver_library/PassCorrelation.hpp"
+
+#include "ProfilingInternal.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace ethosn
+{
+namespace driver_library
+{
+namespace profiling
+{
+
+namespace
+{
+
+using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+uint64_t GetDramBytes(const support_library::MemoryStats& stats)
+{
+    return static_cast<uint64_t>(stats.m_DramParallel) + stats.m_DramNonParallel;
+}
+
+/// Finds the pass which generated the given command, or returns passes.size() if there isn't one
+/// (e.g. a dump command at the start of the command stream).
+size_t FindPass(const std::vector<support_library::PassCommandInfo>& passes, uint32_t commandIdx)
+{
+    auto it = std::upper_bound(passes.begin(), passes.end(), commandIdx,
+                               [](uint32_t idx, const support_library::PassCommandInfo& pass) {
+                                   return idx < pass.m_FirstCommandIdx;
+                               });
+    if (it == passes.begin() || commandIdx > std::prev(it)->m_LastCommandIdx)
+    {
+        return passes.size();
+    }
+    return static_cast<size_t>(std::prev(it) - passes.begin());
+}
+
+/// The span of time covered by the commands of a pass during a single inference.
+struct PassSpan
+{
+    bool m_Started = false;
+    bool m_Ended   = false;
+    TimePoint m_Start;
+    TimePoint m_End;
+};
+
+}    // namespace
+
+std::vector<PassCorrelation> CorrelatePassPerformance(const support_library::CompiledNetwork& compiledNetwork,
+                                                      const std::vector<ProfilingEntry>& entries,
+                                                      uint32_t dramBytesPerCycle,
+                                                      uint32_t coreId)
+{
+    const std::vector<support_library::PassCommandInfo>& passes = compiledNetwork.GetPassCommandInfos();
+
+    std::vector<PassCorrelation> result(passes.size());
+    std::vector<double> totalMeasuredNs(passes.size(), 0.0);
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        const support_library::PassStats& stats = passes[i].m_Stats;
+
+        PassCorrelation& pass     = result[i];
+        pass.m_PassIdx            = static_cast<uint32_t>(i);
+        pass.m_FirstCommandIdx    = passes[i].m_FirstCommandIdx;
+        pass.m_LastCommandIdx     = passes[i].m_LastCommandIdx;
+        pass.m_OperationIds       = passes[i].m_OperationIds;
+        pass.m_EstimatedDramBytes = GetDramBytes(stats.m_Input.m_MemoryStats) +
+                                    GetDramBytes(stats.m_Output.m_MemoryStats) +
+                                    GetDramBytes(stats.m_Weights.m_MemoryStats);
+        pass.m_EstimatedMceCycles = stats.m_Mce.m_CycleCount;
+        pass.m_EstimatedCycles    = std::max<uint64_t>(
+            pass.m_EstimatedMceCycles,
+            (pass.m_EstimatedDramBytes + dramBytesPerCycle - 1) / std::max(dramBytesPerCycle, 1U));
+    }
+
+    // Only consider the firmware events of the given core, in time order. The firmware only reports the bottom 8 bits
+    // of the command index so the full index is reconstructed by counting wrap-arounds since the start of the
+    // inference, relying on commands being started in command stream order, which only holds within a core.
+    std::vector<const ProfilingEntry*> firmwareEntries;
+    for (const ProfilingEntry& entry : entries)
+    {
+        if (entry.m_CoreId != coreId)
+        {
+            continue;
+        }
+        if (entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::FirmwareInference ||
+            entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::FirmwareCommand)
+        {
+            firmwareEntries.push_back(&entry);
+        }
+    }
+    std::stable_sort(firmwareEntries.begin(), firmwareEntries.end(),
+                     [](const ProfilingEntry* a, const ProfilingEntry* b) { return a->m_Timestamp < b->m_Timestamp; });
+
+    std::vector<PassSpan> spans(passes.size());
+    std::map<uint64_t, uint32_t> openCommands;
+    uint32_t commandIdxBase = 0;
+    int32_t lastCommandIdx8 = -1;
+
+    auto FinishInference = [&]() {
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            if (spans[i].m_Started && spans[i].m_Ended && spans[i].m_End >= spans[i].m_Start)
+            {
+                totalMeasuredNs[i] += static_cast<double>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(spans[i].m_End - spans[i].m_Start).count());
+                ++result[i].m_NumMeasurements;
+            }
+            spans[i] = PassSpan();
+        }
+        openCommands.clear();
+        commandIdxBase  = 0;
+        lastCommandIdx8 = -1;
+    };
+
+    for (const ProfilingEntry* entry : firmwareEntries)
+    {
+        if (entry->m_MetadataCategory == ProfilingEntry::MetadataCategory::FirmwareInference)
+        {
+            // Both the start and the end of an inference delimit the commands of the previous one.
+            FinishInference();
+            continue;
+        }
+
+        DataUnion data = {};
+        data.m_Raw     = static_cast<EntryData>(entry->m_MetadataValue);
+
+        if (entry->m_Type == ProfilingEntry::Type::TimelineEventStart)
+        {
+            const int32_t commandIdx8 = data.m_CommandFields.m_CommandIdx;
+            if (commandIdx8 < lastCommandIdx8)
+            {
+                commandIdxBase += 256;
+            }
+            lastCommandIdx8 = commandIdx8;
+
+            const uint32_t commandIdx = commandIdxBase + static_cast<uint32_t>(commandIdx8);
+            openCommands[entry->m_Id] = commandIdx;
+
+            size_t passIdx = FindPass(passes, commandIdx);
+            if (passIdx < passes.size() && !spans[passIdx].m_Started)
+            {
+                spans[passIdx].m_Started = true;
+                spans[passIdx].m_Start   = entry->m_Timestamp;
+            }
+        }
+        else if (entry->m_Type == ProfilingEntry::Type::TimelineEventEnd)
+        {
+            auto openIt = openCommands.find(entry->m_Id);
+            if (openIt == openCommands.end())
+            {
+                continue;
+            }
+            size_t passIdx = FindPass(passes, openIt->second);
+            openCommands.erase(openIt);
+            if (passIdx < passes.size())
+            {
+                spans[passIdx].m_Ended = true;
+                spans[passIdx].m_End   = std::max(spans[passIdx].m_End, entry->m_Timestamp);
+            }
+        }
+    }
+    // The inference end event may not have been captured, e.g. if the profiling buffer wrapped.
+    FinishInference();
+
+    // Scale the estimates so that they sum to the measured total, so the ratios are independent of the clock
+    // frequency and bandwidth assumed by the estimates.
+    double measuredSum  = 0.0;
+    double estimatedSum = 0.0;
+    for (PassCorrelation& pass : result)
+    {
+        if (pass.m_NumMeasurements > 0)
+        {
+            pass.m_MeasuredNs = totalMeasuredNs[pass.m_PassIdx] / pass.m_NumMeasurements;
+            measuredSum += pass.m_MeasuredNs;
+            estimatedSum += static_cast<double>(pass.m_EstimatedCycles);
+        }
+    }
+    for (PassCorrelation& pass : result)
+    {
+        if (pass.m_NumMeasurements > 0 && pass.m_EstimatedCycles > 0 && measuredSum > 0.0)
+        {
+            const double scaledEstimateNs =
+                static_cast<double>(pass.m_EstimatedCycles) * measuredSum / std::max(estimatedSum, 1.0);
+            pass.m_MispredictionRatio = pass.m_MeasuredNs / scaledEstimateNs;
+        }
+    }
+
+    return result;
+}
+
+void PrintPassCorrelation(const std::vector<PassCorrelation>& passes, std::ostream& outStream, uint32_t numWorstToFlag)
+{
+    // Rank the passes by how far their ratio is from 1, in either direction.
+    std::vector<const PassCorrelation*> ranked;
+    for (const PassCorrelation& pass : passes)
+    {
+        if (pass.m_MispredictionRatio > 0.0)
+        {
+            ranked.push_back(&pass);
+        }
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const PassCorrelation* a, const PassCorrelation* b) {
+        return std::fabs(std::log(a->m_MispredictionRatio)) > std::fabs(std::log(b->m_MispredictionRatio));
+    });
+    ranked.resize(std::min<size_t>(ranked.size(), numWorstToFlag));
+
+    outStream << std::left << std::setw(6) << "Pass" << std::setw(12) << "Commands" << std::setw(20) << "Operations"
+              << std::right << std::setw(14) << "DRAM bytes" << std::setw(12) << "MCE cycles" << std::setw(12)
+              << "Est cycles" << std::setw(14) << "Measured us" << std::setw(10) << "Ratio"
+              << "\n";
+
+    for (const PassCorrelation& pass : passes)
+    {
+        std::stringstream commands;
+        commands << pass.m_FirstCommandIdx << "-" << pass.m_LastCommandIdx;
+
+        std::stringstream operations;
+        for (uint32_t id : pass.m_OperationIds)
+        {
+            operations << (operations.tellp() > 0 ? "," : "") << id;
+        }
+
+        outStream << std::left << std::setw(6) << pass.m_PassIdx << std::setw(12) << commands.str() << std::setw(20)
+                  << operations.str() << std::right << std::setw(14) << pass.m_EstimatedDramBytes << std::setw(12)
+                  << pass.m_EstimatedMceCycles << std::setw(12) << pass.m_EstimatedCycles;
+        if (pass.m_NumMeasurements > 0)
+        {
+            outStream << std::fixed << std::setprecision(1) << std::setw(14) << pass.m_MeasuredNs / 1000.0
+                      << std::setprecision(2) << std::setw(10) << pass.m_MispredictionRatio;
+        }
+        else
+        {
+            outStream << std::setw(14) << "-" << std::setw(10) << "-";
+        }
+        if (std::find(ranked.begin(), ranked.end(), &pass) != ranked.end())
+        {
+            outStream << (pass.m_MispredictionRatio > 1.0 ? "  <-- under-estimated" : "  <-- over-estimated");
+        }
+        outStream << "\n";
+    }
+}
+
+}    // namespace profiling
+}    // namespace driver_library
+}    // namespace ethosn
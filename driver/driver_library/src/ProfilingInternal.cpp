@@ -5,10 +5,13 @@
 
 #include "ProfilingInternal.hpp"
 
+#include "CounterMultiplexer.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <vector>
 
@@ -25,9 +28,38 @@ uint64_t GetNextTimeLineEventId()
     return g_NextTimelineEventId;
 }
 
+/// Set while hardware counter multiplexing is enabled, see Configuration::m_MultiplexPeriod.
+std::unique_ptr<CounterMultiplexer> g_CounterMultiplexer;
+
+namespace
+{
+
+/// Returns config with m_HardwareCounters set to the given counters, which the kernel driver can count at once.
+Configuration WithHardwareCounters(Configuration config, const std::vector<HardwareCounters>& counters)
+{
+    assert(counters.size() <= 6);
+    config.m_NumHardwareCounters = static_cast<uint32_t>(counters.size());
+    std::copy(counters.begin(), counters.end(), config.m_HardwareCounters);
+    return config;
+}
+
+}    // namespace
+
 bool ApplyConfiguration(Configuration config)
 {
+    std::unique_ptr<CounterMultiplexer> multiplexer;
+    if (config.m_EnableProfiling && config.m_MultiplexPeriod > 0 && !config.m_MultiplexedHardwareCounters.empty())
+    {
+        multiplexer = std::make_unique<CounterMultiplexer>(config.m_MultiplexedHardwareCounters,
+                                                           config.m_MultiplexPeriod);
+        config      = WithHardwareCounters(config, multiplexer->GetActiveSet());
+    }
+
     bool hasKernelConfigureSucceeded = ConfigureKernelDriver(config);
+    if (hasKernelConfigureSucceeded)
+    {
+        g_CounterMultiplexer = std::move(multiplexer);
+    }
 
     if (hasKernelConfigureSucceeded && g_CurrentConfiguration.m_EnableProfiling && !config.m_EnableProfiling)
     {
@@ -61,8 +93,20 @@ Configuration GetConfigFromString(const char* str)
     {
         return Configuration();
     }
+    // Option names of the hardware counters, in HardwareCounters order.
+    static const std::string hwCounterNames[] = {
+        "busAccessRdTransfers", "busRdCompleteTransfers",  "busReadBeats",        "busReadTxfrStallCycles",
+        "busAccessWrTransfers", "busWrCompleteTransfers",  "busWriteBeats",       "busWriteTxfrStallCycles",
+        "busWriteStallCycles",  "busErrorCount",           "ncuMcuIcacheMiss",    "ncuMcuDcacheMiss",
+        "ncuMcuBusReadBeats",   "ncuMcuBusWriteBeats",
+    };
+    static_assert(sizeof(hwCounterNames) / sizeof(hwCounterNames[0]) ==
+                      static_cast<size_t>(HardwareCounters::NumValues),
+                  "hwCounterNames not in sync with HardwareCounters");
+
     Configuration config     = {};
     config.m_EnableProfiling = true;
+    std::vector<HardwareCounters> hwCounters;
     for (auto option : Split(str, ' '))
     {
         auto optionPair         = Split(option, '=');
@@ -72,90 +116,47 @@ Configuration GetConfigFromString(const char* str)
         {
             g_DumpFile = optionValue;
         }
+        else if (optionName == "traceFile")
+        {
+            g_TraceFile = optionValue;
+        }
         else if (optionName == "firmwareBufferSize")
         {
             config.m_FirmwareBufferSize = static_cast<uint32_t>(std::stoul(optionValue));
         }
+        else if (optionName == "multiplexPeriod")
+        {
+            config.m_MultiplexPeriod = static_cast<uint32_t>(std::stoul(optionValue));
+        }
         else if (optionName == "hwCounters")
         {
-            auto hwCounters = Split(optionValue, ',');
-            if (hwCounters.size() > 6)
+            hwCounters.clear();
+            for (auto counter : Split(optionValue, ','))
             {
-                std::cerr << "There can only be at most 6 hardware counters\n";
-                continue;
-            }
-            for (auto counter : hwCounters)
-            {
-                if (counter == "busAccessRdTransfers")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusAccessRdTransfers;
-                }
-                else if (counter == "busRdCompleteTransfers")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusRdCompleteTransfers;
-                }
-                else if (counter == "busReadBeats")
+                auto it = std::find(std::begin(hwCounterNames), std::end(hwCounterNames), counter);
+                if (it != std::end(hwCounterNames))
                 {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] = HardwareCounters::FirmwareBusReadBeats;
-                }
-                else if (counter == "busReadTxfrStallCycles")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusReadTxfrStallCycles;
-                }
-                else if (counter == "busAccessWrTransfers")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusAccessWrTransfers;
-                }
-                else if (counter == "busWrCompleteTransfers")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusWrCompleteTransfers;
-                }
-                else if (counter == "busWriteBeats")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] = HardwareCounters::FirmwareBusWriteBeats;
-                }
-                else if (counter == "busWriteTxfrStallCycles")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusWriteTxfrStallCycles;
-                }
-                else if (counter == "busWriteStallCycles")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareBusWriteStallCycles;
-                }
-                else if (counter == "busErrorCount")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] = HardwareCounters::FirmwareBusErrorCount;
-                }
-                else if (counter == "ncuMcuIcacheMiss")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareNcuMcuIcacheMiss;
-                }
-                else if (counter == "ncuMcuDcacheMiss")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareNcuMcuDcacheMiss;
-                }
-                else if (counter == "ncuMcuBusReadBeats")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareNcuMcuBusReadBeats;
-                }
-                else if (counter == "ncuMcuBusWriteBeats")
-                {
-                    config.m_HardwareCounters[config.m_NumHardwareCounters++] =
-                        HardwareCounters::FirmwareNcuMcuBusWriteBeats;
+                    hwCounters.push_back(static_cast<HardwareCounters>(it - std::begin(hwCounterNames)));
                 }
             }
         }
     }
+
+    if (config.m_MultiplexPeriod > 0)
+    {
+        config.m_MultiplexedHardwareCounters = hwCounters;
+    }
+    else if (hwCounters.size() > 6)
+    {
+        std::cerr << "There can only be at most 6 hardware counters, unless multiplexPeriod is set\n";
+    }
+    else
+    {
+        for (HardwareCounters counter : hwCounters)
+        {
+            config.m_HardwareCounters[config.m_NumHardwareCounters++] = counter;
+        }
+    }
     return config;
 }
 
@@ -176,6 +177,7 @@ Configuration GetDefaultConfiguration()
 }
 
 std::string g_DumpFile               = "";
+std::string g_TraceFile              = "";
 Configuration g_CurrentConfiguration = GetDefaultConfiguration();
 
 std::vector<ProfilingEntry> g_ProfilingEntries              = {};
@@ -201,7 +203,35 @@ std::vector<ProfilingEntry> ReportNewProfilingData()
     return res;
 }
 
+void UpdateCounterMultiplexing(size_t firstNewEntry)
+{
+    if (!g_CounterMultiplexer)
+    {
+        return;
+    }
+
+    firstNewEntry = std::min(firstNewEntry, g_ProfilingEntries.size());
+    if (!g_CounterMultiplexer->AddInference(g_ProfilingEntries.cbegin() + firstNewEntry, g_ProfilingEntries.cend()))
+    {
+        return;
+    }
+
+    std::vector<ProfilingEntry> samples =
+        g_CounterMultiplexer->GetScaledSamples(std::chrono::high_resolution_clock::now());
+    g_ProfilingEntries.insert(g_ProfilingEntries.end(), samples.begin(), samples.end());
+
+    if (!ConfigureKernelDriver(WithHardwareCounters(g_CurrentConfiguration, g_CounterMultiplexer->GetActiveSet())))
+    {
+        std::cerr << "Failed to rotate the multiplexed hardware counters\n";
+    }
+}
+
 uint64_t GetCounterValue(PollCounterName counter)
+{
+    return GetCounterValue(counter, 0);
+}
+
+uint64_t GetCounterValue(PollCounterName counter, uint32_t coreId)
 {
     if (!g_CurrentConfiguration.m_EnableProfiling)
     {
@@ -214,9 +244,12 @@ uint64_t GetCounterValue(PollCounterName counter)
             return g_BufferToLifetimeEventId.size();
         case PollCounterName::DriverLibraryNumLiveInferences:
             return g_InferenceToLifetimeEventId.size();
-        case PollCounterName::KernelDriverNumMailboxMessagesSent:    // Deliberate fallthrough
-        case PollCounterName::KernelDriverNumMailboxMessagesReceived:
-            return GetKernelDriverCounterValue(counter);
+        case PollCounterName::KernelDriverNumMailboxMessagesSent:        // Deliberate fallthrough
+        case PollCounterName::KernelDriverNumMailboxMessagesReceived:    // Deliberate fallthrough
+        case PollCounterName::KernelDriverNumInferencesCompleted:        // Deliberate fallthrough
+        case PollCounterName::KernelDriverBusyTimeMs:                    // Deliberate fallthrough
+        case PollCounterName::KernelDriverNumAffinityHits:
+            return GetKernelDriverCounterValue(counter, coreId);
         default:
             assert(!"Invalid counter");
             return 0;
@@ -253,12 +286,18 @@ const char* MetadataCategoryToCString(ProfilingEntry::MetadataCategory category)
             return "FirmwareWfeChecking";
         case ProfilingEntry::MetadataCategory::FirmwareTimeSync:
             return "FirmwareTimeSync";
+        case ProfilingEntry::MetadataCategory::FirmwareAgent:
+            return "FirmwareAgent";
+        case ProfilingEntry::MetadataCategory::FirmwareAgentStripe:
+            return "FirmwareAgentStripe";
         case ProfilingEntry::MetadataCategory::InferenceLifetime:
             return "InferenceLifetime";
         case ProfilingEntry::MetadataCategory::BufferLifetime:
             return "BufferLifetime";
         case ProfilingEntry::MetadataCategory::CounterValue:
             return "CounterValue";
+        case ProfilingEntry::MetadataCategory::ScaledCounterValue:
+            return "ScaledCounterValue";
         default:
             return nullptr;
     }
@@ -536,6 +575,100 @@ ProfilingEntry ConvertProfilingEntry(const ethosn_profiling_entry& kernelEntry)
     return result;
 }
 
+TimeSync GetTimeDelta(const std::vector<ProfilingEntry>& entries, int clockFrequencyMhz)
+{
+    using namespace std::chrono;
+    static_assert(sizeof(uint64_t) == sizeof(time_point<high_resolution_clock>), "Timestamp size does not match");
+
+    TimeSync retVal;
+    time_point<high_resolution_clock> timestamp = {};
+    uint64_t sync                               = 0;
+    uint8_t index                               = 0;
+    EntryId lastTimelineEventId                 = 0;
+
+    auto ResetSearchIndex = [&]() -> void {
+        sync                = 0;
+        index               = 0;
+        lastTimelineEventId = 0;
+    };
+
+    auto HandleTimelineEventInstant = [&](const ProfilingEntry& entry) -> void {
+        if (entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::FirmwareTimeSync)
+        {
+            DataUnion temp = {};
+            temp.m_Raw     = static_cast<uint32_t>(entry.m_MetadataValue);
+            if (index == 0)
+            {
+                timestamp           = entry.m_Timestamp;
+                lastTimelineEventId = static_cast<EntryId>(entry.m_Id);
+            }
+            else
+            {
+                ++lastTimelineEventId;
+                if (entry.m_Id != lastTimelineEventId)
+                {
+                    // The Ids of the four events containing part of the host CPU timestamp must be consecutive.
+                    ResetSearchIndex();
+                    return;
+                }
+            }
+
+            for (uint8_t i = 0; i < 2; ++i)
+            {
+                // The ETHOSN_MESSAGE_TIME_SYNC message is sent by the host CPU to the accelerator CPU.
+                // It contains the timestamp taken by the host CPU using the reference monotonic clock.
+                // This value is 64 bits long and it does not fit in the current data field of the
+                // ethosn_profiling_entry which is 32 bits long (note that the firmware uses 8 bits of
+                // the data field for the category).
+                // This value is split in two bytes chunks and spread across four events of type
+                // TIMELINE_EVENT_INSTANT.
+                sync |= static_cast<uint64_t>(temp.m_TimeSyncFields.m_TimeSyncData[i])
+                        << (8 * (sizeof(uint64_t) - 1 - index));
+                ++index;
+            }
+
+            if (index == sizeof(uint64_t))
+            {
+                // Time sync fully retrieved from 4 consecutive messages
+                // The timestamp of the message (i.e. PMU cycle count) is stored as the number of nanoseconds since the
+                // high_resolution_clock epoch. Convert this to actual nanoseconds based on the clock frequency
+                // before calculating the difference with the host CPU (also measured in nanoseconds).
+                retVal.m_Delta = sync - (1000 / clockFrequencyMhz) * timestamp.time_since_epoch().count();
+                retVal.m_Valid = true;
+                ResetSearchIndex();
+                return;
+            }
+        }
+    };
+
+    // Update the global profiling entries
+    for (const ProfilingEntry& entry : entries)
+    {
+        switch (entry.m_Type)
+        {
+            case ProfilingEntry::Type::TimelineEventInstant:
+                HandleTimelineEventInstant(entry);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return retVal;
+}
+
+void ApplyTimeDelta(std::vector<ProfilingEntry>& entries, int clockFrequencyMhz, int64_t delta)
+{
+    for (ProfilingEntry& entry : entries)
+    {
+        // The timestamp of the message (i.e. PMU cycle count) is stored as the number of nanoseconds since the
+        // high_resolution_clock epoch. Convert this to actual nanoseconds based on the clock frequency
+        // before calculating the difference with the host CPU (also measured in nanoseconds).
+        entry.m_Timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>(std::chrono::nanoseconds(
+            (1000 / clockFrequencyMhz) * entry.m_Timestamp.time_since_epoch().count() + delta));
+    }
+}
+
 }    // namespace profiling
 }    // namespace driver_library
 }    // namespace ethosn
@@ -37,6 +37,14 @@ inline uint64_t CreateCounterValue(uint64_t counterValue)
     return counterValue;
 }
 
+inline uint64_t CreateScaledCounterValue(uint64_t counterValue, float confidence)
+{
+    const uint64_t maxValue = (uint64_t(1) << impl::g_ScaledCounterConfidenceShift) - 1;
+    uint64_t value          = counterValue < maxValue ? counterValue : maxValue;
+    uint64_t fixedPoint     = static_cast<uint64_t>(confidence * 65535.0f + 0.5f);
+    return (fixedPoint << impl::g_ScaledCounterConfidenceShift) | value;
+}
+
 }    // namespace metadata
 
 Configuration GetConfigFromString(const char* str);
@@ -51,6 +59,8 @@ extern std::map<Inference*, uint64_t> g_InferenceToLifetimeEventId;
 /// If set, automatically dump profiling entries and counters to this file after each inference.
 /// Set by the environment variable parsed in GetDefaultConfiguration().
 extern std::string g_DumpFile;
+/// As g_DumpFile, but in the Chrome trace event format (see DumpChromeTrace).
+extern std::string g_TraceFile;
 
 /// ProfilingInternal functions
 /// @{
@@ -91,13 +101,16 @@ void RecordLifetimeEvent(T* object,
     entry.m_MetadataValue    = 0;
     g_ProfilingEntries.push_back(entry);
 }
+/// Feeds the entries appended to g_ProfilingEntries from firstNewEntry onwards, reported for one inference, to the
+/// hardware counter multiplexer, if enabled, and reconfigures the kernel driver when the sampled set changes.
+void UpdateCounterMultiplexing(size_t firstNewEntry);
 /// @}
 
 /// Implemented by the backend (model, kernel module etc.)
 /// in either KmodProfiling.cpp or NullKmodProfiling.cpp.
 /// @{
 bool ConfigureKernelDriver(Configuration config);
-uint64_t GetKernelDriverCounterValue(PollCounterName counter);
+uint64_t GetKernelDriverCounterValue(PollCounterName counter, uint32_t coreId);
 /// Append all entries reported by the kernel driver to the given vector.
 bool AppendKernelDriverEntries();
 /// @}
@@ -105,6 +118,26 @@ bool AppendKernelDriverEntries();
 ethosn_profiling_hw_counter_types ConvertHwCountersToKernel(HardwareCounters counter);
 ProfilingEntry ConvertProfilingEntry(const ethosn_profiling_entry& kernelEntry);
 
+struct TimeSync
+{
+    TimeSync()
+        : m_Valid(false)
+        , m_Delta(0)
+    {}
+
+    // True if the time delta is a valid value
+    bool m_Valid;
+    // Time delta between the host reference clock and the accelerator clock.
+    // We are disregarding any clock drift.
+    int64_t m_Delta;
+};
+
+/// Get time delta between firmware profiling and global profiling, from the time sync events in the given
+/// firmware entries (as returned by ConvertProfilingEntry).
+TimeSync GetTimeDelta(const std::vector<ProfilingEntry>& entries, int clockFrequencyMhz);
+/// Converts the timestamps of the given firmware entries from accelerator clock cycles to host time.
+void ApplyTimeDelta(std::vector<ProfilingEntry>& entries, int clockFrequencyMhz, int64_t delta);
+
 }    // namespace profiling
 }    // namespace driver_library
 }    // namespace ethosn
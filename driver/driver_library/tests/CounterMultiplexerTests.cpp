@@ -0,0 +1,179 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/CounterMultiplexer.hpp"
+#include "../src/ProfilingInternal.hpp"
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <map>
+
+using namespace ethosn::driver_library::profiling;
+
+namespace
+{
+
+std::vector<HardwareCounters> GetFirstCounters(uint32_t numCounters)
+{
+    std::vector<HardwareCounters> counters;
+    for (uint32_t i = 0; i < numCounters; ++i)
+    {
+        counters.push_back(static_cast<HardwareCounters>(i));
+    }
+    return counters;
+}
+
+/// The entries the firmware reports for one inference: a sample of `value` for each of the given counters.
+std::vector<ProfilingEntry> CreateSamples(const std::vector<HardwareCounters>& counters, uint64_t value)
+{
+    std::vector<ProfilingEntry> entries;
+    for (HardwareCounters counter : counters)
+    {
+        ProfilingEntry entry;
+        entry.m_Type             = ProfilingEntry::Type::CounterSample;
+        entry.m_Id               = static_cast<uint64_t>(ConvertHwCounterToCollated(counter));
+        entry.m_MetadataCategory = ProfilingEntry::MetadataCategory::CounterValue;
+        entry.m_MetadataValue    = metadata::CreateCounterValue(value);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+bool AddInference(CounterMultiplexer& multiplexer, const std::vector<ProfilingEntry>& entries)
+{
+    return multiplexer.AddInference(entries.begin(), entries.end());
+}
+
+std::map<HardwareCounters, ProfilingEntry> GetScaledSamples(const CounterMultiplexer& multiplexer)
+{
+    std::map<HardwareCounters, ProfilingEntry> samples;
+    for (const ProfilingEntry& entry : multiplexer.GetScaledSamples(std::chrono::high_resolution_clock::now()))
+    {
+        REQUIRE(entry.m_Type == ProfilingEntry::Type::CounterSample);
+        REQUIRE(entry.m_MetadataCategory == ProfilingEntry::MetadataCategory::ScaledCounterValue);
+        for (uint32_t i = 0; i < static_cast<uint32_t>(HardwareCounters::NumValues); ++i)
+        {
+            const HardwareCounters counter = static_cast<HardwareCounters>(i);
+            if (entry.m_Id == static_cast<uint64_t>(ConvertHwCounterToCollated(counter)))
+            {
+                samples[counter] = entry;
+            }
+        }
+    }
+    return samples;
+}
+
+}    // namespace
+
+TEST_CASE("CounterMultiplexer splits the counters into balanced sets")
+{
+    const std::vector<HardwareCounters> counters = GetFirstCounters(14);
+    CounterMultiplexer multiplexer(counters, 1);
+
+    // 14 counters need 3 sets of at most 6, which are dealt as 5, 5 and 4 rather than 6, 6 and 2.
+    std::vector<HardwareCounters> seen;
+    std::vector<size_t> setSizes;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const std::vector<HardwareCounters>& set = multiplexer.GetActiveSet();
+        setSizes.push_back(set.size());
+        seen.insert(seen.end(), set.begin(), set.end());
+        AddInference(multiplexer, {});
+    }
+    CHECK(setSizes == std::vector<size_t>{ 5, 5, 4 });
+
+    // Every counter is in exactly one set.
+    std::sort(seen.begin(), seen.end());
+    CHECK(seen == counters);
+
+    SECTION("A single set is never rotated")
+    {
+        CounterMultiplexer single(GetFirstCounters(6), 1);
+        CHECK(single.GetActiveSet().size() == 6);
+        CHECK(!AddInference(single, {}));
+        CHECK(!AddInference(single, {}));
+    }
+
+    SECTION("Invalid arguments")
+    {
+        CHECK_THROWS_AS(CounterMultiplexer({}, 1), std::invalid_argument);
+        CHECK_THROWS_AS(CounterMultiplexer(counters, 0), std::invalid_argument);
+        CHECK_THROWS_AS(CounterMultiplexer(counters, 1, 0), std::invalid_argument);
+    }
+}
+
+TEST_CASE("CounterMultiplexer rotates the active set every period inferences")
+{
+    const uint32_t period = 3;
+    CounterMultiplexer multiplexer(GetFirstCounters(13), period);
+
+    const std::vector<HardwareCounters> firstSet = multiplexer.GetActiveSet();
+    std::vector<std::vector<HardwareCounters>> sets;
+    for (uint32_t set = 0; set < 3; ++set)
+    {
+        sets.push_back(multiplexer.GetActiveSet());
+        for (uint32_t i = 0; i < period - 1; ++i)
+        {
+            CHECK(!AddInference(multiplexer, {}));
+            CHECK(multiplexer.GetActiveSet() == sets.back());
+        }
+        // The last inference of the period reports that the firmware needs reconfiguring.
+        CHECK(AddInference(multiplexer, {}));
+        CHECK(multiplexer.GetActiveSet() != sets.back());
+    }
+
+    // All the sets have been active once and the first is active again.
+    CHECK(sets[0] != sets[1]);
+    CHECK(sets[1] != sets[2]);
+    CHECK(sets[0] != sets[2]);
+    CHECK(multiplexer.GetActiveSet() == firstSet);
+}
+
+TEST_CASE("CounterMultiplexer scales the samples by the fraction of inferences they were sampled for")
+{
+    // Two sets of 4, rotating every inference.
+    CounterMultiplexer multiplexer(GetFirstCounters(8), 1, 4);
+    const std::vector<HardwareCounters> set0 = multiplexer.GetActiveSet();
+
+    // Counters that have never been active aren't reported.
+    CHECK(GetScaledSamples(multiplexer).empty());
+
+    // Samples of the counters of the other set, which the firmware was not configured with, are ignored.
+    std::vector<ProfilingEntry> entries = CreateSamples(GetFirstCounters(8), 10);
+    AddInference(multiplexer, entries);
+    const std::vector<HardwareCounters> set1 = multiplexer.GetActiveSet();
+    {
+        const std::map<HardwareCounters, ProfilingEntry> samples = GetScaledSamples(multiplexer);
+        REQUIRE(samples.size() == set0.size());
+        for (HardwareCounters counter : set0)
+        {
+            REQUIRE(samples.count(counter) == 1);
+            CHECK(samples.at(counter).GetScaledCounterValue() == 10);
+            CHECK(samples.at(counter).GetScaledCounterConfidence() == Approx(1.0f).margin(1e-4));
+        }
+    }
+
+    // Several samples for the same counter in one inference add up.
+    entries.insert(entries.end(), entries.begin(), entries.end());
+    AddInference(multiplexer, CreateSamples(set1, 7));
+    AddInference(multiplexer, entries);
+
+    // After 3 inferences, set0 was sampled for 2 of them and set1 for 1.
+    const std::map<HardwareCounters, ProfilingEntry> samples = GetScaledSamples(multiplexer);
+    REQUIRE(samples.size() == 8);
+    for (HardwareCounters counter : set0)
+    {
+        // (10 + 2 * 10) * 3 / 2
+        CHECK(samples.at(counter).GetScaledCounterValue() == 45);
+        CHECK(samples.at(counter).GetScaledCounterConfidence() == Approx(2.0f / 3.0f).margin(1e-4));
+    }
+    for (HardwareCounters counter : set1)
+    {
+        // 7 * 3 / 1
+        CHECK(samples.at(counter).GetScaledCounterValue() == 21);
+        CHECK(samples.at(counter).GetScaledCounterConfidence() == Approx(1.0f / 3.0f).margin(1e-4));
+    }
+}
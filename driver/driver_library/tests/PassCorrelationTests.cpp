@@ -0,0 +1,214 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_driver_library/PassCorrelation.hpp"
+
+#include <catch.hpp>
+
+#include <uapi/ethosn_shared.h>
+
+using namespace ethosn;
+using namespace ethosn::driver_library::profiling;
+
+namespace
+{
+
+/// A compiled network with only the pass command infos needed to correlate its passes.
+class FakeCompiledNetwork : public support_library::CompiledNetwork
+{
+public:
+    FakeCompiledNetwork(const std::vector<support_library::PassCommandInfo>& passes)
+        : m_Passes(passes)
+    {}
+
+    const std::set<uint32_t>& GetOperationIds() const override
+    {
+        return m_OperationIds;
+    }
+    const std::vector<support_library::PassCommandInfo>& GetPassCommandInfos() const override
+    {
+        return m_Passes;
+    }
+    const std::vector<support_library::InputBufferInfo>& GetInputBufferInfos() const override
+    {
+        return m_InputBufferInfos;
+    }
+    const std::vector<support_library::OutputBufferInfo>& GetOutputBufferInfos() const override
+    {
+        return m_OutputBufferInfos;
+    }
+    const std::vector<uint8_t>& GetConstantControlUnitData() const override
+    {
+        return m_Data;
+    }
+    const std::vector<uint8_t>& GetConstantDmaData() const override
+    {
+        return m_Data;
+    }
+    const std::vector<support_library::BufferInfo>& GetConstantControlUnitDataBufferInfos() const override
+    {
+        return m_BufferInfos;
+    }
+    const std::vector<support_library::BufferInfo>& GetConstantDmaDataBufferInfos() const override
+    {
+        return m_BufferInfos;
+    }
+    const std::vector<support_library::BufferInfo>& GetIntermediateDataBufferInfos() const override
+    {
+        return m_BufferInfos;
+    }
+    uint32_t GetIntermediateDataSize() const override
+    {
+        return 0;
+    }
+    const support_library::CompilationStats& GetCompilationStats() const override
+    {
+        return m_CompilationStats;
+    }
+    void Serialize(std::ostream&) const override
+    {}
+
+private:
+    std::vector<support_library::PassCommandInfo> m_Passes;
+    std::set<uint32_t> m_OperationIds;
+    std::vector<support_library::InputBufferInfo> m_InputBufferInfos;
+    std::vector<support_library::OutputBufferInfo> m_OutputBufferInfos;
+    std::vector<uint8_t> m_Data;
+    std::vector<support_library::BufferInfo> m_BufferInfos;
+    support_library::CompilationStats m_CompilationStats;
+};
+
+support_library::PassCommandInfo CreatePass(uint32_t firstCommandIdx, uint32_t lastCommandIdx, uint64_t mceCycles)
+{
+    support_library::PassCommandInfo pass;
+    pass.m_FirstCommandIdx          = firstCommandIdx;
+    pass.m_LastCommandIdx           = lastCommandIdx;
+    pass.m_Stats.m_Mce.m_CycleCount = static_cast<uint32_t>(mceCycles);
+    return pass;
+}
+
+/// Builds the firmware profiling entries of inferences running concurrently on several cores.
+class TraceBuilder
+{
+public:
+    using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+    /// Adds an inference starting at startUs on the given core, running numCommands[i] commands of commandUs[i]
+    /// microseconds each for each i, one after the other. The command indices are only reported modulo 256,
+    /// as the firmware does.
+    void AddInference(uint32_t coreId,
+                      uint64_t startUs,
+                      const std::vector<uint32_t>& numCommands,
+                      const std::vector<uint64_t>& commandUs)
+    {
+        TimePoint time = TimePoint(std::chrono::microseconds(startUs));
+        const uint64_t inferenceId = m_NextId++;
+        Add(coreId, time, ProfilingEntry::Type::TimelineEventStart, inferenceId, EntryDataCategory::Inference, 0);
+
+        uint32_t commandIdx = 0;
+        for (size_t i = 0; i < numCommands.size(); ++i)
+        {
+            for (uint32_t j = 0; j < numCommands[i]; ++j, ++commandIdx)
+            {
+                const uint64_t id = m_NextId++;
+                Add(coreId, time, ProfilingEntry::Type::TimelineEventStart, id, EntryDataCategory::Command,
+                    commandIdx);
+                time += std::chrono::microseconds(commandUs[i]);
+                Add(coreId, time, ProfilingEntry::Type::TimelineEventEnd, id, EntryDataCategory::Command,
+                    commandIdx);
+            }
+        }
+
+        Add(coreId, time, ProfilingEntry::Type::TimelineEventEnd, inferenceId, EntryDataCategory::Inference, 0);
+    }
+
+    /// The entries of all the cores, in time order as the driver library would report them.
+    std::vector<ProfilingEntry> GetEntries() const
+    {
+        std::vector<ProfilingEntry> entries = m_Entries;
+        std::stable_sort(entries.begin(), entries.end(), [](const ProfilingEntry& a, const ProfilingEntry& b) {
+            return a.m_Timestamp < b.m_Timestamp;
+        });
+        return entries;
+    }
+
+private:
+    void Add(uint32_t coreId,
+             TimePoint time,
+             ProfilingEntry::Type type,
+             uint64_t id,
+             EntryDataCategory category,
+             uint32_t commandIdx)
+    {
+        DataUnion data                    = {};
+        data.m_Category                   = category;
+        data.m_CommandFields.m_CommandIdx = static_cast<uint8_t>(commandIdx);
+
+        ProfilingEntry entry;
+        entry.m_Timestamp        = time;
+        entry.m_Type             = type;
+        entry.m_Id               = id;
+        entry.m_MetadataCategory = category == EntryDataCategory::Inference
+                                       ? ProfilingEntry::MetadataCategory::FirmwareInference
+                                       : ProfilingEntry::MetadataCategory::FirmwareCommand;
+        entry.m_MetadataValue    = data.m_Raw;
+        entry.m_CoreId           = coreId;
+        m_Entries.push_back(entry);
+    }
+
+    std::vector<ProfilingEntry> m_Entries;
+    uint64_t m_NextId = 1;
+};
+
+}    // namespace
+
+// The second pass goes past command 255, so its command indices wrap around. The inferences of the two cores overlap
+// in time, so their commands interleave.
+TEST_CASE("CorrelatePassPerformance measures the passes of one core")
+{
+    const FakeCompiledNetwork network({ CreatePass(0, 199, 1000), CreatePass(200, 299, 1000) });
+
+    TraceBuilder trace;
+    trace.AddInference(0, 0, { 200, 100 }, { 1, 3 });
+    trace.AddInference(0, 1000, { 200, 100 }, { 1, 3 });
+    trace.AddInference(1, 50, { 200, 100 }, { 2, 1 });
+    const std::vector<ProfilingEntry> entries = trace.GetEntries();
+
+    SECTION("Core 0")
+    {
+        const std::vector<PassCorrelation> passes = CorrelatePassPerformance(network, entries, 16, 0);
+        REQUIRE(passes.size() == 2);
+
+        CHECK(passes[0].m_NumMeasurements == 2);
+        CHECK(passes[1].m_NumMeasurements == 2);
+        CHECK(passes[0].m_MeasuredNs == Approx(200000.0));
+        CHECK(passes[1].m_MeasuredNs == Approx(300000.0));
+
+        // The passes have the same estimate, which is scaled to their total measured time.
+        CHECK(passes[0].m_MispredictionRatio == Approx(0.8));
+        CHECK(passes[1].m_MispredictionRatio == Approx(1.2));
+    }
+
+    SECTION("Core 1")
+    {
+        const std::vector<PassCorrelation> passes = CorrelatePassPerformance(network, entries, 16, 1);
+        REQUIRE(passes.size() == 2);
+
+        CHECK(passes[0].m_NumMeasurements == 1);
+        CHECK(passes[1].m_NumMeasurements == 1);
+        CHECK(passes[0].m_MeasuredNs == Approx(400000.0));
+        CHECK(passes[1].m_MeasuredNs == Approx(100000.0));
+    }
+
+    SECTION("A core without entries")
+    {
+        const std::vector<PassCorrelation> passes = CorrelatePassPerformance(network, entries, 16, 2);
+        REQUIRE(passes.size() == 2);
+
+        CHECK(passes[0].m_NumMeasurements == 0);
+        CHECK(passes[1].m_NumMeasurements == 0);
+        CHECK(passes[0].m_MispredictionRatio == 0.0);
+    }
+}
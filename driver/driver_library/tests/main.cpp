@@ -0,0 +1,7 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
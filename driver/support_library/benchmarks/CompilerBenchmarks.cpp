@@ -0,0 +1,335 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+// Benchmarks of the hot paths of the compiler, run on synthetic networks of configurable size.
+// Use e.g. --benchmark_out=results.json --benchmark_out_format=json to get machine-readable results.
+
+#include "../include/ethosn_support_library/Support.hpp"
+#include "../src/CapabilitiesInternal.hpp"
+#include "../src/Graph.hpp"
+#include "../src/GraphNodes.hpp"
+#include "../src/Network.hpp"
+#include "../src/Optimization.hpp"
+#include "../src/Utils.hpp"
+#include "../src/WeightEncoder.hpp"
+#include "../src/cascading/Cascading.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+enum class SyntheticNetworkType
+{
+    /// 3x3 convolutions, each followed by a relu.
+    ConvChain,
+    /// Depthwise 3x3 convolutions, each followed by a pointwise 1x1 convolution, as in MobileNet.
+    DepthwiseStack,
+    /// Bottleneck residual blocks (1x1, 3x3 and 1x1 convolutions plus a shortcut addition), as in ResNet.
+    ResidualBlocks,
+};
+
+/// Builds a synthetic network of the given type, with numLayers convolutions (or blocks) working on a
+/// (size x size x numChannels) tensor. The weights are pseudo-random but the same on every run.
+class SyntheticNetwork
+{
+public:
+    SyntheticNetwork(SyntheticNetworkType type, uint32_t numLayers, uint32_t numChannels, uint32_t size)
+        : m_Capabilities(GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77))
+        , m_Network(CreateNetwork(m_Capabilities))
+        , m_ActivationQuantInfo(0, 0.1f)
+        , m_WeightsQuantInfo(0, 0.01f)
+        , m_BiasQuantInfo(0, 0.001f)
+        , m_Random(1)
+    {
+        std::shared_ptr<Operand> x = AddInput(m_Network, TensorInfo({ 1, size, size, numChannels },
+                                                                    DataType::UINT8_QUANTIZED, DataFormat::NHWC,
+                                                                    m_ActivationQuantInfo))
+                                         .tensor;
+        for (uint32_t i = 0; i < numLayers; ++i)
+        {
+            switch (type)
+            {
+                case SyntheticNetworkType::ConvChain:
+                    x = AddRelu(m_Network, *AddConv(*x, 3, numChannels, false), ReluInfo(0, 255)).tensor;
+                    break;
+                case SyntheticNetworkType::DepthwiseStack:
+                    x = AddConv(*AddConv(*x, 3, numChannels, true), 1, numChannels, false);
+                    break;
+                case SyntheticNetworkType::ResidualBlocks:
+                {
+                    std::shared_ptr<Operand> y = AddConv(*x, 1, numChannels / 4, false);
+                    y                          = AddConv(*y, 3, numChannels / 4, false);
+                    y                          = AddConv(*y, 1, numChannels, false);
+                    x = AddRelu(m_Network, *AddAddition(m_Network, *x, *y, m_ActivationQuantInfo).tensor,
+                                ReluInfo(0, 255))
+                            .tensor;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        AddOutput(m_Network, *x);
+    }
+
+    const std::vector<char>& GetCapabilities() const
+    {
+        return m_Capabilities;
+    }
+
+    const Network& GetNetwork() const
+    {
+        return *m_Network;
+    }
+
+private:
+    std::shared_ptr<Operand> AddConv(Operand& input, uint32_t kernelSize, uint32_t numOutputChannels, bool depthwise)
+    {
+        const uint32_t numInputChannels = input.GetTensorInfo().m_Dimensions[3];
+
+        std::vector<uint8_t> weightsData(kernelSize * kernelSize * numInputChannels *
+                                         (depthwise ? 1 : numOutputChannels));
+        std::uniform_int_distribution<uint32_t> weightsDistribution(0, 255);
+        for (uint8_t& w : weightsData)
+        {
+            w = static_cast<uint8_t>(weightsDistribution(m_Random));
+        }
+        std::vector<int32_t> biasData(numOutputChannels);
+        std::uniform_int_distribution<int32_t> biasDistribution(0, 100);
+        for (int32_t& b : biasData)
+        {
+            b = biasDistribution(m_Random);
+        }
+
+        const TensorInfo weightsInfo({ kernelSize, kernelSize, numInputChannels, depthwise ? 1 : numOutputChannels },
+                                     DataType::UINT8_QUANTIZED, depthwise ? DataFormat::HWIM : DataFormat::HWIO,
+                                     m_WeightsQuantInfo);
+        const TensorInfo biasInfo({ 1, 1, 1, numOutputChannels }, DataType::INT32_QUANTIZED, DataFormat::NHWC,
+                                  m_BiasQuantInfo);
+        std::shared_ptr<Constant> weights = AddConstant(m_Network, weightsInfo, weightsData.data()).tensor;
+        std::shared_ptr<Constant> bias    = AddConstant(m_Network, biasInfo, biasData.data()).tensor;
+
+        const uint32_t pad = kernelSize / 2;
+        const ConvolutionInfo convInfo(Padding(pad, pad, pad, pad), Stride(1, 1), m_ActivationQuantInfo);
+        return depthwise ? AddDepthwiseConvolution(m_Network, input, *bias, *weights, convInfo).tensor
+                         : AddConvolution(m_Network, input, *bias, *weights, convInfo).tensor;
+    }
+
+    std::vector<char> m_Capabilities;
+    std::shared_ptr<Network> m_Network;
+    QuantizationInfo m_ActivationQuantInfo;
+    QuantizationInfo m_WeightsQuantInfo;
+    QuantizationInfo m_BiasQuantInfo;
+    std::mt19937 m_Random;
+};
+
+/// The benchmark arguments are: network type, number of layers (or blocks), number of channels and tensor size.
+SyntheticNetwork CreateSyntheticNetwork(const benchmark::State& state)
+{
+    return SyntheticNetwork(static_cast<SyntheticNetworkType>(state.range(0)), static_cast<uint32_t>(state.range(1)),
+                            static_cast<uint32_t>(state.range(2)), static_cast<uint32_t>(state.range(3)));
+}
+
+void SetLabel(benchmark::State& state)
+{
+    static const char* names[] = { "ConvChain", "DepthwiseStack", "ResidualBlocks" };
+    state.SetLabel(names[state.range(0)]);
+}
+
+/// The sizes of network that most benchmarks are run on, from small to large.
+void SyntheticNetworkArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({ "type", "layers", "channels", "size" });
+    for (int64_t type : { static_cast<int64_t>(SyntheticNetworkType::ConvChain),
+                          static_cast<int64_t>(SyntheticNetworkType::DepthwiseStack),
+                          static_cast<int64_t>(SyntheticNetworkType::ResidualBlocks) })
+    {
+        b->Args({ type, 4, 64, 56 });
+        b->Args({ type, 16, 64, 56 });
+        b->Args({ type, 4, 256, 28 });
+    }
+    b->Unit(benchmark::kMillisecond);
+}
+
+/// The cascading search grows quickly with the size of the network, so it is benchmarked on smaller ones.
+/// It doesn't support standalone PLE operations (e.g. the relus and additions of the other networks) yet.
+void CascadingSyntheticNetworkArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({ "type", "layers", "channels", "size" });
+    const int64_t type = static_cast<int64_t>(SyntheticNetworkType::DepthwiseStack);
+    b->Args({ type, 1, 16, 16 });
+    b->Args({ type, 2, 32, 16 });
+    b->Args({ type, 4, 32, 16 });
+    b->Unit(benchmark::kMillisecond);
+}
+
+void BM_Compile(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    for (auto _ : state)
+    {
+        std::vector<std::unique_ptr<CompiledNetwork>> compiledNetworks =
+            Compile(network.GetNetwork(), CompilationOptions());
+        if (compiledNetworks.empty())
+        {
+            state.SkipWithError("Compilation failed");
+            break;
+        }
+        benchmark::DoNotOptimize(compiledNetworks);
+    }
+    SetLabel(state);
+}
+BENCHMARK(BM_Compile)->Apply(SyntheticNetworkArgs);
+
+void BM_EstimatePerformance(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    for (auto _ : state)
+    {
+        NetworkPerformanceData perfData =
+            EstimatePerformance(network.GetNetwork(), CompilationOptions(), EstimationOptions());
+        benchmark::DoNotOptimize(perfData);
+    }
+    SetLabel(state);
+}
+BENCHMARK(BM_EstimatePerformance)->Apply(SyntheticNetworkArgs);
+
+void BM_OptimizeGraph(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    const HardwareCapabilities caps(GetValidCapabilities(network.GetCapabilities()));
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        Graph graph(network.GetNetwork(), caps, EstimationOptions());
+        state.ResumeTiming();
+
+        OptimizeGraph(graph);
+    }
+    SetLabel(state);
+}
+BENCHMARK(BM_OptimizeGraph)->Apply(SyntheticNetworkArgs);
+
+/// The creation of the passes is dominated by the stripe shape search of the strategies, which is repeated for every
+/// block config and set of nodes tried. This is most costly on deep MobileNet-like networks with large inputs.
+void CreatePassesArgs(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({ "type", "layers", "channels", "size" });
+    const int64_t type = static_cast<int64_t>(SyntheticNetworkType::DepthwiseStack);
+    b->Args({ type, 13, 64, 224 });
+    b->Args({ type, 13, 64, 640 });
+    b->Unit(benchmark::kMillisecond);
+}
+
+/// Times only the "CreatePasses" stage of the (non-cascading) compilation of the network.
+void BM_CreatePasses(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    CompilationOptions options;
+    for (auto _ : state)
+    {
+        CompilationStats stats;
+        options.m_CompilationStats = &stats;
+        std::vector<std::unique_ptr<CompiledNetwork>> compiledNetworks = Compile(network.GetNetwork(), options);
+        if (compiledNetworks.empty())
+        {
+            state.SkipWithError("Compilation failed");
+            break;
+        }
+
+        double createPassesMs = 0.0;
+        for (const CompilationStageStats& stage : stats.m_Stages)
+        {
+            if (stage.m_Name == "CreatePasses")
+            {
+                createPassesMs += stage.m_WallTimeMs;
+            }
+        }
+        state.SetIterationTime(createPassesMs / 1000.0);
+    }
+    SetLabel(state);
+}
+BENCHMARK(BM_CreatePasses)->Apply(CreatePassesArgs)->UseManualTime();
+
+/// Encodes the weights of every convolution in the network, each as a single stripe.
+void BM_WeightEncoderEncode(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    const HardwareCapabilities caps(GetValidCapabilities(network.GetCapabilities()));
+    Graph graph(network.GetNetwork(), caps, EstimationOptions());
+    std::unique_ptr<WeightEncoder> encoder = WeightEncoder::CreateWeightEncoder(caps);
+
+    // The algorithm is normally chosen when the passes are created, which this graph never goes through
+    std::vector<const MceOperationNode*> mceOperations;
+    for (const std::unique_ptr<Node>& node : graph.GetNodes())
+    {
+        MceOperationNode* mceOperation = dynamic_cast<MceOperationNode*>(node.get());
+        if (mceOperation)
+        {
+            mceOperation->SetAlgorithm(CompilerMceAlgorithm::Direct);
+            mceOperations.push_back(mceOperation);
+        }
+    }
+
+    int64_t numBytes = 0;
+    for (auto _ : state)
+    {
+        for (const MceOperationNode* mceOperation : mceOperations)
+        {
+            const uint32_t numOfms = mceOperation->GetShape()[3];
+            const uint32_t numIfms = mceOperation->GetInputShape(0)[3];
+            EncodedWeights encodedWeights =
+                encoder->Encode(*mceOperation, numOfms, numIfms, mceOperation->GetQuantizationInfo());
+            numBytes += static_cast<int64_t>(encodedWeights.m_Data.size());
+        }
+    }
+    state.SetBytesProcessed(numBytes);
+    SetLabel(state);
+}
+BENCHMARK(BM_WeightEncoderEncode)->Apply(SyntheticNetworkArgs);
+
+/// Combines the plans of the parts of the network, with the plans themselves created beforehand.
+void BM_Combiner(benchmark::State& state)
+{
+    const SyntheticNetwork network = CreateSyntheticNetwork(state);
+    const HardwareCapabilities caps(GetValidCapabilities(network.GetCapabilities()));
+    const CompilationOptions compilationOptions;
+    const EstimationOptions estimationOptions;
+
+    Graph graph(network.GetNetwork(), caps, estimationOptions);
+    OptimizeGraph(graph);
+    GraphOfParts graphOfParts = CreateGraphOfParts(graph, estimationOptions, compilationOptions, caps);
+    try
+    {
+        for (std::unique_ptr<Part>& part : graphOfParts.m_Parts)
+        {
+            part->CreatePlans();
+        }
+
+        for (auto _ : state)
+        {
+            Cascading cascading(estimationOptions, compilationOptions, caps);
+            Combinations combinations = cascading.Combine(graphOfParts);
+            benchmark::DoNotOptimize(combinations);
+        }
+    }
+    catch (const NotSupportedException& e)
+    {
+        state.SkipWithError(e.what());
+    }
+    SetLabel(state);
+}
+BENCHMARK(BM_Combiner)->Apply(CascadingSyntheticNetworkArgs);
+
+}    // namespace
+
+BENCHMARK_MAIN();
@@ -19,6 +19,7 @@
 #include <set>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <valarray>
 #include <vector>
 
@@ -66,6 +67,38 @@ enum class CompilerAlgorithm
 const char* EthosNCompilerAlgorithmAsString(CompilerAlgorithm mode);
 CompilerAlgorithm EthosNCompilerAlgorithmFromString(const char* mode);
 
+/// The wall time and the memory high-water mark of one stage of compiling or estimating a Network.
+struct CompilationStageStats
+{
+    std::string m_Name;
+    /// Total wall time spent in the stage, summed over every time it was entered.
+    double m_WallTimeMs = 0.0;
+    /// The highest resident set size of the process during any run of the stage, in bytes (0 where this is not
+    /// known or not sampled for the stage).
+    uint64_t m_PeakRssBytes = 0;
+    /// The most that the resident set size went up during a single run of the stage, in bytes.
+    uint64_t m_PeakRssIncreaseBytes = 0;
+};
+
+/// Statistics gathered while compiling or estimating a Network, see CompilationOptions::m_CompilationStats.
+struct CompilationStats
+{
+    /// The stages in the order they first finished. Some stages are part of others (e.g. "WeightEncoding" is done
+    /// during "CreatePasses" and "Generate"), so their times don't add up to the total.
+    std::vector<CompilationStageStats> m_Stages;
+    /// Number of plans generated by the cascading search, and how many of those were discarded as they don't fit in
+    /// SRAM.
+    uint64_t m_NumPlansGenerated = 0;
+    uint64_t m_NumPlansPruned    = 0;
+    /// Number of combinations of plans generated by the cascading search, and how many of those were discarded in
+    /// favour of a better one.
+    uint64_t m_NumCombinationsGenerated = 0;
+    uint64_t m_NumCombinationsPruned    = 0;
+    /// Total size of the weights encoded into the compiled network, in bytes. Weights which are only encoded to
+    /// estimate performance are not counted.
+    uint64_t m_EncodedWeightsBytes = 0;
+};
+
 struct CompilationOptions
 {
     enum class DebugLevel
@@ -112,14 +145,29 @@ struct CompilationOptions
     /// - for estimation: executing cascaded and non cascaded approach and returning
     ///                   the one which is the more performant
     CompilerAlgorithm m_CompilerAlgorithm = CompilerAlgorithm::NonCascadingOnly;
+    /// If set, this is reset and then filled in with statistics about each call to Compile or EstimatePerformance
+    /// made with these options. The overload of EstimatePerformance which estimates several configurations at once
+    /// doesn't fill it in.
+    CompilationStats* m_CompilationStats = nullptr;
 };
 
 /// Contains options for performance estimation
+/// The hardware capabilities don't describe the bandwidth of the DRAM of the system that the NPU is integrated in.
+/// Where an estimate needs one, e.g. to tell whether a layer is bound by its DRAM transfers, this typical value is
+/// assumed, in bytes per cycle of the NPU clock.
+constexpr uint32_t g_NominalDramBytesPerCycle = 16;
+
 struct EstimationOptions
 {
     /// The proportion of space saved with activation compression, where it can be used. (Default 0.0f indicates no compression)
     /// Appropriate values for this parameter are determined by network topology, weights and input data. Please contact Arm for more details.
     float m_ActivationCompressionSaving = 0.0f;
+    /// Measured proportions of space saved with activation compression for the outputs of individual operations,
+    /// keyed by operation id, which take precedence over m_ActivationCompressionSaving. These can be found by
+    /// compressing the intermediate tensors of the network when run on representative input data, as
+    /// compressibility varies a lot between layers (e.g. before and after a relu).
+    /// Where operations have been fused the saving of the last of them in the Network is used.
+    std::map<uint32_t, float> m_ActivationCompressionSavings;
     /// Switch to override the weight compression with the space saving proportion below
     bool m_UseWeightCompressionOverride = false;
     /// The proportion of space saved with weight compression if m_UseWeightCompressionOverride is set to true (0.0f indicates no compression)
@@ -128,6 +176,9 @@ struct EstimationOptions
     /// Switch to use "current" numbers which estimates the performance as measured with todays software.
     /// Default is to be using "future" estimates, i.e. possible future performance of the stack.
     bool m_Current = false;
+    /// Number of images which are run back to back through each pass, so that each stripe of weights is fetched once
+    /// and applied to all of them. The performance data is then given per image.
+    uint32_t m_BatchSize = 1;
 };
 
 struct MceStats
@@ -294,6 +345,28 @@ struct PassPerformanceData
     PassStats m_Stats;
 };
 
+/// Identifies the commands in the command stream of a CompiledNetwork which were generated for a single pass,
+/// together with the estimated performance of that pass. The firmware reports profiling events by command index,
+/// so this allows measured performance to be correlated with the estimates.
+struct PassCommandInfo
+{
+    PassCommandInfo()
+        : m_FirstCommandIdx(0)
+        , m_LastCommandIdx(0)
+        , m_OperationIds()
+        , m_Stats()
+    {}
+
+    /// The (inclusive) range of command indices that were generated for this pass.
+    /// @{
+    uint32_t m_FirstCommandIdx;
+    uint32_t m_LastCommandIdx;
+    /// @}
+    /// The set of operations from the input Network that are associated with this pass.
+    std::set<uint32_t> m_OperationIds;
+    PassStats m_Stats;
+};
+
 struct NetworkPerformanceData
 {
     /// The performance figures grouped into passes. Each pass will be associated with one or more operations
@@ -981,6 +1054,8 @@ public:
     /// Data for consumption by the user.
     /// @{
     virtual const std::set<uint32_t>& GetOperationIds() const = 0;
+    /// The commands and estimated performance of each pass, in command stream order.
+    virtual const std::vector<PassCommandInfo>& GetPassCommandInfos() const = 0;
     /// @}
 
     /// Data for consumption by both the user and the Ethos-N Driver Library.
@@ -1008,6 +1083,10 @@ public:
 
     virtual uint32_t GetIntermediateDataSize() const = 0;
 
+    /// Statistics gathered while compiling this network, if CompilationOptions::m_CompilationStats was set.
+    /// These are not serialized.
+    virtual const CompilationStats& GetCompilationStats() const = 0;
+
     virtual void Serialize(std::ostream&) const = 0;
 };
 
@@ -1102,11 +1181,36 @@ EthosNVariant EthosNVariantFromString(const char* ethosnType);
 // Optionally SRAM size can be overridden.
 std::vector<char> GetFwAndHwCapabilities(EthosNVariant variant, uint32_t sramSizeBytes = 0);
 
+// Call the Compiler to estimate the performance of the network on each of the given Ethos-N variants and SRAM sizes
+// (0 meaning the default SRAM size of the variant), e.g. to compare hardware configurations for a network.
+// Returns one NetworkPerformanceData per configuration, in the same order, as EstimatePerformance would for the
+// capabilities returned by GetFwAndHwCapabilities for that configuration.
+// The configurations are estimated in parallel and weights which are encoded the same way for several of them are
+// only encoded once, so this is much quicker than estimating each of them separately.
+// The network should be created with CreateEstimationNetwork so that it isn't restricted to the operations supported
+// by the capabilities it was created with.
+std::vector<NetworkPerformanceData>
+    EstimatePerformance(const Network& network,
+                        const CompilationOptions& compilationOptions,
+                        const EstimationOptions& estimationOptions,
+                        const std::vector<std::pair<EthosNVariant, uint32_t>>& configurations);
+
 // Deserialize a serialized CompiledNetwork from the specified input stream
 // If the versions used for serialization and deserialization are different
 //      an exception of type VersionMismatchException will be thrown.
 std::unique_ptr<CompiledNetwork> DeserializeCompiledNetwork(std::istream&);
 
+// Replace the weights and biases of a CompiledNetwork with those of the given Network, without compiling it again.
+// The Network must have the same operations, shapes and activation quantization as the Network that the
+//      CompiledNetwork was compiled from and only the data of its constants may differ. The CompilationOptions
+//      must be the same as those used to compile it.
+// The new weights are encoded using the same stripes as the original weights, and the constant data of the
+//      CompiledNetwork is updated in place.
+// An exception of type NotSupportedException will be thrown, leaving the CompiledNetwork unchanged, if the
+//      Network doesn't match or if the new weights of an operation no longer fit in the Sram that was allocated
+//      for them.
+void ReplaceWeights(CompiledNetwork& compiledNetwork, const Network& network, const CompilationOptions& options);
+
 /// Creates a new Network
 ///
 /// @param caps: An opaque block of data containing the capabilities of the hardware and the firmware.
@@ -0,0 +1,136 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "CompilationStats.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+// Like the DebuggingContext, this is thread_local so that networks can be compiled in parallel on different threads,
+// each recording into their own stats.
+static thread_local CompilationStats* s_CompilationStats = nullptr;
+
+ScopedCompilationStats::ScopedCompilationStats(CompilationStats* stats)
+    : m_Previous(s_CompilationStats)
+{
+    s_CompilationStats = stats;
+}
+
+ScopedCompilationStats::~ScopedCompilationStats()
+{
+    s_CompilationStats = m_Previous;
+}
+
+CompilationStats* GetCurrentCompilationStats()
+{
+    return s_CompilationStats;
+}
+
+// The innermost stage sampling the memory on the current thread.
+static thread_local ScopedCompilationStage* s_CurrentRssStage = nullptr;
+
+ScopedCompilationStage::ScopedCompilationStage(const char* name, bool sampleRss)
+    : m_Stats(s_CompilationStats)
+    , m_Name(name)
+    , m_SampleRss(sampleRss && m_Stats)
+    , m_Enclosing(nullptr)
+    , m_Start()
+    , m_StartRssBytes(0)
+    , m_PeakRssBytes(0)
+{
+    if (m_SampleRss)
+    {
+        m_Enclosing = s_CurrentRssStage;
+        if (m_Enclosing)
+        {
+            m_Enclosing->m_PeakRssBytes = std::max(m_Enclosing->m_PeakRssBytes, GetPeakRssBytes());
+        }
+        // Once reset, the high-water mark is the current resident set size. Where it can't be reset it is the peak
+        // of the whole process instead, so only an increase above that is seen.
+        ResetPeakRss();
+        m_StartRssBytes   = GetPeakRssBytes();
+        m_PeakRssBytes    = m_StartRssBytes;
+        s_CurrentRssStage = this;
+    }
+    if (m_Stats)
+    {
+        m_Start = std::chrono::steady_clock::now();
+    }
+}
+
+ScopedCompilationStage::~ScopedCompilationStage()
+{
+    if (!m_Stats)
+    {
+        return;
+    }
+    const std::chrono::duration<double, std::milli> wallTime = std::chrono::steady_clock::now() - m_Start;
+
+    auto stageIt = std::find_if(m_Stats->m_Stages.begin(), m_Stats->m_Stages.end(),
+                                [&](const CompilationStageStats& s) { return s.m_Name == m_Name; });
+    if (stageIt == m_Stats->m_Stages.end())
+    {
+        m_Stats->m_Stages.emplace_back();
+        stageIt         = m_Stats->m_Stages.end() - 1;
+        stageIt->m_Name = m_Name;
+    }
+    stageIt->m_WallTimeMs += wallTime.count();
+
+    if (m_SampleRss)
+    {
+        m_PeakRssBytes                  = std::max(m_PeakRssBytes, GetPeakRssBytes());
+        stageIt->m_PeakRssBytes         = std::max(stageIt->m_PeakRssBytes, m_PeakRssBytes);
+        stageIt->m_PeakRssIncreaseBytes = std::max(stageIt->m_PeakRssIncreaseBytes, m_PeakRssBytes - m_StartRssBytes);
+
+        if (m_Enclosing)
+        {
+            m_Enclosing->m_PeakRssBytes = std::max(m_Enclosing->m_PeakRssBytes, m_PeakRssBytes);
+        }
+        s_CurrentRssStage = m_Enclosing;
+    }
+}
+
+uint64_t GetPeakRssBytes()
+{
+#if defined(__unix__)
+    // The high-water mark of the resident set is reported by Linux as e.g. "VmHWM:     1234 kB".
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key)
+    {
+        if (key == "VmHWM:")
+        {
+            uint64_t kiloBytes = 0;
+            status >> kiloBytes;
+            return kiloBytes * 1024;
+        }
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+#endif
+    return 0;
+}
+
+bool ResetPeakRss()
+{
+#if defined(__unix__)
+    // Writing 5 to clear_refs resets VmHWM to VmRSS.
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+#else
+    return false;
+#endif
+}
+
+}    // namespace support_library
+}    // namespace ethosn
@@ -0,0 +1,67 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "../include/ethosn_support_library/Support.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+/// Makes the given stats the ones recorded into by the current thread, for as long as this object exists.
+/// A null pointer means nothing is recorded.
+class ScopedCompilationStats
+{
+public:
+    ScopedCompilationStats(CompilationStats* stats);
+    ~ScopedCompilationStats();
+    ScopedCompilationStats(const ScopedCompilationStats&) = delete;
+    ScopedCompilationStats& operator=(const ScopedCompilationStats&) = delete;
+
+private:
+    CompilationStats* m_Previous;
+};
+
+/// Returns the stats being recorded into by the current thread, or nullptr if there are none.
+CompilationStats* GetCurrentCompilationStats();
+
+/// Records the wall time and the memory high-water mark of a stage, from construction to destruction, into the
+/// current thread's stats. Entering a stage with the same name again accumulates into the same entry.
+/// Sampling the memory reads and resets the high-water mark of the process, so stages which are entered many times
+/// (e.g. once per pass) should only record their time. A stage inside another one passes its high-water mark on to
+/// the enclosing stage, so that resetting it doesn't hide the peak from the enclosing stage.
+class ScopedCompilationStage
+{
+public:
+    ScopedCompilationStage(const char* name, bool sampleRss = true);
+    ~ScopedCompilationStage();
+    ScopedCompilationStage(const ScopedCompilationStage&) = delete;
+    ScopedCompilationStage& operator=(const ScopedCompilationStage&) = delete;
+
+private:
+    CompilationStats* m_Stats;
+    const char* m_Name;
+    bool m_SampleRss;
+    ScopedCompilationStage* m_Enclosing;
+    std::chrono::steady_clock::time_point m_Start;
+    uint64_t m_StartRssBytes;
+    uint64_t m_PeakRssBytes;
+};
+
+/// Returns the peak resident set size of the process since it started or since the last ResetPeakRss(), in bytes,
+/// or 0 where this is not known.
+uint64_t GetPeakRssBytes();
+
+/// Resets the peak resident set size of the process to the current resident set size. Returns false where this is
+/// not supported (e.g. Linux before 4.0), in which case the peak keeps covering the whole life of the process.
+bool ResetPeakRss();
+
+}    // namespace support_library
+}    // namespace ethosn
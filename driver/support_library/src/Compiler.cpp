@@ -5,20 +5,25 @@
 
 #include "Compiler.hpp"
 
+#include "CompilationStats.hpp"
 #include "GraphNodes.hpp"
 #include "IEstimationStrategy.hpp"
 #include "Optimization.hpp"
 #include "SramAllocator.hpp"
 #include "cascading/Cascading.hpp"
+#include "cascading/EstimationUtils.hpp"
 #include "nonCascading/ConversionPass.hpp"
 #include "nonCascading/McePlePass.hpp"
 #include "nonCascading/NonCascading.hpp"
 #include "nonCascading/PlePass.hpp"
 #include "nonCascading/Section.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <numeric>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 
 namespace ethosn
@@ -117,7 +122,8 @@ std::vector<command_stream::BlockConfig> GenerateAllowedBlockConfigs(const Compi
 Compiler::Compiler(const Network& network,
                    const FirmwareAndHardwareCapabilities& fwAndHwCapabilities,
                    const CompilationOptions& compilationOptions,
-                   const EstimationOptions& estimationOptions)
+                   const EstimationOptions& estimationOptions,
+                   SharedWeightEncoderCache* sharedWeightEncoderCache)
     : m_Network(network)
     , m_AllowedStrategies(GenerateAllowedStrategies(compilationOptions))
     , m_AllowedBlockConfigs(GenerateAllowedBlockConfigs(compilationOptions))
@@ -126,6 +132,7 @@ Compiler::Compiler(const Network& network,
     , m_EnableCascading(false)
     , m_EstimationOptions(estimationOptions)
     , m_PerfEstimate(false)
+    , m_SharedWeightEncoderCache(sharedWeightEncoderCache)
 {
     SetDebuggingContext(DebuggingContext(&compilationOptions.m_DebugInfo));
 }
@@ -137,6 +144,8 @@ std::unique_ptr<CompiledNetwork> Compiler::Compile()
 {
     m_PerfEstimate = false;
 
+    ScopedCompilationStats scopedCompilationStats(ResetCompilationStats());
+
     try
     {
         Convert();
@@ -156,15 +165,40 @@ std::unique_ptr<CompiledNetwork> Compiler::Compile()
     // For now we're just passing the full network ids through.
     std::set<uint32_t> compiledOperationIds = m_Network.GetOperationIds();
 
+    // Record which commands each pass generated so that profiling data can be correlated with the estimates,
+    // and how the weights were encoded so that they can be replaced later.
+    std::vector<PassCommandInfo> passCommandInfos;
+    std::vector<WeightsEncodingInfo> weightsEncodingInfos;
+    for (const std::unique_ptr<Pass>& pass : m_Passes)
+    {
+        if (pass->IsGenerated())
+        {
+            passCommandInfos.push_back(pass->GetCommandInfo(m_EstimationOptions));
+
+            const McePlePass* mcePlePass = dynamic_cast<const McePlePass*>(pass.get());
+            if (mcePlePass)
+            {
+                weightsEncodingInfos.push_back(mcePlePass->GetWeightsEncodingInfo());
+            }
+        }
+    }
+    std::sort(passCommandInfos.begin(), passCommandInfos.end(),
+              [](const PassCommandInfo& a, const PassCommandInfo& b) {
+                  return a.m_FirstCommandIdx < b.m_FirstCommandIdx;
+              });
+
     std::unique_ptr<CompiledNetworkImpl> compiledNetwork = std::make_unique<CompiledNetworkImpl>(
         m_BufferManager.GetConstantDmaData(), m_BufferManager.GetConstantControlUnitData(),
-        m_BufferManager.GetBuffers(), compiledOperationIds);
+        m_BufferManager.GetBuffers(), compiledOperationIds, passCommandInfos, weightsEncodingInfos,
+        m_CompilationOptions.m_CompilationStats ? *m_CompilationOptions.m_CompilationStats : CompilationStats());
 
     return compiledNetwork;
 }
 
 NetworkPerformanceData Compiler::EstimatePerformance()
 {
+    ScopedCompilationStats scopedCompilationStats(ResetCompilationStats());
+
     bool nonCascadedPerformanceValid = false;
     bool cascadedPerformanceValid    = false;
     NetworkPerformanceData nonCascadedPerformance, cascadedPerformance;
@@ -246,6 +280,7 @@ NetworkPerformanceData Compiler::PrivateEstimatePerformance()
     {
         Optimize();
     }
+    ScopedCompilationStage stage("Estimate");
     if (!m_EnableCascading)
     {
         NonCascading nonCascadingEstimate(m_EstimationOptions, m_CompilationOptions, m_Capabilities);
@@ -260,8 +295,18 @@ NetworkPerformanceData Compiler::PrivateEstimatePerformance()
     return m_PerformanceStream;
 }
 
+CompilationStats* Compiler::ResetCompilationStats()
+{
+    if (m_CompilationOptions.m_CompilationStats)
+    {
+        *m_CompilationOptions.m_CompilationStats = CompilationStats();
+    }
+    return m_CompilationOptions.m_CompilationStats;
+}
+
 void Compiler::Convert()
 {
+    ScopedCompilationStage stage("Convert");
     m_Graph = Graph(m_Network, m_Capabilities, m_EstimationOptions, m_CompilationOptions.m_StrictPrecision);
 
     DumpGraph("GraphInitial");
@@ -269,6 +314,7 @@ void Compiler::Convert()
 
 void Compiler::Optimize()
 {
+    ScopedCompilationStage stage("Optimize");
     OptimizeGraph(m_Graph);
 }
 
@@ -381,6 +427,7 @@ bool Compiler::IsPrepared()
 
 void Compiler::CreatePasses()
 {
+    ScopedCompilationStage stage("CreatePasses");
     std::vector<IStrategy*> strategies = utils::GetRawPointers(m_AllowedStrategies);
     std::vector<Node*> sortedNodes     = m_Graph.GetNodesSorted();
     SramAllocator sramAllocator(m_Capabilities.GetTotalSramSize() / m_Capabilities.GetNumberOfSrams());
@@ -399,8 +446,8 @@ void Compiler::CreatePasses()
             if (!p)
             {
                 p = McePlePass::CreateGreedily(m_Capabilities, passId, strategies, m_AllowedBlockConfigs,
-                                               m_CompilationOptions.m_EnableIntermediateCompression,
-                                               !m_CompilationOptions.m_DisableWinograd, n, sramAllocator, forwardEst);
+                                               !m_CompilationOptions.m_DisableWinograd, n, sramAllocator,
+                                               m_SharedWeightEncoderCache);
             }
             if (!p)
             {
@@ -418,6 +465,85 @@ void Compiler::CreatePasses()
             n->PrepareAfterPassAssignment(sramAllocator);
         }
     }
+
+    if (m_CompilationOptions.m_EnableIntermediateCompression)
+    {
+        ChooseIntermediateCompressedFormats(forwardEst);
+    }
+}
+
+void Compiler::ChooseIntermediateCompressedFormats(bool forwardEst)
+{
+    // Only McePlePasses can write compressed outputs. Whether they can be compressed, and in which formats, depends
+    // on the stripes of both the pass writing them and of all the passes reading them, so this is chosen once all
+    // the passes have been created.
+    ScopedCompilationStage stage("ChooseIntermediateCompressedFormats");
+
+    const std::vector<CompilerDataCompressedFormat> candidateFormats =
+        m_Capabilities.GetActivationCompressionVersion() == 0
+            ? std::vector<CompilerDataCompressedFormat>{ CompilerDataCompressedFormat::NHWCB_COMPRESSED }
+            : std::vector<CompilerDataCompressedFormat>{ CompilerDataCompressedFormat::FCAF_DEEP,
+                                                         CompilerDataCompressedFormat::FCAF_WIDE };
+
+    for (const std::unique_ptr<Pass>& pass : m_Passes)
+    {
+        const McePlePass* producer = dynamic_cast<const McePlePass*>(pass.get());
+        if (producer == nullptr)
+        {
+            continue;
+        }
+        Node* outputNode = producer->GetNodes().back();
+
+        auto isCompatibleWithConsumers = [&](CompilerDataCompressedFormat format) {
+            for (const Edge* edge : outputNode->GetOutputs())
+            {
+                const Node* consumerNode = edge->GetDestination();
+                const Pass* consumer     = consumerNode->GetPass();
+                // The tensor must be read directly by the consumer pass, rather than e.g. by a concat or as the
+                // output of the network.
+                if (consumer == nullptr || consumer->GetNodes().front() != consumerNode)
+                {
+                    return false;
+                }
+                const McePlePass* mcePleConsumer = dynamic_cast<const McePlePass*>(consumer);
+                const bool isCompatible =
+                    mcePleConsumer != nullptr
+                        ? mcePleConsumer->IsInputCompressionFormatCompatible(format, forwardEst)
+                        // The firmware doesn't support loading FCAF formats from DRAM for OPERATION_CONVERT, and
+                        // PlePasses don't support compressed inputs.
+                        : dynamic_cast<const ConversionPass*>(consumer) != nullptr &&
+                              format == CompilerDataCompressedFormat::NHWCB_COMPRESSED;
+                if (!isCompatible)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Choose the compatible format that saves the most DRAM traffic, as the FCAF formats pad the tensor to
+        // whole cells. When compiling, the proportion of space saved by compressing the data isn't known so it is
+        // compressed whenever it can be. When estimating, it isn't compressed if that wouldn't save anything.
+        const float spaceSaving =
+            GetActivationCompressionSaving(outputNode->GetCorrespondingOperationIds(), m_EstimationOptions);
+        CompilerDataCompressedFormat bestFormat = CompilerDataCompressedFormat::NONE;
+        float bestSaving                        = m_PerfEstimate ? 0.0f : std::numeric_limits<float>::lowest();
+        for (CompilerDataCompressedFormat format : candidateFormats)
+        {
+            if (!producer->IsOutputCompressionFormatCompatible(format, forwardEst) ||
+                !isCompatibleWithConsumers(format))
+            {
+                continue;
+            }
+            const float saving = GetCompressedFormatSaving(outputNode->GetShape(), format, spaceSaving);
+            if (saving > bestSaving)
+            {
+                bestFormat = format;
+                bestSaving = saving;
+            }
+        }
+        outputNode->SetCompressedFormat(bestFormat);
+    }
 }
 
 void Compiler::CreateSections()
@@ -443,6 +569,7 @@ void Compiler::CreateSections()
 
 void Compiler::Generate()
 {
+    ScopedCompilationStage stage("Generate");
     const DebuggingContext& debuggingContext = GetConstDebuggingContext();
     std::vector<Node*> sorted                = m_Graph.GetNodesSorted();
 
@@ -488,10 +615,16 @@ void Compiler::DumpGraph(const std::string& filename)
 CompiledNetworkImpl::CompiledNetworkImpl(const std::vector<uint8_t>& constantDmaData,
                                          const std::vector<uint8_t>& constantControlUnitData,
                                          const std::map<uint32_t, CompilerBufferInfo>& buffers,
-                                         const std::set<uint32_t>& operationIds)
+                                         const std::set<uint32_t>& operationIds,
+                                         const std::vector<PassCommandInfo>& passCommandInfos,
+                                         const std::vector<WeightsEncodingInfo>& weightsEncodingInfos,
+                                         const CompilationStats& compilationStats)
     : m_ConstantDmaData(constantDmaData)
     , m_ConstantControlUnitData(constantControlUnitData)
     , m_OperationIds(operationIds)
+    , m_PassCommandInfos(passCommandInfos)
+    , m_WeightsEncodingInfos(weightsEncodingInfos)
+    , m_CompilationStats(compilationStats)
 {
     // Convert the set of buffers from the BufferManager into the format that CompiledNetwork exposes.
     for (auto internalBufferIt : buffers)
@@ -588,6 +721,27 @@ void CompiledNetworkImpl::Serialize(std::ostream& out) const
     Serialize(out, m_ConstantControlUnitDataBufferInfos);
     Serialize(out, m_ConstantDmaDataBufferInfos);
     Serialize(out, m_IntermediateDataBufferInfos);
+
+    // Serialize the pass command infos, flattening the operation ids into a separate vector.
+    // This section is optional so that networks serialized before it was added can still be de-serialized.
+    std::vector<SerializedPassCommandInfo> passCommandInfos;
+    std::vector<uint32_t> passOperationIds;
+    for (const PassCommandInfo& info : m_PassCommandInfos)
+    {
+        SerializedPassCommandInfo serialized;
+        serialized.m_FirstCommandIdx = info.m_FirstCommandIdx;
+        serialized.m_LastCommandIdx  = info.m_LastCommandIdx;
+        serialized.m_NumOperationIds = static_cast<uint32_t>(info.m_OperationIds.size());
+        serialized.m_Stats           = info.m_Stats;
+        passCommandInfos.push_back(serialized);
+        passOperationIds.insert(passOperationIds.end(), info.m_OperationIds.begin(), info.m_OperationIds.end());
+    }
+    Serialize(out, passCommandInfos);
+    Serialize(out, passOperationIds);
+
+    // Also optional, so that networks serialized before it was added can still be de-serialized,
+    // but their weights can't be replaced.
+    Serialize(out, m_WeightsEncodingInfos);
 }
 
 template <typename T>
@@ -635,6 +789,192 @@ void CompiledNetworkImpl::Deserialize(std::istream& in)
     Deserialize(in, m_ConstantControlUnitDataBufferInfos);
     Deserialize(in, m_ConstantDmaDataBufferInfos);
     Deserialize(in, m_IntermediateDataBufferInfos);
+
+    if (in.peek() != std::istream::traits_type::eof())
+    {
+        std::vector<SerializedPassCommandInfo> passCommandInfos;
+        std::vector<uint32_t> passOperationIds;
+        Deserialize(in, passCommandInfos);
+        Deserialize(in, passOperationIds);
+
+        auto operationIdIt = passOperationIds.begin();
+        for (const SerializedPassCommandInfo& serialized : passCommandInfos)
+        {
+            if (static_cast<size_t>(passOperationIds.end() - operationIdIt) < serialized.m_NumOperationIds)
+            {
+                throw std::runtime_error("Corrupt pass command infos in serialized Compiled Network");
+            }
+            PassCommandInfo info;
+            info.m_FirstCommandIdx = serialized.m_FirstCommandIdx;
+            info.m_LastCommandIdx  = serialized.m_LastCommandIdx;
+            info.m_OperationIds.insert(operationIdIt, operationIdIt + serialized.m_NumOperationIds);
+            info.m_Stats = serialized.m_Stats;
+            operationIdIt += serialized.m_NumOperationIds;
+            m_PassCommandInfos.push_back(std::move(info));
+        }
+    }
+
+    if (in.peek() != std::istream::traits_type::eof())
+    {
+        Deserialize(in, m_WeightsEncodingInfos);
+    }
+}
+
+namespace
+{
+
+BufferInfo& FindBuffer(std::vector<BufferInfo>& buffers, uint32_t bufferId)
+{
+    auto it = std::find_if(buffers.begin(), buffers.end(),
+                           [bufferId](const BufferInfo& buffer) { return buffer.m_Id == bufferId; });
+    if (it == buffers.end())
+    {
+        throw std::runtime_error("Compiled Network is missing buffer " + std::to_string(bufferId));
+    }
+    return *it;
+}
+
+std::string GetOperationIdsString(const Node& node)
+{
+    std::string result;
+    for (uint32_t id : node.GetCorrespondingOperationIds())
+    {
+        result += (result.empty() ? "" : ", ") + std::to_string(id);
+    }
+    return result;
+}
+
+bool MatchesEncodingInfo(const MceOperationNode& mceOperation, const WeightsEncodingInfo& info)
+{
+    const TensorInfo& weightsInfo                  = mceOperation.GetWeightsInfo();
+    const QuantizationInfo inputQuantizationInfo   = mceOperation.GetInputQuantizationInfo(0);
+    const QuantizationInfo& outputQuantizationInfo = mceOperation.GetQuantizationInfo();
+    return weightsInfo.m_Dimensions == info.m_WeightsShape && weightsInfo.m_DataFormat == info.m_WeightsFormat &&
+           weightsInfo.m_QuantizationInfo.GetZeroPoint() == info.m_WeightsZeroPoint &&
+           mceOperation.GetBiasInfo().m_Dimensions == info.m_BiasShape &&
+           inputQuantizationInfo.GetZeroPoint() == info.m_InputZeroPoint &&
+           inputQuantizationInfo.GetScale() == info.m_InputScale &&
+           outputQuantizationInfo.GetZeroPoint() == info.m_NodeOutputZeroPoint &&
+           outputQuantizationInfo.GetScale() == info.m_NodeOutputScale &&
+           mceOperation.GetStride().m_Y == info.m_StrideY && mceOperation.GetStride().m_X == info.m_StrideX &&
+           mceOperation.GetPadTop() == info.m_PaddingTop && mceOperation.GetPadLeft() == info.m_PaddingLeft &&
+           mceOperation.GetOperation() == info.m_Operation;
+}
+
+}    // namespace
+
+void CompiledNetworkImpl::ReplaceWeights(const Network& network,
+                                         const HardwareCapabilities& capabilities,
+                                         const CompilationOptions& compilationOptions)
+{
+    // The operation ids are not serialized, in which case only the MCE operations are checked.
+    if (!m_OperationIds.empty() && network.GetOperationIds() != m_OperationIds)
+    {
+        throw NotSupportedException("Network doesn't have the same operations as the compiled network");
+    }
+
+    // Convert the network in the same way as the Compiler does, up to the point where it first optimizes the graph.
+    // The nodes at this point have the same ids as during compilation. Nodes that the Compiler adds later on
+    // (e.g. identity depthwise convolutions) have weights which don't come from the network, so they stay the same.
+    Graph graph(network, capabilities, EstimationOptions(), compilationOptions.m_StrictPrecision);
+    OptimizeGraph(graph);
+
+    std::map<uint32_t, const MceOperationNode*> mceOperations;
+    for (const std::unique_ptr<Node>& node : graph.GetNodes())
+    {
+        const MceOperationNode* mceOperation = dynamic_cast<const MceOperationNode*>(node.get());
+        if (mceOperation)
+        {
+            mceOperations[static_cast<uint32_t>(mceOperation->GetId())] = mceOperation;
+        }
+    }
+    if (!mceOperations.empty() && m_WeightsEncodingInfos.empty())
+    {
+        throw NotSupportedException("Compiled network doesn't record how its weights were encoded. It must be "
+                                    "compiled again with this version of the Support Library");
+    }
+
+    // Encode all the new weights before modifying anything, so that nothing changes if any of them fail.
+    std::unique_ptr<WeightEncoder> weightEncoder = WeightEncoder::CreateWeightEncoder(capabilities);
+    std::map<uint32_t, std::vector<uint8_t>> newWeights;
+    std::map<uint32_t, std::vector<uint8_t>> newMetadata;
+    for (const WeightsEncodingInfo& info : m_WeightsEncodingInfos)
+    {
+        auto mceOperationIt = mceOperations.find(info.m_NodeId);
+        if (mceOperationIt == mceOperations.end())
+        {
+            continue;
+        }
+        const MceOperationNode& mceOperation = *mceOperationIt->second;
+
+        if (!MatchesEncodingInfo(mceOperation, info))
+        {
+            throw NotSupportedException(("Operation(s) " + GetOperationIdsString(mceOperation) +
+                                         " don't have the same structure as in the compiled network")
+                                            .c_str());
+        }
+
+        EncodedWeights encodedWeights = weightEncoder->Encode(
+            mceOperation.GetWeightsInfo(), mceOperation.GetWeightsData().data(), mceOperation.GetBiasInfo(),
+            mceOperation.GetBiasData().data(), QuantizationInfo(info.m_InputZeroPoint, info.m_InputScale),
+            QuantizationInfo(info.m_OutputZeroPoint, info.m_OutputScale), info.m_StripeDepth, info.m_StrideY,
+            info.m_StrideX, info.m_PaddingTop, info.m_PaddingLeft, info.m_IterationSize, info.m_Operation,
+            info.m_Algorithm);
+
+        // The Sram layout, including the space for each stripe of weights, is baked into the command stream.
+        const BufferInfo& metadataBuffer =
+            FindBuffer(m_ConstantControlUnitDataBufferInfos, info.m_WeightsMetadataBufferId);
+        if (encodedWeights.m_MaxSize > info.m_SramStripeSize ||
+            encodedWeights.m_Metadata.size() * sizeof(WeightsMetadata) != metadataBuffer.m_Size)
+        {
+            throw NotSupportedException(("New weights of operation(s) " + GetOperationIdsString(mceOperation) +
+                                         " don't fit in the Sram allocated for the original weights")
+                                            .c_str());
+        }
+
+        newWeights[info.m_WeightsBufferId] = std::move(encodedWeights.m_Data);
+        newMetadata[info.m_WeightsMetadataBufferId].assign(
+            reinterpret_cast<const uint8_t*>(encodedWeights.m_Metadata.data()),
+            reinterpret_cast<const uint8_t*>(encodedWeights.m_Metadata.data() + encodedWeights.m_Metadata.size()));
+    }
+
+    // The metadata has the same size as before, so it is always patched in place.
+    for (const auto& metadata : newMetadata)
+    {
+        const BufferInfo& buffer = FindBuffer(m_ConstantControlUnitDataBufferInfos, metadata.first);
+        std::copy(metadata.second.begin(), metadata.second.end(), m_ConstantControlUnitData.begin() + buffer.m_Offset);
+    }
+
+    // The Dma data is laid out again, in the same way as the BufferManager does, so that the result is the same as
+    // compiling the new network. This only moves buffers within it, as the command stream refers to them by id.
+    std::vector<BufferInfo*> buffers;
+    for (BufferInfo& buffer : m_ConstantDmaDataBufferInfos)
+    {
+        buffers.push_back(&buffer);
+    }
+    std::sort(buffers.begin(), buffers.end(),
+              [](const BufferInfo* a, const BufferInfo* b) { return a->m_Offset < b->m_Offset; });
+
+    std::vector<uint8_t> constantDmaData;
+    for (BufferInfo* buffer : buffers)
+    {
+        constantDmaData.resize(utils::RoundUpToNearestMultiple(constantDmaData.size(), g_DramBufferAlignment));
+        const uint32_t offset = static_cast<uint32_t>(constantDmaData.size());
+
+        auto weightsIt = newWeights.find(buffer->m_Id);
+        if (weightsIt != newWeights.end())
+        {
+            constantDmaData.insert(constantDmaData.end(), weightsIt->second.begin(), weightsIt->second.end());
+            buffer->m_Size = static_cast<uint32_t>(weightsIt->second.size());
+        }
+        else
+        {
+            constantDmaData.insert(constantDmaData.end(), m_ConstantDmaData.begin() + buffer->m_Offset,
+                                   m_ConstantDmaData.begin() + buffer->m_Offset + buffer->m_Size);
+        }
+        buffer->m_Offset = offset;
+    }
+    m_ConstantDmaData = std::move(constantDmaData);
 }
 
 template <typename T>
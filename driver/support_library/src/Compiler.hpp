@@ -8,6 +8,7 @@
 #include "DebuggingContext.hpp"
 #include "Graph.hpp"
 #include "Utils.hpp"
+#include "WeightEncoder.hpp"
 #include "nonCascading/BufferManager.hpp"
 
 #include <ethosn_command_stream/CommandStreamBuffer.hpp>
@@ -38,7 +39,8 @@ public:
     Compiler(const Network& network,
              const FirmwareAndHardwareCapabilities& fwAndHwCapabilities,
              const CompilationOptions& compilationOptions,
-             const EstimationOptions& estimationOptions);
+             const EstimationOptions& estimationOptions,
+             SharedWeightEncoderCache* sharedWeightEncoderCache = nullptr);
     Compiler(const Compiler&) = delete;
     Compiler& operator=(const Compiler&) = delete;
 
@@ -57,6 +59,7 @@ private:
     void Prepare();
     void Optimize();
     void CreatePasses();
+    void ChooseIntermediateCompressedFormats(bool forwardEst);
     bool IsPrepared();
     void CreateSections();
     ///@}
@@ -87,9 +90,18 @@ private:
     /// @{
     const EstimationOptions& m_EstimationOptions;
     bool m_PerfEstimate;
+    /// Weights encoded during estimation are shared through this, if given, with other Compilers estimating the
+    /// same Network.
+    SharedWeightEncoderCache* m_SharedWeightEncoderCache;
     NetworkPerformanceData PrivateEstimatePerformance();
     /// @}
 
+    /// Statistics
+    /// @{
+    /// Clears the stats requested by the CompilationOptions, if any, and returns them.
+    CompilationStats* ResetCompilationStats();
+    /// @}
+
     /// Intermediate data/results
     /// @{
     /// The internal graph of nodes. Modified as we progress through compilation.
@@ -124,12 +136,18 @@ public:
         , m_ConstantDmaDataBufferInfos()
         , m_IntermediateDataBufferInfos()
         , m_OperationIds()
+        , m_PassCommandInfos()
+        , m_WeightsEncodingInfos()
+        , m_CompilationStats()
     {}
 
     CompiledNetworkImpl(const std::vector<uint8_t>& constantDmaData,
                         const std::vector<uint8_t>& constantControlUnitData,
                         const std::map<uint32_t, CompilerBufferInfo>& buffers,
-                        const std::set<uint32_t>& operationIds);
+                        const std::set<uint32_t>& operationIds,
+                        const std::vector<PassCommandInfo>& passCommandInfos,
+                        const std::vector<WeightsEncodingInfo>& weightsEncodingInfos,
+                        const CompilationStats& compilationStats);
 
     virtual const std::vector<uint8_t>& GetConstantDmaData() const override
     {
@@ -146,6 +164,11 @@ public:
         return m_OperationIds;
     }
 
+    virtual const std::vector<PassCommandInfo>& GetPassCommandInfos() const override
+    {
+        return m_PassCommandInfos;
+    }
+
     virtual const std::vector<InputBufferInfo>& GetInputBufferInfos() const override
     {
         return m_InputBufferInfos;
@@ -173,6 +196,11 @@ public:
 
     virtual uint32_t GetIntermediateDataSize() const override;
 
+    virtual const CompilationStats& GetCompilationStats() const override
+    {
+        return m_CompilationStats;
+    }
+
     template <typename T>
     void Serialize(std::ostream& out, const std::vector<T>& data) const;
 
@@ -183,7 +211,28 @@ public:
 
     virtual void Deserialize(std::istream& in);
 
+    const std::vector<WeightsEncodingInfo>& GetWeightsEncodingInfos() const
+    {
+        return m_WeightsEncodingInfos;
+    }
+
+    /// Encodes the weights of the given Network, which must have the same structure as the one this was compiled
+    /// from, in the same way as the original weights and replaces them in the constant data.
+    /// This is left unchanged if anything fails.
+    void ReplaceWeights(const Network& network,
+                        const HardwareCapabilities& capabilities,
+                        const CompilationOptions& compilationOptions);
+
 private:
+    /// Trivially copyable form of PassCommandInfo, for serialization.
+    struct SerializedPassCommandInfo
+    {
+        uint32_t m_FirstCommandIdx;
+        uint32_t m_LastCommandIdx;
+        uint32_t m_NumOperationIds;
+        PassStats m_Stats;
+    };
+
     template <typename T>
     T Read(std::istream& in);
 
@@ -198,6 +247,13 @@ private:
 
     std::set<uint32_t> m_OperationIds;
     std::map<uint32_t, std::string> m_OperationIdsFailureReasons;
+
+    std::vector<PassCommandInfo> m_PassCommandInfos;
+
+    /// How the weights of each McePlePass were encoded, so that they can be replaced.
+    std::vector<WeightsEncodingInfo> m_WeightsEncodingInfos;
+
+    CompilationStats m_CompilationStats;
 };
 
 std::vector<std::unique_ptr<IStrategy>> GenerateAllowedStrategies(const CompilationOptions& m_Options);
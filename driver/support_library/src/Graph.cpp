@@ -41,7 +41,6 @@ Node::Node(NodeId id,
     , m_CompressionHint(CompressionHint::PreferCompressed)
     , m_FixGraphConvertOutputTo(CompilerDataFormat::NONE)
     , m_FixGraphLocationHint(LocationHint::PreferSram)
-    , m_FixGraphCompressionHint(CompressionHint::PreferCompressed)
     , m_Pass(nullptr)
     , m_Location(BufferLocation::None)
     , m_CompressionFormat(CompilerDataCompressedFormat::NONE)
@@ -286,13 +285,6 @@ bool Node::FixGraph(Graph& graph, FixGraphSeverity)
         m_FixGraphLocationHint = LocationHint::PreferSram;
         changed                = true;
     }
-    if (m_FixGraphCompressionHint == CompressionHint::RequiredUncompressed &&
-        m_FixGraphCompressionHint != m_CompressionHint)
-    {
-        SetCompressionHint(CompressionHint::RequiredUncompressed);
-        m_FixGraphCompressionHint = CompressionHint::PreferCompressed;
-        changed                   = true;
-    }
     if (m_FixGraphConvertOutputTo != CompilerDataFormat::NONE)
     {
         if (GetOutputs().size() == 1)    // Not supported for other cases
@@ -436,16 +428,6 @@ void Node::SetFixGraphLocationHint(LocationHint v)
     m_FixGraphLocationHint = v;
 }
 
-ethosn::support_library::CompressionHint Node::GetFixGraphCompressionHint() const
-{
-    return m_FixGraphCompressionHint;
-}
-
-void Node::SetFixGraphCompressionHint(CompressionHint v)
-{
-    m_FixGraphCompressionHint = v;
-}
-
 uint32_t Node::GetBufferId() const
 {
     return m_BufferId;
@@ -151,8 +151,6 @@ public:
     LocationHint GetFixGraphLocationHint() const;
     void SetFixGraphLocationHint(LocationHint v);
 
-    CompressionHint GetFixGraphCompressionHint() const;
-    void SetFixGraphCompressionHint(CompressionHint v);
     /// @}
 
     /// Preparation results
@@ -242,7 +240,6 @@ protected:
     // Fix graph hints
     CompilerDataFormat m_FixGraphConvertOutputTo;
     LocationHint m_FixGraphLocationHint;
-    CompressionHint m_FixGraphCompressionHint;
 
     // Set during preparation, but cleared after each iteration
     bool m_PreparationAttempted;
@@ -557,15 +557,9 @@ bool FormatConversionNode::FixGraph(Graph& graph, FixGraphSeverity severity)
         changed = true;
     }
 
-    // If we couldn't be assigned to a pass and our input is in FCAF format, then try forcing it to uncompressed
-    // as ConversionPass doesn't support FCAF and this change might allow that to work now.
-    if (m_Pass == nullptr && GetInputCompressed(0) &&
-        (GetInputCompressedFormat(0) == CompilerDataCompressedFormat::FCAF_DEEP ||
-         GetInputCompressedFormat(0) == CompilerDataCompressedFormat::FCAF_WIDE))
-    {
-        GetInput(0)->GetSource()->SetCompressionHint(CompressionHint::RequiredUncompressed);
-        changed = true;
-    }
+    // Our input can only be compressed if we were assigned to a ConversionPass that supports its format,
+    // see Compiler::ChooseIntermediateCompressedFormats.
+    assert(m_Pass != nullptr || !GetInputCompressed(0));
     return changed;
 }
 
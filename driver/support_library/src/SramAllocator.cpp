@@ -130,5 +130,15 @@ bool SramAllocator::IsEmpty()
     return m_UsedMemory.empty();
 }
 
+void SramAllocator::AppendFreeMemorySnapshot(std::vector<uint32_t>& snapshot) const
+{
+    snapshot.push_back(static_cast<uint32_t>(m_FreeMemory.size()));
+    for (const MemoryChunk& chunk : m_FreeMemory)
+    {
+        snapshot.push_back(chunk.m_Begin);
+        snapshot.push_back(chunk.m_End);
+    }
+}
+
 }    // namespace support_library
 }    // namespace ethosn
\ No newline at end of file
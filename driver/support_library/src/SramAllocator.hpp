@@ -66,6 +66,11 @@ public:
 
     bool IsEmpty();
 
+    // Appends the ranges of free memory to the given vector. Two allocators with the same free ranges
+    // will succeed or fail the same sequence of allocations at the same offsets, so this can be used
+    // as a key when caching decisions which depend on the allocator state.
+    void AppendFreeMemorySnapshot(std::vector<uint32_t>& snapshot) const;
+
 private:
     // Collapse regions of contiguous free memory into one chunk
     void CollapseRegions();
@@ -13,12 +13,16 @@
 
 #include <ethosn_utils/Json.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 using namespace ethosn::utils;
 
@@ -46,6 +50,32 @@ TensorsAndId GetMultipleOutputResult(const std::shared_ptr<Network>& network, Op
     return { tensors, op.GetId() };
 }
 
+void ValidateEstimationOptions(const CompilationOptions& compilationOptions, const EstimationOptions& estimationOptions)
+{
+    // Until full implementation of cascading in support library,
+    // available  only as future optimistic estimate. i.e m_Current = false.
+    if (compilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly &&
+        estimationOptions.m_Current == true)
+    {
+        throw NotSupportedException(
+            "Current performance and cascading modes are mutually exclusive. Please disable one or the other.");
+    }
+
+    if (estimationOptions.m_BatchSize == 0)
+    {
+        throw NotSupportedException("Batch size must be at least 1.");
+    }
+
+    for (const std::pair<const uint32_t, float>& saving : estimationOptions.m_ActivationCompressionSavings)
+    {
+        // Written so that NaN is rejected too.
+        if (!(saving.second >= 0.0f && saving.second <= 1.0f))
+        {
+            throw NotSupportedException("Activation compression savings must be between 0 and 1.");
+        }
+    }
+}
+
 }    // namespace
 
 Version::Version()
@@ -330,20 +360,79 @@ NetworkPerformanceData EstimatePerformance(const Network& network,
 {
     FirmwareAndHardwareCapabilities caps = GetValidCapabilities(network.GetCapabilities());
 
-    // Until full implementation of cascading in support library,
-    // available  only as future optimistic estimate. i.e m_Current = false.
-    if (compilationOptions.m_CompilerAlgorithm == CompilerAlgorithm::CascadingOnly &&
-        estimationOptions.m_Current == true)
-    {
-        throw NotSupportedException(
-            "Current performance and cascading modes are mutually exclusive. Please disable one or the other.");
-    }
+    ValidateEstimationOptions(compilationOptions, estimationOptions);
 
     Compiler compiler(network, caps, compilationOptions, estimationOptions);
 
     return compiler.EstimatePerformance();
 }
 
+std::vector<NetworkPerformanceData>
+    EstimatePerformance(const Network& network,
+                        const CompilationOptions& compilationOptions,
+                        const EstimationOptions& estimationOptions,
+                        const std::vector<std::pair<EthosNVariant, uint32_t>>& configurations)
+{
+    ValidateEstimationOptions(compilationOptions, estimationOptions);
+
+    std::vector<FirmwareAndHardwareCapabilities> caps;
+    for (const std::pair<EthosNVariant, uint32_t>& configuration : configurations)
+    {
+        caps.push_back(GetValidCapabilities(GetFwAndHwCapabilities(configuration.first, configuration.second)));
+    }
+
+    // Each configuration needs its own Graph as the conversion and preparation of the network depend on the
+    // capabilities, but nearly all of the time is spent encoding the weights, which only depends on a few of them.
+    SharedWeightEncoderCache sharedWeightEncoderCache;
+
+    // The stats of each configuration would be recorded concurrently into the same object, so none are recorded.
+    CompilationOptions configurationCompilationOptions = compilationOptions;
+    configurationCompilationOptions.m_CompilationStats = nullptr;
+
+    std::vector<NetworkPerformanceData> result(configurations.size());
+    std::vector<std::exception_ptr> errors(configurations.size());
+    std::atomic<size_t> nextConfiguration(0);
+
+    auto estimateConfigurations = [&]() {
+        for (size_t i = nextConfiguration++; i < configurations.size(); i = nextConfiguration++)
+        {
+            try
+            {
+                Compiler compiler(network, caps[i], configurationCompilationOptions, estimationOptions,
+                                  &sharedWeightEncoderCache);
+                result[i] = compiler.EstimatePerformance();
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    const size_t numThreads =
+        std::min<size_t>(configurations.size(), std::max(std::thread::hardware_concurrency(), 1U));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back(estimateConfigurations);
+    }
+    estimateConfigurations();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    return result;
+}
+
 void PrintNetworkPerformanceDataJson(std::ostream& os, uint32_t indentNumTabs, const NetworkPerformanceData& perfData)
 {
     Indent indent(indentNumTabs);
@@ -372,6 +461,20 @@ std::unique_ptr<CompiledNetwork> DeserializeCompiledNetwork(std::istream& in)
     return compiledNetwork;
 }
 
+void ReplaceWeights(CompiledNetwork& compiledNetwork, const Network& network, const CompilationOptions& options)
+{
+    CompiledNetworkImpl* compiledNetworkImpl = dynamic_cast<CompiledNetworkImpl*>(&compiledNetwork);
+    if (compiledNetworkImpl == nullptr)
+    {
+        throw NotSupportedException("Compiled Network was not created by the Support Library");
+    }
+
+    FirmwareAndHardwareCapabilities caps = GetValidCapabilities(network.GetCapabilities());
+    SetDebuggingContext(DebuggingContext(&options.m_DebugInfo));
+
+    compiledNetworkImpl->ReplaceWeights(network, HardwareCapabilities(caps), options);
+}
+
 const char* EthosNVariantAsString(EthosNVariant npuType)
 {
     switch (npuType)
@@ -400,6 +400,8 @@ class WeightEncoderV1 : public WeightEncoder
 public:
     WeightEncoderV1(const HardwareCapabilities& capabilities);
 
+    virtual bool DoEncodedOfmsDependOnStripeDepth() const override;
+
 protected:
     struct WeightCompressionParamsV1 : public WeightCompressionParams
     {
@@ -564,6 +566,13 @@ uint32_t WeightEncoderV2::GetOfmShiftOffset() const
     return 16;
 }
 
+bool WeightEncoderV2::DoEncodedOfmsDependOnStripeDepth() const
+{
+    // The number of OFMs processed in parallel, and when the compression parameters are reset, depend on the stripe
+    // depth.
+    return true;
+}
+
 uint32_t WeightEncoderV2::GetNumOfmInParallel(const uint32_t numOfm,
                                               const uint32_t numSrams,
                                               const uint32_t stripeDepth,
@@ -1549,6 +1558,31 @@ EncodedWeights WeightEncoder::Encode(const MceOperationNode& mceOperation,
     // clang-format on
 }
 
+static uint32_t GetNumOfms(const TensorInfo& weightsTensorInfo)
+{
+    uint32_t numOfms = 0;
+    if (weightsTensorInfo.m_DataFormat == DataFormat::HWIO)
+    {
+        numOfms = weightsTensorInfo.m_Dimensions[3];
+    }
+    else if (weightsTensorInfo.m_DataFormat == DataFormat::HWIM)
+    {
+        numOfms = weightsTensorInfo.m_Dimensions[2] * weightsTensorInfo.m_Dimensions[3];
+    }
+    else
+    {
+        assert(false);
+    }
+    return numOfms;
+}
+
+static uint32_t
+    GetNumIterationsOfm(const TensorInfo& weightsTensorInfo, uint32_t strideY, uint32_t strideX, uint32_t iterationSize)
+{
+    uint32_t ifmChannels = weightsTensorInfo.m_Dimensions[2] * strideX * strideY;
+    return weightsTensorInfo.m_DataFormat == DataFormat::HWIM ? 1 : utils::DivRoundUp(ifmChannels, iterationSize);
+}
+
 EncodedWeights WeightEncoder::Encode(const TensorInfo& weightsTensorInfo,
                                      const uint8_t* weightsData,
                                      const TensorInfo& biasTensorInfo,
@@ -1563,24 +1597,35 @@ EncodedWeights WeightEncoder::Encode(const TensorInfo& weightsTensorInfo,
                                      uint32_t iterationSize,
                                      ethosn::command_stream::MceOperation operation,
                                      CompilerMceAlgorithm algorithm)
+{
+    // clang-format off
+    return MergeEncodedOfms(EncodeOfms(weightsTensorInfo, weightsData, biasTensorInfo, biasData, inputQuantizationInfo,
+                                       outputQuantizationInfo, stripeDepth, strideY, strideX, paddingTop, paddingLeft,
+                                       iterationSize, operation, algorithm),
+                            weightsTensorInfo, stripeDepth, strideY, strideX, iterationSize);
+    // clang-format on
+}
+
+WeightEncoder::EncodedOfms WeightEncoder::EncodeOfms(const TensorInfo& weightsTensorInfo,
+                                                       const uint8_t* weightsData,
+                                                       const TensorInfo& biasTensorInfo,
+                                                       const int32_t* biasData,
+                                                       const QuantizationInfo& inputQuantizationInfo,
+                                                       const QuantizationInfo& outputQuantizationInfo,
+                                                       uint32_t stripeDepth,
+                                                       uint32_t strideY,
+                                                       uint32_t strideX,
+                                                       uint32_t paddingTop,
+                                                       uint32_t paddingLeft,
+                                                       uint32_t iterationSize,
+                                                       ethosn::command_stream::MceOperation operation,
+                                                       CompilerMceAlgorithm algorithm)
 {
     ETHOSN_UNUSED(biasTensorInfo);
     assert(stripeDepth > 0);
     assert(iterationSize > 0);
 
-    uint32_t numOfms = 0;
-    if (weightsTensorInfo.m_DataFormat == DataFormat::HWIO)
-    {
-        numOfms = weightsTensorInfo.m_Dimensions[3];
-    }
-    else if (weightsTensorInfo.m_DataFormat == DataFormat::HWIM)
-    {
-        numOfms = weightsTensorInfo.m_Dimensions[2] * weightsTensorInfo.m_Dimensions[3];
-    }
-    else
-    {
-        assert(false);
-    }
+    const uint32_t numOfms = GetNumOfms(weightsTensorInfo);
 
     // Bias dimensions should be valid
     assert((biasTensorInfo.m_Dimensions[0] * biasTensorInfo.m_Dimensions[1] * biasTensorInfo.m_Dimensions[2] == 1) &&
@@ -1592,27 +1637,23 @@ EncodedWeights WeightEncoder::Encode(const TensorInfo& weightsTensorInfo,
     assert(weightsTensorInfo.m_QuantizationInfo.GetZeroPoint() <= zeroPointBounds.max &&
            weightsTensorInfo.m_QuantizationInfo.GetZeroPoint() >= zeroPointBounds.min);
 
-    uint32_t ifmChannels = weightsTensorInfo.m_Dimensions[2] * strideX * strideY;
-    uint32_t numIterationsOfm =
-        weightsTensorInfo.m_DataFormat == DataFormat::HWIM ? 1 : utils::DivRoundUp(ifmChannels, iterationSize);
+    const uint32_t numIterationsOfm = GetNumIterationsOfm(weightsTensorInfo, strideY, strideX, iterationSize);
 
     // Number of Ofm processed in parallel which is the minimum number of
     // weights streams that need to be loaded at the same time for all the
     // mce interfaces to start producing an Ofm each.
-    uint32_t numSrams       = m_Capabilities.GetNumberOfSrams();
-    uint32_t numOfmsPerSram = m_Capabilities.GetNumberOfOfm() / numSrams;
-
     // The number of OFMs that can be processed in parallel is limited to the stripe depth
-    uint32_t numOfmInParallel =
-        GetNumOfmInParallel(m_Capabilities.GetNumberOfOfm(), numSrams, stripeDepth, weightsTensorInfo.m_DataFormat);
+    uint32_t numOfmInParallel = GetNumOfmInParallel(m_Capabilities.GetNumberOfOfm(), m_Capabilities.GetNumberOfSrams(),
+                                                    stripeDepth, weightsTensorInfo.m_DataFormat);
 
     std::vector<std::unique_ptr<WeightCompressionParams>> compressionParams =
         GenerateCompressionParams(numOfmInParallel);
 
     // Encode each OFM stream independently
-    std::vector<std::vector<uint8_t>> encodedStreams;
+    EncodedOfms encodedOfms;
+    std::vector<std::vector<uint8_t>>& encodedStreams = encodedOfms.m_Streams;
     encodedStreams.reserve(numOfms * numIterationsOfm);
-    std::vector<uint32_t> encodedNumBits;
+    std::vector<uint32_t>& encodedNumBits = encodedOfms.m_NumBits;
     encodedNumBits.reserve(numOfms * numIterationsOfm);
     const auto numWeightScales = weightsTensorInfo.m_QuantizationInfo.GetScales().size();
 
@@ -1644,6 +1685,28 @@ EncodedWeights WeightEncoder::Encode(const TensorInfo& weightsTensorInfo,
         encodedNumBits.push_back(encodedOfm.m_NumOfBits);
     }
 
+    return encodedOfms;
+}
+
+EncodedWeights WeightEncoder::MergeEncodedOfms(const EncodedOfms& encodedOfms,
+                                               const TensorInfo& weightsTensorInfo,
+                                               uint32_t stripeDepth,
+                                               uint32_t strideY,
+                                               uint32_t strideX,
+                                               uint32_t iterationSize) const
+{
+    const uint32_t numOfms          = GetNumOfms(weightsTensorInfo);
+    const uint32_t numIterationsOfm = GetNumIterationsOfm(weightsTensorInfo, strideY, strideX, iterationSize);
+
+    uint32_t numSrams       = m_Capabilities.GetNumberOfSrams();
+    uint32_t numOfmsPerSram = m_Capabilities.GetNumberOfOfm() / numSrams;
+    uint32_t numOfmInParallel =
+        GetNumOfmInParallel(m_Capabilities.GetNumberOfOfm(), numSrams, stripeDepth, weightsTensorInfo.m_DataFormat);
+
+    const std::vector<std::vector<uint8_t>>& encodedStreams = encodedOfms.m_Streams;
+    const std::vector<uint32_t>& encodedNumBits             = encodedOfms.m_NumBits;
+    assert(encodedStreams.size() == numOfms * numIterationsOfm);
+
     constexpr uint32_t dmaEngineAlignment = 16;
 
     // Merge the OFM streams together so that all the OFMs that will be processed in the same stripe
@@ -2382,6 +2445,12 @@ uint32_t WeightEncoderV1::GetOfmShiftOffset() const
     return 0;
 }
 
+bool WeightEncoderV1::DoEncodedOfmsDependOnStripeDepth() const
+{
+    // The same number of OFMs are processed in parallel, and share compression parameters, for any stripe depth.
+    return false;
+}
+
 std::pair<uint32_t, uint32_t> WeightEncoderV1::GetHwimWeightPadding(const bool usePadding,
                                                                     const uint32_t ifmIdx,
                                                                     const uint32_t numIfmsProcessedInParallel) const
@@ -2711,5 +2780,108 @@ std::vector<uint8_t> WeightEncoder::InterleaveStreams(const std::vector<std::vec
     return result;
 }
 
+bool SharedWeightEncoderCache::Params::operator==(const Params& r) const
+{
+    return numberOfEngines == r.numberOfEngines && numberOfOfm == r.numberOfOfm && numberOfSrams == r.numberOfSrams &&
+           ifmPerEngine == r.ifmPerEngine && weightCompressionVersion == r.weightCompressionVersion &&
+           weightsTensorInfo == r.weightsTensorInfo && weightsData == r.weightsData &&
+           biasTensorInfo == r.biasTensorInfo && biasData == r.biasData &&
+           inputQuantizationInfo == r.inputQuantizationInfo && outputQuantizationInfo == r.outputQuantizationInfo &&
+           stripeDepth == r.stripeDepth && strideY == r.strideY && strideX == r.strideX &&
+           paddingTop == r.paddingTop && paddingLeft == r.paddingLeft && iterationSize == r.iterationSize &&
+           operation == r.operation && algorithm == r.algorithm;
+}
+
+size_t SharedWeightEncoderCache::Hasher::operator()(const Params& p) const
+{
+    // Unlike the cache of a single Part, this holds the weights of every MceOperation in the network, many of which
+    // have the same shape, so some of the weight values are hashed too.
+    size_t h = 17;
+    h        = h * 37 + std::hash<size_t>()(p.weightsData.size());
+    h        = h * 37 + std::hash<size_t>()(p.biasData.size());
+    h        = h * 37 + std::hash<uint32_t>()(p.stripeDepth);
+    h        = h * 37 + std::hash<uint32_t>()(p.iterationSize);
+    h        = h * 37 + std::hash<uint32_t>()(static_cast<uint32_t>(p.algorithm));
+    const size_t numSampledWeights = std::min<size_t>(p.weightsData.size(), 64);
+    for (size_t i = 0; i < numSampledWeights; ++i)
+    {
+        h = h * 37 + p.weightsData[i * p.weightsData.size() / numSampledWeights];
+    }
+    return h;
+}
+
+EncodedWeights SharedWeightEncoderCache::Encode(WeightEncoder& encoder,
+                                                const HardwareCapabilities& capabilities,
+                                                const MceOperationNode& mceOperation,
+                                                uint32_t stripeDepth,
+                                                uint32_t stripeSize,
+                                                const QuantizationInfo& outputQuantizationInfo)
+{
+    // clang-format off
+    Params params{ capabilities.GetNumberOfEngines(),
+                   capabilities.GetNumberOfOfm(),
+                   capabilities.GetNumberOfSrams(),
+                   capabilities.GetIfmPerEngine(),
+                   capabilities.GetWeightCompressionVersion(),
+                   mceOperation.GetWeightsInfo(),
+                   mceOperation.GetWeightsData(),
+                   mceOperation.GetBiasInfo(),
+                   mceOperation.GetBiasData(),
+                   mceOperation.GetInputQuantizationInfo(0),
+                   outputQuantizationInfo,
+                   stripeDepth,
+                   mceOperation.GetStride().m_Y,
+                   mceOperation.GetStride().m_X,
+                   mceOperation.GetMceData().m_PadTop(),
+                   mceOperation.GetMceData().m_PadLeft(),
+                   stripeSize,
+                   mceOperation.GetMceData().m_Operation(),
+                   mceOperation.GetAlgorithm() };
+    // clang-format on
+
+    // The stripe depth is only part of the key if it changes the encoding of the OFMs. It is still needed to merge
+    // them below.
+    if (!encoder.DoEncodedOfmsDependOnStripeDepth())
+    {
+        params.stripeDepth = 0;
+    }
+
+    // Only the entries themselves are locked while encoding so that different weights can be encoded at once.
+    std::shared_ptr<Entry> entry;
+    const Params* key;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Entries.find(params);
+        if (it == m_Entries.end())
+        {
+            it = m_Entries.emplace(std::move(params), std::make_shared<Entry>()).first;
+        }
+        entry = it->second;
+        // References to the elements of an unordered_map stay valid when other elements are added.
+        key = &it->first;
+    }
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->isEncoded)
+    {
+        entry->encodedOfms =
+            encoder.EncodeOfms(key->weightsTensorInfo, key->weightsData.data(), key->biasTensorInfo,
+                               key->biasData.data(), key->inputQuantizationInfo, key->outputQuantizationInfo,
+                               stripeDepth, key->strideY, key->strideX, key->paddingTop, key->paddingLeft,
+                               key->iterationSize, key->operation, key->algorithm);
+        entry->isEncoded = true;
+        ++m_NumEncodes;
+    }
+
+    auto encodedWeightsIt = entry->encodedWeights.find(stripeDepth);
+    if (encodedWeightsIt == entry->encodedWeights.end())
+    {
+        EncodedWeights encodedWeights = encoder.MergeEncodedOfms(
+            entry->encodedOfms, key->weightsTensorInfo, stripeDepth, key->strideY, key->strideX, key->iterationSize);
+        encodedWeightsIt = entry->encodedWeights.emplace(stripeDepth, std::move(encodedWeights)).first;
+    }
+    return encodedWeightsIt->second;
+}
+
 }    // namespace support_library
 }    // namespace ethosn
@@ -8,8 +8,12 @@
 #include "GraphNodes.hpp"
 #include "Network.hpp"
 
+#include <atomic>
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace ethosn
@@ -37,6 +41,46 @@ struct EncodedWeights
     std::vector<uint8_t> m_Data;
 };
 
+/// Everything apart from the weight and bias data which determined how the weights of an MceOperationNode were
+/// encoded, so that different weights can later be encoded in the same way without compiling the network again.
+/// This is trivially copyable so that it can be serialized along with the CompiledNetwork.
+struct WeightsEncodingInfo
+{
+    /// Id of the MceOperationNode in the Graph converted from the Network.
+    uint32_t m_NodeId;
+    uint32_t m_WeightsBufferId;
+    uint32_t m_WeightsMetadataBufferId;
+
+    /// Properties of the MceOperationNode which must be unchanged for new weights to be encoded.
+    /// @{
+    TensorShape m_WeightsShape;
+    DataFormat m_WeightsFormat;
+    int32_t m_WeightsZeroPoint;
+    TensorShape m_BiasShape;
+    int32_t m_InputZeroPoint;
+    float m_InputScale;
+    int32_t m_NodeOutputZeroPoint;
+    float m_NodeOutputScale;
+    /// @}
+
+    /// The remaining arguments given to WeightEncoder::Encode.
+    /// @{
+    int32_t m_OutputZeroPoint;
+    float m_OutputScale;
+    uint32_t m_StripeDepth;
+    uint32_t m_StrideY;
+    uint32_t m_StrideX;
+    uint32_t m_PaddingTop;
+    uint32_t m_PaddingLeft;
+    uint32_t m_IterationSize;
+    ethosn::command_stream::MceOperation m_Operation;
+    CompilerMceAlgorithm m_Algorithm;
+    /// @}
+
+    /// Space allocated in Sram for each stripe of weights.
+    uint32_t m_SramStripeSize;
+};
+
 class WeightEncoder
 {
 public:
@@ -77,6 +121,42 @@ public:
                           ethosn::command_stream::MceOperation operation,
                           CompilerMceAlgorithm algorithm);
 
+    /// The weights of each OFM encoded separately, in the order they are merged into stripes.
+    struct EncodedOfms
+    {
+        std::vector<std::vector<uint8_t>> m_Streams;
+        std::vector<uint32_t> m_NumBits;
+    };
+
+    /// The two halves of Encode: encoding the weights of each OFM and then merging them into stripes and SRAMs.
+    /// @{
+    EncodedOfms EncodeOfms(const TensorInfo& weightsTensorInfo,
+                           const uint8_t* weightsData,
+                           const TensorInfo& biasTensorInfo,
+                           const int32_t* biasData,
+                           const QuantizationInfo& inputQuantizationInfo,
+                           const QuantizationInfo& outputQuantizationInfo,
+                           uint32_t stripeDepth,
+                           uint32_t strideY,
+                           uint32_t strideX,
+                           uint32_t paddingTop,
+                           uint32_t paddingLeft,
+                           uint32_t iterationSize,
+                           ethosn::command_stream::MceOperation operation,
+                           CompilerMceAlgorithm algorithm);
+
+    EncodedWeights MergeEncodedOfms(const EncodedOfms& encodedOfms,
+                                    const TensorInfo& weightsTensorInfo,
+                                    uint32_t stripeDepth,
+                                    uint32_t strideY,
+                                    uint32_t strideX,
+                                    uint32_t iterationSize) const;
+    /// @}
+
+    /// Whether the result of EncodeOfms depends on the stripe depth. If it doesn't then the same EncodedOfms
+    /// can be merged for any stripe depth.
+    virtual bool DoEncodedOfmsDependOnStripeDepth() const = 0;
+
 protected:
     struct EncodingParams
     {
@@ -194,5 +274,76 @@ protected:
     const HardwareCapabilities& m_Capabilities;
 };
 
+/// Remembers the weights encoded for MceOperationNodes so that the same weights encoded in the same way are only
+/// encoded once. Unlike the WeightEncoderCache used for the cascading plans, this can be shared between Compilers
+/// for different hardware capabilities (e.g. when estimating the performance of a network for several SRAM sizes)
+/// and between threads. The capabilities are only part of the key where they affect the encoding.
+/// The OFMs are cached before they are merged into stripes so that, where the encoder allows it, weights which are
+/// only split into stripes of a different depth don't need to be encoded again.
+class SharedWeightEncoderCache
+{
+public:
+    /// Equivalent to encoder.Encode(mceOperation, stripeDepth, stripeSize, outputQuantizationInfo), where the
+    /// encoder was created for the given capabilities.
+    EncodedWeights Encode(WeightEncoder& encoder,
+                          const HardwareCapabilities& capabilities,
+                          const MceOperationNode& mceOperation,
+                          uint32_t stripeDepth,
+                          uint32_t stripeSize,
+                          const QuantizationInfo& outputQuantizationInfo);
+
+    /// Number of times that the OFMs of some weights have actually been encoded, rather than found in the cache.
+    size_t GetNumEncodes() const
+    {
+        return m_NumEncodes;
+    }
+
+private:
+    struct Params
+    {
+        uint32_t numberOfEngines;
+        uint32_t numberOfOfm;
+        uint32_t numberOfSrams;
+        uint32_t ifmPerEngine;
+        uint32_t weightCompressionVersion;
+        TensorInfo weightsTensorInfo;
+        std::vector<uint8_t> weightsData;
+        TensorInfo biasTensorInfo;
+        std::vector<int32_t> biasData;
+        QuantizationInfo inputQuantizationInfo;
+        QuantizationInfo outputQuantizationInfo;
+        uint32_t stripeDepth;
+        uint32_t strideY;
+        uint32_t strideX;
+        uint32_t paddingTop;
+        uint32_t paddingLeft;
+        uint32_t iterationSize;
+        ethosn::command_stream::MceOperation operation;
+        CompilerMceAlgorithm algorithm;
+
+        bool operator==(const Params& r) const;
+    };
+
+    struct Hasher
+    {
+        size_t operator()(const Params& p) const;
+    };
+
+    struct Entry
+    {
+        /// Held while encoding so that other threads needing the same weights wait for them rather than encode them
+        /// again.
+        std::mutex mutex;
+        bool isEncoded = false;
+        WeightEncoder::EncodedOfms encodedOfms;
+        /// The encodedOfms merged for each of the stripe depths they have been needed for so far.
+        std::map<uint32_t, EncodedWeights> encodedWeights;
+    };
+
+    std::mutex m_Mutex;
+    std::unordered_map<Params, std::shared_ptr<Entry>, Hasher> m_Entries;
+    std::atomic<size_t> m_NumEncodes{ 0 };
+};
+
 }    // namespace support_library
 }    // namespace ethosn
@@ -108,6 +108,8 @@ public:
                     WeightCompMode mode,
                     const WeightCompressionParamsV2& params = {});
 
+    virtual bool DoEncodedOfmsDependOnStripeDepth() const override;
+
 protected:
     struct GRCSymbol
     {
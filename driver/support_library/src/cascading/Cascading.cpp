@@ -5,6 +5,7 @@
 
 #include "Cascading.hpp"
 
+#include "../CompilationStats.hpp"
 #include "../Graph.hpp"
 #include "../GraphNodes.hpp"
 #include "../Utils.hpp"
@@ -150,6 +151,7 @@ GraphOfParts CreateGraphOfParts(const Graph& graph,
 
 void CreatePlans(Parts& parts)
 {
+    ScopedCompilationStage stage("CreatePlans");
     for (auto& part : parts)
     {
         part->CreatePlans();
@@ -5,6 +5,7 @@
 
 #include "Combiner.hpp"
 
+#include "../CompilationStats.hpp"
 #include "../SramAllocator.hpp"
 #include "../Utils.hpp"
 #include "Cascading.hpp"
@@ -15,9 +16,11 @@
 
 #include <ethosn_utils/Filesystem.hpp>
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <list>
+#include <map>
 
 namespace ethosn
 {
@@ -728,6 +731,55 @@ GrownSeeds GrowSeeds(const Combinations& combs,
     return result;
 }
 
+/// A seed only records which plan of the next part it is connected to, so estimating the seed on its own doesn't
+/// tell seeds which differ only in that plan apart. This returns the combination with those pending plans appended,
+/// for the parts whose inputs are all connected to a plan already in the combination.
+Combination AddPendingPlans(const Combination& comb, const GraphOfParts& parts)
+{
+    Combination result = comb;
+
+    std::map<PartId, PlanId> pendingPlans;
+    for (const Elem& elem : comb.m_Elems)
+    {
+        for (const auto& glue : elem.m_Glues)
+        {
+            const InPart inPa = parts.GetInputPart(*glue.first);
+            if (inPa.first && comb.m_Scratch.m_Idx.count(inPa.second) == 0)
+            {
+                pendingPlans.insert(std::make_pair(inPa.second, glue.second.m_Id));
+            }
+        }
+    }
+
+    for (const auto& pending : pendingPlans)
+    {
+        bool allInputsConnected = true;
+        for (const Edge* inputEdge : parts.GetPart(pending.first).GetInputs())
+        {
+            const OutPart outPa = parts.GetOutputPart(*inputEdge);
+            auto srcIt          = std::find_if(comb.m_Elems.begin(), comb.m_Elems.end(),
+                                      [&](const Elem& e) { return outPa.first && e.m_PartId == outPa.second; });
+            if (srcIt == comb.m_Elems.end())
+            {
+                allInputsConnected = false;
+                break;
+            }
+            auto linkIt = srcIt->m_Glues.find(inputEdge);
+            if (linkIt == srcIt->m_Glues.end() || linkIt->second.m_Id != pending.second)
+            {
+                allInputsConnected = false;
+                break;
+            }
+        }
+        if (allInputsConnected)
+        {
+            result.m_Elems.push_back(Elem{ pending.first, pending.second, {} });
+        }
+    }
+
+    return result;
+}
+
 Combination PruneCombinations(const GraphOfParts& parts,
                               const HardwareCapabilities& caps,
                               const Combinations& combs,
@@ -737,19 +789,36 @@ Combination PruneCombinations(const GraphOfParts& parts,
     {
         utils::Optional<Combination> result;
         NetworkPerformanceData refNetPerfData;
+        bool refIncludesPendingPlans = false;
         for (const Combination& combination : combs)
         {
             try
             {
-                OpGraph combiOpGraph = GetOpGraphForCombination(combination, parts);
-                EstimatedOpGraph curNetPerfData =
-                    ethosn::support_library::EstimateOpGraph(combiOpGraph, caps, estimationOpts);
+                // Prefer estimating the combination together with the plans it is going to be connected to so that
+                // e.g. the stripe shapes and traversal order of the next part are taken into account. Not all plans
+                // can be estimated without their consumers though, in which case fall back to the seed on its own.
+                // These are not comparable so the former are always preferred.
+                bool includesPendingPlans = true;
+                EstimatedOpGraph curNetPerfData;
+                try
+                {
+                    OpGraph combiOpGraph = GetOpGraphForCombination(AddPendingPlans(combination, parts), parts);
+                    curNetPerfData = ethosn::support_library::EstimateOpGraph(combiOpGraph, caps, estimationOpts);
+                }
+                catch (const NotSupportedException&)
+                {
+                    includesPendingPlans = false;
+                    OpGraph combiOpGraph = GetOpGraphForCombination(combination, parts);
+                    curNetPerfData = ethosn::support_library::EstimateOpGraph(combiOpGraph, caps, estimationOpts);
+                }
 
-                if (!result.has_value() ||
-                    utils::IsLeftMoreDataPerformantThanRight(curNetPerfData.m_PerfData, refNetPerfData))
+                if (!result.has_value() || (includesPendingPlans && !refIncludesPendingPlans) ||
+                    (includesPendingPlans == refIncludesPendingPlans &&
+                     utils::IsLeftMoreDataPerformantThanRight(curNetPerfData.m_PerfData, refNetPerfData)))
                 {
-                    refNetPerfData = curNetPerfData.m_PerfData;
-                    result         = combination;
+                    refNetPerfData          = curNetPerfData.m_PerfData;
+                    refIncludesPendingPlans = includesPendingPlans;
+                    result                  = combination;
                 }
             }
             catch (const NotSupportedException&)
@@ -771,6 +840,9 @@ Combinations Cascading::Combine(const GraphOfParts& parts)
 {
     using namespace ethosn::utils;
 
+    ScopedCompilationStage stage("Combine");
+    CompilationStats* stats = GetCurrentCompilationStats();
+
     m_Metadata = CreateMetadata(parts, m_Capabilities);
 
     if (m_DebuggingContext.m_DebugInfo->m_DumpDebugFiles >= CompilationOptions::DebugLevel::High)
@@ -821,6 +893,10 @@ Combinations Cascading::Combine(const GraphOfParts& parts)
     }
 
     Combinations currSeeds = CreateSeeds(parts, m_Metadata, m_Capabilities);
+    if (stats)
+    {
+        stats->m_NumCombinationsGenerated += currSeeds.size();
+    }
 
     GrownSeeds grownSeeds;
     std::deque<Combinations> history;
@@ -839,8 +915,16 @@ Combinations Cascading::Combine(const GraphOfParts& parts)
             }
             pruned.push_back(PruneCombinations(parts, m_Capabilities, currSeeds, GetEstimationOptions()));
             grownSeeds = GrowSeeds(pruned, parts, 0U, m_Metadata, m_Capabilities, GrowScheme::DramOnly);
+            if (stats && currSeeds.size() > 1)
+            {
+                stats->m_NumCombinationsPruned += currSeeds.size() - 1;
+            }
         }
         currSeeds = grownSeeds.m_Combinations;
+        if (stats)
+        {
+            stats->m_NumCombinationsGenerated += currSeeds.size();
+        }
 
         if (history.size() > g_kHistoryDepth)
         {
@@ -227,6 +227,17 @@ GrownSeeds GrowSeeds(const Combinations&,
                      const HardwareCapabilities&,
                      const GrowScheme scheme = GrowScheme::Default);
 
+// Returns the given combination with the plans of the next parts that
+// it is linked to appended, so that it can be estimated together with them.
+Combination AddPendingPlans(const Combination& comb, const GraphOfParts& parts);
+
+// Keeps the best of the given combinations, estimating each of them
+// together with its pending plans when possible.
+Combination PruneCombinations(const GraphOfParts& parts,
+                              const HardwareCapabilities& caps,
+                              const Combinations& combs,
+                              const EstimationOptions& estimationOpts);
+
 /// Creates a single OpGraph which contains the full graph of Ops and Buffers for the given Combination.
 /// This handles merging of adjacent Plans and Glues to give a homogenous structure, suitable for
 /// Estimation or Generation into a command stream.
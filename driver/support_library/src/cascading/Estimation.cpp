@@ -137,7 +137,8 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
                                        weightsDram->m_QuantizationInfo);
         result.m_Stats.m_Weights =
             GetWeightsStats(capabilities, *weightsDram->m_EncodedWeights, weightsTensorInfo, weightsSram->m_StripeShape,
-                            weightsSram->m_SizeInBytes, inputBuffer->m_TensorShape, inputBuffer->m_StripeShape);
+                            weightsSram->m_SizeInBytes, inputBuffer->m_TensorShape, inputBuffer->m_StripeShape,
+                            mceOp->m_Order);
 
         includeOp(dmaOp);
         includeOp(mceOp);
@@ -184,7 +185,9 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
         }
         Location inputLocation = Location::Sram;
         bool isCompressed      = false;
-        DmaOp* dmaOp           = GetObjectAs<DmaOp>(opGraph.GetProducer(sramInputBuffer));
+        // The operations which produced the input, if they are part of this graph.
+        std::set<uint32_t> inputOperationIds;
+        DmaOp* dmaOp = GetObjectAs<DmaOp>(opGraph.GetProducer(sramInputBuffer));
         if (dmaOp != nullptr && unestimatedOps.count(dmaOp) > 0)
         {
             if (opGraph.GetInputs(dmaOp).size() != 1)
@@ -194,6 +197,10 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
             Buffer* dramBuffer = opGraph.GetInputs(dmaOp)[0];
             inputLocation      = dramBuffer->m_Location;
             isCompressed       = IsCompressed(dramBuffer->m_Format);
+            if (opGraph.GetProducer(dramBuffer) != nullptr)
+            {
+                inputOperationIds = opGraph.GetProducer(dramBuffer)->m_OperationIds;
+            }
             includeOp(dmaOp);
         }
 
@@ -201,13 +208,15 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
         uint32_t numOutStripeC =
             utils::DivRoundUp(sramOutputBuffer->m_TensorShape[3], sramOutputBuffer->m_StripeShape[3]);
 
+        // The order only affects the reloading of the input data of an MceOp.
+        const TraversalOrder order = mceOp != nullptr ? mceOp->m_Order : TraversalOrder::Xyz;
+
         const InputStats uncompressedStats =
             GetInputStats(capabilities, sramInputBuffer->m_TensorShape, sramInputBuffer->m_StripeShape, inputLocation,
-                          sramInputBuffer->m_SizeInBytes, weightsTensorInfo, numOutStripeC);
+                          sramInputBuffer->m_SizeInBytes, weightsTensorInfo, numOutStripeC, order);
+        const float saving          = GetActivationCompressionSaving(inputOperationIds, estimationOpts);
         const InputStats inputStats =
-            isCompressed
-                ? AccountForActivationCompression(uncompressedStats, estimationOpts.m_ActivationCompressionSaving)
-                : uncompressedStats;
+            isCompressed ? AccountForActivationCompression(uncompressedStats, saving) : uncompressedStats;
         result.m_Stats.m_Input += inputStats;
     }
 
@@ -243,12 +252,13 @@ EstimatedPass EstimatePassGrownFrom(const OpGraph& opGraph,
 
         const OutputStats uncompressedStats =
             GetOutputStats(roundedUpOutputShape, sramOutputBuffer->m_StripeShape, outputLocation);
+        const float saving      = GetActivationCompressionSaving(backOp->m_OperationIds, estimationOpts);
         result.m_Stats.m_Output =
-            isCompressed
-                ? AccountForActivationCompression(uncompressedStats, estimationOpts.m_ActivationCompressionSaving)
-                : uncompressedStats;
+            isCompressed ? AccountForActivationCompression(uncompressedStats, saving) : uncompressedStats;
     }
 
+    result.m_Stats = AccountForBatching(result.m_Stats, estimationOpts.m_BatchSize);
+
     return result;
 }
 
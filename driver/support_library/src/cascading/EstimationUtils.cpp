@@ -7,6 +7,8 @@
 
 #include "Plan.hpp"
 
+#include <limits>
+
 namespace ethosn
 {
 namespace support_library
@@ -51,7 +53,8 @@ uint32_t GetInputNumReloads(const bool isStreamingH,
                             const bool isStreamingC,
                             const TensorInfo& weights,
                             const uint32_t ofmProduced,
-                            const uint32_t numOutStripesC)
+                            const uint32_t numOutStripesC,
+                            const TraversalOrder order)
 {
     assert(numOutStripesC > 0);
 
@@ -62,6 +65,12 @@ uint32_t GetInputNumReloads(const bool isStreamingH,
     }
     else if (isStreamingH || isStreamingW)
     {
+        // When traversing depth first each input stripe stays in Sram while all the output stripes in depth are
+        // produced from it, so it is never reloaded.
+        if (order == TraversalOrder::Zxy)
+        {
+            return 0;
+        }
         return weights.m_DataFormat == DataFormat::HWIM ? 0 : numOutStripesC - 1U;
     }
 
@@ -105,7 +114,8 @@ InputStats GetInputStats(const HardwareCapabilities& caps,
                          const Location location,
                          const uint32_t tileSize,
                          const TensorInfo& weights,
-                         const uint32_t numOutStripesC)
+                         const uint32_t numOutStripesC,
+                         const TraversalOrder order)
 {
     InputStats data;
 
@@ -138,7 +148,7 @@ InputStats GetInputStats(const HardwareCapabilities& caps,
         const bool isStreamingC = numStripesC > 1U;
 
         data.m_StripesStats.m_NumReloads =
-            GetInputNumReloads(isStreamingH, isStreamingW, isStreamingC, weights, ofmProduced, numOutStripesC);
+            GetInputNumReloads(isStreamingH, isStreamingW, isStreamingC, weights, ofmProduced, numOutStripesC, order);
 
         // Calculate the total amount of input data to be transferred included reloading.
         const uint32_t total =
@@ -253,5 +263,108 @@ InputStats AccountForActivationCompression(InputStats stats, float spaceSavingRa
     return ret;
 }
 
+float GetActivationCompressionSaving(const std::set<uint32_t>& operationIds,
+                                     const EstimationOptions& estimationOptions)
+{
+    // Operation ids are normally given out in the order the operations are added to the Network, so the last one of
+    // those fused together is the one which produces the tensor.
+    for (auto it = operationIds.rbegin(); it != operationIds.rend(); ++it)
+    {
+        auto savingIt = estimationOptions.m_ActivationCompressionSavings.find(*it);
+        if (savingIt != estimationOptions.m_ActivationCompressionSavings.end())
+        {
+            return savingIt->second;
+        }
+    }
+    return estimationOptions.m_ActivationCompressionSaving;
+}
+
+float GetCompressedFormatSaving(const TensorShape& shape,
+                                CompilerDataCompressedFormat compressedFormat,
+                                float spaceSavingRatio)
+{
+    using namespace utils;
+
+    // Cells of NHWCB (i.e. bricks), FCAF_DEEP and FCAF_WIDE, in height, width and depth.
+    TensorShape cellShape;
+    switch (compressedFormat)
+    {
+        case CompilerDataCompressedFormat::NHWCB_COMPRESSED:
+            cellShape = { 8, 8, 16 };
+            break;
+        case CompilerDataCompressedFormat::FCAF_DEEP:
+            cellShape = { 8, 8, 32 };
+            break;
+        case CompilerDataCompressedFormat::FCAF_WIDE:
+            cellShape = { 8, 16, 16 };
+            break;
+        default:
+            return 0.0f;
+    }
+    const uint32_t nhwcbSize = RoundUpToNearestMultiple(shape[1], 8) * RoundUpToNearestMultiple(shape[2], 8) *
+                               RoundUpToNearestMultiple(shape[3], 16);
+    const uint32_t paddedSize = RoundUpToNearestMultiple(shape[1], cellShape[0]) *
+                                RoundUpToNearestMultiple(shape[2], cellShape[1]) *
+                                RoundUpToNearestMultiple(shape[3], cellShape[2]);
+    // The padding is compressed as well as the data.
+    return spaceSavingRatio -
+           (1.0f - spaceSavingRatio) * static_cast<float>(paddedSize - nhwcbSize) / static_cast<float>(nhwcbSize);
+}
+
+constexpr uint32_t SaturateToUint32(uint64_t value)
+{
+    return static_cast<uint32_t>(std::min<uint64_t>(value, std::numeric_limits<uint32_t>::max()));
+}
+
+constexpr uint64_t DivRoundUp64(uint64_t numerator, uint64_t denominator)
+{
+    return (numerator + denominator - 1) / denominator;
+}
+
+PassStats AccountForBatching(const PassStats& stats, uint32_t batchSize)
+{
+    // The stats hold 32-bit byte counts, which the products below can exceed for large tensors, so the arithmetic is
+    // done in 64 bits and the results saturate.
+    const uint64_t inputDram = static_cast<uint64_t>(stats.m_Input.m_MemoryStats.m_DramParallel) +
+                               stats.m_Input.m_MemoryStats.m_DramNonParallel;
+    const uint64_t weightsDram = static_cast<uint64_t>(stats.m_Weights.m_MemoryStats.m_DramParallel) +
+                                 stats.m_Weights.m_MemoryStats.m_DramNonParallel;
+
+    // The input of the other images can only be brought in if it comes from Dram, as Sram only holds a single image.
+    if (batchSize <= 1 || inputDram == 0 || weightsDram == 0)
+    {
+        return stats;
+    }
+
+    // If the input of an image is only loaded once then it is kept in Sram for all the weights stripes, which can't
+    // be done for all the images at once. It is reloaded for every weights stripe instead.
+    const uint32_t numWeightsStripes = std::max(stats.m_Weights.m_StripesStats.m_NumCentralStripes, 1U);
+    const uint32_t inputLoads        = stats.m_Input.m_StripesStats.m_NumReloads == 0 ? numWeightsStripes : 1U;
+
+    // Only batch the pass if it reduces the total amount of data transferred per image.
+    const uint64_t unbatchedDram = inputDram + weightsDram;
+    const uint64_t batchedDram   = inputDram * inputLoads + DivRoundUp64(weightsDram, batchSize);
+    if (batchedDram >= unbatchedDram)
+    {
+        return stats;
+    }
+
+    PassStats result = stats;
+
+    // The first stripe still has to be loaded before processing can start.
+    result.m_Input.m_MemoryStats.m_DramParallel =
+        SaturateToUint32(inputDram * inputLoads - stats.m_Input.m_MemoryStats.m_DramNonParallel);
+    result.m_Input.m_StripesStats.m_NumReloads =
+        SaturateToUint32(static_cast<uint64_t>(stats.m_Input.m_StripesStats.m_NumReloads) + inputLoads - 1U);
+
+    // Each weights stripe is loaded once for the whole batch so it is shared between the images.
+    result.m_Weights.m_MemoryStats.m_DramNonParallel =
+        SaturateToUint32(DivRoundUp64(stats.m_Weights.m_MemoryStats.m_DramNonParallel, batchSize));
+    result.m_Weights.m_MemoryStats.m_DramParallel =
+        SaturateToUint32(DivRoundUp64(stats.m_Weights.m_MemoryStats.m_DramParallel, batchSize));
+
+    return result;
+}
+
 }    // namespace support_library
 }    // namespace ethosn
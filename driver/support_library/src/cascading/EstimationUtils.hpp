@@ -32,11 +32,29 @@ InputStats GetInputStats(const HardwareCapabilities& caps,
                                  DataFormat::HWIM,
                                  { 0, 0.1f },
                              },
-                         const uint32_t numOutStripesC = 1);
+                         const uint32_t numOutStripesC = 1,
+                         const TraversalOrder order    = TraversalOrder::Xyz);
 
 OutputStats GetOutputStats(const TensorShape& shape, const TensorShape& stripeShape, const Location location);
 
 InputStats AccountForActivationCompression(InputStats stats, float spaceSavingRatio);
 
+/// Gets the proportion of space saved with activation compression for the output of the given operations, which is
+/// the measured one of the last of them if there is one, otherwise the one for all the tensors.
+float GetActivationCompressionSaving(const std::set<uint32_t>& operationIds,
+                                     const EstimationOptions& estimationOptions);
+
+/// Gets the proportion of DRAM traffic saved by storing a tensor in the given compressed format rather than as NHWCB,
+/// given the proportion of space saved by compressing its data. The FCAF formats pad the tensor to whole cells, so
+/// this can be negative when the tensor doesn't fill them.
+float GetCompressedFormatSaving(const TensorShape& shape,
+                                CompilerDataCompressedFormat compressedFormat,
+                                float spaceSavingRatio);
+
+/// Converts the stats of a pass for a single image into the stats per image when a batch of images is run back to
+/// back through the pass, with each weights stripe being applied to all the images before moving on to the next one.
+/// The stats are returned unchanged if batching the pass doesn't reduce the amount of data transferred.
+PassStats AccountForBatching(const PassStats& stats, uint32_t batchSize);
+
 }    //namespace support_library
 }    //namespace ethosn
@@ -5,6 +5,8 @@
 
 #include "MceEstimationUtils.hpp"
 
+#include "EstimationUtils.hpp"
+
 #include <random>
 
 namespace ethosn
@@ -170,7 +172,8 @@ uint32_t GetWeightsNumReloads(const HardwareCapabilities& caps,
                               const TensorShape& inShape,
                               const TensorShape& inStripeShape,
                               const TensorInfo& info,
-                              const uint32_t tileSize)
+                              const uint32_t tileSize,
+                              const TraversalOrder order)
 {
     // The input data streaming affects the number of weights data reloads.
     const uint32_t numStripesH = utils::GetNumStripesH(inShape, inStripeShape);
@@ -182,8 +185,11 @@ uint32_t GetWeightsNumReloads(const HardwareCapabilities& caps,
 
     const bool isStreamingHC = numStripesH > 1U && numStripesW == 1U && numStripesC > 1U;
 
+    // When traversing depth first all the weights are needed again for each input stripe in width and height.
+    const bool isStreamingZxy = order == TraversalOrder::Zxy && (numStripesH > 1U || numStripesW > 1U);
+
     // Account for the reloading of the weights data, this happens when streaming input data in depth and height.
-    return isStreamingHC && (tileSize < totalSize) ? (numStripesW * numStripesH - 1U) : 0;
+    return (isStreamingHC || isStreamingZxy) && (tileSize < totalSize) ? (numStripesW * numStripesH - 1U) : 0;
 }
 
 WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
@@ -192,7 +198,8 @@ WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
                              const TensorShape& stripeShape,
                              const uint32_t tileSize,
                              const TensorShape& inShape,
-                             const TensorShape& inStripeShape)
+                             const TensorShape& inStripeShape,
+                             const TraversalOrder order)
 {
     WeightsStats data;
 
@@ -201,7 +208,7 @@ WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
 
     // Account for the reloading of the weights data, this happens when streaming input data in depth and height.
     data.m_StripesStats.m_NumCentralStripes = static_cast<uint32_t>(encodedWeights.m_Metadata.size());
-    data.m_StripesStats.m_NumReloads        = GetWeightsNumReloads(caps, inShape, inStripeShape, info, tileSize);
+    data.m_StripesStats.m_NumReloads        = GetWeightsNumReloads(caps, inShape, inStripeShape, info, tileSize, order);
 
     // Check if there is more than a stripe in the tile.
     const bool buffering = tileSize > stripeSize;
@@ -230,5 +237,45 @@ WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
     return data;
 }
 
+uint64_t EstimateMceOperationCycles(const HardwareCapabilities& caps,
+                                    const Stride& stride,
+                                    const ethosn::command_stream::MceOperation& convtype,
+                                    const CompilerMceAlgorithm& algo,
+                                    const TensorShape& inputShape,
+                                    const TensorShape& inputStripeShape,
+                                    const Location inputLocation,
+                                    const uint32_t inputTileSize,
+                                    const TensorShape& outputShape,
+                                    const TensorShape& outputStripeShape,
+                                    const Location outputLocation,
+                                    const TensorInfo& weightsInfo,
+                                    const uint32_t weightsTileSize,
+                                    const TraversalOrder order)
+{
+    const uint64_t mceCycles = GetMceCycleCount(caps, stride, convtype, algo, inputShape, outputShape,
+                                                weightsInfo.m_Dimensions[0], weightsInfo.m_Dimensions[1]);
+
+    const uint32_t numOutStripesC = utils::DivRoundUp(outputShape[3], outputStripeShape[3]);
+    const InputStats inputStats =
+        GetInputStats(caps, inputShape, inputStripeShape, inputLocation, inputTileSize, weightsInfo, numOutStripesC,
+                      order);
+    const uint64_t inputBytes = inputStats.m_MemoryStats.m_DramParallel + inputStats.m_MemoryStats.m_DramNonParallel;
+
+    // The weights are always in DRAM and the kernel is rounded up for Winograd (and the wide kernel mode of Direct).
+    TensorInfo roundedWeightsInfo   = weightsInfo;
+    roundedWeightsInfo.m_Dimensions = utils::GetRoundedWeights(weightsInfo.m_Dimensions, algo);
+    const uint32_t numWeightsReloads =
+        GetWeightsNumReloads(caps, inputShape, inputStripeShape, roundedWeightsInfo, weightsTileSize, order);
+    const uint64_t weightsBytes = static_cast<uint64_t>(numWeightsReloads + 1U) *
+                                  utils::EstimateWeightSizeBytes(roundedWeightsInfo.m_Dimensions, caps,
+                                                                 weightsInfo.m_DataFormat == DataFormat::HWIM);
+
+    const uint64_t outputBytes = outputLocation == Location::Dram ? utils::TotalSizeBytes(outputShape) : 0U;
+
+    const uint64_t dramBytes  = inputBytes + weightsBytes + outputBytes;
+    const uint64_t dramCycles = (dramBytes + g_NominalDramBytesPerCycle - 1U) / g_NominalDramBytesPerCycle;
+    return std::max(mceCycles, dramCycles);
+}
+
 }    // namespace support_library
 }    // namespace ethosn
@@ -29,7 +29,27 @@ WeightsStats GetWeightsStats(const HardwareCapabilities& caps,
                              const TensorShape& stripeShape,
                              const uint32_t tileSize,
                              const TensorShape& inShape,
-                             const TensorShape& inStripeShape);
+                             const TensorShape& inStripeShape,
+                             const TraversalOrder order = TraversalOrder::Xyz);
+
+/// Estimates the number of cycles an MCE operation takes with the given algorithm and stripes, to choose between the
+/// Direct and Winograd algorithms. The MCE and the DMA work in parallel so this is the larger of the MCE cycles and
+/// the cycles to transfer the input, weights and output to or from DRAM. Winograd needs fewer MCE cycles but its
+/// kernels are rounded up and its stripes may need more reloads, so it can be slower when bound by the DRAM bandwidth.
+uint64_t EstimateMceOperationCycles(const HardwareCapabilities& caps,
+                                    const Stride& stride,
+                                    const ethosn::command_stream::MceOperation& convtype,
+                                    const CompilerMceAlgorithm& algo,
+                                    const TensorShape& inputShape,
+                                    const TensorShape& inputStripeShape,
+                                    const Location inputLocation,
+                                    const uint32_t inputTileSize,
+                                    const TensorShape& outputShape,
+                                    const TensorShape& outputStripeShape,
+                                    const Location outputLocation,
+                                    const TensorInfo& weightsInfo,
+                                    const uint32_t weightsTileSize,
+                                    const TraversalOrder order = TraversalOrder::Xyz);
 
 std::vector<uint8_t> GenerateCompressibleData(size_t numElements, float spaceSavingProportion, int32_t zeroPoint);
 
@@ -5,9 +5,11 @@
 
 #include "Part.hpp"
 
+#include "../CompilationStats.hpp"
 #include "../Graph.hpp"
 #include "../Utils.hpp"
 #include "GraphNodes.hpp"
+#include "MceEstimationUtils.hpp"
 #include "Plan.hpp"
 #include "WeightEncoder.hpp"
 
@@ -156,6 +158,8 @@ public:
         auto it = m_Entries.find(params);
         if (it == m_Entries.end())
         {
+            // This is entered for every plan, so only its time is recorded.
+            ScopedCompilationStage stage("WeightEncoding", false);
             EncodedWeights w =
                 m_Encoder->Encode(params.weightsTensorInfo, params.weightsData.data(), params.biasTensorInfo,
                                   params.biasData.data(), params.inputQuantizationInfo, params.outputQuantizationInfo,
@@ -241,15 +245,17 @@ bool Part::StripeInfos::operator<(const StripeInfos& rhs) const
     return false;
 }
 
-std::unique_ptr<Op>
-    CreateOpFromNode(const Node* node, const CompilationOptions& compOpt, const HardwareCapabilities& caps)
+std::unique_ptr<Op> CreateOpFromNode(const Node* node,
+                                     const CompilationOptions& compOpt,
+                                     const HardwareCapabilities& caps,
+                                     TraversalOrder order)
 {
     if (IsObjectOfType<MceOperationNode>(node))
     {
         const MceOperationNode* mceOperationNode = dynamic_cast<const MceOperationNode*>(node);
         MceOp op(Lifetime::Cascade, mceOperationNode->GetOperation(),
                  mceOperationNode->GetEffectiveAlgorithm(caps, !compOpt.m_DisableWinograd), BlockConfig{ 8U, 8U },
-                 TensorShape{}, TensorShape{}, TensorShape{}, TraversalOrder::Xyz, mceOperationNode->GetStride(),
+                 TensorShape{}, TensorShape{}, TensorShape{}, order, mceOperationNode->GetStride(),
                  mceOperationNode->GetPadLeft(), mceOperationNode->GetPadTop());
         return std::make_unique<MceOp>(std::move(op));
     }
@@ -302,6 +308,23 @@ int GetStripePosition(TraversalOrder order)
     }
 }
 
+bool IsSplit(uint32_t tensorSize, uint32_t stripeSize)
+{
+    return stripeSize != 0 && stripeSize < tensorSize;
+}
+
+/// The order in which the stripes of a buffer are traversed only makes a difference when the buffer is split both
+/// in width/height and in depth. Other buffers are always given Xyz order so that they can be shared between plans
+/// of different traversal orders without a glue.
+TraversalOrder
+    GetBufferTraversalOrder(TraversalOrder order, const TensorShape& tensorShape, const TensorShape& stripeShape)
+{
+    const bool isSplitXY = IsSplit(GetHeight(tensorShape), GetHeight(stripeShape)) ||
+                           IsSplit(GetWidth(tensorShape), GetWidth(stripeShape));
+    const bool isSplitZ = IsSplit(GetChannels(tensorShape), GetChannels(stripeShape));
+    return (isSplitXY && isSplitZ) ? order : TraversalOrder::Xyz;
+}
+
 TensorShape GetShapeRoundedToBrickGroup(TensorShape shape)
 {
     shape    = utils::RoundUpHeightAndWidthToBrickGroup(shape);
@@ -602,10 +625,18 @@ void Part::AddNewPlan(Plan::InputMapping&& inputMappings, Plan::OutputMapping&&
 {
     auto plan       = std::make_unique<Plan>(std::move(inputMappings), std::move(outputMappings));
     plan->m_OpGraph = std::move(opGraph);
-    if (IsPlanValid(m_Capabilities, *plan))
+    const bool isValid = IsPlanValid(m_Capabilities, *plan);
+    if (isValid)
     {
         m_Plans.push_back(std::move(plan));
     }
+
+    CompilationStats* stats = GetCurrentCompilationStats();
+    if (stats)
+    {
+        ++stats->m_NumPlansGenerated;
+        stats->m_NumPlansPruned += isValid ? 0 : 1;
+    }
 }
 
 void Part::CreatePlanForInputNode(Node* node, Lifetime lifetime, TraversalOrder order)
@@ -644,6 +675,44 @@ void Part::CreatePlanForOutputNode(Node* node, Lifetime lifetime, TraversalOrder
     AddNewPlan(std::move(inputMappings), std::move(outputMappings), std::move(opGraph));
 }
 
+/// An MceOperation is only given the Winograd algorithm because it needs fewer MACs, but with the stripes of a plan
+/// Direct may be faster, e.g. if Winograd rounds up the kernel when the operation is bound by the DRAM bandwidth.
+/// Switches the MceOp of the plan to Direct if that is estimated to be faster. This must be done before its weights
+/// are encoded.
+void ChooseMceAlgorithm(OwnedOpGraph& opGraph,
+                        const HardwareCapabilities& caps,
+                        const TensorInfo& weightInfo,
+                        const uint32_t numWeightStripes)
+{
+    assert(dynamic_cast<MceOp*>(opGraph.GetOps().front()) != nullptr);
+    MceOp* mceOp = dynamic_cast<MceOp*>(opGraph.GetOps().front());
+    if (mceOp->m_Algo != CompilerMceAlgorithm::Winograd)
+    {
+        return;
+    }
+
+    const Buffer* mceInput  = opGraph.GetInputs(mceOp)[0];
+    const Buffer* mceOutput = opGraph.GetOutput(mceOp);
+    auto estimateCycles     = [&](CompilerMceAlgorithm algorithm) {
+        TensorInfo roundedWeightInfo   = weightInfo;
+        roundedWeightInfo.m_Dimensions = utils::GetRoundedWeights(weightInfo.m_Dimensions, algorithm);
+        const TensorShape weightStripeShape =
+            CalculateWeightStripeShape(roundedWeightInfo, mceInput->m_StripeShape, mceOutput->m_StripeShape);
+        const uint32_t weightsTileSize =
+            numWeightStripes *
+            utils::EstimateWeightSizeBytes(weightStripeShape, caps, weightInfo.m_DataFormat == DataFormat::HWIM);
+        return EstimateMceOperationCycles(caps, mceOp->m_Stride, mceOp->m_Op, algorithm, mceInput->m_TensorShape,
+                                          mceInput->m_StripeShape, mceInput->m_Location, mceInput->m_SizeInBytes,
+                                          mceOutput->m_TensorShape, mceOutput->m_StripeShape, mceOutput->m_Location,
+                                          weightInfo, weightsTileSize, mceOp->m_Order);
+    };
+
+    if (estimateCycles(CompilerMceAlgorithm::Direct) < estimateCycles(CompilerMceAlgorithm::Winograd))
+    {
+        mceOp->m_Algo = CompilerMceAlgorithm::Direct;
+    }
+}
+
 void AddWeightBuffersAndDmaOpToMceOp(OwnedOpGraph& opGraph,
                                      const TensorShape& inpStripeShape,
                                      const TensorShape& outStripeShape,
@@ -824,7 +893,7 @@ void Part::CreatePlanWithIdentityMceOp(FuseOnlyPleOperationNode* node,
                                                                  lifetime, order, mceInputStripe, mceInputStripe,
                                                                  numInputStripes, numWeightStripes, weightEncoderCache);
             // Add PleOp
-            opGraph.AddOp(CreateOpFromNode(node, m_CompilationOptions, m_Capabilities));
+            opGraph.AddOp(CreateOpFromNode(node, m_CompilationOptions, m_Capabilities, order));
             Op* op                             = opGraph.GetOps().back();
             const OpGraph::BufferList& buffers = opGraph.GetBuffers();
 
@@ -886,6 +955,7 @@ void Part::CreatePlanWithIdentityPleOp(Node* node,
 
         // Add weights
         MceOperationNode* mceNode = GetObjectAs<MceOperationNode>(node);
+        ChooseMceAlgorithm(opGraph, m_Capabilities, mceNode->GetWeightsInfo(), numWeightStripes);
         AddWeightBuffersAndDmaOpToMceOp(opGraph, mceInputBuff->m_StripeShape, mceOutputBuff->m_StripeShape,
                                         numWeightStripes, mceNode->GetWeightsInfo(), mceNode->GetWeightsData(),
                                         mceNode->GetBiasInfo(), mceNode->GetBiasData(), lifetime, order,
@@ -934,7 +1004,7 @@ void Part::AddOpToOpGraphWithInputOutputBuffers(OwnedOpGraph& opGraph,
 {
     (void)outputMappings;    //Currently unused but expected to be used whenever multi output will be supported
 
-    opGraph.AddOp(CreateOpFromNode(node, m_CompilationOptions, m_Capabilities));
+    opGraph.AddOp(CreateOpFromNode(node, m_CompilationOptions, m_Capabilities, order));
 
     const OpGraph::BufferList& buffers = opGraph.GetBuffers();
     const OpGraph::OpList& ops         = opGraph.GetOps();
@@ -948,6 +1018,7 @@ void Part::AddOpToOpGraphWithInputOutputBuffers(OwnedOpGraph& opGraph,
         const Node* inputNode   = edge->GetSource();
         inBuffer->m_TensorShape = inputNode->GetShape();
         inBuffer->m_StripeShape = inputStripe;
+        inBuffer->m_Order       = GetBufferTraversalOrder(order, inBuffer->m_TensorShape, inputStripe);
         inBuffer->m_NumStripes  = numInputStripes;
         inBuffer->m_SizeInBytes = inputBufferLocation == Location::Sram
                                       ? CalculateTileSize(node, m_Capabilities, inBuffer->m_TensorShape, inputStripe,
@@ -978,6 +1049,7 @@ void Part::AddOpToOpGraphWithInputOutputBuffers(OwnedOpGraph& opGraph,
     auto outputNode          = m_SubGraph.back();
     outBuffer->m_TensorShape = outputNode->GetShape();
     outBuffer->m_StripeShape = outputStripe;
+    outBuffer->m_Order       = GetBufferTraversalOrder(order, outBuffer->m_TensorShape, outputStripe);
     outBuffer->m_NumStripes  = numOutputStripes;
     outBuffer->m_SizeInBytes =
         outputBufferLocation == Location::Sram
@@ -1016,7 +1088,7 @@ void Part::CreatePlanForNode(Node* node,
 
     if (this->m_SubGraph.size() > 1 && IsObjectOfType<McePostProcessOperationNode>(this->m_SubGraph[1]))
     {
-        opGraph.AddOp(CreateOpFromNode(this->m_SubGraph[1], m_CompilationOptions, m_Capabilities));
+        opGraph.AddOp(CreateOpFromNode(this->m_SubGraph[1], m_CompilationOptions, m_Capabilities, order));
         auto mcePpOp = ops.back();
         opGraph.AddBuffer(std::make_unique<Buffer>(lifetime, Location::Sram, CascadingBufferFormat::NHWCB, order));
         auto mcePpOpBuffer = buffers.back();
@@ -1032,6 +1104,7 @@ void Part::CreatePlanForNode(Node* node,
         const TensorInfo& weightsInfo = GetWeightsInfo(node);
         if (utils::GetNumElements(weightsInfo.m_Dimensions) > 0)
         {
+            ChooseMceAlgorithm(opGraph, m_Capabilities, mceNode->GetWeightsInfo(), numWeightStripes);
             for (auto pair : inputMappings)
             {
                 Buffer* inBuffer = pair.first;
@@ -1092,7 +1165,7 @@ void Part::GenerateWithTraversalOrders(Node* node, WeightEncoderCache& weightEnc
 {
     std::vector<BlockConfig> blockConfigs = GenerateBlockConfigs(node);
     GenerateWithStripeSizes(node, blockConfigs, TraversalOrder::Xyz, weightEncoderCache);
-    // TODO: Add the same function call with traversal order ZXY
+    GenerateWithStripeSizes(node, blockConfigs, TraversalOrder::Zxy, weightEncoderCache);
 
     auto inputStripe  = CreateStripe(node->GetInputShape(0), TensorShape{ 0, 0, 0, 0 }, m_Capabilities);
     auto outputStripe = CreateStripe(node->GetShape(), TensorShape{ 0, 0, 0, 0 }, m_Capabilities);
@@ -1123,7 +1196,10 @@ void Part::GenerateWithTraversalOrders(Node* node, WeightEncoderCache& weightEnc
     }
 }
 
-std::set<Part::StripeInfos> GenerateStripes(Node* node, const HardwareCapabilities& caps, const BlockConfig blockConfig)
+std::set<Part::StripeInfos> GenerateStripes(Node* node,
+                                            const HardwareCapabilities& caps,
+                                            const BlockConfig blockConfig,
+                                            TraversalOrder order)
 {
     using namespace utils;
 
@@ -1194,6 +1270,53 @@ std::set<Part::StripeInfos> GenerateStripes(Node* node, const HardwareCapabiliti
         }
     };
 
+    if (order == TraversalOrder::Zxy)
+    {
+        // Traversing depth first only makes a difference when the output is split in both width/height and depth,
+        // so only those stripes are considered. The input of an MceOperation is kept at full depth so that each input
+        // stripe is loaded once and reused for all the output depth stripes, while the weights are streamed through
+        // (and possibly double buffered) for each input stripe instead.
+        const std::vector<TensorShape> xyEncodings = {
+            { 0, blockConfig.m_BlockHeight(), 0, 0 },
+            { 0, blockConfig.m_BlockHeight(), blockConfig.m_BlockWidth(), 0 },
+        };
+        for (const TensorShape& xyEncoding : xyEncodings)
+        {
+            const TensorShape& inputShape   = node->GetInputShape(0);
+            const TensorShape& outputShape  = node->GetShape();
+            Part::NumStripes numStripesCopy = numStripes;
+            TensorShape inputEncoding;
+            TensorShape outputEncoding;
+
+            if (IsObjectOfType<MceOperationNode>(node))
+            {
+                inputEncoding  = xyEncoding;
+                outputEncoding = { 0, xyEncoding[1], xyEncoding[2], caps.GetNumberOfOfm() };
+
+                auto mceNode     = GetObjectAs<MceOperationNode>(node);
+                auto kernelWidth = mceNode->GetWeightsInfo().m_Dimensions[1];
+                if (xyEncoding[2] != 0 && kernelWidth == 1)
+                {
+                    numStripesCopy.minInputStripes = 1;
+                    numStripesCopy.maxInputStripes = 2;
+                }
+            }
+            else
+            {
+                inputEncoding  = { 0, xyEncoding[1], xyEncoding[2], caps.GetNumberOfOfm() };
+                outputEncoding = ApplyShapeMult(inputEncoding);
+            }
+
+            TensorShape inputStripe  = CreateStripe(inputShape, inputEncoding, caps);
+            TensorShape outputStripe = CreateStripe(outputShape, outputEncoding, caps);
+            if (GetBufferTraversalOrder(order, outputShape, outputStripe) == order)
+            {
+                AddStripeInfos(inputStripe, outputStripe, numStripesCopy, inputShape, outputShape);
+            }
+        }
+        return result;
+    }
+
     // Use the minimum stripe size possible to minimize the time before processing
     // Try splitting height first
     {
@@ -1352,7 +1475,7 @@ void Part::GenerateWithStripeSizes(Node* node,
     std::set<Part::StripeInfos> stripeInfos;
     for (auto blockConfig : blockConfigs)
     {
-        auto mceStripes = GenerateStripes(node, m_Capabilities, blockConfig);
+        auto mceStripes = GenerateStripes(node, m_Capabilities, blockConfig, order);
         stripeInfos.insert(mceStripes.begin(), mceStripes.end());
     }
 
@@ -115,10 +115,7 @@ uint32_t AppendBufferAligned(std::vector<uint8_t>& dest, uint32_t alignment, con
 
 void BufferManager::Allocate()
 {
-    // There is a restriction on the alignment of DRAM accesses for NHWCB and NHWCB_COMPRESSED formats.
-    // NHWCB needs to be 16 byte aligned.
-    // NHWCB_COMPRESSED needs to be 64 byte aligned.
-    constexpr uint32_t alignment = 64;
+    constexpr uint32_t alignment = g_DramBufferAlignment;
     uint32_t intermediatesOffset = 0;
     uint32_t inputsOffset        = 0;
     uint32_t outputsOffset       = 0;
@@ -20,6 +20,12 @@ class CommandStreamBuffer;
 namespace support_library
 {
 
+/// Alignment of the start of each Dram buffer.
+/// There is a restriction on the alignment of DRAM accesses for NHWCB and NHWCB_COMPRESSED formats.
+/// NHWCB needs to be 16 byte aligned.
+/// NHWCB_COMPRESSED needs to be 64 byte aligned.
+constexpr uint32_t g_DramBufferAlignment = 64;
+
 enum class BufferType
 {
     Input,
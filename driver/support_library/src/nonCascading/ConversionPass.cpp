@@ -90,13 +90,10 @@ std::unique_ptr<ethosn::support_library::ConversionPass> ConversionPass::CreateG
 
     // If our input is in DRAM then we can support any linear sequence of Conversion nodes (i.e. convert from NHWCB to NHWC or vice versa).
     bool isInputDram = (firstNode->GetInputLocation(0) == BufferLocation::Dram);
-    if (isInputDram && firstNode->GetInputCompressed(0) &&
-        (firstNode->GetInputCompressedFormat(0) == CompilerDataCompressedFormat::FCAF_DEEP ||
-         firstNode->GetInputCompressedFormat(0) == CompilerDataCompressedFormat::FCAF_WIDE))
-    {
-        // Firmware doesn't support loading FCAF formats from Dram in for OPERATION_CONVERT.
-        return std::unique_ptr<ConversionPass>();
-    }
+    // The compressed formats of intermediate tensors are only chosen once all the passes have been created. Only
+    // NHWCB_COMPRESSED is chosen for the input of a ConversionPass, as the firmware doesn't support loading FCAF
+    // formats from DRAM for OPERATION_CONVERT.
+    assert(!firstNode->GetInputCompressed(0));
     // If our input is in SRAM then we can also support NHWC reinterprets (i.e. reshapes) as long as the sequence ends in NHWCB
     bool isInputSram = (firstNode->GetInputLocation(0) == BufferLocation::Sram);
 
@@ -359,13 +356,19 @@ PassStats ConversionPass::GetStats(const EstimationOptions& estimationOptions)
 
     if (m_Nodes.front()->GetInputCompressed(0))
     {
-        perfData.m_Input =
-            AccountForActivationCompression(perfData.m_Input, estimationOptions.m_ActivationCompressionSaving);
+        const Node& inputNode = *m_Nodes.front()->GetInput(0)->GetSource();
+        const float saving =
+            GetCompressedFormatSaving(inputShape, inputNode.GetCompressedFormat(),
+                                      GetActivationCompressionSaving(inputNode.GetCorrespondingOperationIds(),
+                                                                     estimationOptions));
+        perfData.m_Input = AccountForActivationCompression(perfData.m_Input, saving);
     }
     if (m_Nodes.back()->GetCompressed())
     {
-        perfData.m_Output =
-            AccountForActivationCompression(perfData.m_Output, estimationOptions.m_ActivationCompressionSaving);
+        const float saving = GetCompressedFormatSaving(
+            outputShape, m_Nodes.back()->GetCompressedFormat(),
+            GetActivationCompressionSaving(m_Nodes.back()->GetCorrespondingOperationIds(), estimationOptions));
+        perfData.m_Output = AccountForActivationCompression(perfData.m_Output, saving);
     }
 
     return perfData;
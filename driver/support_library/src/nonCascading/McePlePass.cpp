@@ -5,6 +5,7 @@
 
 #include "McePlePass.hpp"
 
+#include "CompilationStats.hpp"
 #include "Compiler.hpp"
 #include "StrategyX.hpp"
 #include "Utils.hpp"
@@ -71,55 +72,6 @@ bool IsNodeCompressible(const Node& node)
     return hintIsOk && isFormatCompressible;
 }
 
-CompilerDataCompressedFormat GetIntermediateOutputCompressedFormat(const HardwareCapabilities& capabilities,
-                                                                   bool enableIntermediateCompression,
-                                                                   const LinearNodesOutput& linearOutputNodes,
-                                                                   bool forwardEst)
-{
-    const Node& outputNode = *linearOutputNodes.m_WorkingNodes.back();
-
-    // Only attempt to compress if the format is compatible and there is a transfer to the DRAM
-    if (!IsNodeCompressible(outputNode) || linearOutputNodes.m_OutputLocation != BufferLocation::Dram)
-    {
-        return CompilerDataCompressedFormat::NONE;
-    }
-
-    // Attempt to compress if it was requested
-    if (enableIntermediateCompression)
-    {
-        const Strategy strategy              = linearOutputNodes.m_TensorConfig.strategy;
-        const TensorShape& outputStripeShape = linearOutputNodes.m_TensorConfig.outputAllocation.stripeShape;
-        const TensorShape& outputNodeShape   = outputNode.GetShape();
-
-        // Attempt to find a compatible compression to use
-        if (capabilities.GetActivationCompressionVersion() == 0)
-        {
-            if (IsCompressionFormatCompatible(CompilerDataCompressedFormat::NHWCB_COMPRESSED, outputNodeShape,
-                                              outputStripeShape, strategy, forwardEst))
-            {
-                return CompilerDataCompressedFormat::NHWCB_COMPRESSED;
-            }
-        }
-        else
-        {
-            if (IsCompressionFormatCompatible(CompilerDataCompressedFormat::FCAF_DEEP, outputNodeShape,
-                                              outputStripeShape, strategy, forwardEst))
-            {
-                return CompilerDataCompressedFormat::FCAF_DEEP;
-            }
-
-            if (IsCompressionFormatCompatible(CompilerDataCompressedFormat::FCAF_WIDE, outputNodeShape,
-                                              outputStripeShape, strategy, forwardEst))
-            {
-                return CompilerDataCompressedFormat::FCAF_WIDE;
-            }
-        }
-    }
-
-    // Output can't or should not be compressed
-    return CompilerDataCompressedFormat::NONE;
-}
-
 }    // namespace
 
 std::vector<command_stream::BlockConfig>
@@ -409,10 +361,6 @@ LinearNodesOutput McePlePass::FindLinearWorkingNodes(Node* firstNode,
                 mceOperation->GetShapeMultiplier() *
                 (fuseOnlyPle != nullptr ? fuseOnlyPle->GetShapeMultiplier() : g_IdentityShapeMultiplier);
 
-            res.m_Algorithm = mceOperation->GetEffectiveAlgorithm(capabilities, enableWinograd);
-
-            TensorShape weightsShape = GetRoundedWeights(mceOperation->GetWeightsInfo().m_Dimensions, res.m_Algorithm);
-
             uint32_t depthMax = UINT32_MAX;
             if ((fuseOnlyPle != nullptr) &&
                 ((fuseOnlyPle->GetKernelOperation() == command_stream::PleOperation::MAXPOOL_3X3_2_2_EVEN) ||
@@ -434,29 +382,74 @@ LinearNodesOutput McePlePass::FindLinearWorkingNodes(Node* firstNode,
             {
                 validStrategies = FilterStrategiesForPle(fuseOnlyPle->GetKernelOperation(), validStrategies);
             }
-            auto validBlockConfigs = FilterValidAndSortBlockConfigs(
-                mceOperation, fuseOnlyPle, allowedBlockConfigs, capabilities, lastNode->GetShape(), res.m_Algorithm);
-            TensorConfig tensorConfig;
-            // Reset the SramAllocator used to calculate strategies to the base one originally passed in.
-            SramAllocator currentSramAllocator = sramAllocator;
             // The shape we pass to strategy selection is the *MCE* input shape.
             // Note this may be different to firstNode->GetShape() if we are taking our input from a supertensor.
             TensorShape mceInputShape = mceOperation->GetInputShape(0);
-            strategySelected          = ChooseAndSetupStrategy(
-                capabilities, currentSramAllocator, validStrategies, validBlockConfigs, tensorConfig, mceInputShape,
-                lastNode->GetShape(), mceOperation->GetWeightsInfo().m_DataFormat, weightsShape, shapeMultiplier,
-                inputStaticAndOffset, res.m_Algorithm, depthMax);
 
-            if (IsStrategyX(mceOperation->GetOperation(), tensorConfig, res.m_Algorithm, validStrategies))
-            {
+            // Chooses the strategy and block config for the given algorithm, starting from the SramAllocator
+            // originally passed in.
+            auto chooseStrategy = [&](CompilerMceAlgorithm algorithm, TensorConfig& tensorConfig,
+                                      SramAllocator& currentSramAllocator,
+                                      std::vector<command_stream::BlockConfig>& validBlockConfigs) {
+                TensorShape weightsShape = GetRoundedWeights(mceOperation->GetWeightsInfo().m_Dimensions, algorithm);
+                validBlockConfigs        = FilterValidAndSortBlockConfigs(
+                    mceOperation, fuseOnlyPle, allowedBlockConfigs, capabilities, lastNode->GetShape(), algorithm);
                 currentSramAllocator = sramAllocator;
-                strategySelected     = TryStrategyX(
-                    mceOperation->GetOperation(), mceOperation->GetUpsampleType(), tensorConfig, currentSramAllocator,
-                    mceInputShape, lastNode->GetShape(), mceOperation->GetWeightsInfo().m_DataFormat, weightsShape,
-                    std::make_pair(mceOperation->GetPadTop(), mceOperation->GetPadLeft()), validBlockConfigs,
-                    capabilities, mceOperation->GetShapeMultiplier(),
-                    (fuseOnlyPle != nullptr ? fuseOnlyPle->GetShapeMultiplier() : g_IdentityShapeMultiplier),
-                    inputStaticAndOffset, depthMax);
+                bool selected        = ChooseAndSetupStrategy(
+                    capabilities, currentSramAllocator, validStrategies, validBlockConfigs, tensorConfig, mceInputShape,
+                    lastNode->GetShape(), mceOperation->GetWeightsInfo().m_DataFormat, weightsShape, shapeMultiplier,
+                    inputStaticAndOffset, algorithm, depthMax);
+
+                if (IsStrategyX(mceOperation->GetOperation(), tensorConfig, algorithm, validStrategies))
+                {
+                    currentSramAllocator = sramAllocator;
+                    selected             = TryStrategyX(
+                        mceOperation->GetOperation(), mceOperation->GetUpsampleType(), tensorConfig,
+                        currentSramAllocator, mceInputShape, lastNode->GetShape(),
+                        mceOperation->GetWeightsInfo().m_DataFormat, weightsShape,
+                        std::make_pair(mceOperation->GetPadTop(), mceOperation->GetPadLeft()), validBlockConfigs,
+                        capabilities, mceOperation->GetShapeMultiplier(),
+                        (fuseOnlyPle != nullptr ? fuseOnlyPle->GetShapeMultiplier() : g_IdentityShapeMultiplier),
+                        inputStaticAndOffset, depthMax);
+                }
+                return selected;
+            };
+
+            auto estimateCycles = [&](CompilerMceAlgorithm algorithm, const TensorConfig& tensorConfig) {
+                const Location inputLocation  = inputStaticAndOffset.first ? Location::Sram : Location::Dram;
+                const Location outputLocation =
+                    tensorConfig.strategy == Strategy::STRATEGY_3 ? Location::Sram : Location::Dram;
+                return EstimateMceOperationCycles(
+                    capabilities, mceOperation->GetStride(), mceOperation->GetOperation(), algorithm, mceInputShape,
+                    tensorConfig.inputAllocation.stripeShape, inputLocation, tensorConfig.inputAllocation.tileSize,
+                    lastNode->GetShape(), tensorConfig.outputAllocation.stripeShape, outputLocation,
+                    mceOperation->GetWeightsInfo(), tensorConfig.weightsAllocation.tileSize);
+            };
+
+            res.m_Algorithm = mceOperation->GetEffectiveAlgorithm(capabilities, enableWinograd);
+            TensorConfig tensorConfig;
+            SramAllocator currentSramAllocator;
+            std::vector<command_stream::BlockConfig> validBlockConfigs;
+            strategySelected = chooseStrategy(res.m_Algorithm, tensorConfig, currentSramAllocator, validBlockConfigs);
+
+            if (res.m_Algorithm == CompilerMceAlgorithm::Winograd)
+            {
+                // Winograd is only preferred because it needs fewer MACs, but the strategy it allows may need more
+                // DRAM traffic than the one Direct would use, so keep whichever is estimated to be faster.
+                TensorConfig directTensorConfig;
+                SramAllocator directSramAllocator;
+                std::vector<command_stream::BlockConfig> directValidBlockConfigs;
+                if (chooseStrategy(CompilerMceAlgorithm::Direct, directTensorConfig, directSramAllocator,
+                                   directValidBlockConfigs) &&
+                    (!strategySelected || estimateCycles(CompilerMceAlgorithm::Direct, directTensorConfig) <
+                                              estimateCycles(CompilerMceAlgorithm::Winograd, tensorConfig)))
+                {
+                    res.m_Algorithm      = CompilerMceAlgorithm::Direct;
+                    strategySelected     = true;
+                    tensorConfig         = directTensorConfig;
+                    currentSramAllocator = directSramAllocator;
+                    validBlockConfigs    = directValidBlockConfigs;
+                }
             }
 
             if (strategySelected)
@@ -507,11 +500,10 @@ std::unique_ptr<ethosn::support_library::McePlePass>
                                size_t id,
                                std::vector<IStrategy*> allowedStrategies,
                                std::vector<command_stream::BlockConfig> allowedBlockConfigs,
-                               bool enableIntermediateCompression,
                                bool enableWinograd,
                                Node* firstNode,
                                SramAllocator& sramAllocator,
-                               bool forwardEst)
+                               SharedWeightEncoderCache* sharedWeightEncoderCache)
 {
     // Find the largest set of linear nodes which can be formed into a pass
     LinearNodesOutput linearNodes = FindLinearWorkingNodes(firstNode, sramAllocator, capabilities, allowedStrategies,
@@ -588,24 +580,8 @@ std::unique_ptr<ethosn::support_library::McePlePass>
         return std::unique_ptr<McePlePass>();
     }
 
-    const Strategy strategy             = linearNodes.m_TensorConfig.strategy;
-    const TensorShape& inputStripeShape = linearNodes.m_TensorConfig.inputAllocation.stripeShape;
-    Node& inputNode                     = *linearNodes.m_WorkingNodes.front();
-
-    // If the compression format can't be used for the IFM, we need to give a hint to the previous
-    // node that its output needs to be uncompressed.
-    if (inputNode.GetInputCompressed(0) &&
-        !IsCompressionFormatCompatible(inputNode.GetInputCompressedFormat(0), inputNode.GetInputShape(0),
-                                       inputStripeShape, strategy, forwardEst))
-    {
-        inputNode.GetInput(0)->GetSource()->SetFixGraphCompressionHint(CompressionHint::RequiredUncompressed);
-        return std::unique_ptr<McePlePass>();
-    }
     assert(linearNodes.m_OutputLocation != BufferLocation::None);
 
-    const CompilerDataCompressedFormat intermediateOutputCompressedFormat =
-        GetIntermediateOutputCompressedFormat(capabilities, enableIntermediateCompression, linearNodes, forwardEst);
-
     // Once we've found a valid strategy we can set the old SramAllocator to the updated one.
     sramAllocator = linearNodes.m_SramAllocator;
     // We can deallocate the weights and ple now.
@@ -624,24 +600,43 @@ std::unique_ptr<ethosn::support_library::McePlePass>
 
     std::unique_ptr<ethosn::support_library::McePlePass> result = std::make_unique<McePlePass>(
         capabilities, id, linearNodes.m_WorkingNodes, linearNodes.m_TensorConfig, linearNodes.m_OutputLocation,
-        intermediateOutputCompressedFormat, linearNodes.m_Algorithm, sramOffset);
+        linearNodes.m_Algorithm, sramOffset, sharedWeightEncoderCache);
 
     return result;
 }
 
+bool McePlePass::IsOutputCompressionFormatCompatible(CompilerDataCompressedFormat compressedFormat,
+                                                     bool forwardEst) const
+{
+    const Node& outputNode = *m_Nodes.back();
+    return IsNodeCompressible(outputNode) && outputNode.GetLocation() == BufferLocation::Dram &&
+           IsCompressionFormatCompatible(compressedFormat, outputNode.GetShape(),
+                                         m_TensorConfig.outputAllocation.stripeShape, m_TensorConfig.strategy,
+                                         forwardEst);
+}
+
+bool McePlePass::IsInputCompressionFormatCompatible(CompilerDataCompressedFormat compressedFormat,
+                                                    bool forwardEst) const
+{
+    return IsCompressionFormatCompatible(compressedFormat, m_Nodes.front()->GetInputShape(0),
+                                         m_TensorConfig.inputAllocation.stripeShape, m_TensorConfig.strategy,
+                                         forwardEst);
+}
+
 McePlePass::McePlePass(const HardwareCapabilities& capabilities,
                        size_t id,
                        std::vector<Node*> nodes,
                        const TensorConfig& tensorConfig,
                        BufferLocation outputLocation,
-                       CompilerDataCompressedFormat intermediateCompressedFormat,
                        CompilerMceAlgorithm algorithm,
-                       uint32_t sramOffset)
+                       uint32_t sramOffset,
+                       SharedWeightEncoderCache* sharedWeightEncoderCache)
     : Pass(capabilities, id)
     , m_ExtractSubtensorNode(nullptr)
     , m_MceOperation(nullptr)
     , m_PleOperation(nullptr)
     , m_WeightEncoder(WeightEncoder::CreateWeightEncoder(capabilities))
+    , m_SharedWeightEncoderCache(sharedWeightEncoderCache)
     , m_TensorConfig(tensorConfig)
 {
     m_Nodes = nodes;
@@ -688,9 +683,9 @@ McePlePass::McePlePass(const HardwareCapabilities& capabilities,
 
     m_Nodes.back()->SetOutputSramOffset(sramOffset);
     m_Nodes.back()->SetLocation(outputLocation);
-    // We can use compression only in the case when:
-    // NHWCB tensors in DRAM where the output stripe is the full width and depth.
-    m_Nodes.back()->SetCompressedFormat(intermediateCompressedFormat);
+    // The output is uncompressed until the formats of all the intermediate tensors are chosen, once all the passes
+    // have been created (see Compiler::ChooseIntermediateCompressedFormats).
+    m_Nodes.back()->SetCompressedFormat(CompilerDataCompressedFormat::NONE);
 
     m_MceOperation->SetAlgorithm(algorithm);
 }
@@ -881,8 +876,13 @@ void McePlePass::Generate(command_stream::CommandStreamBuffer& cmdStream, Buffer
     uint32_t weightStripeSize;
     uint32_t weightStripeDepth;
     std::tie(weightStripeSize, weightStripeDepth) = GetWeightStripeSizeAndDepth();
-    EncodedWeights encodedWeights =
-        m_WeightEncoder->Encode(*m_MceOperation, weightStripeDepth, weightStripeSize, quantizationInfo);
+    EncodedWeights encodedWeights           = EncodeWeights(weightStripeDepth, weightStripeSize, quantizationInfo);
+    m_GeneratedWeightsStats                 = GetEncodedWeightsStats(encodedWeights);
+    CompilationStats* stats                 = GetCurrentCompilationStats();
+    if (stats)
+    {
+        stats->m_EncodedWeightsBytes += encodedWeights.m_Data.size();
+    }
     std::vector<uint8_t>& compressedWeights = encodedWeights.m_Data;
     uint32_t weightBufferId                 = bufferManager.AddDramConstant(BufferType::ConstantDma, compressedWeights);
 
@@ -895,6 +895,32 @@ void McePlePass::Generate(command_stream::CommandStreamBuffer& cmdStream, Buffer
     uint32_t weightMetadataBufferId    = bufferManager.AddDramConstant(BufferType::ConstantControlUnit, metadataBytes);
     convCmd.m_WeightMetadataBufferId() = weightMetadataBufferId;
 
+    // Remember how the weights were encoded so that they can be replaced without compiling the network again.
+    const QuantizationInfo mceInputQuantizationInfo = m_MceOperation->GetInputQuantizationInfo(0);
+    m_WeightsEncodingInfo.m_NodeId                  = static_cast<uint32_t>(m_MceOperation->GetId());
+    m_WeightsEncodingInfo.m_WeightsBufferId         = weightBufferId;
+    m_WeightsEncodingInfo.m_WeightsMetadataBufferId = weightMetadataBufferId;
+    m_WeightsEncodingInfo.m_WeightsShape            = weightsInfo.m_Dimensions;
+    m_WeightsEncodingInfo.m_WeightsFormat           = weightsInfo.m_DataFormat;
+    m_WeightsEncodingInfo.m_WeightsZeroPoint        = weightsInfo.m_QuantizationInfo.GetZeroPoint();
+    m_WeightsEncodingInfo.m_BiasShape               = m_MceOperation->GetBiasInfo().m_Dimensions;
+    m_WeightsEncodingInfo.m_InputZeroPoint          = mceInputQuantizationInfo.GetZeroPoint();
+    m_WeightsEncodingInfo.m_InputScale              = mceInputQuantizationInfo.GetScale();
+    m_WeightsEncodingInfo.m_NodeOutputZeroPoint     = m_MceOperation->GetQuantizationInfo().GetZeroPoint();
+    m_WeightsEncodingInfo.m_NodeOutputScale         = m_MceOperation->GetQuantizationInfo().GetScale();
+    m_WeightsEncodingInfo.m_OutputZeroPoint         = quantizationInfo.GetZeroPoint();
+    m_WeightsEncodingInfo.m_OutputScale             = quantizationInfo.GetScale();
+    m_WeightsEncodingInfo.m_StripeDepth             = weightStripeDepth;
+    m_WeightsEncodingInfo.m_StrideY                 = m_MceOperation->GetStride().m_Y;
+    m_WeightsEncodingInfo.m_StrideX                 = m_MceOperation->GetStride().m_X;
+    m_WeightsEncodingInfo.m_PaddingTop              = m_MceOperation->GetMceData().m_PadTop();
+    m_WeightsEncodingInfo.m_PaddingLeft             = m_MceOperation->GetMceData().m_PadLeft();
+    m_WeightsEncodingInfo.m_IterationSize           = weightStripeSize;
+    m_WeightsEncodingInfo.m_Operation               = m_MceOperation->GetMceData().m_Operation();
+    m_WeightsEncodingInfo.m_Algorithm               = m_MceOperation->GetAlgorithm();
+    m_WeightsEncodingInfo.m_SramStripeSize          = EstimateWeightSizeBytes(
+        m_TensorConfig.weightsAllocation.stripeShape, m_Capabilities, weightsInfo.m_DataFormat == DataFormat::HWIM);
+
     convCmd.m_InputInfo().m_DataType()         = GetCommandDataType(m_Nodes.front()->GetInputDataType(0));
     convCmd.m_InputInfo().m_DataFormat()       = m_Nodes.front()->GetInputBufferFormat(0);
     convCmd.m_InputInfo().m_TensorShape()      = mceInputShape;
@@ -1077,6 +1103,28 @@ void McePlePass::Generate(command_stream::CommandStreamBuffer& cmdStream, Buffer
     Pass::PostGenerate(cmdStream, dumpRam);
 }
 
+EncodedWeights McePlePass::EncodeWeights(uint32_t stripeDepth,
+                                         uint32_t stripeSize,
+                                         const QuantizationInfo& outputQuantizationInfo) const
+{
+    // This is entered for every pass, so only its time is recorded.
+    ScopedCompilationStage stage("WeightEncoding", false);
+
+    EncodedWeights encodedWeights =
+        m_SharedWeightEncoderCache
+            ? m_SharedWeightEncoderCache->Encode(*m_WeightEncoder, m_Capabilities, *m_MceOperation, stripeDepth,
+                                                 stripeSize, outputQuantizationInfo)
+            : m_WeightEncoder->Encode(*m_MceOperation, stripeDepth, stripeSize, outputQuantizationInfo);
+    return encodedWeights;
+}
+
+WeightsStats McePlePass::GetEncodedWeightsStats(EncodedWeights& encodedWeights) const
+{
+    return GetWeightsStats(m_Capabilities, encodedWeights, m_MceOperation->GetWeightsInfo(),
+                           m_TensorConfig.weightsAllocation.stripeShape, m_TensorConfig.weightsAllocation.tileSize,
+                           m_MceOperation->GetInputShape(0), m_TensorConfig.inputAllocation.stripeShape);
+}
+
 PassStats McePlePass::GetStats(const EstimationOptions& estimationOptions)
 {
     PassStats perfData;
@@ -1090,9 +1138,7 @@ PassStats McePlePass::GetStats(const EstimationOptions& estimationOptions)
     const BufferLocation inputLocation  = m_Nodes.front()->GetInput(0)->GetSource()->GetLocation();
     const uint32_t inputTileSize        = m_TensorConfig.inputAllocation.tileSize;
 
-    const TensorInfo& weightsInfo         = m_MceOperation->GetWeightsInfo();
-    const TensorShape& weightsStripeShape = m_TensorConfig.weightsAllocation.stripeShape;
-    const uint32_t weightsTileSize        = m_TensorConfig.weightsAllocation.tileSize;
+    const TensorInfo& weightsInfo = m_MceOperation->GetWeightsInfo();
 
     const TensorShape& mceOutputShape = m_MceOperation->GetShape();
 
@@ -1114,8 +1160,12 @@ PassStats McePlePass::GetStats(const EstimationOptions& estimationOptions)
 
     if (m_Nodes.front()->GetInputCompressed(0))
     {
-        perfData.m_Input =
-            AccountForActivationCompression(uncompressedInput, estimationOptions.m_ActivationCompressionSaving);
+        const Node& inputNode = *m_Nodes.front()->GetInput(0)->GetSource();
+        const float saving =
+            GetCompressedFormatSaving(inputNode.GetShape(), inputNode.GetCompressedFormat(),
+                                      GetActivationCompressionSaving(inputNode.GetCorrespondingOperationIds(),
+                                                                     estimationOptions));
+        perfData.m_Input = AccountForActivationCompression(uncompressedInput, saving);
     }
     else
     {
@@ -1129,34 +1179,41 @@ PassStats McePlePass::GetStats(const EstimationOptions& estimationOptions)
 
     if (m_Nodes.back()->GetCompressed())
     {
-        perfData.m_Output =
-            AccountForActivationCompression(uncompressedOutput, estimationOptions.m_ActivationCompressionSaving);
+        const float saving = GetCompressedFormatSaving(
+            outputShape, m_Nodes.back()->GetCompressedFormat(),
+            GetActivationCompressionSaving(m_Nodes.back()->GetCorrespondingOperationIds(), estimationOptions));
+        perfData.m_Output = AccountForActivationCompression(uncompressedOutput, saving);
     }
     else
     {
         perfData.m_Output = uncompressedOutput;
     }
 
-    const QuantizationInfo& quantizationInfo = m_RequantizeNodes.empty()
-                                                   ? m_MceOperation->GetQuantizationInfo()
-                                                   : m_RequantizeNodes.back()->GetQuantizationInfo();
+    if (m_IsGenerated)
+    {
+        perfData.m_Weights = m_GeneratedWeightsStats;
+    }
+    else
+    {
+        const QuantizationInfo& quantizationInfo = m_RequantizeNodes.empty()
+                                                       ? m_MceOperation->GetQuantizationInfo()
+                                                       : m_RequantizeNodes.back()->GetQuantizationInfo();
 
-    // Encode weights to know the actual amount of data including headers.
-    uint32_t weightStripeSize;
-    uint32_t weightStripeDepth;
-    std::tie(weightStripeSize, weightStripeDepth) = GetWeightStripeSizeAndDepth();
-    EncodedWeights encodedWeights =
-        m_WeightEncoder->Encode(*m_MceOperation, weightStripeDepth, weightStripeSize, quantizationInfo);
+        // Encode weights to know the actual amount of data including headers.
+        uint32_t weightStripeSize;
+        uint32_t weightStripeDepth;
+        std::tie(weightStripeSize, weightStripeDepth) = GetWeightStripeSizeAndDepth();
+        EncodedWeights encodedWeights = EncodeWeights(weightStripeDepth, weightStripeSize, quantizationInfo);
 
-    perfData.m_Weights = GetWeightsStats(m_Capabilities, encodedWeights, weightsInfo, weightsStripeShape,
-                                         weightsTileSize, inputShape, inputStripeShape);
+        perfData.m_Weights = GetEncodedWeightsStats(encodedWeights);
+    }
 
     perfData.m_Mce = GetMceStats(m_Capabilities, m_MceOperation->GetStride(), m_MceOperation->GetOperation(),
                                  m_MceOperation->GetAlgorithm(), inputShape, mceOutputShape, weightsInfo.m_Dimensions);
 
     perfData.m_Ple = GetPleStats(m_Capabilities, { mceOutputShape }, GetPleOperation());
 
-    return perfData;
+    return AccountForBatching(perfData, estimationOptions.m_BatchSize);
 }
 
 }    // namespace support_library
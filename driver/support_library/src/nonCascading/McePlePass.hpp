@@ -47,26 +47,39 @@ public:
                                                       size_t id,
                                                       std::vector<IStrategy*> allowedStrategies,
                                                       std::vector<command_stream::BlockConfig> allowedBlockConfigs,
-                                                      bool enableIntermediateCompression,
                                                       bool enableWinograd,
                                                       Node* firstNode,
                                                       SramAllocator& sramAllocator,
-                                                      bool forwardEst);
+                                                      SharedWeightEncoderCache* sharedWeightEncoderCache);
 
     McePlePass(const HardwareCapabilities& capabilities,
                size_t id,
                std::vector<Node*> nodes,
                const TensorConfig& tensorConfig,
                BufferLocation outputLocation,
-               CompilerDataCompressedFormat intermediateCompressedFormat,
                CompilerMceAlgorithm algorithm,
-               uint32_t sramOffset);
+               uint32_t sramOffset,
+               SharedWeightEncoderCache* sharedWeightEncoderCache);
 
     /// Generates this Pass by adding appropriate entries to the given command stream, memory map and buffer table.
     void Generate(command_stream::CommandStreamBuffer& cmdStream, BufferManager& bufferManager, bool dumpRam) override;
 
     DotAttributes GetDotAttributes() override;
 
+    /// Describes how the weights were encoded. Must only be called once the Pass has been generated.
+    const WeightsEncodingInfo& GetWeightsEncodingInfo() const
+    {
+        assert(m_IsGenerated);
+        return m_WeightsEncodingInfo;
+    }
+
+    /// Whether the output of this pass can be written to DRAM in the given compressed format, with the stripes it uses.
+    /// forwardEst allows the FCAF formats for arbitrary stripes when doing a forward-looking performance estimate.
+    bool IsOutputCompressionFormatCompatible(CompilerDataCompressedFormat compressedFormat, bool forwardEst) const;
+
+    /// Whether the input of this pass can be read from DRAM in the given compressed format, with the stripes it uses.
+    bool IsInputCompressionFormatCompatible(CompilerDataCompressedFormat compressedFormat, bool forwardEst) const;
+
     static bool ChooseAndSetupStrategy(const HardwareCapabilities& capabilities,
                                        SramAllocator& sramAllocator,
                                        std::vector<IStrategy*> allowedStrategies,
@@ -108,6 +121,13 @@ private:
 
     std::pair<uint32_t, uint32_t> GetWeightStripeSizeAndDepth();
 
+    /// Encodes the weights of the MCE operation, through the shared cache if there is one.
+    EncodedWeights EncodeWeights(uint32_t stripeDepth,
+                                 uint32_t stripeSize,
+                                 const QuantizationInfo& outputQuantizationInfo) const;
+
+    WeightsStats GetEncodedWeightsStats(EncodedWeights& encodedWeights) const;
+
     std::vector<FormatConversionNode*> m_PreConversionNodes;
     ExtractSubtensorNode* m_ExtractSubtensorNode;
     MceOperationNode* m_MceOperation;
@@ -118,9 +138,17 @@ private:
     std::vector<CopyNode*> m_CopyNodes;
 
     std::unique_ptr<WeightEncoder> m_WeightEncoder;
+    /// Optional cache of the weights encoded during estimation, shared with other Compilers. May be null.
+    SharedWeightEncoderCache* m_SharedWeightEncoderCache;
 
     /// Tensor sram allocation information
     TensorConfig m_TensorConfig;
+
+    /// Statistics of the weights encoded during Generate, so that estimating a generated pass
+    /// doesn't need to encode them again.
+    WeightsStats m_GeneratedWeightsStats;
+
+    WeightsEncodingInfo m_WeightsEncodingInfo;
 };
 
 }    // namespace support_library
@@ -81,6 +81,20 @@ void Pass::Estimate(std::vector<PassPerformanceData>& perfStream, const Estimati
     m_IsEstimated = true;
 }
 
+PassCommandInfo Pass::GetCommandInfo(const EstimationOptions& estimationOptions)
+{
+    assert(m_IsGenerated);
+
+    PassCommandInfo info;
+
+    info.m_FirstCommandIdx = m_CommandStreamFirstCommandIdx;
+    info.m_LastCommandIdx  = m_CommandStreamLastCommandIdx;
+    info.m_OperationIds    = GetCorrespondingOperationIds();
+    info.m_Stats           = GetStats(estimationOptions);
+
+    return info;
+}
+
 void Pass::PreGenerate(command_stream::CommandStreamBuffer& cmdStream)
 {
     m_CommandStreamFirstCommandIdx = cmdStream.GetCount();
@@ -117,6 +117,10 @@ public:
     /// Estimate performance of this Pass.
     void Estimate(std::vector<PassPerformanceData>& perfStream, const EstimationOptions& estimationOptions);
 
+    /// Describes the commands generated for this Pass along with its estimated performance.
+    /// Must only be called once the Pass has been generated.
+    PassCommandInfo GetCommandInfo(const EstimationOptions& estimationOptions);
+
     /// Generates section command to the given command stream
     void PreGenerate(command_stream::CommandStreamBuffer& cmdStream);
 
@@ -173,19 +173,12 @@ std::unique_ptr<PlePass> PlePass::CreateGreedily(const HardwareCapabilities& cap
                 return std::unique_ptr<PlePass>();
             }
 
-            // Compression format can't be used for the IFM, we need to give a hint to the previous
-            // node that its output needs to be uncompressed.
-            // Non legacy code does not support it quite yet.
-            bool requiredUncompressed    = false;
             bool splitInDepthUnsupported = false;
             for (uint32_t i = 0; i < firstNode->GetInputs().size(); ++i)
             {
-                if (firstNode->GetInputCompressed(i))
-                {
-                    firstNode->GetInput(i)->GetSource()->SetFixGraphCompressionHint(
-                        CompressionHint::RequiredUncompressed);
-                    requiredUncompressed = true;
-                }
+                // The compressed formats of intermediate tensors are only chosen once all the passes have been
+                // created, and never for the inputs of a PlePass as it doesn't support them.
+                assert(!firstNode->GetInputCompressed(i));
 
                 auto inputSramAllocation = inputSramAllocations[i];
                 auto inputShape          = firstNode->GetInputShape(i);
@@ -198,7 +191,7 @@ std::unique_ptr<PlePass> PlePass::CreateGreedily(const HardwareCapabilities& cap
                     splitInDepthUnsupported = true;
                 }
             }
-            if (requiredUncompressed || splitInDepthUnsupported)
+            if (splitInDepthUnsupported)
             {
                 return std::unique_ptr<PlePass>();
             }
@@ -601,8 +594,12 @@ PassStats PlePass::GetStats(const EstimationOptions& estimationOptions)
 
         if (m_Nodes.front()->GetInputCompressed(i))
         {
-            inputStats += AccountForActivationCompression(uncompressedInputStats,
-                                                          estimationOptions.m_ActivationCompressionSaving);
+            const Node& inputNode = *m_Nodes.front()->GetInput(i)->GetSource();
+            const float saving =
+                GetCompressedFormatSaving(inputShape, inputNode.GetCompressedFormat(),
+                                          GetActivationCompressionSaving(inputNode.GetCorrespondingOperationIds(),
+                                                                         estimationOptions));
+            inputStats += AccountForActivationCompression(uncompressedInputStats, saving);
         }
         else
         {
@@ -628,8 +625,10 @@ PassStats PlePass::GetStats(const EstimationOptions& estimationOptions)
 
     if (m_Nodes.back()->GetCompressed())
     {
-        perfData.m_Output =
-            AccountForActivationCompression(uncompressedOutputStats, estimationOptions.m_ActivationCompressionSaving);
+        const float saving = GetCompressedFormatSaving(
+            outputShape, m_Nodes.back()->GetCompressedFormat(),
+            GetActivationCompressionSaving(m_Nodes.back()->GetCorrespondingOperationIds(), estimationOptions));
+        perfData.m_Output = AccountForActivationCompression(uncompressedOutputStats, saving);
     }
     else
     {
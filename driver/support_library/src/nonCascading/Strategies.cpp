@@ -29,24 +29,22 @@ constexpr uint32_t g_DefaultMaxNumWeightBuffersInTile = 2;
 
 // Given a requested shape for the output stripe (which is not required to be rounded at all),
 // calculates what the actual stripe sizes would be (accounting for hardware and firmware constraints)
-// and what the tile sizes would be (accounting for double-buffering etc.) and checks if all this would
-// fit into SRAM.
-// By keeping all the logic of the confusing rounding in this one function it lets the per-Strategy functions
-// be nice and simple and concentrate just on looping over possible stripe sizes.
-bool TryStripeShapes(SramAllocator& sramAllocator,
-                     const TensorShape& requestedOutputStripe,
-                     const TensorShape& inputShape,
-                     const TensorShape& outputShape,
-                     DataFormat weightsFormat,
-                     const TensorShape& weightsShape,
-                     const HardwareCapabilities& capabilities,
-                     const utils::ShapeMultiplier& shapeMultiplier,
-                     std::pair<bool, uint32_t> inputStaticAndOffset,
-                     TensorConfig& outTensorConfig,
-                     const uint32_t depthMax,
-                     const uint32_t maxNumWeightBuffersInTile = g_DefaultMaxNumWeightBuffersInTile,
-                     const uint32_t maxNumInputBuffersInTile  = g_DefaultMaxNumInputBuffersInTile)
+// and what the tile sizes would be (accounting for double-buffering etc.).
+StripeShapeCache::Result CalculateStripeShapes(const TensorShape& requestedOutputStripe,
+                                               const TensorShape& inputShape,
+                                               const TensorShape& outputShape,
+                                               DataFormat weightsFormat,
+                                               const TensorShape& weightsShape,
+                                               const HardwareCapabilities& capabilities,
+                                               const utils::ShapeMultiplier& shapeMultiplier,
+                                               std::pair<bool, uint32_t> inputStaticAndOffset,
+                                               const uint32_t depthMax,
+                                               const uint32_t maxNumWeightBuffersInTile,
+                                               const uint32_t maxNumInputBuffersInTile)
 {
+    StripeShapeCache::Result result = {};
+    result.m_Success                = false;
+
     const uint32_t brickGroupHeight   = capabilities.GetBrickGroupShape()[1];
     const uint32_t brickGroupWidth    = capabilities.GetBrickGroupShape()[2];
     const uint32_t brickGroupChannels = capabilities.GetBrickGroupShape()[3];
@@ -145,7 +143,7 @@ bool TryStripeShapes(SramAllocator& sramAllocator,
     // Check that the number of slots in the tile can be represented in HW
     if (numInputStripesInTile > capabilities.GetNumCentralSlots())
     {
-        return false;
+        return result;
     }
     // Clamp the overall tile size to the size of the full tensor. This means that if we have a small number of stripes
     // and the last one is partial we don't waste space in the tile that will never be used.
@@ -196,22 +194,98 @@ bool TryStripeShapes(SramAllocator& sramAllocator,
         // Note that there is only very limited support for the case where there are
         // more input stripes than output stripes, but it isn't clear what those
         // limitations are so this check is probably overly permissive for those cases.
+        return result;
+    }
+
+    result.m_Success      = true;
+    result.m_InputStripe  = inputStripe;
+    result.m_OutputStripe = outputStripe;
+    result.m_WeightStripe = weightStripe;
+    result.m_InputTile    = inputTile;
+    result.m_OutputTile   = outputTile;
+    result.m_WeightTile   = weightTile;
+    return result;
+}
+
+// Chooses the stripe and tile sizes for the requested output stripe (see CalculateStripeShapes) and checks if all
+// this would fit into SRAM.
+// By keeping all the logic of the confusing rounding in this one function it lets the per-Strategy functions
+// be nice and simple and concentrate just on looping over possible stripe sizes.
+// The strategies try the same stripe shapes many times over, so the results are cached, keyed on all the
+// arguments and on the free memory in the SRAM allocator.
+bool TryStripeShapes(StripeShapeCache& cache,
+                     SramAllocator& sramAllocator,
+                     const TensorShape& requestedOutputStripe,
+                     const TensorShape& inputShape,
+                     const TensorShape& outputShape,
+                     DataFormat weightsFormat,
+                     const TensorShape& weightsShape,
+                     const HardwareCapabilities& capabilities,
+                     const utils::ShapeMultiplier& shapeMultiplier,
+                     std::pair<bool, uint32_t> inputStaticAndOffset,
+                     TensorConfig& outTensorConfig,
+                     const uint32_t depthMax,
+                     const uint32_t maxNumWeightBuffersInTile = g_DefaultMaxNumWeightBuffersInTile,
+                     const uint32_t maxNumInputBuffersInTile  = g_DefaultMaxNumInputBuffersInTile)
+{
+    std::vector<uint32_t> key;
+    key.reserve(48);
+    key.insert(key.end(), requestedOutputStripe.begin(), requestedOutputStripe.end());
+    key.insert(key.end(), inputShape.begin(), inputShape.end());
+    key.insert(key.end(), outputShape.begin(), outputShape.end());
+    key.push_back(static_cast<uint32_t>(weightsFormat));
+    key.insert(key.end(), weightsShape.begin(), weightsShape.end());
+    for (const Fraction& f : { shapeMultiplier.m_H, shapeMultiplier.m_W, shapeMultiplier.m_C })
+    {
+        key.push_back(f.m_Numerator);
+        key.push_back(f.m_Denominator);
+    }
+    key.push_back(inputStaticAndOffset.first);
+    key.push_back(inputStaticAndOffset.second);
+    key.push_back(depthMax);
+    key.push_back(maxNumWeightBuffersInTile);
+    key.push_back(maxNumInputBuffersInTile);
+    sramAllocator.AppendFreeMemorySnapshot(key);
+
+    const StripeShapeCache::Result* cached = cache.Find(capabilities, key);
+    if (cached != nullptr && !cached->m_Success)
+    {
         return false;
     }
 
+    StripeShapeCache::Result result =
+        cached != nullptr ? *cached
+                          : CalculateStripeShapes(requestedOutputStripe, inputShape, outputShape, weightsFormat,
+                                                  weightsShape, capabilities, shapeMultiplier, inputStaticAndOffset,
+                                                  depthMax, maxNumWeightBuffersInTile, maxNumInputBuffersInTile);
+
+    // The allocation is repeated even when the result is cached, so that the allocator ends up in exactly the same
+    // state. This only happens once per successful TrySetup so is cheap compared to the failures that are skipped.
     SramAllocator currentSramAllocator = sramAllocator;
-    AllocationResult allocationResults =
-        FitsInSram(currentSramAllocator, capabilities, inputTile, weightTile, outputTile, inputStaticAndOffset);
-    if (!allocationResults.m_Success)
+    AllocationResult allocationResults = {};
+    allocationResults.m_Success        = false;
+    if (result.m_Success)
+    {
+        allocationResults = FitsInSram(currentSramAllocator, capabilities, result.m_InputTile, result.m_WeightTile,
+                                       result.m_OutputTile, inputStaticAndOffset);
+        assert(cached == nullptr || allocationResults.m_Success);
+        result.m_Success = allocationResults.m_Success;
+    }
+
+    if (cached == nullptr)
+    {
+        cache.Insert(std::move(key), result);
+    }
+    if (!result.m_Success)
     {
         return false;
     }
-    outTensorConfig.inputAllocation.stripeShape   = inputStripe;
-    outTensorConfig.inputAllocation.tileSize      = inputTile;
-    outTensorConfig.outputAllocation.stripeShape  = outputStripe;
-    outTensorConfig.outputAllocation.tileSize     = outputTile;
-    outTensorConfig.weightsAllocation.stripeShape = weightStripe;
-    outTensorConfig.weightsAllocation.tileSize    = weightTile;
+    outTensorConfig.inputAllocation.stripeShape   = result.m_InputStripe;
+    outTensorConfig.inputAllocation.tileSize      = result.m_InputTile;
+    outTensorConfig.outputAllocation.stripeShape  = result.m_OutputStripe;
+    outTensorConfig.outputAllocation.tileSize     = result.m_OutputTile;
+    outTensorConfig.weightsAllocation.stripeShape = result.m_WeightStripe;
+    outTensorConfig.weightsAllocation.tileSize    = result.m_WeightTile;
     // If we succeeded in finding a strategy, update the sram allocation state
     sramAllocator = currentSramAllocator;
     FillTensorConfigOffsets(allocationResults, outTensorConfig);
@@ -222,6 +296,34 @@ bool TryStripeShapes(SramAllocator& sramAllocator,
 
 using namespace utils;
 
+const StripeShapeCache::Result* StripeShapeCache::Find(const HardwareCapabilities& capabilities,
+                                                       const std::vector<uint32_t>& key)
+{
+    if (m_Capabilities != &capabilities)
+    {
+        m_Results.clear();
+        m_Capabilities = &capabilities;
+        return nullptr;
+    }
+    auto it = m_Results.find(key);
+    return it != m_Results.end() ? &it->second : nullptr;
+}
+
+size_t StripeShapeCache::KeyHash::operator()(const std::vector<uint32_t>& key) const
+{
+    size_t hash = key.size();
+    for (uint32_t value : key)
+    {
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+void StripeShapeCache::Insert(std::vector<uint32_t> key, const Result& result)
+{
+    m_Results.emplace(std::move(key), result);
+}
+
 bool Strategy0::TrySetup(TensorConfig& tensorConfig,
                          SramAllocator& sramAllocator,
                          const TensorShape& inputShape,
@@ -259,10 +361,10 @@ bool Strategy0::TrySetup(TensorConfig& tensorConfig,
 
     for (auto params : paramsList)
     {
-        if (TryStripeShapes(sramAllocator, { 1, params.outputStripeHeight, outputShape[2], outputShape[3] }, inputShape,
-                            outputShape, weightsFormat, weightsShape, capabilities, shapeMultiplier,
-                            inputStaticAndOffset, tensorConfig, depthMax, g_DefaultMaxNumWeightBuffersInTile,
-                            params.numInputBuffers))
+        if (TryStripeShapes(m_StripeShapeCache, sramAllocator,
+                            { 1, params.outputStripeHeight, outputShape[2], outputShape[3] }, inputShape, outputShape,
+                            weightsFormat, weightsShape, capabilities, shapeMultiplier, inputStaticAndOffset,
+                            tensorConfig, depthMax, g_DefaultMaxNumWeightBuffersInTile, params.numInputBuffers))
         {
             tensorConfig.blockWidth  = blockConfig.m_BlockWidth();
             tensorConfig.blockHeight = blockConfig.m_BlockHeight();
@@ -288,9 +390,10 @@ bool Strategy1::TrySetup(TensorConfig& tensorConfig,
                          const uint32_t depthMax)
 {
     auto TrySolution = [&](const uint32_t outputStripeChannels, uint32_t numWeightBuffers) {
-        if (TryStripeShapes(sramAllocator, { 1, outputShape[1], outputShape[2], outputStripeChannels }, inputShape,
-                            outputShape, weightsFormat, weightsShape, capabilities, shapeMultiplier,
-                            inputStaticAndOffset, tensorConfig, depthMax, numWeightBuffers))
+        if (TryStripeShapes(m_StripeShapeCache, sramAllocator,
+                            { 1, outputShape[1], outputShape[2], outputStripeChannels }, inputShape, outputShape,
+                            weightsFormat, weightsShape, capabilities, shapeMultiplier, inputStaticAndOffset,
+                            tensorConfig, depthMax, numWeightBuffers))
         {
             tensorConfig.blockWidth  = blockConfig.m_BlockWidth();
             tensorConfig.blockHeight = blockConfig.m_BlockHeight();
@@ -346,8 +449,8 @@ bool Strategy3::TrySetup(TensorConfig& tensorConfig,
                          CompilerMceAlgorithm,
                          const uint32_t depthMax)
 {
-    if (TryStripeShapes(sramAllocator, outputShape, inputShape, outputShape, weightsFormat, weightsShape, capabilities,
-                        shapeMultiplier, inputStaticAndOffset, tensorConfig, depthMax))
+    if (TryStripeShapes(m_StripeShapeCache, sramAllocator, outputShape, inputShape, outputShape, weightsFormat,
+                        weightsShape, capabilities, shapeMultiplier, inputStaticAndOffset, tensorConfig, depthMax))
     {
         tensorConfig.blockWidth  = blockConfig.m_BlockWidth();
         tensorConfig.blockHeight = blockConfig.m_BlockHeight();
@@ -541,7 +644,7 @@ bool Strategy6::TrySetup(TensorConfig& tensorConfig,
 
     for (auto params : paramsList)
     {
-        if (TryStripeShapes(originalSramAllocator,
+        if (TryStripeShapes(m_StripeShapeCache, originalSramAllocator,
                             { 1, params.outputStripeHeight, params.outputStripeWidth, params.outputStripeChannel },
                             inputShape, outputShape, weightsFormat, weightsShape, capabilities, shapeMultiplier,
                             inputStaticAndOffset, tensorConfig, depthMax))
@@ -588,9 +691,10 @@ bool Strategy7::TrySetup(TensorConfig& tensorConfig,
 
     auto TrySolution = [&](const uint32_t outputStripeHeight, const uint32_t outputStripeChannels,
                            uint32_t numWeightBuffers) {
-        if (TryStripeShapes(sramAllocator, { 1, outputStripeHeight, outputShape[2], outputStripeChannels }, inputShape,
-                            outputShape, weightsFormat, weightsShape, capabilities, shapeMultiplier,
-                            inputStaticAndOffset, tensorConfig, depthMax, numWeightBuffers))
+        if (TryStripeShapes(m_StripeShapeCache, sramAllocator,
+                            { 1, outputStripeHeight, outputShape[2], outputStripeChannels }, inputShape, outputShape,
+                            weightsFormat, weightsShape, capabilities, shapeMultiplier, inputStaticAndOffset,
+                            tensorConfig, depthMax, numWeightBuffers))
         {
             tensorConfig.blockWidth  = blockConfig.m_BlockWidth();
             tensorConfig.blockHeight = blockConfig.m_BlockHeight();
@@ -11,6 +11,9 @@
 
 #include <ethosn_command_stream/CommandStream.hpp>
 
+#include <unordered_map>
+#include <vector>
+
 namespace ethosn
 {
 namespace support_library
@@ -33,6 +36,40 @@ enum class Strategy
     STRATEGY_FC
 };
 
+/// Memoizes the stripe shape search done by the strategies, which is repeated with the same arguments for every
+/// block config and every set of nodes that is tried when creating the passes. The results depend on the state of
+/// the SRAM allocator so this is part of the key. Failures are cached as well as successes.
+class StripeShapeCache
+{
+public:
+    /// The stripe and tile sizes chosen by a successful search.
+    struct Result
+    {
+        bool m_Success;
+        TensorShape m_InputStripe;
+        TensorShape m_OutputStripe;
+        TensorShape m_WeightStripe;
+        uint32_t m_InputTile;
+        uint32_t m_OutputTile;
+        uint32_t m_WeightTile;
+    };
+
+    /// Returns the result previously stored for the given key, or nullptr if there isn't one.
+    const Result* Find(const HardwareCapabilities& capabilities, const std::vector<uint32_t>& key);
+
+    void Insert(std::vector<uint32_t> key, const Result& result);
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const std::vector<uint32_t>& key) const;
+    };
+
+    /// The results are only valid for the capabilities they were calculated with.
+    const HardwareCapabilities* m_Capabilities = nullptr;
+    std::unordered_map<std::vector<uint32_t>, Result, KeyHash> m_Results;
+};
+
 class IStrategy
 {
 public:
@@ -75,6 +112,9 @@ public:
                           const uint32_t depthMax = UINT32_MAX) override;
 
     virtual const char* GetStrategyString() override;
+
+private:
+    StripeShapeCache m_StripeShapeCache;
 };
 
 /// SRAM allocation strategy where the weights are "streamed" in one depth stripe at a time.
@@ -97,6 +137,9 @@ public:
                           const uint32_t depthMax = UINT32_MAX) override;
 
     virtual const char* GetStrategyString() override;
+
+private:
+    StripeShapeCache m_StripeShapeCache;
 };
 
 /// SRAM allocation strategy where input feature maps and weights are copied all at once.
@@ -117,6 +160,9 @@ public:
                           const uint32_t depthMax = UINT32_MAX) override;
 
     virtual const char* GetStrategyString() override;
+
+private:
+    StripeShapeCache m_StripeShapeCache;
 };
 
 /// Implementation of the SRAM allocation strategy 4 where the input width
@@ -159,6 +205,9 @@ public:
                           const uint32_t depthMax = UINT32_MAX) override;
 
     virtual const char* GetStrategyString() override;
+
+private:
+    StripeShapeCache m_StripeShapeCache;
 };
 
 /// This strategy is similar to strategy 1, however splits the IFM along depth.
@@ -180,6 +229,9 @@ public:
                           const uint32_t depthMax = UINT32_MAX) override;
 
     virtual const char* GetStrategyString() override;
+
+private:
+    StripeShapeCache m_StripeShapeCache;
 };
 
 /// SRAM allocation strategy for fully connected
@@ -0,0 +1,136 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/CapabilitiesInternal.hpp"
+#include "../src/Utils.hpp"
+#include "../src/cascading/Cascading.hpp"
+#include "../src/cascading/Estimation.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+
+#include <algorithm>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// Grows the seeds of the given parts in the same way as Cascading::Combine, until they first need to be pruned.
+Combinations GrowUntilPruned(const GraphOfParts& parts, const Metadata& metadata, const HardwareCapabilities& caps)
+{
+    Combinations currSeeds = CreateSeeds(parts, metadata, caps);
+    while (true)
+    {
+        GrownSeeds grownSeeds = GrowSeeds(currSeeds, parts, 0U, metadata, caps, GrowScheme::MergeOnly);
+        if (grownSeeds.m_Combinations.empty() || grownSeeds.m_Terminated)
+        {
+            return currSeeds;
+        }
+        currSeeds = grownSeeds.m_Combinations;
+    }
+}
+
+utils::Optional<uint64_t> EstimateMetric(const Combination& comb,
+                                         const GraphOfParts& parts,
+                                         const HardwareCapabilities& caps,
+                                         const EstimationOptions& estOpt)
+{
+    try
+    {
+        const OpGraph opGraph = GetOpGraphForCombination(comb, parts);
+        return utils::GetMetric(EstimateOpGraph(opGraph, caps, estOpt).m_PerfData);
+    }
+    catch (const NotSupportedException&)
+    {
+        return {};
+    }
+}
+
+bool HaveSamePlans(const Combination& lhs, const Combination& rhs)
+{
+    auto isSamePlan = [](const Elem& l, const Elem& r) { return l.m_PartId == r.m_PartId && l.m_PlanId == r.m_PlanId; };
+    return std::equal(lhs.m_Elems.begin(), lhs.m_Elems.end(), rhs.m_Elems.begin(), rhs.m_Elems.end(), isSamePlan);
+}
+
+}    // namespace
+
+// The first seeds of a chain of two convolutions on 56x56x256 end with the plan of the first convolution, which can't
+// be estimated without the convolution that consumes its output. Without looking ahead to that plan every seed failed
+// to estimate and the first one was kept, even though others lead to much less DRAM traffic.
+TEST_CASE("PruneCombinations estimates the seeds together with the plans they are linked to")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const HardwareCapabilities hwCaps(GetValidCapabilities(caps));
+    const EstimationOptions estOpt;
+    const CompilationOptions compOpt;
+
+    std::shared_ptr<Network> network = CreateNetwork(caps);
+    std::shared_ptr<Operand> x =
+        AddInput(network, TensorInfo({ 1, 56, 56, 256 }, DataType::UINT8_QUANTIZED, DataFormat::NHWC,
+                                     QuantizationInfo(0, 0.1f)))
+            .tensor;
+    x = AddConvolutionLayer(network, *x, 3, 256);
+    x = AddConvolutionLayer(network, *x, 3, 256);
+    AddOutput(network, *x);
+    const Graph graph = CreateOptimizedGraph(*network, hwCaps, estOpt);
+
+    GraphOfParts parts = CreateGraphOfParts(graph, estOpt, compOpt, hwCaps);
+    for (std::unique_ptr<Part>& part : parts.m_Parts)
+    {
+        part->CreatePlans();
+    }
+    const Metadata metadata    = CreateMetadata(parts, hwCaps);
+    const Combinations toPrune = GrowUntilPruned(parts, metadata, hwCaps);
+    REQUIRE(toPrune.size() > 1);
+
+    SECTION("AddPendingPlans")
+    {
+        for (const Combination& comb : toPrune)
+        {
+            const Combination withPending = AddPendingPlans(comb, parts);
+            REQUIRE(withPending.m_Elems.size() == comb.m_Elems.size() + 1);
+            Combination withoutPending = withPending;
+            withoutPending.m_Elems.pop_back();
+            CHECK(HaveSamePlans(comb, withoutPending));
+
+            // The appended plan is the one that the last plan of the seed is linked to.
+            const Elem& pending = withPending.m_Elems.back();
+            const Elem& last    = comb.m_Elems.back();
+            REQUIRE(last.m_Glues.size() == 1);
+            CHECK(last.m_Glues.begin()->second.m_Id == pending.m_PlanId);
+            CHECK(parts.GetInputPart(*last.m_Glues.begin()->first).second == pending.m_PartId);
+        }
+    }
+
+    SECTION("PruneCombinations")
+    {
+        utils::Optional<uint64_t> bestMetric;
+        for (const Combination& comb : toPrune)
+        {
+            // None of the seeds can be estimated on their own, which is what made them all look the same.
+            CHECK(!EstimateMetric(comb, parts, hwCaps, estOpt).has_value());
+
+            const utils::Optional<uint64_t> metric =
+                EstimateMetric(AddPendingPlans(comb, parts), parts, hwCaps, estOpt);
+            REQUIRE(metric.has_value());
+            if (!bestMetric.has_value() || metric.value() < bestMetric.value())
+            {
+                bestMetric = metric;
+            }
+        }
+
+        const Combination pruned = PruneCombinations(parts, hwCaps, toPrune, estOpt);
+        const utils::Optional<uint64_t> prunedMetric =
+            EstimateMetric(AddPendingPlans(pruned, parts), parts, hwCaps, estOpt);
+        REQUIRE(prunedMetric.has_value());
+        CHECK(prunedMetric.value() == bestMetric.value());
+
+        // The first seed, which used to be kept, is worse.
+        const utils::Optional<uint64_t> firstMetric =
+            EstimateMetric(AddPendingPlans(toPrune.front(), parts), parts, hwCaps, estOpt);
+        CHECK(prunedMetric.value() < firstMetric.value());
+    }
+}
@@ -0,0 +1,220 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_support_library/Support.hpp"
+#include "../src/CapabilitiesInternal.hpp"
+#include "../src/Compiler.hpp"
+#include "../src/Network.hpp"
+#include "../src/WeightEncoder.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+
+#include <limits>
+#include <sstream>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// Creates a network of two convolutions of a 32x32x16 input, as an estimation network for the given capabilities.
+std::shared_ptr<Network> CreateTwoConvolutionNetwork(const std::vector<char>& caps)
+{
+    std::shared_ptr<Network> network = CreateEstimationNetwork(caps);
+    std::shared_ptr<Operand> input =
+        AddInput(network, TensorInfo({ 1, 32, 32, 16 }, DataType::UINT8_QUANTIZED, DataFormat::NHWC,
+                                     QuantizationInfo(0, 0.1f)))
+            .tensor;
+    std::shared_ptr<Operand> conv = AddConvolutionLayer(network, *input, 3, 32);
+    AddOutput(network, *AddConvolutionLayer(network, *conv, 1, 16));
+    return network;
+}
+
+/// A chain of three convolutions of a 128x128x64 input, whose intermediate tensors are too big to be kept in Sram.
+struct ThreeConvolutionNetwork
+{
+    ThreeConvolutionNetwork(const std::vector<char>& caps)
+        : m_Network(CreateEstimationNetwork(caps))
+    {
+        std::shared_ptr<Operand> input =
+            AddInput(m_Network, TensorInfo({ 1, 128, 128, 64 }, DataType::UINT8_QUANTIZED, DataFormat::NHWC,
+                                           QuantizationInfo(0, 0.1f)))
+                .tensor;
+        std::shared_ptr<Operand> first  = AddConvolutionLayer(m_Network, *input, 3, 64);
+        std::shared_ptr<Operand> second = AddConvolutionLayer(m_Network, *first, 1, 64);
+        std::shared_ptr<Operand> third  = AddConvolutionLayer(m_Network, *second, 1, 64);
+        AddOutput(m_Network, *third);
+
+        m_SecondId = second->GetProducer().GetId();
+        m_ThirdId  = third->GetProducer().GetId();
+    }
+
+    std::shared_ptr<Network> m_Network;
+    uint32_t m_SecondId;
+    uint32_t m_ThirdId;
+};
+
+uint64_t InputDram(const PassPerformanceData& pass)
+{
+    const MemoryStats& stats = pass.m_Stats.m_Input.m_MemoryStats;
+    return uint64_t{ stats.m_DramParallel } + stats.m_DramNonParallel;
+}
+
+uint64_t OutputDram(const PassPerformanceData& pass)
+{
+    const MemoryStats& stats = pass.m_Stats.m_Output.m_MemoryStats;
+    return uint64_t{ stats.m_DramParallel } + stats.m_DramNonParallel;
+}
+
+std::string ToJson(const NetworkPerformanceData& perfData)
+{
+    std::stringstream json;
+    PrintNetworkPerformanceDataJson(json, 0, perfData);
+    return json.str();
+}
+
+}    // namespace
+
+TEST_CASE("Estimating several configurations at once matches estimating them one by one")
+{
+    const std::vector<std::pair<EthosNVariant, uint32_t>> configurations = {
+        { EthosNVariant::ETHOS_N77, 0 },
+        { EthosNVariant::ETHOS_N57, 0 },
+        { EthosNVariant::ETHOS_N78_1TOPS_2PLE_RATIO, 0 },
+        { EthosNVariant::ETHOS_N78_1TOPS_4PLE_RATIO, 0 },
+        { EthosNVariant::ETHOS_N78_4TOPS_2PLE_RATIO, 512 * 1024 },
+        { EthosNVariant::ETHOS_N78_4TOPS_2PLE_RATIO, 0 },
+    };
+    const CompilationOptions compilationOptions;
+    const EstimationOptions estimationOptions;
+
+    std::shared_ptr<Network> network =
+        CreateTwoConvolutionNetwork(GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77));
+    const std::vector<NetworkPerformanceData> together =
+        EstimatePerformance(*network, compilationOptions, estimationOptions, configurations);
+    REQUIRE(together.size() == configurations.size());
+
+    for (size_t i = 0; i < configurations.size(); ++i)
+    {
+        INFO("Configuration " << EthosNVariantAsString(configurations[i].first) << ", "
+                              << configurations[i].second << " bytes of SRAM");
+        const std::vector<char> caps = GetFwAndHwCapabilities(configurations[i].first, configurations[i].second);
+        const NetworkPerformanceData alone =
+            EstimatePerformance(*CreateTwoConvolutionNetwork(caps), compilationOptions, estimationOptions);
+
+        CHECK(!together[i].m_Stream.empty());
+        CHECK(ToJson(together[i]) == ToJson(alone));
+    }
+}
+
+// The two variants only differ in their number of PLE lanes, which doesn't change how the weights are encoded.
+TEST_CASE("SharedWeightEncoderCache reuses the weights encoded for another configuration")
+{
+    const CompilationOptions compilationOptions;
+    const EstimationOptions estimationOptions;
+    const std::vector<char> caps2Ple = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N78_1TOPS_2PLE_RATIO);
+    const std::vector<char> caps4Ple = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N78_1TOPS_4PLE_RATIO);
+    std::shared_ptr<Network> network = CreateTwoConvolutionNetwork(caps2Ple);
+
+    SharedWeightEncoderCache cache;
+
+    Compiler compiler2Ple(*network, GetValidCapabilities(caps2Ple), compilationOptions, estimationOptions, &cache);
+    const NetworkPerformanceData perf2Ple = compiler2Ple.EstimatePerformance();
+    const size_t numEncodes               = cache.GetNumEncodes();
+    REQUIRE(numEncodes > 0);
+
+    // Estimating the same configuration again encodes nothing new.
+    Compiler compilerAgain(*network, GetValidCapabilities(caps2Ple), compilationOptions, estimationOptions, &cache);
+    CHECK(ToJson(compilerAgain.EstimatePerformance()) == ToJson(perf2Ple));
+    CHECK(cache.GetNumEncodes() == numEncodes);
+
+    // Nor does another configuration which encodes the weights in the same way.
+    Compiler compiler4Ple(*network, GetValidCapabilities(caps4Ple), compilationOptions, estimationOptions, &cache);
+    const NetworkPerformanceData perf4Ple = compiler4Ple.EstimatePerformance();
+    CHECK(cache.GetNumEncodes() == numEncodes);
+
+    // Which gives the same results as without the cache.
+    Compiler uncached(*network, GetValidCapabilities(caps4Ple), compilationOptions, estimationOptions);
+    CHECK(ToJson(perf4Ple) == ToJson(uncached.EstimatePerformance()));
+}
+
+TEST_CASE("EstimatePerformance rejects activation compression savings outside of [0, 1]")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const ThreeConvolutionNetwork network(caps);
+    const CompilationOptions compilationOptions;
+
+    EstimationOptions estimationOptions;
+    estimationOptions.m_Current = true;
+
+    SECTION("In range")
+    {
+        const float saving = GENERATE(0.0f, 0.5f, 1.0f);
+        estimationOptions.m_ActivationCompressionSavings[network.m_SecondId] = saving;
+        CHECK_NOTHROW(EstimatePerformance(*network.m_Network, compilationOptions, estimationOptions));
+    }
+
+    SECTION("Out of range")
+    {
+        const float saving = GENERATE(-0.1f, 1.1f, std::numeric_limits<float>::quiet_NaN(),
+                                      std::numeric_limits<float>::infinity());
+        INFO("Saving " << saving);
+        estimationOptions.m_ActivationCompressionSavings[network.m_SecondId] = saving;
+
+        CHECK_THROWS_AS(EstimatePerformance(*network.m_Network, compilationOptions, estimationOptions),
+                        NotSupportedException);
+        CHECK_THROWS_AS(EstimatePerformance(*network.m_Network, compilationOptions, estimationOptions,
+                                            { { EthosNVariant::ETHOS_N77, 0 } }),
+                        NotSupportedException);
+    }
+}
+
+// The output of the second convolution is written to Dram by its pass and read back by the pass of the third one.
+TEST_CASE("A measured activation compression saving only changes the Dram traffic of the output of its operation")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const ThreeConvolutionNetwork network(caps);
+    const CompilationOptions compilationOptions;
+
+    EstimationOptions estimationOptions;
+    estimationOptions.m_Current = true;
+    // The measured saving takes precedence over the default one, which still applies to the other tensors.
+    estimationOptions.m_ActivationCompressionSaving = GENERATE(0.0f, 0.25f);
+    INFO("Default saving " << estimationOptions.m_ActivationCompressionSaving);
+
+    const NetworkPerformanceData baseline =
+        EstimatePerformance(*network.m_Network, compilationOptions, estimationOptions);
+
+    estimationOptions.m_ActivationCompressionSavings[network.m_SecondId] = 0.5f;
+    const NetworkPerformanceData perfData =
+        EstimatePerformance(*network.m_Network, compilationOptions, estimationOptions);
+    REQUIRE(perfData.m_Stream.size() == baseline.m_Stream.size());
+
+    bool producerFound = false;
+    bool consumerFound = false;
+    for (size_t i = 0; i < perfData.m_Stream.size(); ++i)
+    {
+        const PassPerformanceData& pass         = perfData.m_Stream[i];
+        const PassPerformanceData& baselinePass = baseline.m_Stream[i];
+        REQUIRE(pass.m_OperationIds == baselinePass.m_OperationIds);
+
+        const bool isProducer = pass.m_OperationIds.count(network.m_SecondId) > 0;
+        const bool isConsumer = pass.m_OperationIds.count(network.m_ThirdId) > 0;
+        producerFound |= isProducer;
+        consumerFound |= isConsumer;
+
+        // The saved proportion of the 128x128x64 tensor, which isn't converted to another format.
+        const uint64_t compressedSize = 128 * 128 * 64 / 2;
+        CHECK(OutputDram(pass) == (isProducer ? compressedSize : OutputDram(baselinePass)));
+        CHECK(InputDram(pass) == (isConsumer ? compressedSize : InputDram(baselinePass)));
+        CHECK(pass.m_Stats.m_Weights.m_MemoryStats.m_DramParallel ==
+              baselinePass.m_Stats.m_Weights.m_MemoryStats.m_DramParallel);
+        CHECK(pass.m_Stats.m_Weights.m_MemoryStats.m_DramNonParallel ==
+              baselinePass.m_Stats.m_Weights.m_MemoryStats.m_DramNonParallel);
+    }
+    CHECK(producerFound);
+    CHECK(consumerFound);
+}
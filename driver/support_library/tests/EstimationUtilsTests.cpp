@@ -0,0 +1,88 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/cascading/EstimationUtils.hpp"
+
+#include <catch.hpp>
+
+#include <limits>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// Stats of a pass whose input is loaded once and kept in Sram while numWeightsStripes weights stripes are
+/// streamed through, with the first stripe of each not transferred in parallel.
+PassStats CreatePassStats(uint32_t inputDram, uint32_t weightsDram, uint32_t numWeightsStripes)
+{
+    PassStats stats;
+    stats.m_Input.m_MemoryStats.m_DramNonParallel      = inputDram / 10;
+    stats.m_Input.m_MemoryStats.m_DramParallel         = inputDram - inputDram / 10;
+    stats.m_Weights.m_MemoryStats.m_DramNonParallel    = weightsDram / numWeightsStripes;
+    stats.m_Weights.m_MemoryStats.m_DramParallel       = weightsDram - weightsDram / numWeightsStripes;
+    stats.m_Weights.m_StripesStats.m_NumCentralStripes = numWeightsStripes;
+    return stats;
+}
+
+uint64_t InputDram(const PassStats& stats)
+{
+    return uint64_t{ stats.m_Input.m_MemoryStats.m_DramParallel } + stats.m_Input.m_MemoryStats.m_DramNonParallel;
+}
+
+uint64_t WeightsDram(const PassStats& stats)
+{
+    return uint64_t{ stats.m_Weights.m_MemoryStats.m_DramParallel } + stats.m_Weights.m_MemoryStats.m_DramNonParallel;
+}
+
+}    // namespace
+
+TEST_CASE("AccountForBatching shares the weights traffic between the images of a batch")
+{
+    // Weights bound: a small input against many weights.
+    const PassStats stats = CreatePassStats(10000, 4000000, 4);
+
+    CHECK(WeightsDram(AccountForBatching(stats, 1)) == WeightsDram(stats));
+    CHECK(InputDram(AccountForBatching(stats, 1)) == InputDram(stats));
+
+    const uint32_t batchSize = GENERATE(2U, 8U, 100U);
+    const PassStats batched  = AccountForBatching(stats, batchSize);
+
+    // Each image brings in its share of the weights and reloads its input for every weights stripe.
+    CHECK(WeightsDram(batched) == 4000000 / batchSize);
+    CHECK(InputDram(batched) == 4 * 10000);
+    CHECK(batched.m_Input.m_MemoryStats.m_DramNonParallel == stats.m_Input.m_MemoryStats.m_DramNonParallel);
+    CHECK(batched.m_Input.m_StripesStats.m_NumReloads == 3);
+
+    // The bigger the batch, the less data is transferred per image.
+    CHECK(InputDram(batched) + WeightsDram(batched) < InputDram(stats) + WeightsDram(stats));
+    CHECK(WeightsDram(AccountForBatching(stats, batchSize * 2)) < WeightsDram(batched));
+}
+
+TEST_CASE("AccountForBatching keeps the stats of a pass which batching doesn't help")
+{
+    // Input bound: reloading the input for every weights stripe costs more than sharing the weights saves.
+    const PassStats stats   = CreatePassStats(4000000, 10000, 4);
+    const PassStats batched = AccountForBatching(stats, 16);
+
+    CHECK(InputDram(batched) == InputDram(stats));
+    CHECK(WeightsDram(batched) == WeightsDram(stats));
+}
+
+TEST_CASE("AccountForBatching saturates rather than overflows")
+{
+    // Neither the input reloaded for every weights stripe nor the total weights fit in 32 bits.
+    const uint32_t max = std::numeric_limits<uint32_t>::max();
+    PassStats stats    = CreatePassStats(1000000000, 0, 8);
+    stats.m_Weights.m_MemoryStats.m_DramNonParallel = max;
+    stats.m_Weights.m_MemoryStats.m_DramParallel    = max;
+
+    const PassStats batched = AccountForBatching(stats, 64);
+
+    CHECK(batched.m_Input.m_MemoryStats.m_DramParallel == max);
+    CHECK(batched.m_Input.m_MemoryStats.m_DramNonParallel == stats.m_Input.m_MemoryStats.m_DramNonParallel);
+    CHECK(batched.m_Weights.m_MemoryStats.m_DramNonParallel == max / 64 + 1);
+    CHECK(batched.m_Weights.m_MemoryStats.m_DramParallel == max / 64 + 1);
+}
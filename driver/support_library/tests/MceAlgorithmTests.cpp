@@ -0,0 +1,146 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/CapabilitiesInternal.hpp"
+#include "../src/Compiler.hpp"
+#include "../src/Graph.hpp"
+#include "../src/GraphNodes.hpp"
+#include "../src/Utils.hpp"
+#include "../src/cascading/Cascading.hpp"
+#include "../src/cascading/MceEstimationUtils.hpp"
+#include "../src/cascading/Part.hpp"
+#include "../src/cascading/Plan.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+
+#include <algorithm>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// Compiles the network with the non-cascading compiler and returns the algorithm chosen for its only convolution.
+CompilerMceAlgorithm CompileAndGetAlgorithm(const Network& network)
+{
+    CompilationOptions options;
+    std::vector<std::unique_ptr<CompiledNetwork>> compiledNetworks = Compile(network, options);
+    REQUIRE(compiledNetworks.size() == 1);
+    const CompiledNetworkImpl* compiledNetwork = dynamic_cast<const CompiledNetworkImpl*>(compiledNetworks[0].get());
+    REQUIRE(compiledNetwork != nullptr);
+    REQUIRE(compiledNetwork->GetWeightsEncodingInfos().size() == 1);
+    return compiledNetwork->GetWeightsEncodingInfos()[0].m_Algorithm;
+}
+
+/// Creates the cascading plans of the Part holding the only convolution of the network and returns the algorithms
+/// chosen by each of them.
+std::vector<CompilerMceAlgorithm> CreatePlansAndGetAlgorithms(const Network& network, const std::vector<char>& caps)
+{
+    const HardwareCapabilities hwCaps(GetValidCapabilities(caps));
+    const EstimationOptions estOpt;
+    const CompilationOptions compOpt;
+    const Graph graph = CreateOptimizedGraph(network, hwCaps, estOpt);
+    GraphOfParts graphOfParts = CreateGraphOfParts(graph, estOpt, compOpt, hwCaps);
+
+    std::vector<CompilerMceAlgorithm> algorithms;
+    for (std::unique_ptr<Part>& part : graphOfParts.m_Parts)
+    {
+        if (!IsObjectOfType<MceOperationNode>(part->m_SubGraph.front()))
+        {
+            continue;
+        }
+        part->CreatePlans();
+        for (const std::unique_ptr<Plan>& plan : part->m_Plans)
+        {
+            for (Op* op : plan->m_OpGraph.GetOps())
+            {
+                if (const MceOp* mceOp = dynamic_cast<const MceOp*>(op))
+                {
+                    algorithms.push_back(mceOp->m_Algo);
+                }
+            }
+        }
+    }
+    return algorithms;
+}
+
+size_t Count(const std::vector<CompilerMceAlgorithm>& algorithms, CompilerMceAlgorithm algorithm)
+{
+    return static_cast<size_t>(std::count(algorithms.begin(), algorithms.end(), algorithm));
+}
+
+}    // namespace
+
+// A 5x5 kernel is rounded up to 6x6 for Winograd, which needs 44% more weights. With few output elements to reuse
+// them for, the convolution is bound by the DRAM bandwidth needed to stream the weights, so Direct is faster.
+TEST_CASE("Direct is chosen for a convolution bound by its weights bandwidth")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    std::shared_ptr<Network> network = CreateConvolutionNetwork(caps, 7, 512, 5, 512);
+
+    SECTION("Non-cascading")
+    {
+        CHECK(CompileAndGetAlgorithm(*network) == CompilerMceAlgorithm::Direct);
+    }
+
+    SECTION("Cascading")
+    {
+        const std::vector<CompilerMceAlgorithm> algorithms = CreatePlansAndGetAlgorithms(*network, caps);
+        REQUIRE(!algorithms.empty());
+        CHECK(Count(algorithms, CompilerMceAlgorithm::Winograd) == 0);
+    }
+}
+
+// A 3x3 kernel is not rounded up and a large input reuses the weights many times, so the fewer MACs of Winograd win.
+TEST_CASE("Winograd is kept for a compute bound convolution")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    std::shared_ptr<Network> network = CreateConvolutionNetwork(caps, 56, 64, 3, 64);
+
+    SECTION("Non-cascading")
+    {
+        CHECK(CompileAndGetAlgorithm(*network) == CompilerMceAlgorithm::Winograd);
+    }
+
+    SECTION("Cascading")
+    {
+        const std::vector<CompilerMceAlgorithm> algorithms = CreatePlansAndGetAlgorithms(*network, caps);
+        REQUIRE(!algorithms.empty());
+        CHECK(Count(algorithms, CompilerMceAlgorithm::Direct) == 0);
+    }
+}
+
+// Whole-tensor stripes, with the input and output in SRAM, so that only the weights are transferred from DRAM.
+TEST_CASE("EstimateMceOperationCycles is bound by the nominal DRAM bandwidth")
+{
+    const HardwareCapabilities caps(GetValidCapabilities(GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77)));
+
+    auto estimate = [&](CompilerMceAlgorithm algorithm, uint32_t size, uint32_t numChannels, uint32_t kernelSize) {
+        const TensorInfo weightsInfo({ kernelSize, kernelSize, numChannels, numChannels }, DataType::UINT8_QUANTIZED,
+                                     DataFormat::HWIO, QuantizationInfo(0, 0.01f));
+        const TensorShape shape = { 1, size, size, numChannels };
+        const uint32_t weightsTileSize =
+            utils::EstimateWeightSizeBytes(utils::GetRoundedWeights(weightsInfo.m_Dimensions, algorithm), caps, false);
+        return EstimateMceOperationCycles(caps, Stride(1, 1), ethosn::command_stream::MceOperation::CONVOLUTION,
+                                          algorithm, shape, shape, Location::Sram, utils::TotalSizeBytesNHWCB(shape),
+                                          shape, shape, Location::Sram, weightsInfo, weightsTileSize);
+    };
+
+    SECTION("Bandwidth bound")
+    {
+        const uint64_t directCycles   = estimate(CompilerMceAlgorithm::Direct, 7, 512, 5);
+        const uint64_t winogradCycles = estimate(CompilerMceAlgorithm::Winograd, 7, 512, 5);
+        CHECK(directCycles < winogradCycles);
+        // The weights are loaded once so the estimate is at least their transfer time.
+        const uint32_t directWeightsBytes = utils::EstimateWeightSizeBytes({ 5, 5, 512, 512 }, caps, false);
+        CHECK(directCycles >= directWeightsBytes / g_NominalDramBytesPerCycle);
+    }
+
+    SECTION("Compute bound")
+    {
+        CHECK(estimate(CompilerMceAlgorithm::Winograd, 56, 64, 3) < estimate(CompilerMceAlgorithm::Direct, 56, 64, 3));
+    }
+}
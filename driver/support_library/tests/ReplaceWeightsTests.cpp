@@ -0,0 +1,198 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../include/ethosn_support_library/Support.hpp"
+#include "../src/Compiler.hpp"
+#include "../src/WeightEncoder.hpp"
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+using namespace ethosn::support_library;
+
+namespace
+{
+
+/// Creates a network of a convolution with "same" padding and a stride of 1, followed by a depthwise convolution,
+/// whose weights are given by weightAt(index in the weights data).
+std::shared_ptr<Network> CreateTwoLayerNetwork(const std::vector<char>& caps,
+                                               uint32_t kernelSize,
+                                               const std::function<uint8_t(size_t)>& weightAt)
+{
+    const uint32_t size        = 16;
+    const uint32_t numChannels = 16;
+
+    std::shared_ptr<Network> network = CreateNetwork(caps);
+    std::shared_ptr<Operand> input =
+        AddInput(network, TensorInfo({ 1, size, size, numChannels }, DataType::UINT8_QUANTIZED, DataFormat::NHWC,
+                                     QuantizationInfo(0, 0.1f)))
+            .tensor;
+
+    std::vector<uint8_t> weightsData(kernelSize * kernelSize * numChannels * numChannels);
+    for (size_t i = 0; i < weightsData.size(); ++i)
+    {
+        weightsData[i] = weightAt(i);
+    }
+    std::vector<uint8_t> depthwiseWeightsData(kernelSize * kernelSize * numChannels);
+    for (size_t i = 0; i < depthwiseWeightsData.size(); ++i)
+    {
+        depthwiseWeightsData[i] = weightAt(weightsData.size() + i);
+    }
+    const std::vector<int32_t> biasData(numChannels, 1);
+
+    const TensorInfo weightsInfo({ kernelSize, kernelSize, numChannels, numChannels }, DataType::UINT8_QUANTIZED,
+                                 DataFormat::HWIO, QuantizationInfo(0, 0.01f));
+    const TensorInfo depthwiseWeightsInfo({ kernelSize, kernelSize, numChannels, 1 }, DataType::UINT8_QUANTIZED,
+                                          DataFormat::HWIM, QuantizationInfo(0, 0.01f));
+    const TensorInfo biasInfo({ 1, 1, 1, numChannels }, DataType::INT32_QUANTIZED, DataFormat::NHWC,
+                              QuantizationInfo(0, 0.001f));
+
+    const uint32_t pad = kernelSize / 2;
+    const ConvolutionInfo convInfo(Padding(pad, pad, pad, pad), Stride(1, 1), QuantizationInfo(0, 0.1f));
+
+    std::shared_ptr<Constant> weights = AddConstant(network, weightsInfo, weightsData.data()).tensor;
+    std::shared_ptr<Constant> bias    = AddConstant(network, biasInfo, biasData.data()).tensor;
+    std::shared_ptr<Operand> conv     = AddConvolution(network, *input, *bias, *weights, convInfo).tensor;
+
+    std::shared_ptr<Constant> depthwiseWeights =
+        AddConstant(network, depthwiseWeightsInfo, depthwiseWeightsData.data()).tensor;
+    std::shared_ptr<Constant> depthwiseBias = AddConstant(network, biasInfo, biasData.data()).tensor;
+    std::shared_ptr<Operand> depthwise =
+        AddDepthwiseConvolution(network, *conv, *depthwiseBias, *depthwiseWeights, convInfo).tensor;
+
+    AddOutput(network, *depthwise);
+    return network;
+}
+
+uint8_t Arbitrary(size_t i)
+{
+    return static_cast<uint8_t>((i * 7U) % 251U);
+}
+
+/// Compresses much better than Arbitrary.
+uint8_t MostlyZero(size_t i)
+{
+    return i % 37 == 0 ? 3 : 0;
+}
+
+/// Compresses worse than Arbitrary.
+uint8_t Noise(size_t i)
+{
+    return static_cast<uint8_t>((i * 2654435761U) >> 13);
+}
+
+std::unique_ptr<CompiledNetwork> CompileNetwork(const Network& network, const CompilationOptions& options)
+{
+    std::vector<std::unique_ptr<CompiledNetwork>> compiledNetworks = Compile(network, options);
+    REQUIRE(compiledNetworks.size() == 1);
+    return std::move(compiledNetworks[0]);
+}
+
+bool SameBuffers(const std::vector<BufferInfo>& a, const std::vector<BufferInfo>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const BufferInfo& x, const BufferInfo& y) {
+        return x.m_Id == y.m_Id && x.m_Offset == y.m_Offset && x.m_Size == y.m_Size;
+    });
+}
+
+void CheckSameConstants(const CompiledNetwork& actual, const CompiledNetwork& expected)
+{
+    CHECK(actual.GetConstantDmaData() == expected.GetConstantDmaData());
+    CHECK(actual.GetConstantControlUnitData() == expected.GetConstantControlUnitData());
+    CHECK(SameBuffers(actual.GetConstantDmaDataBufferInfos(), expected.GetConstantDmaDataBufferInfos()));
+    CHECK(SameBuffers(actual.GetConstantControlUnitDataBufferInfos(),
+                      expected.GetConstantControlUnitDataBufferInfos()));
+}
+
+/// Serializes the compiled network and de-serializes it again, optionally dropping the trailing section with the
+/// WeightsEncodingInfos as if it was serialized by a version of the Support Library which didn't write it.
+std::unique_ptr<CompiledNetwork> SerializeRoundTrip(const CompiledNetwork& compiledNetwork,
+                                                    bool withWeightsEncodingInfos)
+{
+    std::stringstream stream;
+    compiledNetwork.Serialize(stream);
+    std::string serialized = stream.str();
+    if (!withWeightsEncodingInfos)
+    {
+        const size_t numInfos =
+            dynamic_cast<const CompiledNetworkImpl&>(compiledNetwork).GetWeightsEncodingInfos().size();
+        const size_t sectionSize = sizeof(uint32_t) + numInfos * sizeof(WeightsEncodingInfo);
+        REQUIRE(serialized.size() > sectionSize);
+        serialized.resize(serialized.size() - sectionSize);
+    }
+    std::stringstream in(serialized);
+    return DeserializeCompiledNetwork(in);
+}
+
+}    // namespace
+
+TEST_CASE("ReplaceWeights gives the same constants as compiling with the new weights")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const CompilationOptions options;
+
+    std::unique_ptr<CompiledNetwork> compiledNetwork =
+        CompileNetwork(*CreateTwoLayerNetwork(caps, 3, Arbitrary), options);
+    REQUIRE(dynamic_cast<const CompiledNetworkImpl&>(*compiledNetwork).GetWeightsEncodingInfos().size() == 2);
+
+    auto newWeights = GENERATE(as<uint8_t (*)(size_t)>(), MostlyZero, Noise, Arbitrary);
+    std::shared_ptr<Network> newNetwork = CreateTwoLayerNetwork(caps, 3, newWeights);
+
+    ReplaceWeights(*compiledNetwork, *newNetwork, options);
+
+    CheckSameConstants(*compiledNetwork, *CompileNetwork(*newNetwork, options));
+}
+
+TEST_CASE("ReplaceWeights after a serialization round trip")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const CompilationOptions options;
+
+    std::unique_ptr<CompiledNetwork> original = CompileNetwork(*CreateTwoLayerNetwork(caps, 3, Arbitrary), options);
+    std::shared_ptr<Network> newNetwork       = CreateTwoLayerNetwork(caps, 3, Noise);
+
+    SECTION("With the weights encoding section")
+    {
+        std::unique_ptr<CompiledNetwork> deserialized = SerializeRoundTrip(*original, true);
+        CheckSameConstants(*deserialized, *original);
+
+        ReplaceWeights(*deserialized, *newNetwork, options);
+
+        CheckSameConstants(*deserialized, *CompileNetwork(*newNetwork, options));
+    }
+
+    SECTION("Without the weights encoding section")
+    {
+        // Networks serialized before the section was added can still be loaded, but their weights can't be replaced.
+        std::unique_ptr<CompiledNetwork> deserialized = SerializeRoundTrip(*original, false);
+        CheckSameConstants(*deserialized, *original);
+
+        CHECK_THROWS_AS(ReplaceWeights(*deserialized, *newNetwork, options), NotSupportedException);
+
+        CheckSameConstants(*deserialized, *original);
+    }
+}
+
+TEST_CASE("ReplaceWeights rejects weights of a different shape")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const CompilationOptions options;
+
+    std::unique_ptr<CompiledNetwork> compiledNetwork =
+        CompileNetwork(*CreateTwoLayerNetwork(caps, 3, Arbitrary), options);
+    const std::unique_ptr<CompiledNetwork> original =
+        CompileNetwork(*CreateTwoLayerNetwork(caps, 3, Arbitrary), options);
+
+    // Same operations and output shape, with a 1x1 instead of a 3x3 kernel.
+    std::shared_ptr<Network> newNetwork = CreateTwoLayerNetwork(caps, 1, Noise);
+
+    CHECK_THROWS_AS(ReplaceWeights(*compiledNetwork, *newNetwork, options), NotSupportedException);
+
+    // Nothing is modified when the weights are rejected.
+    CheckSameConstants(*compiledNetwork, *original);
+}
@@ -0,0 +1,67 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "TestUtils.hpp"
+
+#include "../src/Network.hpp"
+#include "../src/Optimization.hpp"
+
+namespace ethosn
+{
+namespace support_library
+{
+
+std::shared_ptr<Operand> AddConvolutionLayer(const std::shared_ptr<Network>& network,
+                                             Operand& input,
+                                             uint32_t kernelSize,
+                                             uint32_t numOutputChannels)
+{
+    const uint32_t numInputChannels = input.GetTensorInfo().m_Dimensions[3];
+
+    std::vector<uint8_t> weightsData(kernelSize * kernelSize * numInputChannels * numOutputChannels);
+    for (size_t i = 0; i < weightsData.size(); ++i)
+    {
+        weightsData[i] = static_cast<uint8_t>((i * 7U) % 251U);
+    }
+    const std::vector<int32_t> biasData(numOutputChannels, 1);
+
+    const TensorInfo weightsInfo({ kernelSize, kernelSize, numInputChannels, numOutputChannels },
+                                 DataType::UINT8_QUANTIZED, DataFormat::HWIO, QuantizationInfo(0, 0.01f));
+    const TensorInfo biasInfo({ 1, 1, 1, numOutputChannels }, DataType::INT32_QUANTIZED, DataFormat::NHWC,
+                              QuantizationInfo(0, 0.001f));
+    std::shared_ptr<Constant> weights = AddConstant(network, weightsInfo, weightsData.data()).tensor;
+    std::shared_ptr<Constant> bias    = AddConstant(network, biasInfo, biasData.data()).tensor;
+
+    const uint32_t pad = kernelSize / 2;
+    const ConvolutionInfo convInfo(Padding(pad, pad, pad, pad), Stride(1, 1), QuantizationInfo(0, 0.1f));
+    return AddConvolution(network, input, *bias, *weights, convInfo).tensor;
+}
+
+std::shared_ptr<Network> CreateConvolutionNetwork(const std::vector<char>& caps,
+                                                  uint32_t size,
+                                                  uint32_t numInputChannels,
+                                                  uint32_t kernelSize,
+                                                  uint32_t numOutputChannels)
+{
+    std::shared_ptr<Network> network = CreateNetwork(caps);
+    std::shared_ptr<Operand> input =
+        AddInput(network, TensorInfo({ 1, size, size, numInputChannels }, DataType::UINT8_QUANTIZED,
+                                     DataFormat::NHWC, QuantizationInfo(0, 0.1f)))
+            .tensor;
+    AddOutput(network, *AddConvolutionLayer(network, *input, kernelSize, numOutputChannels));
+    return network;
+}
+
+Graph CreateOptimizedGraph(const Network& network,
+                           const HardwareCapabilities& capabilities,
+                           const EstimationOptions& estimationOptions)
+{
+    Graph graph(network, capabilities, estimationOptions);
+    OptimizeGraph(graph);
+    return graph;
+}
+
+}    // namespace support_library
+}    // namespace ethosn
@@ -0,0 +1,39 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+
+#include "../include/ethosn_support_library/Support.hpp"
+#include "../src/Graph.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ethosn
+{
+namespace support_library
+{
+
+/// Adds a convolution of the given kernel size and number of output channels to the network, with "same" padding
+/// and a stride of 1. The weights and bias are arbitrary but deterministic.
+std::shared_ptr<Operand> AddConvolutionLayer(const std::shared_ptr<Network>& network,
+                                             Operand& input,
+                                             uint32_t kernelSize,
+                                             uint32_t numOutputChannels);
+
+/// Creates a network of a single convolution of a (size x size x numInputChannels) input.
+std::shared_ptr<Network> CreateConvolutionNetwork(const std::vector<char>& caps,
+                                                  uint32_t size,
+                                                  uint32_t numInputChannels,
+                                                  uint32_t kernelSize,
+                                                  uint32_t numOutputChannels);
+
+/// Converts the network to a Graph and optimizes it, as is done before the cascading estimation.
+Graph CreateOptimizedGraph(const Network& network,
+                           const HardwareCapabilities& capabilities,
+                           const EstimationOptions& estimationOptions);
+
+}    // namespace support_library
+}    // namespace ethosn
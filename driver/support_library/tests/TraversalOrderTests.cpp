@@ -0,0 +1,100 @@
+//
+// Copyright © 2020 Arm Limited. All rights reserved.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "../src/CapabilitiesInternal.hpp"
+#include "../src/Utils.hpp"
+#include "../src/cascading/Cascading.hpp"
+#include "../src/cascading/EstimationUtils.hpp"
+#include "../src/cascading/MceEstimationUtils.hpp"
+#include "TestUtils.hpp"
+
+#include <catch.hpp>
+
+using namespace ethosn::support_library;
+
+// A 3x3 convolution from 256 to 1024 channels, whose 2.4MB of weights don't fit in Sram, computed in 4 stripes in
+// height and 64 stripes in depth. Traversing XYZ reloads the whole input for each output stripe in depth, whereas
+// traversing ZXY keeps each input stripe and reloads the weights for each of them instead, which is much less data.
+TEST_CASE("Traversing ZXY needs less DRAM traffic than XYZ when the input would be reloaded for each output depth")
+{
+    const HardwareCapabilities caps(GetValidCapabilities(GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77)));
+    const TensorInfo weightsInfo({ 3, 3, 256, 1024 }, DataType::UINT8_QUANTIZED, DataFormat::HWIO,
+                                 QuantizationInfo(0, 0.01f));
+    const TensorShape inputShape         = { 1, 28, 28, 256 };
+    const TensorShape inputStripeShape   = { 1, 8, 28, 256 };
+    const TensorShape outputShape        = { 1, 28, 28, 1024 };
+    const TensorShape outputStripeShape  = { 1, 8, 28, 16 };
+    const TensorShape weightsStripeShape = { 3, 3, 256, 16 };
+    const uint32_t inputTileSize         = 2 * utils::TotalSizeBytesNHWCB(inputStripeShape);
+    const uint32_t weightsTileSize       = 2 * utils::EstimateWeightSizeBytes(weightsStripeShape, caps, false);
+    const uint32_t numOutStripesC        = outputShape[3] / outputStripeShape[3];
+
+    SECTION("Input reloads")
+    {
+        const InputStats xyz = GetInputStats(caps, inputShape, inputStripeShape, Location::Dram, inputTileSize,
+                                             weightsInfo, numOutStripesC, TraversalOrder::Xyz);
+        const InputStats zxy = GetInputStats(caps, inputShape, inputStripeShape, Location::Dram, inputTileSize,
+                                             weightsInfo, numOutStripesC, TraversalOrder::Zxy);
+        CHECK(xyz.m_StripesStats.m_NumReloads == numOutStripesC - 1);
+        CHECK(zxy.m_StripesStats.m_NumReloads == 0);
+        CHECK(zxy.m_MemoryStats.m_DramNonParallel + zxy.m_MemoryStats.m_DramParallel <
+              xyz.m_MemoryStats.m_DramNonParallel + xyz.m_MemoryStats.m_DramParallel);
+    }
+
+    SECTION("Estimated cycles")
+    {
+        auto estimate = [&](TraversalOrder order) {
+            return EstimateMceOperationCycles(caps, Stride(1, 1), ethosn::command_stream::MceOperation::CONVOLUTION,
+                                              CompilerMceAlgorithm::Direct, inputShape, inputStripeShape,
+                                              Location::Dram, inputTileSize, outputShape, outputStripeShape,
+                                              Location::Dram, weightsInfo, weightsTileSize, order);
+        };
+        CHECK(estimate(TraversalOrder::Zxy) < estimate(TraversalOrder::Xyz));
+    }
+
+    SECTION("Weights reloads")
+    {
+        // With the same stripes but an input split only in depth, there is nothing to traverse in XY so the weights
+        // are not reloaded in either order.
+        const TensorShape depthOnlyInputStripeShape = { 1, 28, 28, 64 };
+        auto estimate                               = [&](TraversalOrder order) {
+            return EstimateMceOperationCycles(caps, Stride(1, 1), ethosn::command_stream::MceOperation::CONVOLUTION,
+                                              CompilerMceAlgorithm::Direct, inputShape, depthOnlyInputStripeShape,
+                                              Location::Sram, inputTileSize, outputShape, { 1, 28, 28, 16 },
+                                              Location::Sram, weightsInfo, weightsTileSize, order);
+        };
+        CHECK(estimate(TraversalOrder::Zxy) == estimate(TraversalOrder::Xyz));
+    }
+}
+
+TEST_CASE("The cascading estimate chooses a ZXY plan for a convolution whose weights don't fit in Sram")
+{
+    const std::vector<char> caps = GetFwAndHwCapabilities(EthosNVariant::ETHOS_N77);
+    const HardwareCapabilities hwCaps(GetValidCapabilities(caps));
+    const EstimationOptions estOpt;
+    const CompilationOptions compOpt;
+    std::shared_ptr<Network> network = CreateConvolutionNetwork(caps, 28, 256, 3, 1024);
+    Graph graph                      = CreateOptimizedGraph(*network, hwCaps, estOpt);
+
+    Cascading cascading(estOpt, compOpt, hwCaps);
+    cascading.Estimate(graph);
+    const Combination* best = cascading.GetBestCombination();
+    REQUIRE(best != nullptr);
+
+    std::vector<TraversalOrder> mceOrders;
+    for (const Elem& elem : best->m_Elems)
+    {
+        const Plan& plan = cascading.GetGraphOfParts().GetPart(elem.m_PartId).GetPlan(elem.m_PlanId);
+        for (Op* op : plan.m_OpGraph.GetOps())
+        {
+            if (const MceOp* mceOp = dynamic_cast<const MceOp*>(op))
+            {
+                mceOrders.push_back(mceOp->m_Order);
+            }
+        }
+    }
+    REQUIRE(mceOrders.size() == 1);
+    CHECK(mceOrders[0] == TraversalOrder::Zxy);
+}
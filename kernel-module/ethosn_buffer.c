@@ -31,6 +31,7 @@
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/types.h>
+#include <linux/uaccess.h>
 
 #if (MB_RDONLY != O_RDONLY) ||	   \
 	(MB_WRONLY != O_WRONLY) || \
@@ -45,13 +46,20 @@ static int ethosn_buffer_mmap(struct file *file,
 static loff_t ethosn_buffer_llseek(struct file *file,
 				   loff_t offset,
 				   int whence);
+static long ethosn_buffer_ioctl(struct file *file,
+				unsigned int cmd,
+				unsigned long arg);
 static int ethosn_dma_view_release(struct inode *const inode,
 				   struct file *const file);
 
 static const struct file_operations ethosn_buffer_fops = {
-	.release = &ethosn_buffer_release,
-	.mmap    = &ethosn_buffer_mmap,
-	.llseek  = &ethosn_buffer_llseek,
+	.release        = &ethosn_buffer_release,
+	.mmap           = &ethosn_buffer_mmap,
+	.llseek         = &ethosn_buffer_llseek,
+	.unlocked_ioctl = &ethosn_buffer_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl   = &ethosn_buffer_ioctl,
+#endif
 };
 
 static bool is_ethosn_buffer_file(const struct file *const file)
@@ -161,6 +169,139 @@ static loff_t ethosn_buffer_llseek(struct file *const file,
 		return -EINVAL;
 }
 
+/*
+ * Ownership state machine of a buffer:
+ *
+ * - ethosn_buffer_sync_for_device() moves the buffer to the device, cleaning
+ *   the caches if the CPU may have written to it.
+ * - ethosn_buffer_device_done() marks the buffer as written by the device.
+ * - CPU access begin moves the buffer back to the CPU, invalidating the
+ *   caches if the device has written to it. This includes a device write
+ *   which completed after user space began an earlier access.
+ * - CPU access end marks the buffer as written by the CPU, if requested.
+ *
+ * Buffers which are not bracketed by user space are treated as always
+ * written by the CPU and are synced for the CPU as soon as the device is done.
+ */
+static int buffer_cpu_access_begin(struct ethosn_buffer *buf,
+				   u32 flags)
+{
+	struct ethosn_dma_allocator *allocator = buf->ethosn->allocator;
+
+	if (flags & ~(ETHOSN_CPU_ACCESS_READ | ETHOSN_CPU_ACCESS_WRITE))
+		return -EINVAL;
+
+	mutex_lock(&buf->sync_mutex);
+
+	buf->explicit_sync = true;
+
+	if (buf->device_dirty)
+		ethosn_dma_sync_for_cpu(allocator, buf->dma_info);
+
+	buf->owner = ETHOSN_BUFFER_OWNER_CPU;
+	buf->device_dirty = false;
+
+	mutex_unlock(&buf->sync_mutex);
+
+	return 0;
+}
+
+static int buffer_cpu_access_end(struct ethosn_buffer *buf,
+				 u32 flags)
+{
+	if (flags & ~(ETHOSN_CPU_ACCESS_READ | ETHOSN_CPU_ACCESS_WRITE))
+		return -EINVAL;
+
+	mutex_lock(&buf->sync_mutex);
+
+	if (buf->owner != ETHOSN_BUFFER_OWNER_CPU) {
+		mutex_unlock(&buf->sync_mutex);
+
+		return -EINVAL;
+	}
+
+	if (flags & ETHOSN_CPU_ACCESS_WRITE)
+		buf->cpu_dirty = true;
+
+	mutex_unlock(&buf->sync_mutex);
+
+	return 0;
+}
+
+void ethosn_buffer_sync_for_device(struct ethosn_buffer *buf)
+{
+	struct ethosn_dma_allocator *allocator = buf->ethosn->allocator;
+
+	mutex_lock(&buf->sync_mutex);
+
+	if (!buf->explicit_sync || buf->cpu_dirty)
+		ethosn_dma_sync_for_device(allocator, buf->dma_info);
+
+	buf->owner = ETHOSN_BUFFER_OWNER_DEVICE;
+	buf->cpu_dirty = false;
+
+	mutex_unlock(&buf->sync_mutex);
+}
+
+void ethosn_buffer_device_done(struct ethosn_buffer *buf,
+			       bool written)
+{
+	struct ethosn_dma_allocator *allocator = buf->ethosn->allocator;
+
+	if (!written)
+		return;
+
+	mutex_lock(&buf->sync_mutex);
+
+	if (buf->explicit_sync) {
+		buf->device_dirty = true;
+	} else {
+		ethosn_dma_sync_for_cpu(allocator, buf->dma_info);
+		buf->owner = ETHOSN_BUFFER_OWNER_CPU;
+	}
+
+	mutex_unlock(&buf->sync_mutex);
+}
+
+static long ethosn_buffer_ioctl(struct file *file,
+				unsigned int cmd,
+				unsigned long arg)
+{
+	struct ethosn_buffer *buf = file->private_data;
+	const void __user *udata = (void __user *)arg;
+	struct ethosn_buffer_cpu_access access;
+	int ret;
+
+	if (WARN_ON(!is_ethosn_buffer_file(file)))
+		return -EBADF;
+
+	switch (cmd) {
+	case ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN: {
+		if (copy_from_user(&access, udata, sizeof(access))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = buffer_cpu_access_begin(buf, access.flags);
+		break;
+	}
+	case ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END: {
+		if (copy_from_user(&access, udata, sizeof(access))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = buffer_cpu_access_end(buf, access.flags);
+		break;
+	}
+	default: {
+		ret = -EINVAL;
+	}
+	}
+
+	return ret;
+}
+
 /**
  * ethosn_buffer_register() - Register a new Ethos-N buffer
  * @ethosn: [in]     pointer to Ethos-N device
@@ -195,6 +336,10 @@ int ethosn_buffer_register(struct ethosn_device *ethosn,
 	 */
 	buf->ethosn = ethosn;
 
+	mutex_init(&buf->sync_mutex);
+	buf->owner = ETHOSN_BUFFER_OWNER_CPU;
+	buf->cpu_dirty = true;
+
 	buf->dma_info =
 		ethosn_dma_alloc(ethosn->allocator, buf_req->size, GFP_KERNEL);
 	if (IS_ERR_OR_NULL(buf->dma_info))
@@ -27,13 +27,32 @@
 #include "ethosn_dma.h"
 #include "uapi/ethosn.h"
 
+#include <linux/mutex.h>
 #include <linux/types.h>
 
+enum ethosn_buffer_owner {
+	ETHOSN_BUFFER_OWNER_CPU,
+	ETHOSN_BUFFER_OWNER_DEVICE,
+};
+
 struct ethosn_buffer {
-	struct ethosn_device   *ethosn;
-	struct ethosn_dma_info *dma_info;
+	struct ethosn_device     *ethosn;
+	struct ethosn_dma_info   *dma_info;
 	/* file pointer used for user-space mmap and for ref-counting */
-	struct file            *file;
+	struct file              *file;
+
+	/* Cache maintenance state, protected by sync_mutex. Until user space
+	 * brackets its CPU accesses with ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN
+	 * and ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END, explicit_sync is false and
+	 * the buffer is synced every time it changes hands.
+	 */
+	struct mutex             sync_mutex;
+	bool                     explicit_sync;
+	enum ethosn_buffer_owner owner;
+	/* The CPU may have written data which is not visible to the device */
+	bool                     cpu_dirty;
+	/* The device may have written data which is not visible to the CPU */
+	bool                     device_dirty;
 };
 
 int ethosn_buffer_register(struct ethosn_device *ethosn,
@@ -41,6 +60,27 @@ int ethosn_buffer_register(struct ethosn_device *ethosn,
 struct ethosn_buffer *ethosn_buffer_get(int fd);
 void put_ethosn_buffer(struct ethosn_buffer *buf);
 
+/**
+ * ethosn_buffer_sync_for_device() - Hand a buffer over to the device
+ * @buf:	Buffer about to be used by an inference.
+ *
+ * Caches are only cleaned if the CPU may have written to the buffer since the
+ * device last owned it.
+ */
+void ethosn_buffer_sync_for_device(struct ethosn_buffer *buf);
+
+/**
+ * ethosn_buffer_device_done() - Record that an inference used a buffer
+ * @buf:	Buffer used by an inference which has finished.
+ * @written:	Whether the inference wrote to the buffer.
+ *
+ * Written buffers are only synced for the CPU here if user space does not
+ * bracket its accesses. Otherwise this is deferred to
+ * ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN.
+ */
+void ethosn_buffer_device_done(struct ethosn_buffer *buf,
+			       bool written);
+
 int ethosn_get_dma_view_fd(struct ethosn_device *ethosn,
 			   struct ethosn_dma_info *dma_info);
 
@@ -0,0 +1,350 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+
+#include "ethosn_completion_queue.h"
+
+#include "ethosn_device.h"
+
+#include <linux/anon_inodes.h>
+#include <linux/device.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+
+/*
+ * A completion queue collects the completion records of every inference
+ * scheduled on the networks attached to it, so that user space can wait for
+ * and reap many inferences with a single poll and read.
+ */
+struct ethosn_completion_queue {
+	struct ethosn_device *ethosn;
+
+	/* Records not read by user space yet, oldest first */
+	spinlock_t           lock;
+	struct list_head     completions;
+	wait_queue_head_t    wqh;
+
+	/* Records reserved or not read yet, at most
+	 * ETHOSN_COMPLETION_QUEUE_MAX_RECORDS. Protected by lock.
+	 */
+	unsigned int         num_records;
+
+	/* file pointer used for ref-counting */
+	struct file          *file;
+};
+
+/*
+ * A record is reserved when the inference is scheduled, so that posting it
+ * can't fail. The reservation holds a reference to the queue until it is
+ * posted or cancelled.
+ */
+struct ethosn_completion_node {
+	struct ethosn_completion_queue *cq;
+	struct list_head               node;
+	struct ethosn_completion       record;
+};
+
+static int cq_release(struct inode *inode,
+		      struct file *file);
+static unsigned int cq_poll(struct file *file,
+			    poll_table *wait);
+static ssize_t cq_read(struct file *file,
+		       char __user *buf,
+		       size_t count,
+		       loff_t *ppos);
+
+static const struct file_operations ethosn_cq_fops = {
+	.owner   = THIS_MODULE,
+	.release = &cq_release,
+	.poll    = &cq_poll,
+	.read    = &cq_read,
+};
+
+static bool is_completion_queue_file(const struct file *const file)
+{
+	return file->f_op == &ethosn_cq_fops;
+}
+
+static bool cq_empty(struct ethosn_completion_queue *cq)
+{
+	bool empty;
+
+	spin_lock(&cq->lock);
+	empty = list_empty(&cq->completions);
+	spin_unlock(&cq->lock);
+
+	return empty;
+}
+
+static int cq_release(struct inode *inode,
+		      struct file *file)
+{
+	struct ethosn_completion_queue *cq = file->private_data;
+	struct ethosn_completion_node *entry;
+	struct ethosn_completion_node *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &cq->completions, node) {
+		list_del(&entry->node);
+		kfree(entry);
+	}
+
+	dev_dbg(cq->ethosn->dev,
+		"Released completion queue. handle=0x%pK\n", cq);
+
+	put_device(cq->ethosn->dev);
+	kfree(cq);
+
+	return 0;
+}
+
+static unsigned int cq_poll(struct file *file,
+			    poll_table *wait)
+{
+	struct ethosn_completion_queue *cq = file->private_data;
+
+	poll_wait(file, &cq->wqh, wait);
+
+	return cq_empty(cq) ? 0 : POLLIN | POLLRDNORM;
+}
+
+/*
+ * Read as many whole records as fit in the user buffer. Blocks until at least
+ * one record is available, unless the file is non-blocking. Records which
+ * can't be copied to user space are put back, so only a fault on the first
+ * record is reported as such.
+ */
+static ssize_t cq_read(struct file *file,
+		       char __user *buf,
+		       size_t count,
+		       loff_t *ppos)
+{
+	struct ethosn_completion_queue *cq = file->private_data;
+	struct ethosn_completion __user *records = (void __user *)buf;
+	struct ethosn_completion_node *entry;
+	struct ethosn_completion_node *tmp;
+	size_t max_records = count / sizeof(*records);
+	size_t num_records = 0;
+	size_t num_copied = 0;
+	LIST_HEAD(reaped);
+	ssize_t ret;
+
+	if (max_records == 0)
+		return -EINVAL;
+
+	/* Another reader may take the records between the wake up and the
+	 * lock, in which case wait again.
+	 */
+	for (;;) {
+		if (!(file->f_flags & O_NONBLOCK)) {
+			ret = wait_event_interruptible(cq->wqh,
+						       !cq_empty(cq));
+			if (ret)
+				return ret;
+		}
+
+		spin_lock(&cq->lock);
+		while (num_records < max_records &&
+		       !list_empty(&cq->completions)) {
+			list_move_tail(cq->completions.next, &reaped);
+			++num_records;
+		}
+
+		spin_unlock(&cq->lock);
+
+		if (num_records)
+			break;
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+	}
+
+	list_for_each_entry_safe(entry, tmp, &reaped, node) {
+		if (copy_to_user(&records[num_copied], &entry->record,
+				 sizeof(entry->record)))
+			break;
+
+		list_del(&entry->node);
+		kfree(entry);
+		++num_copied;
+	}
+
+	/* The records which weren't copied go back to the front, oldest
+	 * first.
+	 */
+	spin_lock(&cq->lock);
+	list_splice(&reaped, &cq->completions);
+	cq->num_records -= num_copied;
+	spin_unlock(&cq->lock);
+
+	if (num_copied < num_records)
+		wake_up_poll(&cq->wqh, POLLIN);
+
+	if (num_copied == 0)
+		return -EFAULT;
+
+	return num_copied * sizeof(*records);
+}
+
+int ethosn_completion_queue_register(struct ethosn_device *ethosn)
+{
+	struct ethosn_completion_queue *cq;
+	int fd;
+
+	cq = kzalloc(sizeof(*cq), GFP_KERNEL);
+	if (!cq)
+		return -ENOMEM;
+
+	cq->ethosn = ethosn;
+	spin_lock_init(&cq->lock);
+	INIT_LIST_HEAD(&cq->completions);
+	init_waitqueue_head(&cq->wqh);
+
+	fd = anon_inode_getfd("ethosn-completion-queue", &ethosn_cq_fops, cq,
+			      O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		kfree(cq);
+
+		return fd;
+	}
+
+	cq->file = fget(fd);
+	fput(cq->file);
+
+	get_device(ethosn->dev);
+
+	dev_dbg(ethosn->dev,
+		"Registered completion queue. handle=0x%pK\n", cq);
+
+	return fd;
+}
+
+struct ethosn_completion_queue *ethosn_completion_queue_get(
+	struct ethosn_device *ethosn,
+	int fd)
+{
+	struct ethosn_completion_queue *cq;
+	struct file *file;
+
+	file = fget(fd);
+	if (!file)
+		return ERR_PTR(-EBADF);
+
+	if (!is_completion_queue_file(file)) {
+		fput(file);
+
+		return ERR_PTR(-EINVAL);
+	}
+
+	/* The records hold file descriptors of the device's inferences */
+	cq = file->private_data;
+	if (cq->ethosn != ethosn) {
+		fput(file);
+
+		return ERR_PTR(-EINVAL);
+	}
+
+	return cq;
+}
+
+struct ethosn_completion_queue *ethosn_completion_queue_ref(
+	struct ethosn_completion_queue *cq)
+{
+	if (cq)
+		get_file(cq->file);
+
+	return cq;
+}
+
+void ethosn_completion_queue_put(struct ethosn_completion_queue *cq)
+{
+	if (cq)
+		fput(cq->file);
+}
+
+struct ethosn_completion_node *ethosn_completion_queue_reserve(
+	struct ethosn_completion_queue *cq)
+{
+	struct ethosn_completion_node *entry;
+	bool full;
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+
+	spin_lock(&cq->lock);
+	full = cq->num_records >= ETHOSN_COMPLETION_QUEUE_MAX_RECORDS;
+	if (!full)
+		++cq->num_records;
+
+	spin_unlock(&cq->lock);
+
+	if (full) {
+		kfree(entry);
+
+		return ERR_PTR(-EAGAIN);
+	}
+
+	entry->cq = ethosn_completion_queue_ref(cq);
+
+	return entry;
+}
+
+void ethosn_completion_queue_cancel(struct ethosn_completion_node *entry)
+{
+	struct ethosn_completion_queue *cq;
+
+	if (!entry)
+		return;
+
+	cq = entry->cq;
+
+	spin_lock(&cq->lock);
+	--cq->num_records;
+	spin_unlock(&cq->lock);
+
+	kfree(entry);
+	ethosn_completion_queue_put(cq);
+}
+
+void ethosn_completion_queue_post(struct ethosn_completion_node *entry,
+				  const struct ethosn_completion *record)
+{
+	struct ethosn_completion_queue *cq = entry->cq;
+
+	entry->record = *record;
+
+	spin_lock(&cq->lock);
+	list_add_tail(&entry->node, &cq->completions);
+	spin_unlock(&cq->lock);
+
+	wake_up_poll(&cq->wqh, POLLIN);
+
+	/* The queued record is freed by the reader or with the queue */
+	ethosn_completion_queue_put(cq);
+}
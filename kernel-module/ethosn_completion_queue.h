@@ -0,0 +1,102 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+
+#ifndef _ETHOSN_COMPLETION_QUEUE_H_
+#define _ETHOSN_COMPLETION_QUEUE_H_
+
+#include "uapi/ethosn.h"
+
+/* Records a queue can hold, including the ones reserved but not posted */
+#define ETHOSN_COMPLETION_QUEUE_MAX_RECORDS 1024
+
+struct ethosn_device;
+struct ethosn_completion_queue;
+struct ethosn_completion_node;
+
+/**
+ * ethosn_completion_queue_register() - Create a completion queue
+ * @ethosn:	Ethos-N device
+ *
+ * Return: File descriptor on success, else error code.
+ */
+int ethosn_completion_queue_register(struct ethosn_device *ethosn);
+
+/**
+ * ethosn_completion_queue_get() - Get the completion queue of a file
+ * descriptor
+ * @ethosn:	Ethos-N device the queue must belong to.
+ * @fd:		File descriptor returned by ethosn_completion_queue_register().
+ *
+ * Return: Completion queue with its reference count increased, else error
+ * pointer. -EINVAL if the file isn't a completion queue of the device.
+ */
+struct ethosn_completion_queue *ethosn_completion_queue_get(
+	struct ethosn_device *ethosn,
+	int fd);
+
+/**
+ * ethosn_completion_queue_ref() - Take another reference to a completion queue
+ * @cq:	Completion queue, may be NULL.
+ *
+ * Return: cq
+ */
+struct ethosn_completion_queue *ethosn_completion_queue_ref(
+	struct ethosn_completion_queue *cq);
+
+/**
+ * ethosn_completion_queue_put() - Drop a reference to a completion queue
+ * @cq:	Completion queue, may be NULL.
+ */
+void ethosn_completion_queue_put(struct ethosn_completion_queue *cq);
+
+/**
+ * ethosn_completion_queue_reserve() - Reserve a completion record
+ * @cq:	Completion queue.
+ *
+ * The reservation takes a reference to the queue, which is dropped when it is
+ * posted or cancelled.
+ *
+ * Return: Reserved record, else error pointer. -EAGAIN if the queue already
+ * holds ETHOSN_COMPLETION_QUEUE_MAX_RECORDS records.
+ */
+struct ethosn_completion_node *ethosn_completion_queue_reserve(
+	struct ethosn_completion_queue *cq);
+
+/**
+ * ethosn_completion_queue_cancel() - Release a reserved record unposted
+ * @entry:	Record returned by ethosn_completion_queue_reserve(), may be
+ *		NULL.
+ */
+void ethosn_completion_queue_cancel(struct ethosn_completion_node *entry);
+
+/**
+ * ethosn_completion_queue_post() - Append a reserved completion record
+ * @entry:	Record returned by ethosn_completion_queue_reserve().
+ * @record:	Completion record.
+ *
+ * Wakes up any reader waiting on the queue. Can't fail.
+ */
+void ethosn_completion_queue_post(struct ethosn_completion_node *entry,
+				  const struct ethosn_completion *record);
+
+#endif /* _ETHOSN_COMPLETION_QUEUE_H_ */
@@ -30,6 +30,7 @@
 #include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/time.h>
 
@@ -63,6 +64,14 @@ module_param_named(profiling, profiling_enabled, bool, 0664);
 static int clock_frequency = 1000;
 module_param_named(clock_frequency, clock_frequency, int, 0440);
 
+/* Number of inferences posted to each core ahead of completion */
+static int ethosn_inference_depth = 2;
+module_param_named(inference_depth, ethosn_inference_depth, int, 0440);
+
+/* Time in ms after which a queued inference is promoted one priority class */
+static int sched_aging_ms = 100;
+module_param_named(sched_aging_ms, sched_aging_ms, int, 0664);
+
 /* Exposes global access to the most-recently created Ethos-N core for testing
  * purposes. See ethosn-tests module
  */
@@ -707,6 +716,58 @@ void ethosn_dump_gps(struct ethosn_core *core)
  * Mailbox
  ****************************************************************************/
 
+/**
+ * sync_queue_range() - Sync part of a mailbox queue.
+ * @core:	Pointer to Ethos-N core.
+ * @dma_info:	DMA allocation of the queue.
+ * @offset:	Offset in bytes of the range from the start of the queue.
+ * @size:	Size in bytes of the range.
+ * @for_device:	Transfer ownership of the range to the device if true, to the
+ *		CPU otherwise.
+ */
+static void sync_queue_range(struct ethosn_core *core,
+			     struct ethosn_dma_info *dma_info,
+			     size_t offset,
+			     size_t size,
+			     bool for_device)
+{
+	if (for_device)
+		ethosn_dma_sync_range_for_device(core->allocator, dma_info,
+						 offset, size);
+	else
+		ethosn_dma_sync_range_for_cpu(core->allocator, dma_info,
+					      offset, size);
+}
+
+/**
+ * sync_queue_data() - Sync bytes of the data array of a mailbox queue.
+ * @core:	Pointer to Ethos-N core.
+ * @dma_info:	DMA allocation of the queue.
+ * @start:	Index in the data array of the first byte to sync.
+ * @size:	Number of bytes to sync.
+ * @for_device:	Transfer ownership of the bytes to the device if true, to the
+ *		CPU otherwise.
+ *
+ * The bytes may wrap around the end of the data array, in which case they are
+ * synced as two ranges. Nothing is synced for an empty queue.
+ */
+static void sync_queue_data(struct ethosn_core *core,
+			    struct ethosn_dma_info *dma_info,
+			    uint32_t start,
+			    uint32_t size,
+			    bool for_device)
+{
+	const struct ethosn_queue *queue = dma_info->cpu_addr;
+	const size_t data = offsetof(struct ethosn_queue, data);
+
+	if (for_device)
+		ethosn_dma_sync_ring_for_device(core->allocator, dma_info, data,
+						queue->capacity, start, size);
+	else
+		ethosn_dma_sync_ring_for_cpu(core->allocator, dma_info, data,
+					     queue->capacity, start, size);
+}
+
 /**
  * ethosn_read_message() - Read message from queue.
  * @queue:	Pointer to queue.
@@ -735,7 +796,14 @@ int ethosn_read_message(struct ethosn_core *core,
 		return -EFAULT;
 	}
 
-	ethosn_dma_sync_for_cpu(core->allocator, core->mailbox_response);
+	/*
+	 * Only the read and write indices and the bytes between them have been
+	 * written by the "writing" side since the last message was read.
+	 */
+	sync_queue_range(core, core->mailbox_response, 0,
+			 offsetof(struct ethosn_queue, data), false);
+	sync_queue_data(core, core->mailbox_response, queue->read,
+			ethosn_queue_get_size(queue), false);
 
 	ret = ethosn_queue_read(queue, (uint8_t *)header,
 				sizeof(struct ethosn_message_header),
@@ -782,7 +850,10 @@ int ethosn_read_message(struct ethosn_core *core,
 
 	queue->read = read_pending;
 
-	ethosn_dma_sync_for_device(core->allocator, core->mailbox_response);
+	/* Sync the read pointer */
+	sync_queue_range(core, core->mailbox_response,
+			 offsetof(struct ethosn_queue, read),
+			 sizeof(queue->read), true);
 
 	ethosn_log_firmware(core, ETHOSN_LOG_FIRMWARE_INPUT, header, data);
 	if (core->profiling.config.enable_profiling)
@@ -810,7 +881,10 @@ int ethosn_write_message(struct ethosn_core *core,
 		.type   = type,
 		.length = length
 	};
-	bool ret;
+	const struct ethosn_queue_segment segments[] = {
+		{ (const uint8_t *)&header, sizeof(header) },
+		{ data, length },
+	};
 	uint32_t write_pending;
 
 	if (core->mailbox_response->size <
@@ -823,7 +897,12 @@ int ethosn_write_message(struct ethosn_core *core,
 		return -EFAULT;
 	}
 
-	ethosn_dma_sync_for_cpu(core->allocator, core->mailbox_request);
+	/*
+	 * The data array is only ever written by this side, so only the read
+	 * pointer, updated by the "reading" side, needs to be invalidated.
+	 */
+	sync_queue_range(core, core->mailbox_request, 0,
+			 offsetof(struct ethosn_queue, data), false);
 
 	dev_dbg(core->dev,
 		"Write message. type=%u, length=%zu, read=%u, write=%u.\n",
@@ -831,22 +910,23 @@ int ethosn_write_message(struct ethosn_core *core,
 
 	write_pending = queue->write;
 
-	ret =
-		ethosn_queue_write(queue, (uint8_t *)&header,
-				   sizeof(struct ethosn_message_header),
-				   &write_pending);
-	if (!ret)
-		return ret;
+	/* The header and payload are published together, or not at all */
+	if (!ethosn_queue_write_batch(queue, segments, ARRAY_SIZE(segments),
+				      &write_pending)) {
+		dev_err(core->dev,
+			"Mailbox request queue full. type=%u, length=%zu\n",
+			type, length);
 
-	ret = ethosn_queue_write(queue, data, length, &write_pending);
-	if (!ret)
-		return ret;
+		return -ENOSPC;
+	}
 
 	/*
 	 * Sync the payload before committing the updated write pointer so that
 	 * the "reading" side (e.g. CU firmware) can't read invalid data.
 	 */
-	ethosn_dma_sync_for_device(core->allocator, core->mailbox_request);
+	sync_queue_data(core, core->mailbox_request, queue->write,
+			(write_pending - queue->write) & (queue->capacity - 1),
+			true);
 
 	/*
 	 * Update the write pointer after all the data has been written.
@@ -854,7 +934,9 @@ int ethosn_write_message(struct ethosn_core *core,
 	queue->write = write_pending;
 
 	/* Sync the write pointer */
-	ethosn_dma_sync_for_device(core->allocator, core->mailbox_request);
+	sync_queue_range(core, core->mailbox_request,
+			 offsetof(struct ethosn_queue, write),
+			 sizeof(queue->write), true);
 	ethosn_notify_firmware(core);
 
 	ethosn_log_firmware(core, ETHOSN_LOG_FIRMWARE_OUTPUT, &header, data);
@@ -1477,6 +1559,38 @@ cleanup:
 	return ret;
 }
 
+static int dma_allocator_show(struct seq_file *s,
+			      void *unused)
+{
+	struct ethosn_core *core = s->private;
+	struct ethosn_device *ethosn = core->parent;
+	int ret;
+
+	seq_puts(s, "core:\n");
+	ethosn_dma_print_stats(core->allocator, s);
+
+	/* Buffers and constant data are allocated by the parent device */
+	seq_puts(s, "device:\n");
+	ethosn_dma_print_stats(ethosn->allocator, s);
+
+	ret = mutex_lock_interruptible(&ethosn->mutex);
+	if (ret)
+		return ret;
+
+	seq_printf(s, "constants: bytes=%zu, saved=%zu\n",
+		   ethosn->constants_bytes, ethosn->constants_bytes_saved);
+
+	mutex_unlock(&ethosn->mutex);
+
+	return 0;
+}
+
+static int dma_allocator_open(struct inode *inode,
+			      struct file *file)
+{
+	return single_open(file, dma_allocator_show, inode->i_private);
+}
+
 static void dfs_deinit(struct ethosn_core *core)
 {
 	debugfs_remove_recursive(core->debug_dir);
@@ -1517,6 +1631,13 @@ static void dfs_init(struct ethosn_core *core)
 		.owner = THIS_MODULE,
 		.read  = &firmware_profiling_read
 	};
+	static const struct file_operations dma_allocator_fops = {
+		.owner   = THIS_MODULE,
+		.open    = &dma_allocator_open,
+		.read    = &seq_read,
+		.llseek  = &seq_lseek,
+		.release = &single_release
+	};
 	char name[16];
 
 	/* Create debugfs directory */
@@ -1540,6 +1661,14 @@ static void dfs_init(struct ethosn_core *core)
 	debugfs_create_file("firmware_profiling", 0400, core->debug_dir,
 			    core,
 			    &firmware_profiling_fops);
+
+	/* Usage and fragmentation of the address spaces of the core */
+	debugfs_create_file("dma_allocator", 0400, core->debug_dir, core,
+			    &dma_allocator_fops);
+
+	/* Allow the in-flight inference depth to be tuned per core. */
+	debugfs_create_u32("inference_depth", 0600, core->debug_dir,
+			   &core->inference_depth);
 }
 
 /****************************************************************************
@@ -1553,6 +1682,9 @@ int ethosn_device_init(struct ethosn_core *core)
 	/* Round up queue size to next power of 2 */
 	core->queue_size = roundup_pow_of_two(ethosn_queue_size);
 
+	core->inference_depth = clamp_t(int, ethosn_inference_depth, 1,
+					ETHOSN_MAX_INFERENCE_DEPTH);
+
 	/* Initialize debugfs */
 	dfs_init(core);
 
@@ -1652,6 +1784,11 @@ int ethosn_clock_frequency(void)
 	return clock_frequency;
 }
 
+u64 ethosn_sched_aging_ns(void)
+{
+	return sched_aging_ms > 0 ? (u64)sched_aging_ms * NSEC_PER_MSEC : 0;
+}
+
 /* uncrustify-off */
 struct ethosn_core *ethosn_get_global_core_for_testing(void)
 {
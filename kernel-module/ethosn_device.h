@@ -39,6 +39,9 @@
 #include <linux/timer.h>
 #include <linux/wait.h>
 
+/* Upper bound for the number of inferences posted to a core at once */
+#define ETHOSN_MAX_INFERENCE_DEPTH 8
+
 struct ethosn_inference;
 
 struct ethosn_addr_map {
@@ -59,6 +62,14 @@ struct ethosn_device {
 	int                           num_cores;
 	struct ethosn_inference_queue queue;
 	struct ethosn_dma_allocator   *allocator;
+
+	/* Constant data of the registered networks, shared between networks
+	 * with identical constants. Protected by the mutex.
+	 */
+	struct list_head              constants;
+	size_t                        constants_bytes;
+	/* Bytes that sharing the constant data currently saves */
+	size_t                        constants_bytes_saved;
 };
 
 enum ethosn_core_status {
@@ -117,8 +128,35 @@ struct ethosn_core {
 	struct workqueue_struct *irq_wq;
 	struct work_struct      irq_work;
 	atomic_t                irq_status;
+	/* Time of the last interrupt, for the inference latency statistics */
+	atomic64_t              irq_time_ns;
+
+	/* Inferences which have been posted to the firmware and have not
+	 * completed yet, oldest first. The firmware executes them in order so
+	 * the head of the list is the one currently running. Protected by
+	 * mutex.
+	 */
+	struct list_head        inflight_inferences;
+	uint32_t                num_inflight_inferences;
+
+	/* Maximum number of inferences posted to the firmware at the same
+	 * time. Posting the next inference while the current one runs hides
+	 * the host-side setup and mailbox latency.
+	 * tests/host/test_network.c simulates the idle gap this hides.
+	 */
+	uint32_t                inference_depth;
 
-	struct ethosn_inference *current_inference;
+	/* Dispatch statistics, readable through
+	 * ETHOSN_IOCTL_GET_COUNTER_VALUE. Protected by mutex.
+	 */
+	struct {
+		u64 inferences_completed;
+		u64 affinity_hits;
+		/* Accumulated time with at least one inference in flight */
+		u64 busy_time_ns;
+		/* Start of the current busy period */
+		u64 busy_since_ns;
+	} dispatch;
 
 	/* Indicates if the core is busy or free.
 	 */
@@ -445,6 +483,13 @@ bool ethosn_mailbox_empty(struct ethosn_queue *queue);
  */
 int ethosn_clock_frequency(void);
 
+/* ethosn_sched_aging_ns() - Get the aging period of queued inferences.
+ *
+ * Return: Time in ns after which a queued inference is promoted one priority
+ * class, or 0 if aging is disabled.
+ */
+u64 ethosn_sched_aging_ns(void);
+
 /* ethosn_get_global_core_for_testing() - Exposes global access to the
  *                                       most-recently created Ethos-N core
  *                                       (in case of single core) or core0 (in
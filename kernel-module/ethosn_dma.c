@@ -277,3 +277,131 @@ void ethosn_dma_sync_for_cpu(struct ethosn_dma_allocator *allocator,
 
 	ops->sync_for_cpu(allocator, dma_info);
 }
+
+void ethosn_dma_sync_range_for_device(struct ethosn_dma_allocator *allocator,
+				      struct ethosn_dma_info *dma_info,
+				      size_t offset,
+				      size_t size)
+{
+	const struct ethosn_dma_allocator_ops *ops = get_ops(allocator);
+
+	if (!ops)
+		return;
+
+	if (IS_ERR_OR_NULL(dma_info))
+		return;
+
+	if (!ops->sync_range_for_device) {
+		ethosn_dma_sync_for_device(allocator, dma_info);
+
+		return;
+	}
+
+	if (offset >= dma_info->size || size == 0)
+		return;
+
+	size = min(size, dma_info->size - offset);
+
+	ops->sync_range_for_device(allocator, dma_info, offset, size);
+}
+
+void ethosn_dma_sync_range_for_cpu(struct ethosn_dma_allocator *allocator,
+				   struct ethosn_dma_info *dma_info,
+				   size_t offset,
+				   size_t size)
+{
+	const struct ethosn_dma_allocator_ops *ops = get_ops(allocator);
+
+	if (!ops)
+		return;
+
+	if (IS_ERR_OR_NULL(dma_info))
+		return;
+
+	if (!ops->sync_range_for_cpu) {
+		ethosn_dma_sync_for_cpu(allocator, dma_info);
+
+		return;
+	}
+
+	if (offset >= dma_info->size || size == 0)
+		return;
+
+	size = min(size, dma_info->size - offset);
+
+	ops->sync_range_for_cpu(allocator, dma_info, offset, size);
+}
+
+static void sync_range(struct ethosn_dma_allocator *allocator,
+		       struct ethosn_dma_info *dma_info,
+		       size_t offset,
+		       size_t size,
+		       bool for_device)
+{
+	if (for_device)
+		ethosn_dma_sync_range_for_device(allocator, dma_info, offset,
+						 size);
+	else
+		ethosn_dma_sync_range_for_cpu(allocator, dma_info, offset,
+					      size);
+}
+
+static void sync_ring(struct ethosn_dma_allocator *allocator,
+		      struct ethosn_dma_info *dma_info,
+		      size_t ring_offset,
+		      size_t ring_size,
+		      size_t start,
+		      size_t size,
+		      bool for_device)
+{
+	size_t first;
+
+	if (ring_size == 0 || size == 0)
+		return;
+
+	start %= ring_size;
+	size = min(size, ring_size);
+	first = min(size, ring_size - start);
+
+	sync_range(allocator, dma_info, ring_offset + start, first, for_device);
+
+	if (size > first)
+		sync_range(allocator, dma_info, ring_offset, size - first,
+			   for_device);
+}
+
+void ethosn_dma_sync_ring_for_device(struct ethosn_dma_allocator *allocator,
+				     struct ethosn_dma_info *dma_info,
+				     size_t ring_offset,
+				     size_t ring_size,
+				     size_t start,
+				     size_t size)
+{
+	sync_ring(allocator, dma_info, ring_offset, ring_size, start, size,
+		  true);
+}
+
+void ethosn_dma_sync_ring_for_cpu(struct ethosn_dma_allocator *allocator,
+				  struct ethosn_dma_info *dma_info,
+				  size_t ring_offset,
+				  size_t ring_size,
+				  size_t start,
+				  size_t size)
+{
+	sync_ring(allocator, dma_info, ring_offset, ring_size, start, size,
+		  false);
+}
+
+void ethosn_dma_print_stats(struct ethosn_dma_allocator *allocator,
+			    struct seq_file *s)
+{
+	const struct ethosn_dma_allocator_ops *ops = get_ops(allocator);
+
+	if (!ops)
+		return;
+
+	if (!ops->print_stats)
+		return;
+
+	ops->print_stats(allocator, s);
+}
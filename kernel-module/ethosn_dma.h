@@ -34,6 +34,7 @@
 #define ETHOSN_PROT_WRITE (1 << 1)
 
 struct device;
+struct seq_file;
 struct vm_area_struct;
 
 /*
@@ -67,9 +68,15 @@ struct ethosn_dma_allocator {
  *                     flushing the CPU cache
  * @sync_for_cpu       Transfer ownership of the memory buffer to the CPU by
  *                     invalidating the CPU cache
+ * @sync_range_for_device Like sync_for_device, but only for the given byte
+ *                     range of the buffer
+ * @sync_range_for_cpu Like sync_for_cpu, but only for the given byte range of
+ *                     the buffer
  * @mmap               Memory map the buffer into userspace
  * @get_addr_base      Get address base
  * @get_addr_size      Get address size
+ * @print_stats        Print statistics of the allocator, e.g. the usage and
+ *                     fragmentation of its address spaces
  */
 struct ethosn_dma_allocator_ops {
 	void                   (*destroy)(
@@ -92,6 +99,16 @@ struct ethosn_dma_allocator_ops {
 					   struct ethosn_dma_info *dma_info);
 	void            (*sync_for_cpu)(struct ethosn_dma_allocator *allocator,
 					struct ethosn_dma_info *dma_info);
+	void            (*sync_range_for_device)(
+		struct ethosn_dma_allocator *allocator,
+		struct ethosn_dma_info *dma_info,
+		size_t offset,
+		size_t size);
+	void            (*sync_range_for_cpu)(
+		struct ethosn_dma_allocator *allocator,
+		struct ethosn_dma_info *dma_info,
+		size_t offset,
+		size_t size);
 	int             (*mmap)(struct ethosn_dma_allocator *allocator,
 				struct vm_area_struct *const vma,
 				const struct ethosn_dma_info *const dma_info);
@@ -99,6 +116,8 @@ struct ethosn_dma_allocator_ops {
 					 enum ethosn_stream_id stream_id);
 	resource_size_t (*get_addr_size)(struct ethosn_dma_allocator *allocator,
 					 enum ethosn_stream_id stream_id);
+	void            (*print_stats)(struct ethosn_dma_allocator *allocator,
+				       struct seq_file *s);
 };
 
 /**
@@ -250,4 +269,86 @@ void ethosn_dma_sync_for_device(struct ethosn_dma_allocator *allocator,
 void ethosn_dma_sync_for_cpu(struct ethosn_dma_allocator *allocator,
 			     struct ethosn_dma_info *dma_info);
 
+/**
+ * ethosn_dma_sync_range_for_device() - Transfer ownership of part of the
+ * memory buffer to the device. Flushes the CPU cache for that part only.
+ * @allocator: Allocator object
+ * @dma_info: DMA allocation information
+ * @offset: Offset in bytes of the start of the range in the buffer
+ * @size: Size in bytes of the range
+ *
+ * The range is clamped to the size of the buffer. Allocators which can't sync
+ * a range sync the whole buffer instead.
+ */
+void ethosn_dma_sync_range_for_device(struct ethosn_dma_allocator *allocator,
+				      struct ethosn_dma_info *dma_info,
+				      size_t offset,
+				      size_t size);
+
+/**
+ * ethosn_dma_sync_range_for_cpu() - Transfer ownership of part of the memory
+ * buffer to the cpu. Invalidates the CPU cache for that part only.
+ * @allocator: Allocator object
+ * @dma_info: DMA allocation information
+ * @offset: Offset in bytes of the start of the range in the buffer
+ * @size: Size in bytes of the range
+ *
+ * The range is clamped to the size of the buffer. Allocators which can't sync
+ * a range sync the whole buffer instead.
+ */
+void ethosn_dma_sync_range_for_cpu(struct ethosn_dma_allocator *allocator,
+				   struct ethosn_dma_info *dma_info,
+				   size_t offset,
+				   size_t size);
+
+/**
+ * ethosn_dma_sync_ring_for_device() - Transfer ownership of bytes of a ring
+ * buffer in the memory buffer to the device.
+ * @allocator: Allocator object
+ * @dma_info: DMA allocation information
+ * @ring_offset: Offset in bytes of the ring in the buffer
+ * @ring_size: Size in bytes of the ring
+ * @start: Index in the ring of the first byte, wrapped to the ring size
+ * @size: Number of bytes, at most the ring size
+ *
+ * Bytes which wrap around the end of the ring are synced as two ranges.
+ * Nothing is synced if size is 0.
+ */
+void ethosn_dma_sync_ring_for_device(struct ethosn_dma_allocator *allocator,
+				     struct ethosn_dma_info *dma_info,
+				     size_t ring_offset,
+				     size_t ring_size,
+				     size_t start,
+				     size_t size);
+
+/**
+ * ethosn_dma_sync_ring_for_cpu() - Transfer ownership of bytes of a ring
+ * buffer in the memory buffer to the cpu.
+ * @allocator: Allocator object
+ * @dma_info: DMA allocation information
+ * @ring_offset: Offset in bytes of the ring in the buffer
+ * @ring_size: Size in bytes of the ring
+ * @start: Index in the ring of the first byte, wrapped to the ring size
+ * @size: Number of bytes, at most the ring size
+ *
+ * Bytes which wrap around the end of the ring are synced as two ranges.
+ * Nothing is synced if size is 0.
+ */
+void ethosn_dma_sync_ring_for_cpu(struct ethosn_dma_allocator *allocator,
+				  struct ethosn_dma_info *dma_info,
+				  size_t ring_offset,
+				  size_t ring_size,
+				  size_t start,
+				  size_t size);
+
+/**
+ * ethosn_dma_print_stats() - Print statistics of the allocator
+ * @allocator: Allocator object
+ * @s: Sequence file to print to
+ *
+ * Prints nothing for allocators which don't keep any statistics.
+ */
+void ethosn_dma_print_stats(struct ethosn_dma_allocator *allocator,
+			    struct seq_file *s);
+
 #endif /* _ETHOSN_DMA_H_ */
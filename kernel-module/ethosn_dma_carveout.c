@@ -26,32 +26,362 @@
 
 #include <linux/dma-mapping.h>
 #include <linux/iommu.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <linux/mutex.h>
 #include <linux/of_address.h>
+#include <linux/seq_file.h>
+
+/*
+ * Buffers of up to half a chunk are sub-allocated from chunks of the reserved
+ * memory, which saves going through the DMA API for every small buffer and
+ * keeps them from fragmenting the reserved memory. Larger buffers are
+ * allocated from the reserved memory directly.
+ */
+#define CARVEOUT_CHUNK_ORDER      9
+#define CARVEOUT_CHUNK_SIZE       (PAGE_SIZE << CARVEOUT_CHUNK_ORDER)
+#define CARVEOUT_MAX_POOLED_SIZE  (CARVEOUT_CHUNK_SIZE / 2)
+#define CARVEOUT_NR_SIZE_CLASSES  (CARVEOUT_CHUNK_ORDER + 1)
+
+/**
+ * struct carveout_chunk - Chunk of reserved memory buffers are sub-allocated
+ *                         from
+ * @node:	Node in the list of chunks of the pool.
+ * @blocks:	Free and allocated blocks of the chunk, sorted by address.
+ * @cpu_addr:	CPU address of the chunk.
+ * @dma_addr:	DMA address of the chunk.
+ * @nr_allocs:	Number of allocated blocks in the chunk.
+ */
+struct carveout_chunk {
+	struct list_head node;
+	struct list_head blocks;
+	void             *cpu_addr;
+	dma_addr_t       dma_addr;
+	unsigned int     nr_allocs;
+};
+
+/**
+ * struct carveout_block - Free or allocated range of a chunk
+ * @chunk_node:	Node in the list of blocks of the chunk.
+ * @free_node:	Node in the free list of its size class, if the block is free.
+ * @chunk:	Chunk the block is in.
+ * @offset:	Offset in bytes of the block in the chunk.
+ * @size:	Size in bytes of the block, a multiple of PAGE_SIZE.
+ * @free:	Whether the block is free.
+ */
+struct carveout_block {
+	struct list_head      chunk_node;
+	struct list_head      free_node;
+	struct carveout_chunk *chunk;
+	size_t                offset;
+	size_t                size;
+	bool                  free;
+};
+
+/**
+ * struct carveout_pool - Pool of chunks of reserved memory
+ * @lock:		Protects the pool.
+ * @chunks:		Chunks of the pool.
+ * @free_lists:		Free blocks, by size class. Class k holds the blocks
+ *			of 2^k to 2^(k+1) - 1 pages.
+ * @nr_chunks:		Number of chunks in the pool.
+ * @nr_empty_chunks:	Number of chunks without any allocated block. At most
+ *			one is kept, to not thrash when a buffer is repeatedly
+ *			allocated and freed.
+ * @pooled_bytes:	Bytes allocated from the chunks.
+ * @free_bytes:		Bytes free in the chunks.
+ * @nr_pooled_allocs:	Number of buffers allocated from the chunks.
+ * @direct_bytes:	Bytes allocated directly from the reserved memory.
+ * @nr_direct_allocs:	Number of buffers allocated directly from the reserved
+ *			memory.
+ */
+struct carveout_pool {
+	struct mutex     lock;
+	struct list_head chunks;
+	struct list_head free_lists[CARVEOUT_NR_SIZE_CLASSES];
+	unsigned int     nr_chunks;
+	unsigned int     nr_empty_chunks;
+	size_t           pooled_bytes;
+	size_t           free_bytes;
+	unsigned long    nr_pooled_allocs;
+	size_t           direct_bytes;
+	unsigned long    nr_direct_allocs;
+};
 
 struct ethosn_allocator_internal {
 	struct ethosn_dma_allocator allocator;
 
 	struct device_node          *res_mem;
+	struct carveout_pool        pool;
+};
+
+struct ethosn_dma_info_internal {
+	struct ethosn_dma_info info;
+	/* Block the buffer is sub-allocated from, NULL if allocated directly */
+	struct carveout_block  *block;
 };
 
+static struct list_head *carveout_free_list(struct carveout_pool *pool,
+					    size_t size)
+{
+	return &pool->free_lists[ilog2(size >> PAGE_SHIFT)];
+}
+
+static struct carveout_chunk *carveout_add_chunk(
+	struct ethosn_dma_allocator *allocator,
+	struct carveout_pool *pool,
+	gfp_t gfp)
+{
+	struct carveout_chunk *chunk;
+	struct carveout_block *block;
+
+	chunk = kzalloc(sizeof(*chunk), gfp);
+	if (!chunk)
+		return NULL;
+
+	block = kzalloc(sizeof(*block), gfp);
+	if (!block)
+		goto free_chunk;
+
+	chunk->cpu_addr = dma_alloc_wc(allocator->dev, CARVEOUT_CHUNK_SIZE,
+				       &chunk->dma_addr, gfp);
+	if (!chunk->cpu_addr)
+		goto free_block;
+
+	INIT_LIST_HEAD(&chunk->blocks);
+	list_add_tail(&chunk->node, &pool->chunks);
+
+	/* The whole chunk is initially a single free block */
+	*block = (struct carveout_block) {
+		.chunk = chunk,
+		.offset = 0,
+		.size = CARVEOUT_CHUNK_SIZE,
+		.free = true,
+	};
+	list_add(&block->chunk_node, &chunk->blocks);
+	list_add(&block->free_node, carveout_free_list(pool, block->size));
+
+	++pool->nr_chunks;
+	++pool->nr_empty_chunks;
+	pool->free_bytes += CARVEOUT_CHUNK_SIZE;
+
+	return chunk;
+
+free_block:
+	kfree(block);
+free_chunk:
+	kfree(chunk);
+
+	return NULL;
+}
+
+static void carveout_remove_chunk(struct ethosn_dma_allocator *allocator,
+				  struct carveout_pool *pool,
+				  struct carveout_chunk *chunk)
+{
+	struct carveout_block *block;
+	struct carveout_block *tmp;
+
+	list_for_each_entry_safe(block, tmp, &chunk->blocks, chunk_node) {
+		if (block->free) {
+			list_del(&block->free_node);
+			pool->free_bytes -= block->size;
+		}
+
+		kfree(block);
+	}
+
+	if (!chunk->nr_allocs)
+		--pool->nr_empty_chunks;
+
+	--pool->nr_chunks;
+	list_del(&chunk->node);
+	dma_free_wc(allocator->dev, CARVEOUT_CHUNK_SIZE, chunk->cpu_addr,
+		    chunk->dma_addr);
+	kfree(chunk);
+}
+
+/*
+ * All the blocks of the first size class which may fit are smaller than twice
+ * the size, so the first block which fits is a good fit. Any block of a larger
+ * class fits.
+ */
+static struct carveout_block *carveout_find_block(struct carveout_pool *pool,
+						  size_t size)
+{
+	struct carveout_block *block;
+	int k;
+
+	for (k = ilog2(size >> PAGE_SHIFT); k < CARVEOUT_NR_SIZE_CLASSES; ++k)
+		list_for_each_entry(block, &pool->free_lists[k], free_node)
+			if (block->size >= size)
+				return block;
+
+	return NULL;
+}
+
+/**
+ * carveout_pool_alloc() - Sub-allocate a block from the chunks of the pool.
+ * @allocator:	Allocator object.
+ * @size:	Size in bytes of the block, a multiple of PAGE_SIZE.
+ * @gfp:	GFP flags of the allocations of the block and of a new chunk,
+ *		if needed.
+ *
+ * Return: Allocated block, or NULL if there is no memory for it.
+ */
+static struct carveout_block *carveout_pool_alloc(
+	struct ethosn_dma_allocator *allocator,
+	size_t size,
+	gfp_t gfp)
+{
+	struct ethosn_allocator_internal *allocator_private =
+		container_of(allocator, typeof(*allocator_private), allocator);
+	struct carveout_pool *pool = &allocator_private->pool;
+	struct carveout_block *block;
+	struct carveout_block *rest;
+
+	/* Allocating from a larger free block splits it in two */
+	rest = kzalloc(sizeof(*rest), gfp);
+	if (!rest)
+		return NULL;
+
+	mutex_lock(&pool->lock);
+
+	block = carveout_find_block(pool, size);
+	if (!block) {
+		struct carveout_chunk *chunk =
+			carveout_add_chunk(allocator, pool, gfp);
+
+		if (!chunk)
+			goto unlock;
+
+		block = list_first_entry(&chunk->blocks, struct carveout_block,
+					 chunk_node);
+	}
+
+	list_del(&block->free_node);
+
+	if (block->size > size) {
+		*rest = (struct carveout_block) {
+			.chunk = block->chunk,
+			.offset = block->offset + size,
+			.size = block->size - size,
+			.free = true,
+		};
+		list_add(&rest->chunk_node, &block->chunk_node);
+		list_add(&rest->free_node, carveout_free_list(pool,
+							      rest->size));
+		rest = NULL;
+		block->size = size;
+	}
+
+	block->free = false;
+	if (block->chunk->nr_allocs++ == 0)
+		--pool->nr_empty_chunks;
+
+	pool->free_bytes -= size;
+	pool->pooled_bytes += size;
+	++pool->nr_pooled_allocs;
+
+unlock:
+	mutex_unlock(&pool->lock);
+
+	kfree(rest);
+
+	return block;
+}
+
+/*
+ * The block is merged with the free blocks either side of it, if any, and its
+ * chunk is released once it is completely free, unless it is the only such
+ * chunk.
+ */
+static void carveout_pool_free(struct ethosn_dma_allocator *allocator,
+			       struct carveout_block *block)
+{
+	struct ethosn_allocator_internal *allocator_private =
+		container_of(allocator, typeof(*allocator_private), allocator);
+	struct carveout_pool *pool = &allocator_private->pool;
+	struct carveout_chunk *chunk = block->chunk;
+	struct carveout_block *prev;
+	struct carveout_block *next;
+
+	mutex_lock(&pool->lock);
+
+	pool->free_bytes += block->size;
+	pool->pooled_bytes -= block->size;
+	--pool->nr_pooled_allocs;
+	block->free = true;
+
+	if (block->chunk_node.prev != &chunk->blocks) {
+		prev = list_prev_entry(block, chunk_node);
+		if (prev->free) {
+			list_del(&prev->free_node);
+			prev->size += block->size;
+			list_del(&block->chunk_node);
+			kfree(block);
+			block = prev;
+		}
+	}
+
+	if (block->chunk_node.next != &chunk->blocks) {
+		next = list_next_entry(block, chunk_node);
+		if (next->free) {
+			list_del(&next->free_node);
+			block->size += next->size;
+			list_del(&next->chunk_node);
+			kfree(next);
+		}
+	}
+
+	list_add(&block->free_node, carveout_free_list(pool, block->size));
+
+	if (--chunk->nr_allocs == 0) {
+		++pool->nr_empty_chunks;
+		if (pool->nr_empty_chunks > 1)
+			carveout_remove_chunk(allocator, pool, chunk);
+	}
+
+	mutex_unlock(&pool->lock);
+}
+
 static struct ethosn_dma_info *carveout_alloc(
 	struct ethosn_dma_allocator *allocator,
 	const size_t size,
 	gfp_t gfp)
 {
-	struct ethosn_dma_info *dma_info;
+	struct ethosn_allocator_internal *allocator_private =
+		container_of(allocator, typeof(*allocator_private), allocator);
+	struct carveout_pool *pool = &allocator_private->pool;
+	struct ethosn_dma_info_internal *dma_info;
+	struct carveout_block *block = NULL;
 	void *cpu_addr = NULL;
 	dma_addr_t dma_addr = 0;
 
-	/* FIXME:- We cannot allocate addresses at different 512MB offsets */
-	/* for the different streams. */
+	/*
+	 * The streams can't be placed at different 512MB offsets, as they all
+	 * share the reserved memory (see carveout_get_addr_base).
+	 */
 	dma_info = devm_kzalloc(allocator->dev,
-				sizeof(struct ethosn_dma_info),
+				sizeof(struct ethosn_dma_info_internal),
 				GFP_KERNEL);
 	if (!dma_info)
 		return ERR_PTR(-ENOMEM);
 
-	if (size) {
+	if (size && (PAGE_ALIGN(size) <= CARVEOUT_MAX_POOLED_SIZE))
+		block = carveout_pool_alloc(allocator, PAGE_ALIGN(size), gfp);
+
+	if (block) {
+		cpu_addr = block->chunk->cpu_addr + block->offset;
+		dma_addr = block->chunk->dma_addr + block->offset;
+
+		/* Memory from the DMA API is zeroed, so keep it that way */
+		memset(cpu_addr, 0, block->size);
+	} else if (size) {
+		/*
+		 * Also fall back to a direct allocation if the reserved memory
+		 * is too fragmented for a new chunk.
+		 */
 		cpu_addr =
 			dma_alloc_wc(allocator->dev, size, &dma_addr, gfp);
 		if (!cpu_addr) {
@@ -62,15 +392,23 @@ static struct ethosn_dma_info *carveout_alloc(
 
 			return ERR_PTR(-ENOMEM);
 		}
+
+		mutex_lock(&pool->lock);
+		pool->direct_bytes += size;
+		++pool->nr_direct_allocs;
+		mutex_unlock(&pool->lock);
 	}
 
-	*dma_info = (struct ethosn_dma_info) {
-		.size = size,
-		.cpu_addr = cpu_addr,
-		.iova_addr = dma_addr,
+	*dma_info = (struct ethosn_dma_info_internal) {
+		.info = (struct ethosn_dma_info) {
+			.size = size,
+			.cpu_addr = cpu_addr,
+			.iova_addr = dma_addr,
+		},
+		.block = block,
 	};
 
-	return dma_info;
+	return &dma_info->info;
 }
 
 static int carveout_map(struct ethosn_dma_allocator *allocator,
@@ -87,18 +425,29 @@ static void carveout_unmap(struct ethosn_dma_allocator *allocator,
 {}
 
 static void carveout_free(struct ethosn_dma_allocator *allocator,
-			  struct ethosn_dma_info *dma_info)
+			  struct ethosn_dma_info *_dma_info)
 {
-	const dma_addr_t dma_addr = dma_info->iova_addr;
-
-	/* FIXME:- We cannot allocate addresses at different 512MB offsets */
-	/* for the different streams. */
-	if (dma_info->size)
-		dma_free_wc(allocator->dev, dma_info->size,
-			    dma_info->cpu_addr,
+	struct ethosn_allocator_internal *allocator_private =
+		container_of(allocator, typeof(*allocator_private), allocator);
+	struct carveout_pool *pool = &allocator_private->pool;
+	struct ethosn_dma_info_internal *dma_info =
+		container_of(_dma_info, typeof(*dma_info), info);
+	const dma_addr_t dma_addr = _dma_info->iova_addr;
+
+	if (dma_info->block) {
+		carveout_pool_free(allocator, dma_info->block);
+	} else if (_dma_info->size) {
+		dma_free_wc(allocator->dev, _dma_info->size,
+			    _dma_info->cpu_addr,
 			    dma_addr);
 
-	memset(dma_info, 0, sizeof(struct ethosn_dma_info));
+		mutex_lock(&pool->lock);
+		pool->direct_bytes -= _dma_info->size;
+		--pool->nr_direct_allocs;
+		mutex_unlock(&pool->lock);
+	}
+
+	memset(dma_info, 0, sizeof(*dma_info));
 	devm_kfree(allocator->dev, dma_info);
 }
 
@@ -110,6 +459,19 @@ static void carveout_sync_for_cpu(struct ethosn_dma_allocator *allocator,
 				  struct ethosn_dma_info *dma_info)
 {}
 
+static void carveout_sync_range_for_device(
+	struct ethosn_dma_allocator *allocator,
+	struct ethosn_dma_info *dma_info,
+	size_t offset,
+	size_t size)
+{}
+
+static void carveout_sync_range_for_cpu(struct ethosn_dma_allocator *allocator,
+					struct ethosn_dma_info *dma_info,
+					size_t offset,
+					size_t size)
+{}
+
 static int carveout_mmap(struct ethosn_dma_allocator *allocator,
 			 struct vm_area_struct *const vma,
 			 const struct ethosn_dma_info *const dma_info)
@@ -172,11 +534,65 @@ static resource_size_t carveout_get_addr_size(
 		return resource_size(&r);
 }
 
-static void carveout_allocator_destroy(struct ethosn_dma_allocator *allocator)
+static void carveout_print_stats(struct ethosn_dma_allocator *_allocator,
+				 struct seq_file *s)
+{
+	struct ethosn_allocator_internal *allocator =
+		container_of(_allocator, typeof(*allocator), allocator);
+	struct carveout_pool *pool = &allocator->pool;
+	const resource_size_t reserved_size =
+		carveout_get_addr_size(_allocator, ETHOSN_STREAM_FIRMWARE);
+	struct carveout_block *block;
+	size_t largest_free = 0;
+	unsigned long fragmentation = 0;
+	int k;
+
+	mutex_lock(&pool->lock);
+
+	/* The largest free block is in the highest non-empty size class */
+	for (k = CARVEOUT_NR_SIZE_CLASSES - 1; k >= 0 && !largest_free; --k)
+		list_for_each_entry(block, &pool->free_lists[k], free_node)
+			largest_free = max(largest_free, block->size);
+
+	/*
+	 * Share of the free space of the chunks which is not in the largest
+	 * free block, i.e. which a single allocation can't use.
+	 */
+	if (pool->free_bytes)
+		fragmentation = 100 - largest_free * 100 / pool->free_bytes;
+
+	seq_printf(s, "reserved: size=%llu\n",
+		   (unsigned long long)reserved_size);
+	seq_printf(s,
+		   "pool: chunks=%u chunk_size=%lu allocated=%zu free=%zu largest_free=%zu fragmentation=%lu%% allocations=%lu\n",
+		   pool->nr_chunks, CARVEOUT_CHUNK_SIZE, pool->pooled_bytes,
+		   pool->free_bytes, largest_free, fragmentation,
+		   pool->nr_pooled_allocs);
+	seq_printf(s, "direct: allocated=%zu allocations=%lu\n",
+		   pool->direct_bytes, pool->nr_direct_allocs);
+
+	mutex_unlock(&pool->lock);
+}
+
+static void carveout_allocator_destroy(struct ethosn_dma_allocator *_allocator)
 {
-	struct device *dev = allocator->dev;
+	struct ethosn_allocator_internal *allocator =
+		container_of(_allocator, typeof(*allocator), allocator);
+	struct carveout_pool *pool = &allocator->pool;
+	struct carveout_chunk *chunk;
+	struct carveout_chunk *tmp;
+	struct device *dev = _allocator->dev;
+
+	if (pool->nr_pooled_allocs)
+		dev_warn(dev, "Destroying DMA allocator with %lu buffers\n",
+			 pool->nr_pooled_allocs);
 
-	memset(allocator, 0, sizeof(struct ethosn_dma_allocator));
+	list_for_each_entry_safe(chunk, tmp, &pool->chunks, node)
+		carveout_remove_chunk(_allocator, pool, chunk);
+
+	mutex_destroy(&pool->lock);
+
+	memset(allocator, 0, sizeof(struct ethosn_allocator_internal));
 	devm_kfree(dev, allocator);
 }
 
@@ -184,19 +600,23 @@ struct ethosn_dma_allocator *ethosn_dma_carveout_allocator_create(
 	struct device *dev)
 {
 	static struct ethosn_dma_allocator_ops ops = {
-		.destroy         = carveout_allocator_destroy,
-		.alloc           = carveout_alloc,
-		.map             = carveout_map,
-		.unmap           = carveout_unmap,
-		.free            = carveout_free,
-		.sync_for_device = carveout_sync_for_device,
-		.sync_for_cpu    = carveout_sync_for_cpu,
-		.mmap            = carveout_mmap,
-		.get_addr_base   = carveout_get_addr_base,
-		.get_addr_size   = carveout_get_addr_size,
+		.destroy               = carveout_allocator_destroy,
+		.alloc                 = carveout_alloc,
+		.map                   = carveout_map,
+		.unmap                 = carveout_unmap,
+		.free                  = carveout_free,
+		.sync_for_device       = carveout_sync_for_device,
+		.sync_for_cpu          = carveout_sync_for_cpu,
+		.sync_range_for_device = carveout_sync_range_for_device,
+		.sync_range_for_cpu    = carveout_sync_range_for_cpu,
+		.mmap                  = carveout_mmap,
+		.get_addr_base         = carveout_get_addr_base,
+		.get_addr_size         = carveout_get_addr_size,
+		.print_stats           = carveout_print_stats,
 	};
 	struct ethosn_allocator_internal *allocator;
 	struct device_node *res_mem;
+	int k;
 
 	/* Iterrates backwards device tree to find a memory-region phandle */
 	do {
@@ -225,5 +645,10 @@ struct ethosn_dma_allocator *ethosn_dma_carveout_allocator_create(
 	allocator->allocator.dev = dev;
 	allocator->allocator.ops = &ops;
 
+	mutex_init(&allocator->pool.lock);
+	INIT_LIST_HEAD(&allocator->pool.chunks);
+	for (k = 0; k < CARVEOUT_NR_SIZE_CLASSES; ++k)
+		INIT_LIST_HEAD(&allocator->pool.free_lists[k]);
+
 	return &allocator->allocator;
 }
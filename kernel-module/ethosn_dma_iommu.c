@@ -27,6 +27,10 @@
 #include <linux/iommu.h>
 #include <linux/iova.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/rbtree.h>
+#include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/version.h>
 #include <linux/vmalloc.h>
 
@@ -44,12 +48,60 @@
 /* IOMMU address space size, use the same for all streams. */
 #define IOMMU_ADDR_SIZE 0x20000000UL
 
+/*
+ * Largest order of the blocks of pages a buffer is allocated with, i.e. 2 MiB
+ * with 4 KiB pages, which is the largest IOMMU block size buffers are likely
+ * to use.
+ */
+#define IOMMU_MAX_ALLOC_ORDER (21 - PAGE_SHIFT)
+
+/**
+ * struct ethosn_iova_range - Range of pages of the IOVA space of a stream
+ * @addr_node:	Node in the tree of free or allocated ranges sorted by
+ *		address.
+ * @size_node:	Node in the tree of free ranges sorted by size.
+ * @start:	Index of the first page of the range in the stream.
+ * @size:	Number of pages in the range.
+ *
+ * A range is either free, in which case it is in both trees of free ranges of
+ * its stream, or allocated to a buffer, in which case it is only in the tree
+ * of allocated ranges.
+ */
+struct ethosn_iova_range {
+	struct rb_node addr_node;
+	struct rb_node size_node;
+	unsigned long  start;
+	unsigned long  size;
+};
+
+/**
+ * struct ethosn_iommu_stream - IOVA space of a stream
+ * @free_by_addr:	Free ranges sorted by address, to merge neighbours.
+ * @free_by_size:	Free ranges sorted by size, then address, to find the
+ *			best fit for an allocation.
+ * @allocated:		Allocated ranges sorted by address, to find them
+ *			again when they are freed.
+ * @addr_base:		IOVA of the first page of the stream.
+ * @nr_pages:		Number of pages in the stream.
+ * @nr_free_pages:	Number of free pages in the stream.
+ * @nr_free_ranges:	Number of free ranges in the stream.
+ * @nr_allocs:		Number of allocated ranges in the stream.
+ * @nr_failed_allocs:	Number of allocations which found no free range.
+ * @page:		Page that the free ranges are mapped to, if any.
+ * @lock:		Protects the ranges and statistics.
+ */
 struct ethosn_iommu_stream {
-	void        *bitmap;
-	dma_addr_t  addr_base;
-	size_t      bits;
-	struct page *page;
-	spinlock_t  lock;
+	struct rb_root free_by_addr;
+	struct rb_root free_by_size;
+	struct rb_root allocated;
+	dma_addr_t     addr_base;
+	unsigned long  nr_pages;
+	unsigned long  nr_free_pages;
+	unsigned long  nr_free_ranges;
+	unsigned long  nr_allocs;
+	unsigned long  nr_failed_allocs;
+	struct page    *page;
+	spinlock_t     lock;
 };
 
 struct ethosn_iommu_domain {
@@ -70,8 +122,8 @@ struct ethosn_allocator_internal {
 struct ethosn_dma_info_internal {
 	struct ethosn_dma_info info;
 	/* Allocator private members */
-	dma_addr_t             *dma_addr;
 	struct page            **pages;
+	struct sg_table        sgt;
 };
 
 static struct ethosn_iommu_stream *iommu_get_stream(
@@ -148,64 +200,382 @@ static resource_size_t iommu_get_addr_size(
 	return IOMMU_ADDR_SIZE;
 }
 
-static dma_addr_t iommu_alloc_iova(struct ethosn_dma_info_internal *dma,
-				   struct ethosn_iommu_domain *domain,
-				   struct ethosn_iommu_stream *stream)
+static void iova_insert_by_addr(struct rb_root *root,
+				struct ethosn_iova_range *range)
+{
+	struct rb_node **link = &root->rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*link) {
+		struct ethosn_iova_range *r =
+			rb_entry(*link, struct ethosn_iova_range, addr_node);
+
+		parent = *link;
+		if (range->start < r->start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&range->addr_node, parent, link);
+	rb_insert_color(&range->addr_node, root);
+}
+
+static void iova_insert_by_size(struct ethosn_iommu_stream *stream,
+				struct ethosn_iova_range *range)
+{
+	struct rb_node **link = &stream->free_by_size.rb_node;
+	struct rb_node *parent = NULL;
+
+	while (*link) {
+		struct ethosn_iova_range *r =
+			rb_entry(*link, struct ethosn_iova_range, size_node);
+
+		parent = *link;
+		if ((range->size < r->size) ||
+		    ((range->size == r->size) && (range->start < r->start)))
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&range->size_node, parent, link);
+	rb_insert_color(&range->size_node, &stream->free_by_size);
+}
+
+static void iova_insert_free(struct ethosn_iommu_stream *stream,
+			     struct ethosn_iova_range *range)
+{
+	iova_insert_by_addr(&stream->free_by_addr, range);
+	iova_insert_by_size(stream, range);
+	++stream->nr_free_ranges;
+}
+
+static void iova_erase_free(struct ethosn_iommu_stream *stream,
+			    struct ethosn_iova_range *range)
+{
+	rb_erase(&range->addr_node, &stream->free_by_addr);
+	rb_erase(&range->size_node, &stream->free_by_size);
+	--stream->nr_free_ranges;
+}
+
+static bool iova_range_fits(const struct ethosn_iova_range *range,
+			    unsigned long size,
+			    unsigned long align)
+{
+	unsigned long start = ALIGN(range->start, align);
+
+	return start + size <= range->start + range->size;
+}
+
+/**
+ * iova_find_free() - Find the free range to allocate pages from.
+ * @stream:	IOVA space to search.
+ * @size:	Number of pages to allocate.
+ * @align:	Alignment in pages of the allocation, a power of 2.
+ *
+ * Finds the smallest free range which fits the allocation whatever its own
+ * alignment, in O(log n). Only if there is none are the smaller ranges which
+ * may still fit once aligned searched one by one.
+ *
+ * Return: Free range, or NULL if there is none which fits the allocation.
+ */
+static struct ethosn_iova_range *iova_find_free(
+	struct ethosn_iommu_stream *stream,
+	unsigned long size,
+	unsigned long align)
+{
+	struct rb_node *node = stream->free_by_size.rb_node;
+	struct ethosn_iova_range *best = NULL;
+	struct ethosn_iova_range *first = NULL;
+	struct rb_node *n;
+
+	while (node) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, size_node);
+
+		if (r->size >= size + align - 1) {
+			best = r;
+			node = node->rb_left;
+		} else {
+			if (r->size >= size)
+				first = r;
+
+			node = node->rb_right;
+		}
+	}
+
+	if (best || (align == 1))
+		return best;
+
+	/* Find the smallest range of at least size pages */
+	for (n = first ? &first->size_node : NULL; n; n = rb_prev(n)) {
+		struct ethosn_iova_range *r =
+			rb_entry(n, struct ethosn_iova_range, size_node);
+
+		if (r->size < size)
+			break;
+
+		first = r;
+	}
+
+	for (n = first ? &first->size_node : NULL; n; n = rb_next(n)) {
+		struct ethosn_iova_range *r =
+			rb_entry(n, struct ethosn_iova_range, size_node);
+
+		if (iova_range_fits(r, size, align))
+			return r;
+	}
+
+	return NULL;
+}
+
+/*
+ * The IOVA is aligned like the first (and largest) block of pages of the
+ * buffer (see iommu_alloc_pages), so that the IOMMU can map the blocks with
+ * the largest page sizes it supports.
+ */
+static dma_addr_t iommu_alloc_iova(struct ethosn_iommu_stream *stream,
+				   int nr_pages)
 {
-	unsigned long start = 0;
+	unsigned int order = min_t(unsigned int, ilog2(nr_pages),
+				   IOMMU_MAX_ALLOC_ORDER);
+	unsigned long align = 1UL << order;
+	struct ethosn_iova_range *iova;
+	struct ethosn_iova_range *spare;
+	struct ethosn_iova_range *range;
 	unsigned long flags;
-	int nr_pages = DIV_ROUND_UP(dma->info.size, PAGE_SIZE);
-	dma_addr_t iova = 0;
+	unsigned long start;
+	unsigned long head;
+	unsigned long tail;
+
+	/*
+	 * Allocating from the middle of a free range splits it in two, so a
+	 * node is needed for the allocation and possibly one for the split.
+	 */
+	iova = kzalloc(sizeof(*iova), GFP_KERNEL);
+	spare = kzalloc(sizeof(*spare), GFP_KERNEL);
+	if (!iova || !spare)
+		goto free_nodes;
 
 	spin_lock_irqsave(&stream->lock, flags);
 
-	start = bitmap_find_next_zero_area(stream->bitmap, stream->bits, 0,
-					   nr_pages, 0);
-	if (start > stream->bits)
-		goto ret;
+	range = iova_find_free(stream, nr_pages, align);
+	if (!range) {
+		++stream->nr_failed_allocs;
+		spin_unlock_irqrestore(&stream->lock, flags);
+		goto free_nodes;
+	}
 
-	bitmap_set(stream->bitmap, start, nr_pages);
+	start = ALIGN(range->start, align);
+	head = start - range->start;
+	tail = range->start + range->size - (start + nr_pages);
+
+	iova_erase_free(stream, range);
+
+	if (head) {
+		range->size = head;
+		iova_insert_free(stream, range);
+		range = spare;
+		spare = NULL;
+	}
+
+	if (tail) {
+		range->start = start + nr_pages;
+		range->size = tail;
+		iova_insert_free(stream, range);
+		range = NULL;
+	}
+
+	iova->start = start;
+	iova->size = nr_pages;
+	iova_insert_by_addr(&stream->allocated, iova);
+
+	stream->nr_free_pages -= nr_pages;
+	++stream->nr_allocs;
 
-	iova = stream->addr_base + start * PAGE_SIZE;
-ret:
 	spin_unlock_irqrestore(&stream->lock, flags);
 
-	return iova;
+	kfree(range);
+	kfree(spare);
+
+	return stream->addr_base + start * PAGE_SIZE;
+
+free_nodes:
+	kfree(spare);
+	kfree(iova);
+
+	return 0;
 }
 
-static void iommu_free_iova(dma_addr_t start,
-			    struct ethosn_iommu_stream *stream,
-			    int nr_pages)
+/*
+ * The range of the allocation becomes free again, merged with the free ranges
+ * either side of it, if any.
+ */
+static void iommu_free_iova(dma_addr_t start_addr,
+			    struct ethosn_iommu_stream *stream)
 {
+	struct rb_node *node;
+	struct ethosn_iova_range *iova = NULL;
+	struct ethosn_iova_range *prev = NULL;
+	struct ethosn_iova_range *next = NULL;
+	unsigned long start;
 	unsigned long flags;
 
 	if (!stream)
 		return;
 
+	start = (start_addr - stream->addr_base) / PAGE_SIZE;
+
 	spin_lock_irqsave(&stream->lock, flags);
 
-	bitmap_clear(stream->bitmap,
-		     (start - stream->addr_base) / PAGE_SIZE,
-		     nr_pages);
+	node = stream->allocated.rb_node;
+	while (node) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, addr_node);
+
+		if (start < r->start) {
+			node = node->rb_left;
+		} else if (start > r->start) {
+			node = node->rb_right;
+		} else {
+			iova = r;
+			break;
+		}
+	}
+
+	if (WARN_ON(!iova)) {
+		spin_unlock_irqrestore(&stream->lock, flags);
+
+		return;
+	}
+
+	rb_erase(&iova->addr_node, &stream->allocated);
+
+	/* Find the free ranges either side of the allocation */
+	node = stream->free_by_addr.rb_node;
+	while (node) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, addr_node);
+
+		if (r->start < iova->start) {
+			prev = r;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
+	}
+
+	node = prev ? rb_next(&prev->addr_node) :
+	       rb_first(&stream->free_by_addr);
+	if (node)
+		next = rb_entry(node, struct ethosn_iova_range, addr_node);
+
+	stream->nr_free_pages += iova->size;
+	--stream->nr_allocs;
+
+	if (prev && (prev->start + prev->size == iova->start)) {
+		iova_erase_free(stream, prev);
+		iova->start = prev->start;
+		iova->size += prev->size;
+	} else {
+		prev = NULL;
+	}
+
+	if (next && (iova->start + iova->size == next->start)) {
+		iova_erase_free(stream, next);
+		iova->size += next->size;
+	} else {
+		next = NULL;
+	}
+
+	iova_insert_free(stream, iova);
 
 	spin_unlock_irqrestore(&stream->lock, flags);
+
+	kfree(prev);
+	kfree(next);
 }
 
-static void iommu_free_pages(struct ethosn_dma_allocator *allocator,
-			     dma_addr_t dma_addr[],
-			     struct page *pages[],
+static void iommu_free_pages(struct page *pages[],
 			     int nr_pages)
 {
 	int i;
 
-	for (i = 0; i < nr_pages; ++i) {
-		if (dma_addr[i])
-			dma_unmap_page(allocator->dev, dma_addr[i],
-				       PAGE_SIZE, DMA_BIDIRECTIONAL);
-
+	for (i = 0; i < nr_pages; ++i)
 		if (pages[i])
 			__free_page(pages[i]);
+}
+
+/**
+ * iommu_alloc_pages() - Allocate the pages of a buffer in blocks of as high an
+ *                       order as possible.
+ * @pages:	Array to fill with the pages.
+ * @nr_pages:	Number of pages to allocate.
+ * @gfp:	GFP flags of the allocation.
+ *
+ * Blocks are never larger than what is left to allocate and their order only
+ * ever decreases, so each block starts at an offset into the buffer which is a
+ * multiple of its size. The blocks are split so that each page can be used,
+ * e.g. vmapped, and freed on its own.
+ *
+ * Return: Number of pages allocated, nr_pages on success.
+ */
+static int iommu_alloc_pages(struct page *pages[],
+			     int nr_pages,
+			     gfp_t gfp)
+{
+	unsigned int order = IOMMU_MAX_ALLOC_ORDER;
+	int i = 0;
+	int j;
+
+	gfp &= ~__GFP_COMP;
+
+	while (i < nr_pages) {
+		struct page *page;
+
+		order = min_t(unsigned int, order, ilog2(nr_pages - i));
+
+		/* Fall back to lower orders, down to single pages */
+		for (;;) {
+			page = alloc_pages(order ?
+					   gfp | __GFP_NOWARN | __GFP_NORETRY :
+					   gfp,
+					   order);
+			if (page || !order)
+				break;
+
+			--order;
+		}
+
+		if (!page)
+			break;
+
+		if (order)
+			split_page(page, order);
+
+		for (j = 0; j < (1 << order); ++j)
+			pages[i++] = page + j;
 	}
+
+	return i;
+}
+
+/*
+ * Number of physically contiguous pages in the given array starting from
+ * pages[i].
+ */
+static int iommu_contiguous_pages(struct page *pages[],
+				  int i,
+				  int nr_pages)
+{
+	const unsigned long pfn = page_to_pfn(pages[i]);
+	int n = 1;
+
+	while ((i + n < nr_pages) && (page_to_pfn(pages[i + n]) == pfn + n))
+		++n;
+
+	return n;
 }
 
 static struct ethosn_dma_info *iommu_alloc(
@@ -216,9 +586,10 @@ static struct ethosn_dma_info *iommu_alloc(
 	struct page **pages = NULL;
 	struct ethosn_dma_info_internal *dma_info;
 	void *cpu_addr = NULL;
-	dma_addr_t *dma_addr = NULL;
+	struct sg_table sgt = { 0 };
 	int nr_pages = DIV_ROUND_UP(size, PAGE_SIZE);
-	int i;
+	int nr_allocated;
+	int nents;
 
 	dma_info =
 		devm_kzalloc(allocator->dev,
@@ -237,36 +608,31 @@ static struct ethosn_dma_info *iommu_alloc(
 	if (!pages)
 		goto free_dma_info;
 
-	dma_addr = (dma_addr_t *)
-		   devm_kzalloc(allocator->dev,
-				sizeof(dma_addr_t) * nr_pages,
-				GFP_KERNEL);
-	if (!dma_addr)
-		goto free_pages_list;
-
-	for (i = 0; i < nr_pages; ++i) {
-		pages[i] = alloc_page(gfp);
-		if (!pages[i])
-			goto free_pages;
+	nr_allocated = iommu_alloc_pages(pages, nr_pages, gfp);
+	if (nr_allocated < nr_pages)
+		goto free_pages;
 
-		dma_addr[i] =
-			dma_map_page(allocator->dev, pages[i], 0,
-				     PAGE_SIZE,
-				     DMA_BIDIRECTIONAL);
+	/* Physically contiguous pages end up in the same segment */
+	if (sg_alloc_table_from_pages(&sgt, pages, nr_pages, 0,
+				      nr_pages * PAGE_SIZE, GFP_KERNEL))
+		goto free_pages;
 
-		if (dma_mapping_error(allocator->dev, dma_addr[i])) {
-			dev_err(allocator->dev,
-				"failed to dma map pa 0x%llX\n",
-				page_to_phys(dma_info->pages[i]));
-			goto free_pages;
-		}
+	nents = dma_map_sg(allocator->dev, sgt.sgl, sgt.orig_nents,
+			   DMA_BIDIRECTIONAL);
+	if (!nents) {
+		dev_err(allocator->dev,
+			"failed to dma map %u segments\n", sgt.orig_nents);
+		goto free_sgt;
 	}
 
+	sgt.nents = nents;
+
 	cpu_addr = vmap(pages, nr_pages, 0, PAGE_KERNEL);
 	if (!cpu_addr)
-		goto free_pages;
+		goto unmap_sg;
 
-	dev_dbg(allocator->dev, "Allocated DMA. handle=%p", dma_info);
+	dev_dbg(allocator->dev, "Allocated DMA. handle=%p, segments=%u",
+		dma_info, sgt.orig_nents);
 
 ret:
 	*dma_info = (struct ethosn_dma_info_internal) {
@@ -275,15 +641,19 @@ ret:
 			.cpu_addr = cpu_addr,
 			.iova_addr = 0
 		},
-		.dma_addr = dma_addr,
-		.pages = pages
+		.pages = pages,
+		.sgt = sgt
 	};
 
 	return &dma_info->info;
 
+unmap_sg:
+	dma_unmap_sg(allocator->dev, sgt.sgl, sgt.orig_nents,
+		     DMA_BIDIRECTIONAL);
+free_sgt:
+	sg_free_table(&sgt);
 free_pages:
-	iommu_free_pages(allocator, dma_addr, pages, i);
-free_pages_list:
+	iommu_free_pages(pages, nr_allocated);
 	devm_kfree(allocator->dev, pages);
 free_dma_info:
 	devm_kfree(allocator->dev, dma_info);
@@ -292,32 +662,25 @@ early_exit:
 	return ERR_PTR(-ENOMEM);
 }
 
-static void iommu_unmap_iova_pages(struct ethosn_dma_info_internal *dma_info,
+static void iommu_unmap_iova_pages(dma_addr_t start_addr,
+				   int nr_pages,
 				   struct iommu_domain *domain,
 				   struct ethosn_iommu_stream *stream)
 {
-	int nr_pages = DIV_ROUND_UP(dma_info->info.size, PAGE_SIZE);
 	int i;
 
-	for (i = 0; i < nr_pages; ++i) {
-		unsigned long iova_addr =
-			dma_info->info.iova_addr + i * PAGE_SIZE;
-
-		if (dma_info->pages[i]) {
-			/* TODO: Should handle error here */
-			iommu_unmap(domain, iova_addr, PAGE_SIZE);
-
-			if (stream->page)
-				iommu_map(
-					domain,
-					iova_addr,
-					page_to_phys(stream->page),
-					PAGE_SIZE,
-					IOMMU_READ);
-		}
-	}
+	/* TODO: Should handle error here */
+	iommu_unmap(domain, start_addr, nr_pages * PAGE_SIZE);
 
-	iommu_free_iova(dma_info->info.iova_addr, stream, nr_pages);
+	if (stream->page)
+		for (i = 0; i < nr_pages; ++i)
+			iommu_map(domain,
+				  start_addr + i * PAGE_SIZE,
+				  page_to_phys(stream->page),
+				  PAGE_SIZE,
+				  IOMMU_READ);
+
+	iommu_free_iova(start_addr, stream);
 }
 
 static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
@@ -335,7 +698,7 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 		container_of(_dma_info, typeof(*dma_info), info);
 	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
 	dma_addr_t start_addr = 0;
-	int i, err, iommu_prot = 0;
+	int i, n, err, iommu_prot = 0;
 
 	if (!dma_info->info.size)
 		goto ret;
@@ -346,7 +709,7 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 	if (!dma_info->pages)
 		goto early_exit;
 
-	start_addr = iommu_alloc_iova(dma_info, domain, stream);
+	start_addr = iommu_alloc_iova(stream, nr_pages);
 	if (!start_addr)
 		goto early_exit;
 
@@ -360,25 +723,30 @@ static int iommu_iova_map(struct ethosn_dma_allocator *allocator,
 		"%s: mapping %lu bytes starting at 0x%llX prot 0x%x\n",
 		__func__, dma_info->info.size, start_addr, iommu_prot);
 
-	for (i = 0; i < nr_pages; ++i) {
-		if (stream->page)
-			iommu_unmap(
-				domain->iommu_domain,
-				start_addr + i * PAGE_SIZE,
-				PAGE_SIZE);
+	if (stream->page)
+		iommu_unmap(domain->iommu_domain, start_addr,
+			    nr_pages * PAGE_SIZE);
+
+	/*
+	 * Map each physically contiguous run of pages at once, so the IOMMU
+	 * uses the largest block sizes the alignment of the run allows.
+	 */
+	for (i = 0; i < nr_pages; i += n) {
+		n = iommu_contiguous_pages(dma_info->pages, i, nr_pages);
 
 		err = iommu_map(
 			domain->iommu_domain,
 			start_addr + i * PAGE_SIZE,
 			page_to_phys(dma_info->pages[i]),
-			PAGE_SIZE,
+			n * PAGE_SIZE,
 			iommu_prot);
 
 		if (err) {
 			dev_err(allocator->dev,
 				"failed to iommu map iova 0x%llX pa 0x%llX size %lu\n",
 				start_addr + i * PAGE_SIZE,
-				page_to_phys(dma_info->pages[i]), PAGE_SIZE);
+				page_to_phys(dma_info->pages[i]),
+				n * PAGE_SIZE);
 			goto unmap_pages;
 		}
 	}
@@ -398,7 +766,8 @@ ret:
 	return 0;
 
 unmap_pages:
-	iommu_unmap_iova_pages(dma_info, domain->iommu_domain, stream);
+	iommu_unmap_iova_pages(start_addr, nr_pages, domain->iommu_domain,
+			       stream);
 early_exit:
 
 	return -ENOMEM;
@@ -421,7 +790,10 @@ static void iommu_iova_unmap(struct ethosn_dma_allocator *allocator,
 		return;
 
 	if (dma_info->info.size)
-		iommu_unmap_iova_pages(dma_info, domain->iommu_domain, stream);
+		iommu_unmap_iova_pages(dma_info->info.iova_addr,
+				       DIV_ROUND_UP(dma_info->info.size,
+						    PAGE_SIZE),
+				       domain->iommu_domain, stream);
 }
 
 static void iommu_free(struct ethosn_dma_allocator *allocator,
@@ -434,10 +806,11 @@ static void iommu_free(struct ethosn_dma_allocator *allocator,
 	vunmap(dma_info->info.cpu_addr);
 
 	if (dma_info->info.size) {
-		iommu_free_pages(allocator, dma_info->dma_addr, dma_info->pages,
-				 nr_pages);
+		dma_unmap_sg(allocator->dev, dma_info->sgt.sgl,
+			     dma_info->sgt.orig_nents, DMA_BIDIRECTIONAL);
+		sg_free_table(&dma_info->sgt);
+		iommu_free_pages(dma_info->pages, nr_pages);
 
-		devm_kfree(allocator->dev, dma_info->dma_addr);
 		devm_kfree(allocator->dev, dma_info->pages);
 	}
 
@@ -450,13 +823,12 @@ static void iommu_sync_for_device(struct ethosn_dma_allocator *allocator,
 {
 	struct ethosn_dma_info_internal *dma_info =
 		container_of(_dma_info, typeof(*dma_info), info);
-	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
-	int i;
 
-	for (i = 0; i < nr_pages; ++i)
-		dma_sync_single_for_device(allocator->dev,
-					   dma_info->dma_addr[i], PAGE_SIZE,
-					   DMA_TO_DEVICE);
+	if (!_dma_info->size)
+		return;
+
+	dma_sync_sg_for_device(allocator->dev, dma_info->sgt.sgl,
+			       dma_info->sgt.orig_nents, DMA_TO_DEVICE);
 }
 
 static void iommu_sync_for_cpu(struct ethosn_dma_allocator *allocator,
@@ -464,14 +836,74 @@ static void iommu_sync_for_cpu(struct ethosn_dma_allocator *allocator,
 {
 	struct ethosn_dma_info_internal *dma_info =
 		container_of(_dma_info, typeof(*dma_info), info);
-	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
 
+	if (!_dma_info->size)
+		return;
+
+	dma_sync_sg_for_cpu(allocator->dev, dma_info->sgt.sgl,
+			    dma_info->sgt.orig_nents, DMA_FROM_DEVICE);
+}
+
+/*
+ * Only the part of each scatter-gather entry which overlaps the range is
+ * synced, so a small range of a buffer made of large physically contiguous
+ * entries doesn't maintain the cache for the whole entry. The range has
+ * already been clamped to the size of the buffer by the caller.
+ */
+static void iommu_sync_sg_range(struct ethosn_dma_allocator *allocator,
+				struct ethosn_dma_info *_dma_info,
+				size_t offset,
+				size_t size,
+				bool for_device)
+{
+	struct ethosn_dma_info_internal *dma_info =
+		container_of(_dma_info, typeof(*dma_info), info);
+	struct scatterlist *sg;
+	size_t remaining = size;
+	size_t skip = offset;
 	int i;
 
-	for (i = 0; i < nr_pages; ++i)
-		dma_sync_single_for_cpu(allocator->dev,
-					dma_info->dma_addr[i],
-					PAGE_SIZE, DMA_FROM_DEVICE);
+	for_each_sg(dma_info->sgt.sgl, sg, dma_info->sgt.orig_nents, i) {
+		dma_addr_t addr;
+		size_t len;
+
+		if (!remaining)
+			break;
+
+		if (skip >= sg->length) {
+			skip -= sg->length;
+			continue;
+		}
+
+		addr = sg_dma_address(sg) + skip;
+		len = min_t(size_t, remaining, sg->length - skip);
+
+		if (for_device)
+			dma_sync_single_for_device(allocator->dev, addr, len,
+						   DMA_TO_DEVICE);
+		else
+			dma_sync_single_for_cpu(allocator->dev, addr, len,
+						DMA_FROM_DEVICE);
+
+		remaining -= len;
+		skip = 0;
+	}
+}
+
+static void iommu_sync_range_for_device(struct ethosn_dma_allocator *allocator,
+					struct ethosn_dma_info *_dma_info,
+					size_t offset,
+					size_t size)
+{
+	iommu_sync_sg_range(allocator, _dma_info, offset, size, true);
+}
+
+static void iommu_sync_range_for_cpu(struct ethosn_dma_allocator *allocator,
+				     struct ethosn_dma_info *_dma_info,
+				     size_t offset,
+				     size_t size)
+{
+	iommu_sync_sg_range(allocator, _dma_info, offset, size, false);
 }
 
 static int iommu_mmap(struct ethosn_dma_allocator *allocator,
@@ -481,12 +913,15 @@ static int iommu_mmap(struct ethosn_dma_allocator *allocator,
 	struct ethosn_dma_info_internal *dma_info =
 		container_of(_dma_info, typeof(*dma_info), info);
 	int nr_pages = DIV_ROUND_UP(_dma_info->size, PAGE_SIZE);
-	int i;
+	int i, n;
 
-	for (i = 0; i < nr_pages; ++i) {
+	for (i = 0; i < nr_pages; i += n) {
 		unsigned long addr = vma->vm_start + i * PAGE_SIZE;
 		unsigned long pfn = page_to_pfn(dma_info->pages[i]);
-		unsigned long size = PAGE_SIZE;
+		unsigned long size;
+
+		n = iommu_contiguous_pages(dma_info->pages, i, nr_pages);
+		size = n * PAGE_SIZE;
 
 		if (remap_pfn_range(vma, addr, pfn, size, vma->vm_page_prot))
 			return -EAGAIN;
@@ -495,27 +930,54 @@ static int iommu_mmap(struct ethosn_dma_allocator *allocator,
 	return 0;
 }
 
+static void iommu_stream_free_ranges(struct ethosn_iommu_stream *stream)
+{
+	struct ethosn_iova_range *range;
+	struct ethosn_iova_range *n;
+
+	rbtree_postorder_for_each_entry_safe(range, n, &stream->free_by_addr,
+					     addr_node)
+		kfree(range);
+
+	rbtree_postorder_for_each_entry_safe(range, n, &stream->allocated,
+					     addr_node)
+		kfree(range);
+
+	stream->free_by_addr = RB_ROOT;
+	stream->free_by_size = RB_ROOT;
+	stream->allocated = RB_ROOT;
+}
+
 static int iommu_stream_init(struct ethosn_allocator_internal *allocator,
-			     enum ethosn_stream_id stream_id,
-			     size_t bitmap_size)
+			     enum ethosn_stream_id stream_id)
 {
 	struct ethosn_iommu_domain *domain = &allocator->ethosn_iommu_domain;
 	struct ethosn_iommu_stream *stream =
 		iommu_get_stream(domain, stream_id);
 	int nr_pages = DIV_ROUND_UP(IOMMU_ADDR_SIZE, PAGE_SIZE);
+	struct ethosn_iova_range *range;
 	int i, k, err;
 
 	dev_dbg(allocator->allocator.dev,
 		"%s: stream_id %u\n", __func__, stream_id);
 
-	stream->bitmap =
-		devm_kzalloc(allocator->allocator.dev, bitmap_size, GFP_KERNEL);
-	if (!stream->bitmap)
+	/* The whole IOVA space is initially a single free range */
+	range = kzalloc(sizeof(*range), GFP_KERNEL);
+	if (!range)
 		return -ENOMEM;
 
+	range->start = 0;
+	range->size = nr_pages;
+
+	stream->free_by_addr = RB_ROOT;
+	stream->free_by_size = RB_ROOT;
+	stream->allocated = RB_ROOT;
+	iova_insert_free(stream, range);
+
 	stream->addr_base =
 		iommu_get_addr_base(&allocator->allocator, stream_id);
-	stream->bits = bitmap_size * BITS_PER_BYTE;
+	stream->nr_pages = nr_pages;
+	stream->nr_free_pages = nr_pages;
 	spin_lock_init(&stream->lock);
 
 	if ((stream_id == ETHOSN_STREAM_DMA) ||
@@ -525,7 +987,7 @@ static int iommu_stream_init(struct ethosn_allocator_internal *allocator,
 	stream->page = alloc_page(GFP_KERNEL);
 
 	if (!stream->page)
-		goto free_bitmap;
+		goto free_ranges;
 
 	/*
 	 * Map all the virtual space to a single physical page to be
@@ -555,8 +1017,8 @@ unmap_page:
 			    stream->addr_base + k * PAGE_SIZE, PAGE_SIZE);
 
 	__free_page(stream->page);
-free_bitmap:
-	devm_kfree(allocator->allocator.dev, stream->bitmap);
+free_ranges:
+	iommu_stream_free_ranges(stream);
 
 	return -ENOMEM;
 }
@@ -576,8 +1038,7 @@ static void iommu_stream_deinit(struct ethosn_allocator_internal *allocator,
 	if (!stream)
 		return;
 
-	devm_kfree(allocator->allocator.dev,
-		   stream->bitmap);
+	iommu_stream_free_ranges(stream);
 
 	if (!stream->page)
 		return;
@@ -604,32 +1065,92 @@ static void iommu_allocator_destroy(struct ethosn_dma_allocator *_allocator)
 	devm_kfree(_allocator->dev, allocator);
 }
 
+static void iommu_print_stats(struct ethosn_dma_allocator *_allocator,
+			      struct seq_file *s)
+{
+	static const char *const stream_names[] = {
+		[ETHOSN_STREAM_FIRMWARE]         = "firmware",
+		[ETHOSN_STREAM_WORKING_DATA]     = "working_data",
+		[ETHOSN_STREAM_COMMAND_STREAM]   = "command_stream",
+		[ETHOSN_STREAM_DMA]              = "dma",
+		[ETHOSN_STREAM_DMA_INTERMEDIATE] = "dma_intermediate",
+	};
+	struct ethosn_allocator_internal *allocator =
+		container_of(_allocator, typeof(*allocator), allocator);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(stream_names); ++i) {
+		struct ethosn_iommu_stream *stream =
+			iommu_get_stream(&allocator->ethosn_iommu_domain, i);
+		unsigned long nr_free_pages;
+		unsigned long nr_free_ranges;
+		unsigned long nr_allocs;
+		unsigned long nr_failed_allocs;
+		unsigned long largest_free = 0;
+		unsigned long fragmentation = 0;
+		unsigned long flags;
+		struct rb_node *node;
+
+		spin_lock_irqsave(&stream->lock, flags);
+
+		nr_free_pages = stream->nr_free_pages;
+		nr_free_ranges = stream->nr_free_ranges;
+		nr_allocs = stream->nr_allocs;
+		nr_failed_allocs = stream->nr_failed_allocs;
+		node = rb_last(&stream->free_by_size);
+		if (node)
+			largest_free = rb_entry(node, struct ethosn_iova_range,
+						size_node)->size;
+
+		spin_unlock_irqrestore(&stream->lock, flags);
+
+		/*
+		 * Share of the free space which is not in the largest free
+		 * range, i.e. which a single allocation can't use.
+		 */
+		if (nr_free_pages)
+			fragmentation = 100 - largest_free * 100 /
+					nr_free_pages;
+
+		seq_printf(s,
+			   "%s: size=%lu free=%lu largest_free=%lu fragmentation=%lu%% free_ranges=%lu allocations=%lu failed_allocations=%lu\n",
+			   stream_names[i], stream->nr_pages * PAGE_SIZE,
+			   nr_free_pages * PAGE_SIZE,
+			   largest_free * PAGE_SIZE, fragmentation,
+			   nr_free_ranges, nr_allocs, nr_failed_allocs);
+	}
+}
+
 struct ethosn_dma_allocator *ethosn_dma_iommu_allocator_create(
 	struct device *dev)
 {
 	static const struct ethosn_dma_allocator_ops ops = {
-		.destroy         = iommu_allocator_destroy,
-		.alloc           = iommu_alloc,
-		.free            = iommu_free,
-		.mmap            = iommu_mmap,
-		.map             = iommu_iova_map,
-		.unmap           = iommu_iova_unmap,
-		.sync_for_device = iommu_sync_for_device,
-		.sync_for_cpu    = iommu_sync_for_cpu,
-		.get_addr_base   = iommu_get_addr_base,
-		.get_addr_size   = iommu_get_addr_size
+		.destroy               = iommu_allocator_destroy,
+		.alloc                 = iommu_alloc,
+		.free                  = iommu_free,
+		.mmap                  = iommu_mmap,
+		.map                   = iommu_iova_map,
+		.unmap                 = iommu_iova_unmap,
+		.sync_for_device       = iommu_sync_for_device,
+		.sync_for_cpu          = iommu_sync_for_cpu,
+		.sync_range_for_device = iommu_sync_range_for_device,
+		.sync_range_for_cpu    = iommu_sync_range_for_cpu,
+		.get_addr_base         = iommu_get_addr_base,
+		.get_addr_size         = iommu_get_addr_size,
+		.print_stats           = iommu_print_stats
 	};
 	static const struct ethosn_dma_allocator_ops ops_no_iommu = {
-		.destroy         = iommu_allocator_destroy,
-		.alloc           = iommu_alloc,
-		.free            = iommu_free,
-		.mmap            = iommu_mmap,
-		.sync_for_device = iommu_sync_for_device,
-		.sync_for_cpu    = iommu_sync_for_cpu,
+		.destroy               = iommu_allocator_destroy,
+		.alloc                 = iommu_alloc,
+		.free                  = iommu_free,
+		.mmap                  = iommu_mmap,
+		.sync_for_device       = iommu_sync_for_device,
+		.sync_for_cpu          = iommu_sync_for_cpu,
+		.sync_range_for_device = iommu_sync_range_for_device,
+		.sync_range_for_cpu    = iommu_sync_range_for_cpu,
 	};
 	struct ethosn_allocator_internal *allocator;
 	struct iommu_domain *domain;
-	size_t bitmap_size;
 	int ret;
 
 	domain = iommu_get_domain_for_dev(dev);
@@ -644,32 +1165,25 @@ struct ethosn_dma_allocator *ethosn_dma_iommu_allocator_create(
 	allocator->ethosn_iommu_domain.iommu_domain = domain;
 
 	if (domain) {
-		bitmap_size = BITS_TO_LONGS(IOMMU_ADDR_SIZE >> PAGE_SHIFT) *
-			      sizeof(unsigned long);
-
-		ret = iommu_stream_init(allocator, ETHOSN_STREAM_FIRMWARE,
-					bitmap_size);
+		ret = iommu_stream_init(allocator, ETHOSN_STREAM_FIRMWARE);
 		if (ret)
 			goto err_stream_firmware;
 
-		ret = iommu_stream_init(allocator, ETHOSN_STREAM_WORKING_DATA,
-					bitmap_size);
+		ret = iommu_stream_init(allocator, ETHOSN_STREAM_WORKING_DATA);
 		if (ret)
 			goto err_stream_working_data;
 
-		ret = iommu_stream_init(allocator, ETHOSN_STREAM_COMMAND_STREAM,
-					bitmap_size);
+		ret = iommu_stream_init(allocator,
+					ETHOSN_STREAM_COMMAND_STREAM);
 		if (ret)
 			goto err_stream_command_stream;
 
-		ret = iommu_stream_init(allocator, ETHOSN_STREAM_DMA,
-					bitmap_size);
+		ret = iommu_stream_init(allocator, ETHOSN_STREAM_DMA);
 		if (ret)
 			goto err_stream_dma;
 
 		ret = iommu_stream_init(allocator,
-					ETHOSN_STREAM_DMA_INTERMEDIATE,
-					bitmap_size);
+					ETHOSN_STREAM_DMA_INTERMEDIATE);
 		if (ret)
 			goto err_stream_dma_intermediate;
 
@@ -23,6 +23,7 @@
 #include "scylla_addr_fields_public.h"
 #include "scylla_regs_public.h"
 #include "ethosn_buffer.h"
+#include "ethosn_completion_queue.h"
 #include "ethosn_device.h"
 #include "ethosn_firmware.h"
 #include "ethosn_log.h"
@@ -329,18 +330,15 @@ static void ethosn_irq_bottom(struct work_struct *work)
 
 		if (core->firmware_running) {
 			(void)ethosn_reset_and_start_ethosn(core);
-			ethosn_network_poll(core, core->current_inference,
-					    ETHOSN_INFERENCE_ERROR);
+			ethosn_network_abort_inflight(core,
+						      ETHOSN_INFERENCE_ERROR);
 		}
 	}
 
 end:
 
-	/* If no inference was scheduled on the core, set the status
-	 * as free.
-	 */
-	if (core->current_inference == NULL)
-		core->status = ETHOSN_CORE_FREE;
+	/* If the core can take another inference, set the status as free. */
+	ethosn_network_update_core_status(core);
 
 	mutex_unlock(&core->mutex);
 }
@@ -362,8 +360,9 @@ static irqreturn_t ethosn_irq_top(const int irq,
 
 	status.word = ethosn_read_top_reg(core, DL1_RP, DL1_IRQ_STATUS);
 
-	/* Save the IRQ status for the bottom half. */
+	/* Save the IRQ status and time for the bottom half. */
 	atomic_or(status.word, &core->irq_status);
+	atomic64_set(&core->irq_time_ns, ktime_get_ns());
 
 	/* Job bit is currently not correctly set by hardware. */
 	clear.bits.err = status.bits.setirq_err;
@@ -599,7 +598,20 @@ static ssize_t firmware_reset_store(struct device *dev,
 	struct ethosn_core *core = ethosn->core[0];
 	int ret;
 
+	ret = mutex_lock_interruptible(&core->mutex);
+	if (ret)
+		return ret;
+
 	ret = ethosn_reset_and_start_ethosn(core);
+
+	/* Resetting the core discards every inference posted to it, so they
+	 * all have to be completed with an error.
+	 */
+	ethosn_network_abort_inflight(core, ETHOSN_INFERENCE_ERROR);
+	ethosn_network_update_core_status(core);
+
+	mutex_unlock(&core->mutex);
+
 	if (ret != 0)
 		return ret;
 
@@ -682,6 +694,50 @@ static void print_buffer_info(struct ethosn_device *ethosn,
 	dev_dbg(ethosn->dev, "%s\n", buf);
 }
 
+/**
+ * get_counter_value() - Read a counter for ETHOSN_IOCTL_GET_COUNTER_VALUE
+ * @ethosn:		Ethos-N device.
+ * @counter_name:	enum ethosn_poll_counter_name, with the core in the
+ *			upper bits.
+ * @value:		Returns the value of the counter.
+ *
+ * Return: 0 on success, else error code.
+ */
+static int get_counter_value(struct ethosn_device *ethosn,
+			     u32 counter_name,
+			     u64 *value)
+{
+	u32 core_id = counter_name >> ETHOSN_POLL_COUNTER_CORE_SHIFT;
+	struct ethosn_core *core;
+	int ret;
+
+	if (core_id >= ethosn->num_cores) {
+		dev_err(ethosn->dev,
+			"Profiling counter: invalid core %u\n", core_id);
+
+		return -EINVAL;
+	}
+
+	core = ethosn->core[core_id];
+
+	ret = mutex_lock_interruptible(&core->mutex);
+	if (ret)
+		return ret;
+
+	ret = ethosn_network_read_counter(
+		core, counter_name & ETHOSN_POLL_COUNTER_NAME_MASK, value);
+
+	mutex_unlock(&core->mutex);
+
+	if (ret == -ENODATA)
+		dev_dbg(core->dev, "Profiling counter: no data\n");
+	else if (ret)
+		dev_err(core->dev,
+			"Profiling counter: invalid counter_name\n");
+
+	return ret;
+}
+
 /**
  * ethosn_ioctl() - Take commands from user space
  * @filep:	File struct.
@@ -732,10 +788,6 @@ static long ethosn_ioctl(struct file *const filep,
 			break;
 		}
 
-		ret = mutex_lock_interruptible(&ethosn->mutex);
-		if (ret)
-			break;
-
 		dev_dbg(ethosn->dev,
 			"IOCTL: Register network. num_dma=%u, num_cu=%u, num_inputs=%u, num_outputs=%u\n",
 			net_req.dma_buffers.num,
@@ -760,8 +812,6 @@ static long ethosn_ioctl(struct file *const filep,
 		dev_dbg(ethosn->dev,
 			"IOCTL: Registered network. fd=%d\n", ret);
 
-		mutex_unlock(&ethosn->mutex);
-
 		break;
 	}
 	case ETHOSN_IOCTL_FW_HW_CAPABILITIES: {
@@ -841,43 +891,46 @@ configure_profiling_end:
 		break;
 	}
 	case ETHOSN_IOCTL_GET_COUNTER_VALUE: {
-		struct ethosn_core *core = ethosn->core[0];
-		enum ethosn_poll_counter_name counter_name;
-
-		ret = mutex_lock_interruptible(&core->mutex);
-		if (ret)
-			break;
-
-		if (!core->profiling.config.enable_profiling) {
-			ret = -ENODATA;
-			dev_err(core->dev, "Profiling counter: no data\n");
-			goto get_counter_value_end;
-		}
+		u32 counter_name;
+		u64 value;
 
 		if (copy_from_user(&counter_name, udata,
 				   sizeof(counter_name))) {
 			ret = -EFAULT;
-			dev_err(core->dev,
+			dev_err(ethosn->dev,
 				"Profiling counter: error in copy_from_user\n");
-			goto get_counter_value_end;
+			break;
 		}
 
-		switch (counter_name) {
-		case ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_SENT:
-			ret = core->profiling.mailbox_messages_sent;
-			break;
-		case ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED:
-			ret = core->profiling.mailbox_messages_received;
+		ret = get_counter_value(ethosn, counter_name, &value);
+
+		/* Only for existing callers: the return value can't hold the
+		 * whole range of the counters.
+		 */
+		if (!ret)
+			ret = min_t(u64, value, INT_MAX);
+
+		break;
+	}
+	case ETHOSN_IOCTL_GET_COUNTER_VALUE_U64: {
+		struct ethosn_counter_value req;
+
+		if (copy_from_user(&req, udata, sizeof(req))) {
+			ret = -EFAULT;
 			break;
-		default:
+		}
+
+		if (req.reserved) {
 			ret = -EINVAL;
-			dev_err(core->dev,
-				"Profiling counter: invalid counter_name\n");
 			break;
 		}
 
-get_counter_value_end:
-		mutex_unlock(&core->mutex);
+		ret = get_counter_value(ethosn, req.counter_name, &req.value);
+		if (ret)
+			break;
+
+		if (copy_to_user(udata, &req, sizeof(req)))
+			ret = -EFAULT;
 
 		break;
 	}
@@ -897,6 +950,14 @@ get_counter_value_end:
 
 		break;
 	}
+	case ETHOSN_IOCTL_CREATE_COMPLETION_QUEUE: {
+		ret = ethosn_completion_queue_register(ethosn);
+
+		dev_dbg(ethosn->dev,
+			"IOCTL: Created completion queue. fd=%d\n", ret);
+
+		break;
+	}
 	case ETHOSN_IOCTL_PING: {
 		struct ethosn_core *core = ethosn->core[0];
 		uint32_t num_pongs_before = core->num_pongs_received;
@@ -1042,6 +1103,7 @@ static int ethosn_driver_probe(struct ethosn_core *core,
 	int ret;
 
 	mutex_init(&core->mutex);
+	INIT_LIST_HEAD(&core->inflight_inferences);
 
 	core->top_regs = ethosn_map_iomem(core, top_regs, TOP_REG_SIZE);
 	if (IS_ERR(core->top_regs))
@@ -1306,6 +1368,7 @@ static int ethosn_pdev_probe(struct platform_device *pdev)
 		goto err_free_ethosn;
 
 	INIT_LIST_HEAD(&ethosn->queue.inference_queue);
+	INIT_LIST_HEAD(&ethosn->constants);
 
 	/* Allocate space for num_of_npus ethosn cores */
 	ethosn->core = devm_kzalloc(&pdev->dev,
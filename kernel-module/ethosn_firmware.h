@@ -234,6 +234,77 @@ static inline bool ethosn_queue_write(struct ethosn_queue *queue,
 	return true;
 }
 
+/**
+ * struct ethosn_queue_segment - Contiguous block of bytes to be written to a
+ *                               queue by ethosn_queue_write_batch().
+ * @var data:		Pointer to the bytes to write.
+ * @var size:		Number of bytes to write.
+ */
+struct ethosn_queue_segment {
+	const uint8_t *data;
+	uint32_t      size;
+};
+
+/**
+ * Writes several buffers of bytes to the queue back to back, e.g. a number of
+ * message headers and their payloads.
+ * Unlike repeated calls to ethosn_queue_write(), the free space is checked
+ * once for the whole batch, against the pending write index, so either all
+ * of the segments are written or none are. The caller then publishes the
+ * whole batch with a single update of queue.write from write_pending.
+ * Returns false if there is not enough free space in the queue.
+ */
+static inline bool ethosn_queue_write_batch(
+	struct ethosn_queue *queue,
+	const struct ethosn_queue_segment *segments,
+	uint32_t num_segments,
+	uint32_t *write_pending)
+{
+	const uint32_t mask = queue->capacity - 1;
+	uint32_t write = *write_pending;
+	uint32_t pending = (write - queue->write) & mask;
+	uint32_t total = 0;
+	uint32_t i;
+	uint32_t j;
+
+	for (i = 0; i < num_segments; ++i) {
+		/* Guard against the sum wrapping around */
+		if (segments[i].size >= queue->capacity)
+			return false;
+
+		total += segments[i].size;
+		if (total >= queue->capacity)
+			return false;
+	}
+
+	/* Bytes already written but not yet committed are not free either */
+	if (ethosn_queue_get_free_space(queue) < pending + total)
+		return false;
+
+	for (i = 0; i < num_segments; ++i) {
+		const uint8_t *src = segments[i].data;
+		uint32_t size = segments[i].size;
+
+		/* Copy up to the end of the data array, then from its start */
+		uint32_t first = queue->capacity - write;
+
+		if (first > size)
+			first = size;
+
+		for (j = 0; j < first; ++j)
+			queue->data[write + j] = src[j];
+
+		for (j = first; j < size; ++j)
+			queue->data[j - first] = src[j];
+
+		write = (write + size) & mask;
+	}
+
+	*write_pending = write;
+
+	return true;
+}
+
 /**
  * struct ethosn_mailbox - Mailbox structure
  * @var request:	Pointer to message queue going from host to Ethos-N .
@@ -22,6 +22,7 @@
 
 #include "ethosn_log.h"
 
+#include "ethosn_network.h"
 #include "uapi/ethosn.h"
 
 #include <linux/debugfs.h>
@@ -323,7 +324,8 @@ int ethosn_log_firmware(struct ethosn_core *core,
 	header.timestamp.sec = timespec.tv_sec;
 	header.timestamp.nsec = timespec.tv_nsec;
 
-	firmware.inference = (ptrdiff_t)core->current_inference;
+	firmware.inference =
+		(ptrdiff_t)ethosn_network_current_inference(core);
 	firmware.direction = direction;
 
 	vec[0].iov_base = &header;
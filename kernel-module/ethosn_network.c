@@ -23,10 +23,12 @@
 #include "ethosn_network.h"
 
 #include "ethosn_buffer.h"
+#include "ethosn_completion_queue.h"
 #include "ethosn_device.h"
 #include "ethosn_dma.h"
 #include "ethosn_firmware.h"
 #include "ethosn_log.h"
+#include "ethosn_sched.h"
 #include "uapi/ethosn.h"
 
 #include <linux/anon_inodes.h>
@@ -34,13 +36,17 @@
 #include <linux/device.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/jhash.h>
 #include <linux/kref.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/uaccess.h>
 #include <linux/version.h>
+#include <linux/vmalloc.h>
 #include <linux/wait.h>
 
 #include <stdbool.h>
@@ -51,6 +57,28 @@
 
 #define MAX_PENDING ((int)-1)
 
+/* Constant data that networks registered with identical constants share.
+ * The data is only read by the device once it has been copied in, so a
+ * single mapping can be used by all of them. The list of shared constants
+ * is protected by the device mutex.
+ */
+struct ethosn_network_constants {
+	struct list_head       node;
+	struct kref            kref;
+	struct ethosn_device   *ethosn;
+	enum ethosn_stream_id  stream_id;
+	size_t                 size;
+	u32                    hash;
+	struct ethosn_dma_info *dma_info;
+};
+
+/* Kernel copy of the constant data of a network being registered */
+struct ethosn_constants_copy {
+	void   *data;
+	size_t size;
+	u32    hash;
+};
+
 struct ethosn_network {
 	/* This is the ethosn device on which the memory for constant_dma_data,
 	 * constant_cu_data, inference_data and intermediate_data was
@@ -58,8 +86,8 @@ struct ethosn_network {
 	 */
 	struct ethosn_device      *ethosn;
 
-	struct ethosn_dma_info    *constant_dma_data;
-	struct ethosn_dma_info    *constant_cu_data;
+	struct ethosn_network_constants *constant_dma_data;
+	struct ethosn_network_constants *constant_cu_data;
 	struct ethosn_dma_info    **inference_data;
 	struct ethosn_dma_info    **intermediate_data;
 
@@ -72,16 +100,62 @@ struct ethosn_network {
 	u32                       num_outputs;
 	struct ethosn_buffer_info *outputs;
 
+	/* Default scheduling parameters of the network's inferences, protected
+	 * by the device's inference queue mutex.
+	 */
+	struct ethosn_sched_params sched;
+
+	/* Core which last had an inference of the network posted, or -1 */
+	int                       last_core_id;
+
+	/* Completion queue the network's inferences are reported to, if any.
+	 * Protected by the device's inference queue mutex.
+	 */
+	struct ethosn_completion_queue *cq;
+
+	/* Per-stage latencies of the completed inferences */
+	spinlock_t                latency_lock;
+	struct ethosn_latency_stats latency;
+
 	/* file pointer used for ref-counting */
 	struct file               *file;
 };
 
 struct ethosn_inference {
+	/* Core the inference has been dequeued to. NULL while the inference
+	 * is waiting in the device queue. Set with the queue mutex held.
+	 */
 	struct ethosn_core    *core;
 	struct ethosn_network *network;
 
+	/* Node in the device queue while the inference is waiting for a core,
+	 * then in the core's in-flight list once it has been posted.
+	 */
 	struct list_head      queue_node;
 
+	/* Ordering in the device queue */
+	struct ethosn_sched_entry sched;
+
+	/* Record reserved in the completion queue to report to, if any, and
+	 * the user space file descriptor the inference is reported as.
+	 */
+	struct ethosn_completion_node *completion;
+	int                   fd;
+
+	/* Start time of each stage, see enum ethosn_latency_stage */
+	struct {
+		u64  submit_ns;
+		u64  queued_ns;
+		u64  dispatch_ns;
+		u64  bound_ns;
+		u64  posted_ns;
+		/* Interrupt which reported the completion, 0 if none */
+		u64  irq_ns;
+		u64  complete_ns;
+		/* The status has been read since completion */
+		bool read;
+	} times;
+
 	struct ethosn_buffer  **inputs;
 	struct ethosn_buffer  **outputs;
 
@@ -103,6 +177,68 @@ static struct device *ifr_to_dev(const struct ethosn_inference *const ifr)
 	return net_to_dev(ifr->network);
 }
 
+/**
+ * latency_add() - Account a stage duration in the network's statistics.
+ * @network:	Network of the inference.
+ * @stage:	Stage of the inference.
+ * @start_ns:	Start time of the stage.
+ * @end_ns:	End time of the stage.
+ *
+ * Must be called with the network's latency lock held.
+ */
+static void latency_add(struct ethosn_network *network,
+			enum ethosn_latency_stage stage,
+			u64 start_ns,
+			u64 end_ns)
+{
+	struct ethosn_stage_latency *lat = &network->latency.stages[stage];
+	u64 ns = end_ns > start_ns ? end_ns - start_ns : 0;
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	u32 bucket = us ? fls64(us) - 1 : 0;
+
+	if (bucket >= ETHOSN_LATENCY_NUM_BUCKETS)
+		bucket = ETHOSN_LATENCY_NUM_BUCKETS - 1;
+
+	++lat->count;
+	lat->total_ns += ns;
+	lat->max_ns = max(lat->max_ns, ns);
+	++lat->histogram[bucket];
+}
+
+/**
+ * latency_complete() - Account the stages of a completed inference.
+ * @inference:	Inference which has just completed.
+ */
+static void latency_complete(struct ethosn_inference *inference)
+{
+	struct ethosn_network *network = inference->network;
+	u64 irq_ns = inference->times.irq_ns;
+
+	/* Without an interrupt since posting, e.g. when the core was polled,
+	 * the whole time is accounted as execution.
+	 */
+	if (irq_ns < inference->times.posted_ns ||
+	    irq_ns > inference->times.complete_ns)
+		irq_ns = inference->times.complete_ns;
+
+	spin_lock(&network->latency_lock);
+	latency_add(network, ETHOSN_LATENCY_STAGE_SUBMIT,
+		    inference->times.submit_ns, inference->times.queued_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_QUEUE,
+		    inference->times.queued_ns, inference->times.dispatch_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_BIND,
+		    inference->times.dispatch_ns, inference->times.bound_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_POST,
+		    inference->times.bound_ns, inference->times.posted_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_EXECUTE,
+		    inference->times.posted_ns, irq_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_IRQ,
+		    irq_ns, inference->times.complete_ns);
+	latency_add(network, ETHOSN_LATENCY_STAGE_TOTAL,
+		    inference->times.submit_ns, inference->times.complete_ns);
+	spin_unlock(&network->latency_lock);
+}
+
 static struct ethosn_buffer_array *get_inference_header(
 	const struct ethosn_network *const network,
 	uint32_t core_id)
@@ -245,6 +381,9 @@ static void inference_kref_release(struct kref *kref)
 	dev_dbg(ifr_to_dev(inference),
 		"Released inference. handle=0x%pK\n", inference);
 
+	/* Not posted if the inference never completed */
+	ethosn_completion_queue_cancel(inference->completion);
+
 	put_network(network);
 
 	free_buffers(network->num_inputs, inference->inputs);
@@ -323,10 +462,110 @@ err_free_bufs:
 	return ERR_PTR(error);
 }
 
+static u32 core_inference_depth(const struct ethosn_core *core)
+{
+	return clamp_t(u32, core->inference_depth, 1,
+		       ETHOSN_MAX_INFERENCE_DEPTH);
+}
+
+static bool core_has_free_slot(const struct ethosn_core *core)
+{
+	return core->num_inflight_inferences < core_inference_depth(core);
+}
+
+static bool inference_is_inflight(struct ethosn_core *core,
+				  struct ethosn_inference *inference)
+{
+	struct ethosn_inference *ifr;
+
+	list_for_each_entry(ifr, &core->inflight_inferences, queue_node)
+		if (ifr == inference)
+			return true;
+
+	return false;
+}
+
+/*
+ * The inference header and the intermediate buffer are allocated per network
+ * and core, so a network can only have one inference in flight on each core.
+ */
+static bool network_is_inflight(struct ethosn_core *core,
+				struct ethosn_network *network)
+{
+	struct ethosn_inference *ifr;
+
+	list_for_each_entry(ifr, &core->inflight_inferences, queue_node)
+		if (ifr->network == network)
+			return true;
+
+	return false;
+}
+
+/**
+ * end_inference() - Set the final status of an inference and notify it.
+ * @core:	Core the inference was scheduled on.
+ * @inference:	Inference, which is no longer in flight.
+ * @status:	Final status.
+ *
+ * Wakes up the pollers of the inference and posts its completion record, if
+ * it has one. Must be called with the core mutex held.
+ */
+static void end_inference(struct ethosn_core *core,
+			  struct ethosn_inference *inference,
+			  int status)
+{
+	int i;
+
+	/* Stamped before the status is visible to inference_read() */
+	inference->times.complete_ns = ktime_get_ns();
+	inference->status = status;
+
+	if (status == ETHOSN_INFERENCE_COMPLETED)
+		latency_complete(inference);
+
+	for (i = 0; i < inference->network->num_outputs; ++i)
+		ethosn_buffer_device_done(inference->outputs[i], true);
+
+	wake_up_poll(&inference->poll_wqh, POLLIN);
+
+	if (inference->completion) {
+		struct ethosn_completion record = {
+			.inference_fd = inference->fd,
+			.status = status,
+		};
+
+		ethosn_completion_queue_post(inference->completion, &record);
+		inference->completion = NULL;
+	}
+}
+
+/**
+ * get_bindings_span() - Extend a span of binding ids to cover some buffers.
+ * @num_buffer_infos:	Number of buffers.
+ * @buffer_infos:	Buffers whose binding ids the span must cover.
+ * @first:		First binding id of the span.
+ * @end:		One past the last binding id of the span.
+ */
+static void get_bindings_span(u32 num_buffer_infos,
+			      const struct ethosn_buffer_info *buffer_infos,
+			      u32 *first,
+			      u32 *end)
+{
+	u32 i;
+
+	for (i = 0; i < num_buffer_infos; ++i) {
+		*first = min(*first, buffer_infos[i].id);
+		*end = max(*end, buffer_infos[i].id + 1);
+	}
+}
+
 /**
  * schedule_inference() - Send an inference to Ethos-N
  *
- * If an inference isn't already running, send it to Ethos-N for execution.
+ * Prepare the bindings of the inference and post it to the core's mailbox.
+ * The firmware picks it up as soon as any inference posted before it has
+ * completed. If that fails, the inference ends with an error without taking
+ * an in-flight slot of the core. Must be called with the core mutex held.
  * Return:
  * * 0 - OK
  * * Negative error code
@@ -337,6 +576,8 @@ static int schedule_inference(struct ethosn_inference *inference)
 	struct ethosn_core *core = inference->core;
 	uint32_t core_id = core->core_id;
 	struct device *dev = core->dev;
+	u32 first_binding = U32_MAX;
+	u32 end_binding = 0;
 	u32 i;
 	int ret;
 
@@ -344,14 +585,13 @@ static int schedule_inference(struct ethosn_inference *inference)
 		return 0;
 
 	inference->status = ETHOSN_INFERENCE_RUNNING;
+	inference->times.dispatch_ns = ktime_get_ns();
 
 	for (i = 0; i < network->num_inputs; ++i) {
 		struct ethosn_dma_info *dma_info =
 			inference->inputs[i]->dma_info;
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
 
-		ethosn_dma_sync_for_device(allocator, dma_info);
+		ethosn_buffer_sync_for_device(inference->inputs[i]);
 
 		ret = update_bindings(network,
 				      core_id,
@@ -368,10 +608,8 @@ static int schedule_inference(struct ethosn_inference *inference)
 	for (i = 0; i < network->num_outputs; ++i) {
 		struct ethosn_dma_info *dma_info =
 			inference->outputs[i]->dma_info;
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
 
-		ethosn_dma_sync_for_device(allocator, dma_info);
+		ethosn_buffer_sync_for_device(inference->outputs[i]);
 
 		ret = update_bindings(network,
 				      core_id,
@@ -385,8 +623,6 @@ static int schedule_inference(struct ethosn_inference *inference)
 			goto out_inference_error;
 	}
 
-	ethosn_dma_sync_for_device(core->allocator,
-				   network->intermediate_data[core_id]);
 	ret = update_bindings(network,
 			      core_id,
 			      network->num_intermediates,
@@ -399,33 +635,59 @@ static int schedule_inference(struct ethosn_inference *inference)
 			      true);
 
 	if (ret)
-		return ret;
+		goto out_inference_error;
 
 	if (ethosn_mailbox_empty(core->mailbox_request->cpu_addr) &&
 	    core->profiling.config.enable_profiling) {
 		/* Send sync message */
 		ret = ethosn_send_time_sync(core);
 		if (ret)
-			return ret;
+			goto out_inference_error;
 	}
 
+	/*
+	 * Only the bindings of the inputs, outputs and intermediates have been
+	 * patched, the rest of the inference data was synced when the network
+	 * was registered.
+	 */
+	get_bindings_span(network->num_inputs, network->inputs,
+			  &first_binding, &end_binding);
+	get_bindings_span(network->num_outputs, network->outputs,
+			  &first_binding, &end_binding);
+	get_bindings_span(network->num_intermediates, network->intermediates,
+			  &first_binding, &end_binding);
+
 	/* kick off execution */
 	dev_dbg(dev, "Starting execution of inference");
-	ethosn_dma_sync_for_device(core->allocator,
-				   network->inference_data[core_id]);
-	core->current_inference = inference;
+	if (first_binding < end_binding)
+		ethosn_dma_sync_range_for_device(
+			core->allocator, network->inference_data[core_id],
+			offsetof(struct ethosn_buffer_array, buffers) +
+			first_binding * sizeof(struct ethosn_buffer_desc),
+			(end_binding - first_binding) *
+			sizeof(struct ethosn_buffer_desc));
+	inference->times.bound_ns = ktime_get_ns();
 
 	/* send the inference to the core (ethosn) assigned to it */
 	ret = ethosn_send_inference(core,
 				    network->inference_data[core_id]->iova_addr,
 				    (ptrdiff_t)inference);
-	if (ret) {
-		core->current_inference = NULL;
+	if (ret)
+		goto out_inference_error;
 
-		return ret;
-	}
+	inference->times.posted_ns = ktime_get_ns();
+
+	if (READ_ONCE(network->last_core_id) == core_id)
+		++core->dispatch.affinity_hits;
+
+	WRITE_ONCE(network->last_core_id, core_id);
+
+	if (core->num_inflight_inferences == 0)
+		core->dispatch.busy_since_ns = ktime_get_ns();
 
 	get_inference(inference);
+	list_add_tail(&inference->queue_node, &core->inflight_inferences);
+	++core->num_inflight_inferences;
 	dev_dbg(dev, "Scheduled inference 0x%pK on core_id = %d\n", inference,
 		core->core_id);
 
@@ -434,69 +696,109 @@ static int schedule_inference(struct ethosn_inference *inference)
 out_inference_error:
 	dev_err(dev, "Error scheduling inference 0x%pK: %d on core_id = %d\n",
 		inference, ret, core->core_id);
-	inference->status = ETHOSN_INFERENCE_ERROR;
+	end_inference(core, inference, ETHOSN_INFERENCE_ERROR);
 
 	return ret;
 }
 
 /**
- * get_free_core() - Get the next free core.
+ * get_free_core() - Get the core to dispatch an inference to.
  * @ethosn:	ethosn_parent_device
+ * @network:	Network of the inference.
+ * @core_mask:	Cores the inference may run on, or 0 for any core.
  *
- * Iterates through the list of cores present in the parent device and returns
- * the first free core.
+ * Of the free cores in the mask, pick the one with the fewest inferences in
+ * flight, preferring the core which last ran the network. See
+ * ethosn_sched_core_before().
  *
  * Return: Pointer to ethosn_device (corresponding to the free core), else
  * NULL (if all the cores are busy)
  */
-static struct ethosn_core *get_free_core(struct ethosn_device *ethosn)
+static struct ethosn_core *get_free_core(struct ethosn_device *ethosn,
+					 struct ethosn_network *network,
+					 u32 core_mask)
 {
-	int i = 0, ret = 0;
-	bool found = false;
-	struct ethosn_core *core = NULL;
+	struct ethosn_sched_core best = { 0 };
+	struct ethosn_sched_core candidate;
+	struct ethosn_core *core;
+	int last_core_id = READ_ONCE(network->last_core_id);
+	int attempt, i, ret;
+	bool claimed;
+
+	/* A core can be claimed by someone else once its mutex has been
+	 * dropped, so start again if that happened to the picked one.
+	 */
+	for (attempt = 0; attempt < ethosn->num_cores; ++attempt) {
+		core = NULL;
 
-	while (i < ethosn->num_cores) {
-		/* Check the status of the core
-		 */
-		ret = mutex_lock_interruptible(&ethosn->core[i]->mutex);
+		for (i = 0; i < ethosn->num_cores; ++i) {
+			struct ethosn_core *cur = ethosn->core[i];
 
-		if (ret)
-			goto end;
+			if (!ethosn_sched_core_allowed(core_mask, i))
+				continue;
 
-		if (ethosn->core[i]->status == ETHOSN_CORE_FREE) {
-			core = ethosn->core[i];
-			core->status = ETHOSN_CORE_BUSY;
-			found = true;
+			ret = mutex_lock_interruptible(&cur->mutex);
+			if (ret)
+				return NULL;
+
+			candidate.core_id = i;
+			candidate.num_inflight = cur->num_inflight_inferences;
+			candidate.last_ran_network = i == last_core_id;
+
+			if (cur->status == ETHOSN_CORE_FREE &&
+			    core_has_free_slot(cur) &&
+			    (!core || ethosn_sched_core_before(&candidate,
+							       &best))) {
+				core = cur;
+				best = candidate;
+			}
+
+			mutex_unlock(&cur->mutex);
 		}
 
-		mutex_unlock(&ethosn->core[i]->mutex);
+		if (!core)
+			return NULL;
 
-		if (found)
-			break;
+		ret = mutex_lock_interruptible(&core->mutex);
+		if (ret)
+			return NULL;
 
-		i++;
-	}
+		claimed = core->status == ETHOSN_CORE_FREE &&
+			  core_has_free_slot(core);
+		if (claimed)
+			core->status = ETHOSN_CORE_BUSY;
 
-end:
+		mutex_unlock(&core->mutex);
+
+		if (claimed)
+			return core;
+	}
 
-	return core;
+	return NULL;
 }
 
 /**
- * schedule_queued_inference() - Schedule a queue inference.
+ * schedule_queued_inference() - Schedule queued inferences.
  * @core:	Ethos-N core.
  *
- * Pop the inference queue until either the queue is empty or an inference has
- * been successfully scheduled.
+ * Pop the inference queue until either the queue is empty or all the
+ * in-flight slots of the core are used. Inferences are picked by priority
+ * class and deadline, see ethosn_sched_before(). Inferences which are not
+ * allowed on the core, or whose network already has one in flight on the core,
+ * are left in the queue.
+ * Must be called with the core mutex held.
  */
 static void schedule_queued_inference(struct ethosn_core *core)
 {
-	struct ethosn_inference *inference = NULL;
+	struct ethosn_inference *inference;
+	struct ethosn_inference *ifr;
 	struct ethosn_device *ethosn = core->parent;
+	u64 aging_ns = ethosn_sched_aging_ns();
+	u64 now;
 	int ret = 0;
-	bool found = false;
 
-	if (!list_empty(&ethosn->queue.inference_queue)) {
+	while (core_has_free_slot(core) &&
+	       !list_empty(&ethosn->queue.inference_queue)) {
 		/* This will be invoked from the irq handlers of multiple npus.
 		 * The inference queue needs to be protected against concurrent
 		 * operation.
@@ -506,20 +808,25 @@ static void schedule_queued_inference(struct ethosn_core *core)
 		if (ret)
 			return;
 
-		found = false;
-
-		inference = list_first_entry(&ethosn->queue.inference_queue,
-					     typeof(*inference),
-					     queue_node);
-		if (inference == NULL) {
-			dev_dbg(ethosn->dev,
-				"Inference is NULL\n");
-			found = false;
-		} else {
-			found = true;
+		/* Pick the queued inference which goes first according to the
+		 * scheduling policy.
+		 */
+		now = ktime_get_ns();
+		inference = NULL;
+		list_for_each_entry(ifr, &ethosn->queue.inference_queue,
+				    queue_node) {
+			if (network_is_inflight(core, ifr->network) ||
+			    !ethosn_sched_core_allowed(ifr->sched.core_mask,
+						       core->core_id))
+				continue;
+
+			if (!inference ||
+			    ethosn_sched_before(&ifr->sched, &inference->sched,
+						now, aging_ns))
+				inference = ifr;
 		}
 
-		if (found) {
+		if (inference) {
 			/* Schedule the inference on a particular core */
 			inference->core = core;
 
@@ -528,8 +835,10 @@ static void schedule_queued_inference(struct ethosn_core *core)
 
 		mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
-		if (found)
-			(void)schedule_inference(inference);
+		if (!inference)
+			return;
+
+		(void)schedule_inference(inference);
 	}
 }
 
@@ -593,8 +902,8 @@ static int inference_release(struct inode *inode,
 			     struct file *filep)
 {
 	struct ethosn_inference *inference = filep->private_data;
-	struct ethosn_core *core = inference->core;
-	struct ethosn_device *ethosn = core->parent;
+	struct ethosn_device *ethosn = inference->network->ethosn;
+	struct ethosn_core *core;
 
 	/* The inference queue belongs to the parent device and should
 	 * be protected by the parent's mutex.
@@ -603,30 +912,29 @@ static int inference_release(struct inode *inode,
 	 * This would prevent the kernel module from being unloaded
 	 * when requested.
 	 */
-	if (inference->status == ETHOSN_INFERENCE_SCHEDULED) {
-		mutex_lock(
-			&ethosn->queue.inference_queue_mutex);
+	mutex_lock(&ethosn->queue.inference_queue_mutex);
+	core = inference->core;
+	if (!core)
 		list_del(&inference->queue_node);
-		mutex_unlock(
-			&ethosn->queue.inference_queue_mutex);
-	}
 
-	if (inference->status == ETHOSN_INFERENCE_RUNNING) {
-		dev_warn(core->dev,
-			 "Reset Ethos-N due to error inference abort. handle=0x%pK\n",
-			 inference);
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
+	if (core) {
 		mutex_lock(&core->mutex);
 
-		(void)ethosn_reset_and_start_ethosn(core);
-		ethosn_network_poll(core, inference,
-				    ETHOSN_INFERENCE_STATUS_ERROR);
-
-		/* If no inference was scheduled on the core, set the status
-		 * as free.
+		/* Resetting the core discards every inference posted to it, so
+		 * they all have to be completed with an error.
 		 */
-		if (core->current_inference == NULL)
-			core->status = ETHOSN_CORE_FREE;
+		if (inference_is_inflight(core, inference)) {
+			dev_warn(core->dev,
+				 "Reset Ethos-N due to error inference abort. handle=0x%pK\n",
+				 inference);
+
+			(void)ethosn_reset_and_start_ethosn(core);
+			ethosn_network_abort_inflight(core,
+						      ETHOSN_INFERENCE_ERROR);
+			ethosn_network_update_core_status(core);
+		}
 
 		mutex_unlock(&core->mutex);
 	}
@@ -668,6 +976,20 @@ static ssize_t inference_read(struct file *file,
 	if (count != sizeof(inference->status))
 		return -EINVAL;
 
+	if (inference->status == ETHOSN_INFERENCE_COMPLETED) {
+		struct ethosn_network *network = inference->network;
+
+		spin_lock(&network->latency_lock);
+		if (!inference->times.read) {
+			inference->times.read = true;
+			latency_add(network, ETHOSN_LATENCY_STAGE_WAKEUP,
+				    inference->times.complete_ns,
+				    ktime_get_ns());
+		}
+
+		spin_unlock(&network->latency_lock);
+	}
+
 	return put_user(inference->status,
 			(int32_t __user *)buf) ? -EFAULT :
 	       sizeof(inference->status);
@@ -675,11 +997,17 @@ static ssize_t inference_read(struct file *file,
 
 /**
  * ethosn_inference_register() - Create an inference job
+ * @network:	Inference network
+ * @req:	Inference description
+ * @sched:	Scheduling parameters of the inference
+ * @submit_ns:	Time the ioctl was entered
  *
  * Return: File descriptor on success, else error code.
  */
 static int ethosn_inference_register(struct ethosn_network *network,
-				     struct ethosn_inference_req *req)
+				     struct ethosn_inference_req *req,
+				     const struct ethosn_sched_params *sched,
+				     u64 submit_ns)
 {
 	static const struct file_operations inference_fops = {
 		.owner   = THIS_MODULE,
@@ -691,12 +1019,41 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	struct ethosn_core *core = ethosn->core[0];
 	struct ethosn_inference *inference;
 	struct ethosn_log_uapi_inference_req log;
+	u32 core_mask = sched->core_mask;
 	int ret_fd, ret;
 
 	inference = inference_create(network, req);
 	if (IS_ERR(inference))
 		return PTR_ERR(inference);
 
+	/* Reserve the completion record now, so that it can't be dropped
+	 * when the inference completes.
+	 */
+	ret = mutex_lock_interruptible(&ethosn->queue.inference_queue_mutex);
+	if (ret) {
+		put_inference(inference);
+
+		return ret;
+	}
+
+	if (network->cq) {
+		struct ethosn_completion_node *completion =
+			ethosn_completion_queue_reserve(network->cq);
+
+		if (IS_ERR(completion))
+			ret = PTR_ERR(completion);
+		else
+			inference->completion = completion;
+	}
+
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
+
+	if (ret) {
+		put_inference(inference);
+
+		return ret;
+	}
+
 	ret_fd = anon_inode_getfd("ethosn-inference",
 				  &inference_fops,
 				  inference,
@@ -718,7 +1075,7 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	ethosn_log_uapi(core, ETHOSN_IOCTL_SCHEDULE_INFERENCE, &log,
 			sizeof(log));
 
-	ret = mutex_lock_interruptible(&ethosn->mutex);
+	ret = mutex_lock_interruptible(&ethosn->queue.inference_queue_mutex);
 	if (ret) {
 		put_inference(inference);
 
@@ -726,12 +1083,19 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	}
 
 	/* Queue and schedule inference. */
+	inference->times.submit_ns = submit_ns;
+	inference->times.queued_ns = ktime_get_ns();
+	ethosn_sched_entry_init(&inference->sched, sched,
+				inference->times.queued_ns);
+	inference->fd = ret_fd;
 	list_add_tail(&inference->queue_node, &ethosn->queue.inference_queue);
 
-	mutex_unlock(&ethosn->mutex);
+	mutex_unlock(&ethosn->queue.inference_queue_mutex);
 
-	/* Get the next free core. */
-	core = get_free_core(ethosn);
+	/* Get the next free core. The inference must not be used from here on
+	 * as it may already have been scheduled and released.
+	 */
+	core = get_free_core(ethosn, network, core_mask);
 
 	if (!core) {
 		dev_dbg(ethosn->dev,
@@ -746,11 +1110,10 @@ static int ethosn_inference_register(struct ethosn_network *network,
 
 		schedule_queued_inference(core);
 
-		/* If no inference was scheduled on the core, set the status
-		 * as free.
+		/* If the core can take another inference, set the status as
+		 * free.
 		 */
-		if (core->current_inference == NULL)
-			core->status = ETHOSN_CORE_FREE;
+		ethosn_network_update_core_status(core);
 
 		mutex_unlock(&core->mutex);
 	}
@@ -758,6 +1121,20 @@ static int ethosn_inference_register(struct ethosn_network *network,
 	return ret_fd;
 }
 
+static int check_sched_params(struct ethosn_network *network,
+			      const struct ethosn_sched_params *sched)
+{
+	u32 all_cores = GENMASK(network->ethosn->num_cores - 1, 0);
+
+	if (sched->priority >= ETHOSN_PRIORITY_MAX)
+		return -EINVAL;
+
+	if (sched->core_mask && !(sched->core_mask & all_cores))
+		return -EINVAL;
+
+	return 0;
+}
+
 /**
  * network_ioctl() - Take network command from user space
  * @filep: File struct
@@ -782,24 +1159,123 @@ static long network_ioctl(struct file *filep,
 	switch (cmd) {
 	case ETHOSN_IOCTL_SCHEDULE_INFERENCE: {
 		struct ethosn_inference_req infer_req;
+		struct ethosn_sched_params sched;
 
 		if (copy_from_user(&infer_req, udata, sizeof(infer_req))) {
 			ret = -EFAULT;
 			break;
 		}
 
-		ret = ethosn_inference_register(network, &infer_req);
+		/* Don't see a concurrent ETHOSN_IOCTL_SET_SCHEDULING half way */
+		mutex_lock(&network->ethosn->queue.inference_queue_mutex);
+		sched = network->sched;
+		mutex_unlock(&network->ethosn->queue.inference_queue_mutex);
+
+		ret = ethosn_inference_register(network, &infer_req, &sched,
+						time);
 
 		dev_dbg(net_to_dev(network), "SCHEDULE_INFERENCE: %llu", time);
 
 		break;
 	}
+	case ETHOSN_IOCTL_SCHEDULE_INFERENCE_SCHED: {
+		struct ethosn_inference_sched_req sched_req;
+
+		if (copy_from_user(&sched_req, udata, sizeof(sched_req))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = check_sched_params(network, &sched_req.sched);
+		if (ret)
+			break;
+
+		ret = ethosn_inference_register(network, &sched_req.request,
+						&sched_req.sched, time);
+
+		dev_dbg(net_to_dev(network),
+			"SCHEDULE_INFERENCE_SCHED: %llu, priority=%u, deadline_us=%u",
+			time, sched_req.sched.priority,
+			sched_req.sched.deadline_us);
+
+		break;
+	}
+	case ETHOSN_IOCTL_SET_COMPLETION_QUEUE: {
+		struct ethosn_completion_queue *cq = NULL;
+		int cq_fd;
+
+		if (copy_from_user(&cq_fd, udata, sizeof(cq_fd))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		/* A negative file descriptor detaches the queue */
+		if (cq_fd >= 0) {
+			cq = ethosn_completion_queue_get(network->ethosn,
+							 cq_fd);
+			if (IS_ERR(cq)) {
+				ret = PTR_ERR(cq);
+				break;
+			}
+		}
+
+		mutex_lock(&network->ethosn->queue.inference_queue_mutex);
+		swap(network->cq, cq);
+		mutex_unlock(&network->ethosn->queue.inference_queue_mutex);
+
+		ethosn_completion_queue_put(cq);
+		ret = 0;
+
+		break;
+	}
+	case ETHOSN_IOCTL_GET_LATENCY_STATS: {
+		struct ethosn_latency_stats *stats;
+
+		stats = kmalloc(sizeof(*stats), GFP_KERNEL);
+		if (!stats) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		spin_lock(&network->latency_lock);
+		*stats = network->latency;
+		spin_unlock(&network->latency_lock);
+
+		ret = copy_to_user((void __user *)udata, stats,
+				   sizeof(*stats)) ? -EFAULT : 0;
+		kfree(stats);
+
+		break;
+	}
+	case ETHOSN_IOCTL_SET_SCHEDULING: {
+		struct ethosn_sched_params sched;
+
+		if (copy_from_user(&sched, udata, sizeof(sched))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		ret = check_sched_params(network, &sched);
+		if (ret)
+			break;
+
+		mutex_lock(&network->ethosn->queue.inference_queue_mutex);
+		network->sched = sched;
+		mutex_unlock(&network->ethosn->queue.inference_queue_mutex);
+
+		break;
+	}
 	case ETHOSN_IOCTL_GET_INTERMEDIATE_BUFFER: {
 		if (network->ethosn->num_cores > 1)
 			dev_warn(net_to_dev(
 					 network),
 				 "Intermediate buffer for multi-core system: core 0 will be returned.");
 
+		/* Intermediate data is not synced after inferences, as
+		 * only this debug view lets the CPU look at it.
+		 */
+		ethosn_dma_sync_for_cpu(network->ethosn->core[0]->allocator,
+					network->intermediate_data[0]);
 		ret = ethosn_get_dma_view_fd(network->ethosn,
 					     network->intermediate_data[0]);
 		break;
@@ -833,8 +1309,8 @@ static int init_bindings(struct ethosn_network *network,
 
 	if (copy_from_user(binfos, binfos_user, binfos_size)) {
 		dev_err(net_to_dev(network), "Error reading binfos\n");
-
-		return -EFAULT;
+		ret = -EFAULT;
+		goto out_free_binfos;
 	}
 
 	ret = update_bindings(network,
@@ -849,6 +1325,8 @@ static int init_bindings(struct ethosn_network *network,
 	if (ret || !binfos_save)
 		goto out_free_binfos;
 
+	/* The bindings are the same on every core, keep the last copy */
+	kfree(*binfos_save);
 	*binfos_save = binfos;
 
 	return ret;
@@ -870,6 +1348,7 @@ static int init_inference_data(struct ethosn_network *network,
 	struct ethosn_buffer_array *buffers =
 		get_inference_header(network, core_id);
 	struct ethosn_device *ethosn = network->ethosn;
+	struct ethosn_dma_info *cu_data;
 
 	buffers->num_buffers = num_bindings;
 
@@ -877,26 +1356,25 @@ static int init_inference_data(struct ethosn_network *network,
 		memset(&buffers->buffers[i], 0, sizeof(buffers->buffers[i]));
 
 	ethosn_dma_sync_for_device(ethosn->allocator,
-				   network->constant_dma_data);
+				   network->constant_dma_data->dma_info);
 	ret = init_bindings(network,
 			    core_id,
 			    net_req->dma_buffers.num,
 			    net_req->dma_buffers.info,
-			    network->constant_dma_data->iova_addr,
+			    network->constant_dma_data->dma_info->iova_addr,
 			    net_req->dma_data.size,
 			    true,
 			    NULL);
 	if (ret)
 		return ret;
 
-	ethosn_dma_sync_for_device(ethosn->allocator,
-				   network->constant_cu_data);
+	cu_data = network->constant_cu_data->dma_info;
+	ethosn_dma_sync_for_device(ethosn->allocator, cu_data);
 	ret = init_bindings(network,
 			    core_id,
 			    net_req->cu_buffers.num,
 			    net_req->cu_buffers.info,
-			    to_ethosn_addr(network->constant_cu_data->iova_addr,
-					   &core->dma_map),
+			    to_ethosn_addr(cu_data->iova_addr, &core->dma_map),
 			    net_req->cu_data.size,
 			    true,
 			    NULL);
@@ -1046,15 +1524,198 @@ static int alloc_init_inference_data(struct ethosn_network *network,
 		if (IS_ERR_OR_NULL(network->intermediate_data[i]))
 			return ret;
 
+		/* The CPU never touches the intermediate data, so this is the
+		 * only time it needs to be synced for the device.
+		 */
+		ethosn_dma_sync_for_device(core->allocator,
+					   network->intermediate_data[i]);
+
 		ret = init_inference_data(network, core, num_bindings, req, i);
 
 		if (ret)
 			return ret;
+
+		/* Each inference then only syncs the bindings it patches */
+		ethosn_dma_sync_for_device(core->allocator,
+					   network->inference_data[i]);
 	}
 
 	return ret;
 }
 
+/**
+ * copy_constants() - Copy constant data from user memory and hash it
+ * @req:	Constant data in user memory
+ * @copy:	Returns the copy, to be freed with vfree()
+ *
+ * Called without the device mutex, so that large constant data doesn't hold
+ * up the other users of the device while it is copied.
+ *
+ * Return: 0 on success, else error code.
+ */
+static int copy_constants(const struct ethosn_constant_data *req,
+			  struct ethosn_constants_copy *copy)
+{
+	*copy = (struct ethosn_constants_copy) {
+		.size = req->size,
+	};
+
+	if (!copy->size)
+		return 0;
+
+	copy->data = vmalloc(copy->size);
+	if (!copy->data)
+		return -ENOMEM;
+
+	if (copy_from_user(copy->data, req->data, copy->size)) {
+		vfree(copy->data);
+		copy->data = NULL;
+
+		return -EFAULT;
+	}
+
+	copy->hash = jhash(copy->data, copy->size, 0);
+
+	return 0;
+}
+
+/**
+ * get_constants() - Get the constant data of a network
+ * @ethosn:	Ethos-N device
+ * @copy:	Kernel copy of the constant data
+ * @stream_id:	Stream the data is mapped to on the cores
+ *
+ * Takes a reference to the constant data of an already registered network if
+ * it is identical, otherwise allocates it, maps it on all the cores and copies
+ * it in. Must be called with the device mutex held.
+ *
+ * Return: Constant data on success, else error pointer.
+ */
+static struct ethosn_network_constants *get_constants(
+	struct ethosn_device *ethosn,
+	const struct ethosn_constants_copy *copy,
+	enum ethosn_stream_id stream_id)
+{
+	struct ethosn_network_constants *constants;
+	int ret;
+	int i;
+
+	lockdep_assert_held(&ethosn->mutex);
+
+	/* The hash only narrows down the candidates: the data is compared
+	 * in full before it is shared.
+	 */
+	list_for_each_entry(constants, &ethosn->constants, node) {
+		if (constants->stream_id != stream_id ||
+		    constants->size != copy->size ||
+		    constants->hash != copy->hash)
+			continue;
+
+		if (copy->size &&
+		    memcmp(constants->dma_info->cpu_addr, copy->data,
+			   copy->size))
+			continue;
+
+		kref_get(&constants->kref);
+		ethosn->constants_bytes_saved += constants->size;
+
+		dev_dbg(ethosn->dev,
+			"Sharing constant data. handle=0x%pK, size=%zu\n",
+			constants, constants->size);
+
+		return constants;
+	}
+
+	constants = kzalloc(sizeof(*constants), GFP_KERNEL);
+	if (!constants)
+		return ERR_PTR(-ENOMEM);
+
+	kref_init(&constants->kref);
+	constants->ethosn = ethosn;
+	constants->stream_id = stream_id;
+	constants->size = copy->size;
+	constants->hash = copy->hash;
+
+	constants->dma_info = ethosn_dma_alloc(ethosn->allocator, copy->size,
+					       GFP_KERNEL);
+	if (IS_ERR_OR_NULL(constants->dma_info)) {
+		ret = -ENOMEM;
+		goto err_free_constants;
+	}
+
+	for (i = 0; i < ethosn->num_cores; ++i) {
+		ret = ethosn_dma_map(ethosn->core[i]->allocator,
+				     constants->dma_info,
+				     ETHOSN_PROT_READ,
+				     stream_id);
+		if (ret)
+			goto err_unmap;
+	}
+
+	if (copy->size)
+		memcpy(constants->dma_info->cpu_addr, copy->data, copy->size);
+
+	list_add(&constants->node, &ethosn->constants);
+	ethosn->constants_bytes += constants->size;
+
+	return constants;
+
+err_unmap:
+	while (i--)
+		ethosn_dma_unmap(ethosn->core[i]->allocator,
+				 constants->dma_info,
+				 stream_id);
+
+	ethosn_dma_free(ethosn->allocator, constants->dma_info);
+err_free_constants:
+	kfree(constants);
+
+	return ERR_PTR(ret);
+}
+
+static void release_constants(struct kref *kref)
+{
+	struct ethosn_network_constants *constants =
+		container_of(kref, struct ethosn_network_constants, kref);
+	struct ethosn_device *ethosn = constants->ethosn;
+	int i;
+
+	list_del(&constants->node);
+	ethosn->constants_bytes -= constants->size;
+
+	for (i = 0; i < ethosn->num_cores; i++)
+		ethosn_dma_unmap(ethosn->core[i]->allocator,
+				 constants->dma_info,
+				 constants->stream_id);
+
+	ethosn_dma_free(ethosn->allocator, constants->dma_info);
+
+	kfree(constants);
+}
+
+/**
+ * put_constants() - Release a reference to the constant data of a network
+ * @constants:	Constant data, or NULL
+ *
+ * Must be called with the device mutex held.
+ */
+static void put_constants(struct ethosn_network_constants *constants)
+{
+	struct ethosn_device *ethosn;
+	size_t size;
+
+	if (!constants)
+		return;
+
+	ethosn = constants->ethosn;
+	size = constants->size;
+
+	lockdep_assert_held(&ethosn->mutex);
+
+	if (!kref_put(&constants->kref, release_constants))
+		ethosn->constants_bytes_saved -= size;
+}
+
 static void free_network(struct ethosn_network *network)
 {
 	int i = 0;
@@ -1077,14 +1738,6 @@ static void free_network(struct ethosn_network *network)
 	for (i = 0; i < ethosn->num_cores; i++) {
 		struct ethosn_core *core = ethosn->core[i];
 
-		/* Unmap virtual addresses from core */
-		ethosn_dma_unmap(core->allocator,
-				 network->constant_dma_data,
-				 ETHOSN_STREAM_DMA);
-		ethosn_dma_unmap(core->allocator,
-				 network->constant_cu_data,
-				 ETHOSN_STREAM_COMMAND_STREAM);
-
 		/* Free allocated dma from core */
 		ethosn_dma_unmap_and_free(core->allocator,
 					  network->intermediate_data[i],
@@ -1094,9 +1747,9 @@ static void free_network(struct ethosn_network *network)
 					  ETHOSN_STREAM_COMMAND_STREAM);
 	}
 
-	/* Free allocated dma from top level device */
-	ethosn_dma_free(ethosn->allocator, network->constant_dma_data);
-	ethosn_dma_free(ethosn->allocator, network->constant_cu_data);
+	/* The constant data may be shared with other networks */
+	put_constants(network->constant_dma_data);
+	put_constants(network->constant_cu_data);
 
 	kfree(network->intermediate_data);
 	kfree(network->inference_data);
@@ -1104,6 +1757,8 @@ static void free_network(struct ethosn_network *network)
 	kfree(network->inputs);
 	kfree(network->outputs);
 
+	ethosn_completion_queue_put(network->cq);
+
 	put_device(net_to_dev(network));
 
 	kfree(network);
@@ -1113,11 +1768,16 @@ static void free_network(struct ethosn_network *network)
  * create_network() - Create a new network
  * @ethosn:     Ethos-N device
  * @net_rq:     Network description
+ * @dma_data:   Kernel copy of the constant DMA data
+ * @cu_data:    Kernel copy of the constant command stream data
  *
  * Return: Network pointer on success, else error code.
  */
-static struct ethosn_network *create_network(struct ethosn_device *ethosn,
-					     struct ethosn_network_req *net_req)
+static struct ethosn_network *create_network(
+	struct ethosn_device *ethosn,
+	struct ethosn_network_req *net_req,
+	const struct ethosn_constants_copy *dma_data,
+	const struct ethosn_constants_copy *cu_data)
 {
 	/* Note:- We register network on ethosn.
 	 * For carveout :- We allocate constant data. inference data
@@ -1129,15 +1789,18 @@ static struct ethosn_network *create_network(struct ethosn_device *ethosn,
 	 *             it should be remapped to both the cores.
 	 *             The remapping part is yet to be done.
 	 */
+	struct ethosn_network_constants *constants;
 	struct ethosn_network *network;
 	int ret = -ENOMEM;
-	int i;
 
 	network = kzalloc(sizeof(*network), GFP_KERNEL);
 	if (!network)
 		return ERR_PTR(-ENOMEM);
 
 	network->ethosn = ethosn;
+	network->sched.priority = ETHOSN_PRIORITY_MEDIUM;
+	network->last_core_id = -1;
+	spin_lock_init(&network->latency_lock);
 
 	/* Increment ref-count on device. Not sure why this is necessary,
 	 * but it needs to be before any potential failures so that when we
@@ -1146,54 +1809,27 @@ static struct ethosn_network *create_network(struct ethosn_device *ethosn,
 	 */
 	get_device(ethosn->dev);
 
-	network->constant_dma_data = ethosn_dma_alloc(ethosn->allocator,
-						      net_req->dma_data.size,
-						      GFP_KERNEL);
-
-	if (IS_ERR_OR_NULL(network->constant_dma_data))
-		goto err_free_network;
-
-	for (i = 0; i < ethosn->num_cores; ++i) {
-		ret = ethosn_dma_map(ethosn->core[i]->allocator,
-				     network->constant_dma_data,
-				     ETHOSN_PROT_READ,
-				     ETHOSN_STREAM_DMA);
-		if (ret)
-			goto err_free_network;
-	}
-
-	if (copy_from_user(network->constant_dma_data->cpu_addr,
-			   net_req->dma_data.data,
-			   net_req->dma_data.size)) {
+	constants = get_constants(ethosn, dma_data, ETHOSN_STREAM_DMA);
+	if (IS_ERR(constants)) {
 		dev_err(ethosn->dev,
-			"Error reading constant dma data\n");
+			"Error allocating constant dma data\n");
+		ret = PTR_ERR(constants);
 		goto err_free_network;
 	}
 
-	network->constant_cu_data =
-		ethosn_dma_alloc(ethosn->allocator,
-				 net_req->cu_data.size,
-				 GFP_KERNEL);
-	if (IS_ERR_OR_NULL(network->constant_cu_data))
-		goto err_free_network;
+	network->constant_dma_data = constants;
 
-	for (i = 0; i < ethosn->num_cores; ++i) {
-		ret = ethosn_dma_map(ethosn->core[i]->allocator,
-				     network->constant_cu_data,
-				     ETHOSN_PROT_READ,
-				     ETHOSN_STREAM_COMMAND_STREAM);
-		if (ret)
-			goto err_free_network;
-	}
-
-	if (copy_from_user(network->constant_cu_data->cpu_addr,
-			   net_req->cu_data.data,
-			   net_req->cu_data.size)) {
+	constants = get_constants(ethosn, cu_data,
+				  ETHOSN_STREAM_COMMAND_STREAM);
+	if (IS_ERR(constants)) {
 		dev_err(ethosn->dev,
-			"Error reading constant cu data\n");
+			"Error allocating constant cu data\n");
+		ret = PTR_ERR(constants);
 		goto err_free_network;
 	}
 
+	network->constant_cu_data = constants;
+
 	ret = alloc_init_inference_data(network, net_req);
 	if (ret)
 		goto err_free_network;
@@ -1227,14 +1863,20 @@ static int network_release(struct inode *inode,
 }
 
 /**
- * ethosn_network_register() - Create a network
+ * register_network() - Create a network and its file descriptor
  * @ethosn:	Ethos-N device
  * @net_req:	Network description
+ * @dma_data:	Kernel copy of the constant DMA data
+ * @cu_data:	Kernel copy of the constant command stream data
+ *
+ * Must be called with the device mutex held.
  *
  * Return: FD on success, else error code
  */
-int ethosn_network_register(struct ethosn_device *ethosn,
-			    struct ethosn_network_req *net_req)
+static int register_network(struct ethosn_device *ethosn,
+			    struct ethosn_network_req *net_req,
+			    const struct ethosn_constants_copy *dma_data,
+			    const struct ethosn_constants_copy *cu_data)
 {
 	static const struct file_operations network_fops = {
 		.owner          = THIS_MODULE,
@@ -1249,7 +1891,7 @@ int ethosn_network_register(struct ethosn_device *ethosn,
 	struct ethosn_log_uapi_network_req log;
 	int fd;
 
-	network = create_network(ethosn, net_req);
+	network = create_network(ethosn, net_req, dma_data, cu_data);
 	if (IS_ERR(network))
 		return PTR_ERR(network);
 
@@ -1282,33 +1924,160 @@ int ethosn_network_register(struct ethosn_device *ethosn,
 	return fd;
 }
 
+/**
+ * ethosn_network_register() - Create a network
+ * @ethosn:	Ethos-N device
+ * @net_req:	Network description
+ *
+ * The constant data is copied in before the device mutex is taken.
+ *
+ * Return: FD on success, else error code
+ */
+int ethosn_network_register(struct ethosn_device *ethosn,
+			    struct ethosn_network_req *net_req)
+{
+	struct ethosn_constants_copy dma_data;
+	struct ethosn_constants_copy cu_data;
+	int ret;
+
+	ret = copy_constants(&net_req->dma_data, &dma_data);
+	if (ret) {
+		dev_err(ethosn->dev, "Error reading constant dma data\n");
+
+		return ret;
+	}
+
+	ret = copy_constants(&net_req->cu_data, &cu_data);
+	if (ret) {
+		dev_err(ethosn->dev, "Error reading constant cu data\n");
+		goto free_dma_data;
+	}
+
+	ret = mutex_lock_interruptible(&ethosn->mutex);
+	if (ret)
+		goto free_cu_data;
+
+	ret = register_network(ethosn, net_req, &dma_data, &cu_data);
+
+	mutex_unlock(&ethosn->mutex);
+
+free_cu_data:
+	vfree(cu_data.data);
+free_dma_data:
+	vfree(dma_data.data);
+
+	return ret;
+}
+
+static void complete_inference(struct ethosn_core *core,
+			       struct ethosn_inference *inference,
+			       int status)
+{
+	list_del(&inference->queue_node);
+	--core->num_inflight_inferences;
+
+	if (status == ETHOSN_INFERENCE_COMPLETED)
+		++core->dispatch.inferences_completed;
+
+	if (core->num_inflight_inferences == 0)
+		core->dispatch.busy_time_ns +=
+			ktime_get_ns() - core->dispatch.busy_since_ns;
+
+	end_inference(core, inference, status);
+
+	put_inference(inference);
+
+	dev_dbg(core->dev,
+		"END_INFERENCE: %llu on core_id = %d",
+		ktime_get_ns(), core->core_id);
+}
+
 void ethosn_network_poll(struct ethosn_core *core,
 			 struct ethosn_inference *inference,
 			 int status)
 {
 	if (inference) {
-		struct ethosn_dma_allocator *allocator =
-			core->parent->allocator;
-		int i;
+		if (inference_is_inflight(core, inference)) {
+			/* The last interrupt is the one which delivered the
+			 * completion message being processed.
+			 */
+			inference->times.irq_ns =
+				atomic64_read(&core->irq_time_ns);
+			complete_inference(core, inference, status);
+		} else
+			dev_err(core->dev,
+				"Response for unknown inference 0x%pK on core_id = %d\n",
+				inference, core->core_id);
+	}
 
-		inference->status = status;
+	/* Refill the in-flight slots from the queue. */
+	schedule_queued_inference(core);
+}
 
-		for (i = 0; i < inference->network->num_outputs; ++i)
-			ethosn_dma_sync_for_cpu(
-				allocator,
-				inference->outputs[i]->dma_info);
+void ethosn_network_abort_inflight(struct ethosn_core *core,
+				   int status)
+{
+	struct ethosn_inference *inference;
+	struct ethosn_inference *tmp;
 
-		wake_up_poll(&inference->poll_wqh, POLLIN);
-		put_inference(inference);
+	list_for_each_entry_safe(inference, tmp, &core->inflight_inferences,
+				 queue_node)
+		complete_inference(core, inference, status);
 
-		dev_dbg(core->dev,
-			"END_INFERENCE: %llu on core_id = %d",
-			ktime_get_ns(), core->core_id);
-	}
+	schedule_queued_inference(core);
+}
 
-	/* Reset current running inference. */
-	core->current_inference = NULL;
+void ethosn_network_update_core_status(struct ethosn_core *core)
+{
+	if (core_has_free_slot(core))
+		core->status = ETHOSN_CORE_FREE;
+}
 
-	/* Schedule next queued inference. */
-	schedule_queued_inference(core);
+struct ethosn_inference *ethosn_network_current_inference(
+	struct ethosn_core *core)
+{
+	return list_first_entry_or_null(&core->inflight_inferences,
+					struct ethosn_inference, queue_node);
+}
+
+int ethosn_network_read_counter(struct ethosn_core *core,
+				u32 counter_name,
+				u64 *value)
+{
+	struct ethosn_core *core0 = core->parent->core[0];
+	bool profiling = core0->profiling.config.enable_profiling;
+	u64 busy_time_ns;
+
+	switch (counter_name) {
+	case ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_SENT:
+		if (!profiling)
+			return -ENODATA;
+
+		*value = core->profiling.mailbox_messages_sent;
+		break;
+	case ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED:
+		if (!profiling)
+			return -ENODATA;
+
+		*value = core->profiling.mailbox_messages_received;
+		break;
+	case ETHOSN_POLL_COUNTER_NAME_INFERENCES_COMPLETED:
+		*value = core->dispatch.inferences_completed;
+		break;
+	case ETHOSN_POLL_COUNTER_NAME_BUSY_TIME_MS:
+		busy_time_ns = core->dispatch.busy_time_ns;
+		if (core->num_inflight_inferences)
+			busy_time_ns += ktime_get_ns() -
+					core->dispatch.busy_since_ns;
+
+		*value = div_u64(busy_time_ns, NSEC_PER_MSEC);
+		break;
+	case ETHOSN_POLL_COUNTER_NAME_AFFINITY_HITS:
+		*value = core->dispatch.affinity_hits;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
 }
@@ -38,4 +38,51 @@ void ethosn_network_poll(struct ethosn_core *core,
 			 struct ethosn_inference *inference,
 			 int status);
 
+/**
+ * ethosn_network_abort_inflight() - Complete every in-flight inference
+ * @core:	Ethos-N core which has been reset.
+ * @status:	Status reported for the aborted inferences.
+ *
+ * Must be called with the core mutex held after the firmware has been reset,
+ * as the reset discards everything that was posted to the mailbox.
+ */
+void ethosn_network_abort_inflight(struct ethosn_core *core,
+				   int status);
+
+/**
+ * ethosn_network_update_core_status() - Mark the core free if it has room
+ * @core:	Ethos-N core.
+ *
+ * Must be called with the core mutex held.
+ */
+void ethosn_network_update_core_status(struct ethosn_core *core);
+
+/**
+ * ethosn_network_current_inference() - Get the inference the core is running
+ * @core:	Ethos-N core.
+ *
+ * Return: Oldest in-flight inference, or NULL if the core is idle.
+ */
+struct ethosn_inference *ethosn_network_current_inference(
+	struct ethosn_core *core);
+
+/**
+ * ethosn_network_read_counter() - Read a counter of a core
+ * @core:		Ethos-N core.
+ * @counter_name:	enum ethosn_poll_counter_name, without the core.
+ * @value:		Returns the value of the counter.
+ *
+ * The dispatch counters are always kept. The mailbox counters are only kept
+ * while profiling is enabled, which is configured through core 0.
+ * Must be called with the core mutex held.
+ *
+ * Return:
+ * * 0 - OK
+ * * -ENODATA - The counter is only kept while profiling
+ * * -EINVAL - Unknown counter
+ */
+int ethosn_network_read_counter(struct ethosn_core *core,
+				u32 counter_name,
+				u64 *value);
+
 #endif /* _ETHOSN_NETWORK_H_ */
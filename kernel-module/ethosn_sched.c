@@ -0,0 +1,101 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+
+#include "ethosn_sched.h"
+
+#include "uapi/ethosn.h"
+
+#include <linux/kernel.h>
+#include <linux/math64.h>
+
+void ethosn_sched_entry_init(struct ethosn_sched_entry *entry,
+			     const struct ethosn_sched_params *params,
+			     u64 now_ns)
+{
+	entry->priority = min_t(u32, params->priority,
+				ETHOSN_PRIORITY_MAX - 1);
+	entry->enqueue_ns = now_ns;
+	entry->deadline_ns = params->deadline_us ?
+			     now_ns + (u64)params->deadline_us * NSEC_PER_USEC :
+			     0;
+	entry->core_mask = params->core_mask;
+}
+
+u32 ethosn_sched_effective_priority(const struct ethosn_sched_entry *entry,
+				    u64 now_ns,
+				    u64 aging_ns)
+{
+	u64 waited;
+	u64 promotion;
+
+	if (!aging_ns || now_ns <= entry->enqueue_ns)
+		return entry->priority;
+
+	waited = now_ns - entry->enqueue_ns;
+	promotion = div64_u64(waited, aging_ns);
+
+	return (u32)min_t(u64, entry->priority + promotion,
+			  ETHOSN_PRIORITY_MAX - 1);
+}
+
+bool ethosn_sched_before(const struct ethosn_sched_entry *a,
+			 const struct ethosn_sched_entry *b,
+			 u64 now_ns,
+			 u64 aging_ns)
+{
+	u32 prio_a = ethosn_sched_effective_priority(a, now_ns, aging_ns);
+	u32 prio_b = ethosn_sched_effective_priority(b, now_ns, aging_ns);
+
+	if (prio_a != prio_b)
+		return prio_a > prio_b;
+
+	if (a->deadline_ns != b->deadline_ns) {
+		if (!a->deadline_ns || !b->deadline_ns)
+			return a->deadline_ns != 0;
+
+		return a->deadline_ns < b->deadline_ns;
+	}
+
+	return a->enqueue_ns < b->enqueue_ns;
+}
+
+bool ethosn_sched_core_allowed(u32 core_mask,
+			       u32 core_id)
+{
+	if (!core_mask)
+		return true;
+
+	return core_id < 32 && (core_mask & (1U << core_id));
+}
+
+bool ethosn_sched_core_before(const struct ethosn_sched_core *a,
+			      const struct ethosn_sched_core *b)
+{
+	if (a->num_inflight != b->num_inflight)
+		return a->num_inflight < b->num_inflight;
+
+	if (a->last_ran_network != b->last_ran_network)
+		return a->last_ran_network;
+
+	return a->core_id < b->core_id;
+}
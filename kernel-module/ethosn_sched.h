@@ -0,0 +1,135 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+
+#ifndef _ETHOSN_SCHED_H_
+#define _ETHOSN_SCHED_H_
+
+#include <linux/types.h>
+
+struct ethosn_sched_params;
+
+/*
+ * Scheduling policy for queued inferences and for dispatching them to cores.
+ *
+ * This only depends on the values passed in, so that it can be exercised
+ * outside of the kernel. tests/host/test_sched.c tests it and simulates the
+ * latencies it gives to each priority class.
+ */
+
+/**
+ * struct ethosn_sched_entry - Scheduling state of a queued inference.
+ * @priority:		Priority class, see enum ethosn_priority.
+ * @enqueue_ns:		Time the inference was queued.
+ * @deadline_ns:	Absolute deadline, or 0 if the inference has none.
+ * @core_mask:		Cores the inference may run on, or 0 for any core.
+ */
+struct ethosn_sched_entry {
+	u32 priority;
+	u64 enqueue_ns;
+	u64 deadline_ns;
+	u32 core_mask;
+};
+
+/**
+ * struct ethosn_sched_core - Dispatch state of a core.
+ * @core_id:		Core index.
+ * @num_inflight:	Number of inferences in flight on the core.
+ * @last_ran_network:	Whether the core is the last one which ran the
+ *			network being dispatched.
+ */
+struct ethosn_sched_core {
+	u32  core_id;
+	u32  num_inflight;
+	bool last_ran_network;
+};
+
+/**
+ * ethosn_sched_entry_init() - Initialize the scheduling state of an inference
+ * @entry:	Entry to initialize.
+ * @params:	Scheduling parameters of the inference.
+ * @now_ns:	Current time.
+ */
+void ethosn_sched_entry_init(struct ethosn_sched_entry *entry,
+			     const struct ethosn_sched_params *params,
+			     u64 now_ns);
+
+/**
+ * ethosn_sched_effective_priority() - Priority class after aging
+ * @entry:	Queued inference.
+ * @now_ns:	Current time.
+ * @aging_ns:	Waiting time after which an inference is promoted by one
+ *		priority class, or 0 to disable aging.
+ *
+ * Aging bounds how long a low priority inference can be starved by a stream
+ * of higher priority ones.
+ *
+ * Return: Priority class used to order the inference.
+ */
+u32 ethosn_sched_effective_priority(const struct ethosn_sched_entry *entry,
+				    u64 now_ns,
+				    u64 aging_ns);
+
+/**
+ * ethosn_sched_before() - Compare two queued inferences
+ * @a:		First inference.
+ * @b:		Second inference.
+ * @now_ns:	Current time.
+ * @aging_ns:	See ethosn_sched_effective_priority().
+ *
+ * Inferences are ordered by effective priority class. Within a class, the
+ * earliest deadline goes first and inferences with a deadline go before the
+ * ones without. The remaining ties are broken in queueing order.
+ *
+ * Return: true if a should be scheduled before b.
+ */
+bool ethosn_sched_before(const struct ethosn_sched_entry *a,
+			 const struct ethosn_sched_entry *b,
+			 u64 now_ns,
+			 u64 aging_ns);
+
+/**
+ * ethosn_sched_core_allowed() - Check a core against a core mask
+ * @core_mask:	Cores allowed, or 0 for any core.
+ * @core_id:	Core index.
+ *
+ * Return: true if the core is in the mask.
+ */
+bool ethosn_sched_core_allowed(u32 core_mask,
+			       u32 core_id);
+
+/**
+ * ethosn_sched_core_before() - Compare two cores to dispatch an inference to
+ * @a:		First core.
+ * @b:		Second core.
+ *
+ * Cores are ordered by the number of inferences in flight, so that work is
+ * balanced across cores. Among equally loaded cores, the one which last ran
+ * the network goes first as its inference header already holds most of the
+ * bindings. The remaining ties are broken by core index.
+ *
+ * Return: true if a should be picked over b.
+ */
+bool ethosn_sched_core_before(const struct ethosn_sched_core *a,
+			      const struct ethosn_sched_core *b);
+
+#endif /* _ETHOSN_SCHED_H_ */
@@ -0,0 +1,345 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef _ETHOSN_FAKE_DEVICE_H_
+#define _ETHOSN_FAKE_DEVICE_H_
+
+/*
+ * Ethos-N device whose cores are replaced by a model of the firmware, for the
+ * tests of the inference dispatch. Posted inferences are executed in order and
+ * complete at a virtual time which the tests advance with
+ * fake_device_next_irq(). Include after ethosn_network.c.
+ */
+
+#include "fake_dma.h"
+
+#include "ethosn_device.h"
+#include "ethosn_log.h"
+
+#define FAKE_DEVICE_MAX_CORES  4
+#define FAKE_FIRMWARE_MAX_JOBS 64
+
+/* Inference posted to the model of the firmware */
+struct fake_job {
+	uint64_t user_arg;
+	u64      start_ns;
+	u64      finish_ns;
+	u64      irq_ns;
+};
+
+/* Model of the firmware of a core */
+struct fake_firmware {
+	struct fake_job jobs[FAKE_FIRMWARE_MAX_JOBS];
+	unsigned int    head;
+	unsigned int    num_jobs;
+	/* Time at which the last posted inference finishes and its interrupt
+	 * is handled. Interrupts are handled in order.
+	 */
+	u64             busy_until_ns;
+	u64             last_irq_ns;
+	/* Every inference which has started, for the idle gaps */
+	u64             *starts_ns;
+	u64             *finishes_ns;
+	size_t          num_started;
+	size_t          max_started;
+};
+
+/* Virtual costs, in ns, of the steps of the dispatch */
+struct fake_costs {
+	/* From posting an inference to the firmware picking it up */
+	u64 mailbox_ns;
+	/* Execution of an inference, uniform in [exec_ns, exec_ns + jitter) */
+	u64 exec_ns;
+	u64 exec_jitter_ns;
+	/* From the end of an inference to the interrupt bottom half */
+	u64 irq_ns;
+	u64 irq_jitter_ns;
+};
+
+struct fake_device {
+	struct ethosn_device   ethosn;
+	struct device          dev;
+	struct ethosn_core     cores[FAKE_DEVICE_MAX_CORES];
+	struct ethosn_core     *core_ptrs[FAKE_DEVICE_MAX_CORES];
+	struct device          core_devs[FAKE_DEVICE_MAX_CORES];
+	struct ethosn_dma_info mailbox_request;
+	struct ethosn_queue    mailbox_queue;
+	struct fake_firmware   firmware[FAKE_DEVICE_MAX_CORES];
+	struct fake_costs      costs;
+	/* Error ethosn_send_inference() returns if non zero, e.g. -ENOSPC */
+	int                    send_error;
+};
+
+static struct fake_device *fake_device;
+
+static u64 fake_jitter(u64 jitter_ns)
+{
+	return jitter_ns ? host_rand() % jitter_ns : 0;
+}
+
+/**
+ * fake_device_create() - Create a device with a model of the firmware.
+ * @num_cores:	Number of cores.
+ * @depth:	Inference depth of each core.
+ * @max_started:	Number of inferences whose start and end are recorded.
+ */
+static struct fake_device *fake_device_create(int num_cores,
+					      u32 depth,
+					      size_t max_started)
+{
+	struct fake_device *fake = calloc(1, sizeof(*fake));
+	int i;
+
+	BUG_ON(!fake || num_cores > FAKE_DEVICE_MAX_CORES);
+
+	fake->dev.name = "ethosn";
+	fake->ethosn.dev = &fake->dev;
+	fake->ethosn.core = fake->core_ptrs;
+	fake->ethosn.num_cores = num_cores;
+	fake->ethosn.allocator = &fake_dma_allocator;
+	mutex_init(&fake->ethosn.mutex);
+	mutex_init(&fake->ethosn.queue.inference_queue_mutex);
+	INIT_LIST_HEAD(&fake->ethosn.queue.inference_queue);
+	INIT_LIST_HEAD(&fake->ethosn.constants);
+
+	fake->mailbox_request.cpu_addr = &fake->mailbox_queue;
+	fake->mailbox_request.size = sizeof(fake->mailbox_queue);
+
+	for (i = 0; i < num_cores; ++i) {
+		struct ethosn_core *core = &fake->cores[i];
+		struct fake_firmware *fw = &fake->firmware[i];
+
+		fake->core_devs[i].name = "ethosn-core";
+		core->dev = &fake->core_devs[i];
+		core->core_id = i;
+		core->parent = &fake->ethosn;
+		core->allocator = &fake_dma_allocator;
+		core->mailbox_request = &fake->mailbox_request;
+		core->inference_depth = depth;
+		core->status = ETHOSN_CORE_FREE;
+		mutex_init(&core->mutex);
+		INIT_LIST_HEAD(&core->inflight_inferences);
+		fake->core_ptrs[i] = core;
+
+		fw->max_started = max_started;
+		fw->starts_ns = calloc(max_started + 1, sizeof(u64));
+		fw->finishes_ns = calloc(max_started + 1, sizeof(u64));
+		BUG_ON(!fw->starts_ns || !fw->finishes_ns);
+	}
+
+	fake_device = fake;
+
+	return fake;
+}
+
+static void fake_device_destroy(struct fake_device *fake)
+{
+	int i;
+
+	for (i = 0; i < FAKE_DEVICE_MAX_CORES; ++i) {
+		free(fake->firmware[i].starts_ns);
+		free(fake->firmware[i].finishes_ns);
+	}
+
+	if (fake_device == fake)
+		fake_device = NULL;
+
+	free(fake);
+}
+
+/**
+ * fake_device_next_irq() - Time of the next completion interrupt.
+ * @fake:	Fake device.
+ * @core_id:	Returns the core raising the interrupt.
+ *
+ * Return: Time of the interrupt, or U64_MAX if no inference is posted.
+ */
+static u64 fake_device_next_irq(struct fake_device *fake,
+				int *core_id)
+{
+	u64 first = U64_MAX;
+	int i;
+
+	for (i = 0; i < fake->ethosn.num_cores; ++i) {
+		struct fake_firmware *fw = &fake->firmware[i];
+
+		if (fw->num_jobs && fw->jobs[fw->head].irq_ns < first) {
+			first = fw->jobs[fw->head].irq_ns;
+			*core_id = i;
+		}
+	}
+
+	return first;
+}
+
+/**
+ * fake_device_irq() - Run the interrupt bottom half of a core.
+ * @fake:	Fake device.
+ * @core_id:	Core whose oldest posted inference has finished.
+ * @irq_ns:	Time of the interrupt.
+ *
+ * Like ethosn_irq_bottom(), reports the completed inference, which refills the
+ * in-flight slots of the core from the queue.
+ */
+static void fake_device_irq(struct fake_device *fake,
+			    int core_id,
+			    u64 irq_ns)
+{
+	struct ethosn_core *core = fake->core_ptrs[core_id];
+	struct fake_firmware *fw = &fake->firmware[core_id];
+	struct fake_job *job = &fw->jobs[fw->head];
+
+	BUG_ON(!fw->num_jobs);
+
+	fw->head = (fw->head + 1) % FAKE_FIRMWARE_MAX_JOBS;
+	--fw->num_jobs;
+
+	host_ktime_ns = max(host_ktime_ns, irq_ns);
+	atomic64_set(&core->irq_time_ns, host_ktime_ns);
+
+	mutex_lock(&core->mutex);
+	ethosn_network_poll(core, (struct ethosn_inference *)job->user_arg,
+			    ETHOSN_INFERENCE_COMPLETED);
+	ethosn_network_update_core_status(core);
+	mutex_unlock(&core->mutex);
+}
+
+/* Mean, median and tail of the idle gaps between inferences on a core */
+struct fake_gaps {
+	size_t num;
+	u64    mean_ns;
+	u64    p50_ns;
+	u64    p99_ns;
+	/* Fraction of the time the core executed inferences, in percent */
+	double utilisation;
+};
+
+static struct fake_gaps fake_device_gaps(struct fake_device *fake,
+					 int core_id)
+{
+	struct fake_firmware *fw = &fake->firmware[core_id];
+	struct fake_gaps gaps = { 0 };
+	u64 *samples;
+	u64 total = 0;
+	u64 busy = 0;
+	size_t i;
+
+	if (fw->num_started < 2)
+		return gaps;
+
+	samples = calloc(fw->num_started, sizeof(*samples));
+	BUG_ON(!samples);
+
+	for (i = 0; i + 1 < fw->num_started; ++i) {
+		samples[i] = fw->starts_ns[i + 1] - fw->finishes_ns[i];
+		total += samples[i];
+		busy += fw->finishes_ns[i] - fw->starts_ns[i];
+	}
+
+	gaps.num = fw->num_started - 1;
+	gaps.mean_ns = total / gaps.num;
+	gaps.utilisation = 100.0 * busy / (busy + total);
+	gaps.p50_ns = host_percentile(samples, gaps.num, 50);
+	gaps.p99_ns = host_percentile(samples, gaps.num, 99);
+	free(samples);
+
+	return gaps;
+}
+
+/* Stand-ins for the parts of the module which talk to the hardware */
+
+int ethosn_send_inference(struct ethosn_core *core,
+			  dma_addr_t buffer_array,
+			  uint64_t user_arg)
+{
+	struct fake_device *fake = fake_device;
+	struct fake_firmware *fw = &fake->firmware[core->core_id];
+	struct fake_job *job;
+
+	if (fake->send_error)
+		return fake->send_error;
+
+	BUG_ON(fw->num_jobs == FAKE_FIRMWARE_MAX_JOBS);
+
+	job = &fw->jobs[(fw->head + fw->num_jobs) % FAKE_FIRMWARE_MAX_JOBS];
+	job->user_arg = user_arg;
+	job->start_ns = max(host_ktime_ns + fake->costs.mailbox_ns,
+			    fw->busy_until_ns);
+	job->finish_ns = job->start_ns + fake->costs.exec_ns +
+			 fake_jitter(fake->costs.exec_jitter_ns);
+	job->irq_ns = max(job->finish_ns + fake->costs.irq_ns +
+			  fake_jitter(fake->costs.irq_jitter_ns),
+			  fw->last_irq_ns);
+	fw->busy_until_ns = job->finish_ns;
+	fw->last_irq_ns = job->irq_ns;
+	++fw->num_jobs;
+
+	if (fw->num_started < fw->max_started) {
+		fw->starts_ns[fw->num_started] = job->start_ns;
+		fw->finishes_ns[fw->num_started] = job->finish_ns;
+		++fw->num_started;
+	}
+
+	return 0;
+}
+
+int ethosn_send_time_sync(struct ethosn_core *core)
+{
+	return 0;
+}
+
+bool ethosn_mailbox_empty(struct ethosn_queue *queue)
+{
+	return true;
+}
+
+int ethosn_reset_and_start_ethosn(struct ethosn_core *core)
+{
+	struct fake_firmware *fw = &fake_device->firmware[core->core_id];
+
+	fw->num_jobs = 0;
+	fw->busy_until_ns = host_ktime_ns;
+	fw->last_irq_ns = host_ktime_ns;
+
+	return 0;
+}
+
+u64 ethosn_sched_aging_ns(void)
+{
+	return 0;
+}
+
+resource_size_t to_ethosn_addr(const resource_size_t linux_addr,
+			       const struct ethosn_addr_map *addr_map)
+{
+	return linux_addr;
+}
+
+int ethosn_log_uapi(struct ethosn_core *core,
+		    uint32_t ioctl,
+		    void *data,
+		    size_t length)
+{
+	return 0;
+}
+
+#endif /* _ETHOSN_FAKE_DEVICE_H_ */
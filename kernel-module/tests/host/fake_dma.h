@@ -0,0 +1,205 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef _ETHOSN_FAKE_DMA_H_
+#define _ETHOSN_FAKE_DMA_H_
+
+/*
+ * DMA allocator backed by host memory, for the tests of the code above the
+ * allocators. Include after ethosn_dma.c, which dispatches to it.
+ */
+
+#include "ethosn_dma.h"
+
+/* Counts of the operations done on the fake allocator */
+struct fake_dma_stats {
+	long num_allocs;
+	long num_frees;
+	long num_maps;
+	long num_unmaps;
+	long num_syncs_for_device;
+	long num_syncs_for_cpu;
+	/* Bytes synced, including ranges */
+	u64  bytes_synced_for_device;
+	u64  bytes_synced_for_cpu;
+};
+
+static struct fake_dma_stats fake_dma_stats;
+
+/* Ranges synced, in order, while fake_dma_num_ranges isn't negative. The
+ * tests which check them reset it to 0.
+ */
+struct fake_dma_range {
+	bool   for_device;
+	size_t offset;
+	size_t size;
+};
+
+#define FAKE_DMA_MAX_RANGES     8
+
+static struct fake_dma_range fake_dma_ranges[FAKE_DMA_MAX_RANGES];
+static int fake_dma_num_ranges = -1;
+
+/* Virtual time taken by cache maintenance, per byte */
+static u64 fake_dma_sync_ps_per_byte;
+
+static dma_addr_t fake_dma_next_iova = 0x10000000;
+
+static void fake_dma_sync_cost(u64 bytes)
+{
+	host_ktime_ns += bytes * fake_dma_sync_ps_per_byte / 1000;
+}
+
+static void fake_dma_log_range(bool for_device,
+			       size_t offset,
+			       size_t size)
+{
+	struct fake_dma_range *range;
+
+	if (fake_dma_num_ranges < 0)
+		return;
+
+	BUG_ON(fake_dma_num_ranges == FAKE_DMA_MAX_RANGES);
+	range = &fake_dma_ranges[fake_dma_num_ranges++];
+	range->for_device = for_device;
+	range->offset = offset;
+	range->size = size;
+}
+
+static struct ethosn_dma_info *fake_dma_alloc(
+	struct ethosn_dma_allocator *allocator,
+	size_t size,
+	gfp_t gfp)
+{
+	struct ethosn_dma_info *dma_info = kzalloc(sizeof(*dma_info), gfp);
+
+	if (!dma_info)
+		return NULL;
+
+	dma_info->cpu_addr = kzalloc(size, gfp);
+	if (!dma_info->cpu_addr) {
+		kfree(dma_info);
+
+		return NULL;
+	}
+
+	dma_info->size = size;
+	dma_info->iova_addr = fake_dma_next_iova;
+	fake_dma_next_iova += PAGE_ALIGN(size) + PAGE_SIZE;
+	++fake_dma_stats.num_allocs;
+
+	return dma_info;
+}
+
+static int fake_dma_map(struct ethosn_dma_allocator *allocator,
+			struct ethosn_dma_info *dma_info,
+			int prot,
+			enum ethosn_stream_id stream_id)
+{
+	++fake_dma_stats.num_maps;
+
+	return 0;
+}
+
+static void fake_dma_unmap(struct ethosn_dma_allocator *allocator,
+			   struct ethosn_dma_info *dma_info,
+			   enum ethosn_stream_id stream_id)
+{
+	++fake_dma_stats.num_unmaps;
+}
+
+static void fake_dma_free(struct ethosn_dma_allocator *allocator,
+			  struct ethosn_dma_info *dma_info)
+{
+	++fake_dma_stats.num_frees;
+	kfree(dma_info->cpu_addr);
+	kfree(dma_info);
+}
+
+static void fake_dma_sync_for_device(struct ethosn_dma_allocator *allocator,
+				     struct ethosn_dma_info *dma_info)
+{
+	++fake_dma_stats.num_syncs_for_device;
+	fake_dma_stats.bytes_synced_for_device += dma_info->size;
+	fake_dma_sync_cost(dma_info->size);
+}
+
+static void fake_dma_sync_for_cpu(struct ethosn_dma_allocator *allocator,
+				  struct ethosn_dma_info *dma_info)
+{
+	++fake_dma_stats.num_syncs_for_cpu;
+	fake_dma_stats.bytes_synced_for_cpu += dma_info->size;
+	fake_dma_sync_cost(dma_info->size);
+}
+
+static void fake_dma_sync_range_for_device(
+	struct ethosn_dma_allocator *allocator,
+	struct ethosn_dma_info *dma_info,
+	size_t offset,
+	size_t size)
+{
+	++fake_dma_stats.num_syncs_for_device;
+	fake_dma_stats.bytes_synced_for_device += size;
+	fake_dma_sync_cost(size);
+	fake_dma_log_range(true, offset, size);
+}
+
+static void fake_dma_sync_range_for_cpu(struct ethosn_dma_allocator *allocator,
+					struct ethosn_dma_info *dma_info,
+					size_t offset,
+					size_t size)
+{
+	++fake_dma_stats.num_syncs_for_cpu;
+	fake_dma_stats.bytes_synced_for_cpu += size;
+	fake_dma_sync_cost(size);
+	fake_dma_log_range(false, offset, size);
+}
+
+static const struct ethosn_dma_allocator_ops fake_dma_ops = {
+	.alloc = fake_dma_alloc,
+	.map = fake_dma_map,
+	.unmap = fake_dma_unmap,
+	.free = fake_dma_free,
+	.sync_for_device = fake_dma_sync_for_device,
+	.sync_for_cpu = fake_dma_sync_for_cpu,
+	.sync_range_for_device = fake_dma_sync_range_for_device,
+	.sync_range_for_cpu = fake_dma_sync_range_for_cpu,
+};
+
+static struct ethosn_dma_allocator fake_dma_allocator = {
+	.ops = &fake_dma_ops,
+};
+
+/* The real allocators aren't built with the fake one */
+struct ethosn_dma_allocator *ethosn_dma_iommu_allocator_create(
+	struct device *dev)
+{
+	return NULL;
+}
+
+struct ethosn_dma_allocator *ethosn_dma_carveout_allocator_create(
+	struct device *dev)
+{
+	return NULL;
+}
+
+#endif /* _ETHOSN_FAKE_DMA_H_ */
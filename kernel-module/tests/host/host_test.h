@@ -0,0 +1,157 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+#ifndef _ETHOSN_HOST_TEST_H_
+#define _ETHOSN_HOST_TEST_H_
+
+/*
+ * Minimal test framework for the host builds of the kernel module sources.
+ * Each test program runs its tests with HOST_RUN() and returns
+ * host_test_result() from main().
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static unsigned int host_test_failures;
+static uint64_t host_rand_state = 0x2545f4914f6cdd1dULL;
+
+#define HOST_EXPECT(cond)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: %s: expected %s\n",	\
+				__FILE__, __LINE__, __func__, #cond);	\
+			++host_test_failures;				\
+		}							\
+	} while (0)
+
+/* Like HOST_EXPECT, but gives up on the test, e.g. before a NULL deref */
+#define HOST_ASSERT(cond)						\
+	do {								\
+		if (!(cond)) {						\
+			fprintf(stderr, "%s:%d: %s: required %s\n",	\
+				__FILE__, __LINE__, __func__, #cond);	\
+			++host_test_failures;				\
+			return;						\
+		}							\
+	} while (0)
+
+#define HOST_RUN(test)							\
+	do {								\
+		unsigned int failures = host_test_failures;		\
+		test();							\
+		printf("%-60s %s\n", #test,				\
+		       failures == host_test_failures ? "ok" : "FAILED");\
+	} while (0)
+
+static inline int host_test_result(void)
+{
+	return host_test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * host_srand() - Seed host_rand().
+ *
+ * The tests use a fixed seed by default so that failures can be reproduced.
+ * It can be changed with the HOST_TEST_SEED environment variable.
+ */
+static inline void host_srand(void)
+{
+	const char *seed = getenv("HOST_TEST_SEED");
+
+	if (seed)
+		host_rand_state = strtoull(seed, NULL, 0) | 1;
+
+	printf("HOST_TEST_SEED=%#llx\n",
+	       (unsigned long long)host_rand_state);
+}
+
+/* xorshift64* */
+static inline uint32_t host_rand(void)
+{
+	host_rand_state ^= host_rand_state >> 12;
+	host_rand_state ^= host_rand_state << 25;
+	host_rand_state ^= host_rand_state >> 27;
+
+	return (uint32_t)((host_rand_state * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+/* Uniform in [0, n) */
+static inline uint32_t host_rand_below(uint32_t n)
+{
+	return (uint32_t)(((uint64_t)host_rand() * n) >> 32);
+}
+
+static inline uint64_t host_time_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline int host_cmp_u64(const void *a, const void *b)
+{
+	const uint64_t x = *(const uint64_t *)a;
+	const uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * host_percentile() - Nearest-rank percentile of samples.
+ * @samples:	Samples, which are sorted in place.
+ * @num:	Number of samples.
+ * @percent:	Percentile, e.g. 99.9.
+ */
+static inline uint64_t host_percentile(uint64_t *samples,
+				       size_t num,
+				       double percent)
+{
+	size_t rank;
+
+	if (!num)
+		return 0;
+
+	qsort(samples, num, sizeof(*samples), host_cmp_u64);
+	rank = (size_t)(percent / 100.0 * (double)num + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	if (rank > num)
+		rank = num;
+
+	return samples[rank - 1];
+}
+
+static inline bool host_bench_requested(int argc,
+					char **argv)
+{
+	return argc > 1 && !strcmp(argv[1], "--bench");
+}
+
+#endif /* _ETHOSN_HOST_TEST_H_ */
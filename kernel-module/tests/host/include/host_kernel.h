@@ -0,0 +1,746 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-ins for the parts of the kernel API that the kernel module uses.
+ * The headers under linux/ include this one.
+ *
+ * Everything is single threaded: locks only check that they are balanced and
+ * held where lockdep would check it. Files, allocations and device references
+ * are counted so that the tests can check for leaks. Time is virtual, see
+ * host_ktime_ns.
+ */
+
+#ifndef _HOST_KERNEL_H_
+#define _HOST_KERNEL_H_
+
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+/* Attributes and annotations */
+
+#define __user
+#define __iomem
+#define __force
+#define __always_unused         __attribute__((unused))
+#define __maybe_unused          __attribute__((unused))
+#define __must_check            __attribute__((warn_unused_result))
+#define likely(x)               __builtin_expect(!!(x), 1)
+#define unlikely(x)             __builtin_expect(!!(x), 0)
+
+#define THIS_MODULE             NULL
+#define EXPORT_SYMBOL(sym)
+#define MODULE_LICENSE(license)
+
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+#ifndef LINUX_VERSION_CODE
+#define LINUX_VERSION_CODE      KERNEL_VERSION(4, 14, 0)
+#endif
+
+/* Failures of the kernel API calls, e.g. a lock taken twice */
+#define host_bug(...)							\
+	do {								\
+		fprintf(stderr, "%s:%d: BUG: ", __FILE__, __LINE__);	\
+		fprintf(stderr, __VA_ARGS__);				\
+		fprintf(stderr, "\n");					\
+		abort();						\
+	} while (0)
+
+#define BUG_ON(cond)							\
+	do {								\
+		if (cond)						\
+			host_bug("%s", #cond);				\
+	} while (0)
+
+#define BUILD_BUG_ON(cond)      ((void)sizeof(char[1 - 2 * !!(cond)]))
+
+static unsigned int host_num_warnings __maybe_unused;
+
+#define WARN_ON(cond)							\
+	({								\
+		int __ret = !!(cond);					\
+		if (__ret) {						\
+			fprintf(stderr, "%s:%d: WARN_ON(%s)\n",		\
+				__FILE__, __LINE__, #cond);		\
+			++host_num_warnings;				\
+		}							\
+		__ret;							\
+	})
+
+#define WARN_ON_ONCE(cond)      WARN_ON(cond)
+
+/* Arithmetic */
+
+#define U8_MAX                  ((u8)~0U)
+#define U16_MAX                 ((u16)~0U)
+#define U32_MAX                 ((u32)~0U)
+#define U64_MAX                 ((u64)~0ULL)
+#define S32_MAX                 ((s32)(U32_MAX >> 1))
+
+#define BIT(nr)                 (1UL << (nr))
+#define BIT_ULL(nr)             (1ULL << (nr))
+#define GENMASK(h, l) \
+	(((~0UL) - (1UL << (l)) + 1) & (~0UL >> (8 * sizeof(long) - 1 - (h))))
+#define GENMASK_ULL(h, l) \
+	(((~0ULL) - (1ULL << (l)) + 1) & \
+	 (~0ULL >> (8 * sizeof(long long) - 1 - (h))))
+
+#define min(x, y)               ((x) < (y) ? (x) : (y))
+#define max(x, y)               ((x) > (y) ? (x) : (y))
+#define clamp(val, lo, hi)      min(max(val, lo), hi)
+#define clamp_t(type, val, lo, hi) \
+	min_t(type, max_t(type, val, lo), hi)
+#define swap(a, b)							\
+	do {								\
+		__typeof__(a) __tmp = (a);				\
+		(a) = (b);						\
+		(b) = __tmp;						\
+	} while (0)
+
+#define DIV_ROUND_UP(n, d)      (((n) + (d) - 1) / (d))
+#define ALIGN(x, a)             (((x) + (a) - 1) & ~((__typeof__(x))(a) - 1))
+#define IS_ALIGNED(x, a)        (((x) & ((__typeof__(x))(a) - 1)) == 0)
+
+static inline int fls(unsigned int x)
+{
+	return x ? 32 - __builtin_clz(x) : 0;
+}
+
+static inline int fls64(u64 x)
+{
+	return x ? 64 - __builtin_clzll(x) : 0;
+}
+
+static inline int __ffs(unsigned long x)
+{
+	return __builtin_ctzl(x);
+}
+
+/* Error pointers */
+
+#define MAX_ERRNO               4095
+
+static inline void *ERR_PTR(long error)
+{
+	return (void *)error;
+}
+
+static inline long PTR_ERR(const void *ptr)
+{
+	return (long)ptr;
+}
+
+static inline bool IS_ERR(const void *ptr)
+{
+	return (unsigned long)ptr >= (unsigned long)-MAX_ERRNO;
+}
+
+static inline bool IS_ERR_OR_NULL(const void *ptr)
+{
+	return !ptr || IS_ERR(ptr);
+}
+
+#define ERESTARTSYS             512
+
+/* Virtual time, which the tests advance */
+
+static u64 host_ktime_ns;
+
+static inline u64 ktime_get_ns(void)
+{
+	return host_ktime_ns;
+}
+
+#define HZ                      100
+
+/* Memory */
+
+#define PAGE_SHIFT              12
+#define PAGE_SIZE               (1UL << PAGE_SHIFT)
+#define PAGE_ALIGN(addr)        ALIGN(addr, PAGE_SIZE)
+
+typedef unsigned int gfp_t;
+
+#define GFP_KERNEL              0x1U
+#define GFP_ATOMIC              0x2U
+#define __GFP_ZERO              0x100U
+
+/* Number of live allocations, and the allocation that fails if non zero */
+static long host_num_allocs;
+static long host_alloc_fail_countdown;
+/* gfp of the last allocation */
+static gfp_t host_last_gfp;
+/* If non zero, the gfp every allocation must be made with, besides zeroing */
+static gfp_t host_alloc_expected_gfp;
+
+static inline void *kmalloc(size_t size,
+			    gfp_t gfp)
+{
+	void *ptr;
+
+	host_last_gfp = gfp;
+	WARN_ON(host_alloc_expected_gfp &&
+		(gfp & ~__GFP_ZERO) != host_alloc_expected_gfp);
+	if (host_alloc_fail_countdown && !--host_alloc_fail_countdown)
+		return NULL;
+
+	ptr = gfp & __GFP_ZERO ? calloc(1, size ? size : 1) :
+	      malloc(size ? size : 1);
+	if (ptr)
+		++host_num_allocs;
+
+	return ptr;
+}
+
+static inline void *kzalloc(size_t size,
+			    gfp_t gfp)
+{
+	return kmalloc(size, gfp | __GFP_ZERO);
+}
+
+static inline void *kcalloc(size_t n,
+			    size_t size,
+			    gfp_t gfp)
+{
+	if (size && n > SIZE_MAX / size)
+		return NULL;
+
+	return kzalloc(n * size, gfp);
+}
+
+static inline void *kmalloc_array(size_t n,
+				  size_t size,
+				  gfp_t gfp)
+{
+	if (size && n > SIZE_MAX / size)
+		return NULL;
+
+	return kmalloc(n * size, gfp);
+}
+
+static inline void kfree(const void *ptr)
+{
+	if (!ptr)
+		return;
+
+	--host_num_allocs;
+	free((void *)ptr);
+}
+
+#define vmalloc(size)           kmalloc(size, GFP_KERNEL)
+#define vzalloc(size)           kzalloc(size, GFP_KERNEL)
+#define vfree(ptr)              kfree(ptr)
+#define kvmalloc(size, gfp)     kmalloc(size, gfp)
+#define kvzalloc(size, gfp)     kzalloc(size, gfp)
+#define kvfree(ptr)             kfree(ptr)
+
+/*
+ * User memory is host memory. Copies from HOST_BAD_USER_PTR fault, as an
+ * invalid user pointer would.
+ */
+#define HOST_BAD_USER_PTR       ((void *)16)
+
+static inline unsigned long copy_from_user(void *to,
+					   const void __user *from,
+					   unsigned long n)
+{
+	if (from == HOST_BAD_USER_PTR)
+		return n;
+
+	memcpy(to, from, n);
+
+	return 0;
+}
+
+/* The copy to user memory that faults if non zero */
+static long host_copy_to_user_fail_countdown;
+
+static inline unsigned long copy_to_user(void __user *to,
+					 const void *from,
+					 unsigned long n)
+{
+	if (to == HOST_BAD_USER_PTR)
+		return n;
+
+	if (host_copy_to_user_fail_countdown &&
+	    !--host_copy_to_user_fail_countdown)
+		return n;
+
+	memcpy(to, from, n);
+
+	return 0;
+}
+
+#define put_user(x, ptr)        (*(ptr) = (x), 0)
+#define get_user(x, ptr)        ((x) = *(ptr), 0)
+
+/* Locking */
+
+struct mutex {
+	bool held;
+};
+
+#define mutex_init(lock)        ((lock)->held = false)
+#define mutex_destroy(lock)     BUG_ON((lock)->held)
+#define mutex_is_locked(lock)   ((lock)->held)
+
+static unsigned int host_num_mutex_locks __maybe_unused;
+
+#define mutex_lock(lock)						\
+	do {								\
+		if ((lock)->held)					\
+			host_bug("deadlock on %s", #lock);		\
+		(lock)->held = true;					\
+		++host_num_mutex_locks;					\
+	} while (0)
+
+#define mutex_lock_interruptible(lock)  ({ mutex_lock(lock); 0; })
+
+#define mutex_unlock(lock)						\
+	do {								\
+		if (!(lock)->held)					\
+			host_bug("unlocking free %s", #lock);		\
+		(lock)->held = false;					\
+	} while (0)
+
+#define lockdep_assert_held(lock)					\
+	do {								\
+		if (!(lock)->held)					\
+			host_bug("%s not held", #lock);			\
+	} while (0)
+
+typedef struct mutex spinlock_t;
+
+#define spin_lock_init(lock)    mutex_init(lock)
+#define spin_lock(lock)         mutex_lock(lock)
+#define spin_unlock(lock)       mutex_unlock(lock)
+#define spin_lock_irqsave(lock, flags) \
+	do { (void)(flags); mutex_lock(lock); } while (0)
+#define spin_unlock_irqrestore(lock, flags) \
+	do { (void)(flags); mutex_unlock(lock); } while (0)
+
+/* Atomics */
+
+typedef struct {
+	int counter;
+} atomic_t;
+
+typedef struct {
+	s64 counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(i)          { (i) }
+#define atomic_read(v)          ((v)->counter)
+#define atomic_set(v, i)        ((v)->counter = (i))
+#define atomic_inc(v)           (++(v)->counter)
+#define atomic_dec(v)           (--(v)->counter)
+#define atomic_add(i, v)        ((v)->counter += (i))
+#define atomic_inc_return(v)    (++(v)->counter)
+#define atomic_dec_return(v)    (--(v)->counter)
+#define atomic_xchg(v, i)						\
+	({								\
+		__typeof__((v)->counter) __old = (v)->counter;		\
+		(v)->counter = (i);					\
+		__old;							\
+	})
+#define atomic64_read(v)        atomic_read(v)
+#define atomic64_set(v, i)      atomic_set(v, i)
+#define atomic64_add(i, v)      atomic_add(i, v)
+
+struct kref {
+	int refcount;
+};
+
+#define kref_init(kref)         ((kref)->refcount = 1)
+#define kref_read(kref)         ((kref)->refcount)
+
+static inline void kref_get(struct kref *kref)
+{
+	BUG_ON(kref->refcount <= 0);
+	++kref->refcount;
+}
+
+static inline int kref_put(struct kref *kref,
+			   void (*release)(struct kref *kref))
+{
+	BUG_ON(kref->refcount <= 0);
+	if (--kref->refcount)
+		return 0;
+
+	release(kref);
+
+	return 1;
+}
+
+/* Lists */
+
+struct list_head {
+	struct list_head *next;
+	struct list_head *prev;
+};
+
+#define LIST_HEAD_INIT(name)    { &(name), &(name) }
+#define LIST_HEAD(name)         struct list_head name = LIST_HEAD_INIT(name)
+
+static inline void INIT_LIST_HEAD(struct list_head *list)
+{
+	list->next = list;
+	list->prev = list;
+}
+
+static inline void __list_add(struct list_head *new,
+			      struct list_head *prev,
+			      struct list_head *next)
+{
+	next->prev = new;
+	new->next = next;
+	new->prev = prev;
+	prev->next = new;
+}
+
+static inline void list_add(struct list_head *new,
+			    struct list_head *head)
+{
+	__list_add(new, head, head->next);
+}
+
+static inline void list_add_tail(struct list_head *new,
+				 struct list_head *head)
+{
+	__list_add(new, head->prev, head);
+}
+
+/* Poisons the entry like the kernel, to catch use after deletion */
+static inline void list_del(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	entry->next = (struct list_head *)0x100;
+	entry->prev = (struct list_head *)0x122;
+}
+
+static inline void list_del_init(struct list_head *entry)
+{
+	entry->next->prev = entry->prev;
+	entry->prev->next = entry->next;
+	INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move_tail(struct list_head *entry,
+				  struct list_head *head)
+{
+	list_del(entry);
+	list_add_tail(entry, head);
+}
+
+static inline int list_empty(const struct list_head *head)
+{
+	return head->next == head;
+}
+
+/* Inserts the entries of list at the front of head */
+static inline void list_splice(const struct list_head *list,
+			       struct list_head *head)
+{
+	if (list_empty(list))
+		return;
+
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next = list->next;
+}
+
+#define list_entry(ptr, type, member)   container_of(ptr, type, member)
+#define list_first_entry(ptr, type, member) \
+	list_entry((ptr)->next, type, member)
+#define list_last_entry(ptr, type, member) \
+	list_entry((ptr)->prev, type, member)
+#define list_first_entry_or_null(ptr, type, member) \
+	(list_empty(ptr) ? NULL : list_first_entry(ptr, type, member))
+#define list_next_entry(pos, member) \
+	list_entry((pos)->member.next, __typeof__(*(pos)), member)
+#define list_prev_entry(pos, member) \
+	list_entry((pos)->member.prev, __typeof__(*(pos)), member)
+
+#define list_for_each_entry(pos, head, member)				\
+	for (pos = list_first_entry(head, __typeof__(*pos), member);	\
+	     &pos->member != (head);					\
+	     pos = list_next_entry(pos, member))
+
+#define list_for_each_entry_safe(pos, n, head, member)			\
+	for (pos = list_first_entry(head, __typeof__(*pos), member),	\
+	     n = list_next_entry(pos, member);				\
+	     &pos->member != (head);					\
+	     pos = n, n = list_next_entry(n, member))
+
+/* Wait queues and polling */
+
+typedef struct {
+	unsigned int num_wakeups;
+} wait_queue_head_t;
+
+typedef struct poll_table_struct {
+	int unused;
+} poll_table;
+
+#define init_waitqueue_head(wq)         ((wq)->num_wakeups = 0)
+#define wake_up(wq)                     (++(wq)->num_wakeups)
+#define wake_up_interruptible(wq)       (++(wq)->num_wakeups)
+#define wake_up_poll(wq, mask)          (++(wq)->num_wakeups)
+#define wake_up_interruptible_poll(wq, mask) (++(wq)->num_wakeups)
+#define poll_wait(file, wq, table)      ((void)(wq))
+
+/* Nothing else runs while the tests wait, so a wait that isn't satisfied
+ * straight away is interrupted.
+ */
+#define wait_event_interruptible(wq, condition) \
+	((void)(wq), (condition) ? 0 : -ERESTARTSYS)
+
+/* Devices */
+
+struct bus_type {
+	const char *name;
+};
+
+struct device_node;
+
+struct device {
+	const char         *name;
+	struct bus_type    *bus;
+	struct device      *parent;
+	struct device_node *of_node;
+	int                refcount;
+};
+
+static inline struct device *get_device(struct device *dev)
+{
+	++dev->refcount;
+
+	return dev;
+}
+
+static inline void put_device(struct device *dev)
+{
+	BUG_ON(dev->refcount <= 0);
+	--dev->refcount;
+}
+
+/* Device managed memory is only ever freed explicitly by the tests */
+#define devm_kzalloc(dev, size, gfp)    kzalloc(size, gfp)
+#define devm_kfree(dev, ptr)            kfree(ptr)
+
+static unsigned int host_num_dev_errors;
+
+static inline void host_dev_printk(const char *level,
+				   const struct device *dev,
+				   const char *fmt,
+				   ...)
+{
+	va_list args;
+
+	if (!getenv("HOST_TEST_VERBOSE"))
+		return;
+
+	fprintf(stderr, "%s %s: ", level, dev && dev->name ? dev->name : "");
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+}
+
+#define dev_err(dev, ...)						\
+	do {								\
+		++host_num_dev_errors;					\
+		host_dev_printk("err", dev, __VA_ARGS__);		\
+	} while (0)
+#define dev_warn(dev, ...)      host_dev_printk("warn", dev, __VA_ARGS__)
+#define dev_info(dev, ...)      host_dev_printk("info", dev, __VA_ARGS__)
+#define dev_dbg(dev, ...)       host_dev_printk("dbg", dev, __VA_ARGS__)
+#define pr_err(...)             host_dev_printk("err", NULL, __VA_ARGS__)
+#define pr_warn(...)            host_dev_printk("warn", NULL, __VA_ARGS__)
+#define pr_info(...)            host_dev_printk("info", NULL, __VA_ARGS__)
+#define pr_debug(...)           host_dev_printk("dbg", NULL, __VA_ARGS__)
+
+typedef u64 dma_addr_t;
+typedef u64 phys_addr_t;
+typedef u64 resource_size_t;
+
+#define DMA_BIT_MASK(n)         (((n) == 64) ? ~0ULL : ((1ULL << (n)) - 1))
+
+/* Files, which are reference counted like in the kernel */
+
+struct inode {
+	int unused;
+};
+
+struct vm_area_struct;
+struct file;
+
+struct file_operations {
+	void         *owner;
+	int          (*release)(struct inode *inode, struct file *file);
+	unsigned int (*poll)(struct file *file, poll_table *wait);
+	ssize_t      (*read)(struct file *file, char __user *buf, size_t count,
+			     loff_t *ppos);
+	ssize_t      (*write)(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos);
+	long         (*unlocked_ioctl)(struct file *file, unsigned int cmd,
+				       unsigned long arg);
+	long         (*compat_ioctl)(struct file *file, unsigned int cmd,
+				     unsigned long arg);
+	int          (*mmap)(struct file *file, struct vm_area_struct *vma);
+	loff_t       (*llseek)(struct file *file, loff_t offset, int whence);
+	int          (*open)(struct inode *inode, struct file *file);
+};
+
+#define FMODE_LSEEK             0x4U
+
+struct file {
+	const struct file_operations *f_op;
+	void                         *private_data;
+	unsigned int                 f_mode;
+	unsigned int                 f_flags;
+	int                          count;
+};
+
+#define HOST_MAX_FDS            256
+
+static struct file *host_fds[HOST_MAX_FDS];
+static long host_num_files;
+
+static inline struct file *get_file(struct file *file)
+{
+	++file->count;
+
+	return file;
+}
+
+static inline void fput(struct file *file)
+{
+	BUG_ON(file->count <= 0);
+	if (--file->count)
+		return;
+
+	if (file->f_op->release)
+		file->f_op->release(NULL, file);
+
+	--host_num_files;
+	free(file);
+}
+
+static inline struct file *fget(unsigned int fd)
+{
+	if (fd >= HOST_MAX_FDS || !host_fds[fd])
+		return NULL;
+
+	return get_file(host_fds[fd]);
+}
+
+static inline int anon_inode_getfd(const char *name,
+				   const struct file_operations *fops,
+				   void *priv,
+				   int flags)
+{
+	int fd;
+
+	(void)name;
+
+	for (fd = 0; fd < HOST_MAX_FDS; ++fd) {
+		if (!host_fds[fd]) {
+			struct file *file = calloc(1, sizeof(*file));
+
+			if (!file)
+				return -ENOMEM;
+
+			file->f_op = fops;
+			file->private_data = priv;
+			file->f_flags = flags;
+			file->count = 1;
+			host_fds[fd] = file;
+			++host_num_files;
+
+			return fd;
+		}
+	}
+
+	return -EMFILE;
+}
+
+/* What close() does in user space: drops the reference of the descriptor */
+static inline int host_close(int fd)
+{
+	struct file *file;
+
+	if (fd < 0 || fd >= HOST_MAX_FDS || !host_fds[fd])
+		return -EBADF;
+
+	file = host_fds[fd];
+	host_fds[fd] = NULL;
+	fput(file);
+
+	return 0;
+}
+
+/* Objects that are only declared or embedded by the module */
+
+struct cdev {
+	int unused;
+};
+
+struct dentry {
+	int unused;
+};
+
+struct debugfs_regset32 {
+	int unused;
+};
+
+struct workqueue_struct {
+	int unused;
+};
+
+struct work_struct {
+	int unused;
+};
+
+struct timer_list {
+	int unused;
+};
+
+struct seq_file;
+
+typedef int irqreturn_t;
+
+#define IRQ_NONE                0
+#define IRQ_HANDLED             1
+
+#endif /* _HOST_KERNEL_H_ */
@@ -0,0 +1,82 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-in for the kernel header of the same name. Write-combined
+ * buffers are host memory, which is also their DMA address.
+ */
+
+#ifndef _HOST_LINUX_DMA_MAPPING_H_
+#define _HOST_LINUX_DMA_MAPPING_H_
+
+#include "../host_kernel.h"
+#include "mm.h"
+
+/* Number and size in bytes of the live write-combined buffers */
+static long host_num_dma_wc_allocs;
+static size_t host_dma_wc_bytes;
+
+static inline void *dma_alloc_wc(struct device *dev,
+				 size_t size,
+				 dma_addr_t *dma_addr,
+				 gfp_t gfp)
+{
+	void *cpu_addr;
+
+	WARN_ON(host_alloc_expected_gfp && gfp != host_alloc_expected_gfp);
+	if (host_alloc_fail_countdown && !--host_alloc_fail_countdown)
+		return NULL;
+
+	cpu_addr = aligned_alloc(PAGE_SIZE, PAGE_ALIGN(size));
+	if (!cpu_addr)
+		return NULL;
+
+	/* Like the DMA API, the memory is zeroed */
+	memset(cpu_addr, 0, size);
+	*dma_addr = (dma_addr_t)(uintptr_t)cpu_addr;
+	++host_num_dma_wc_allocs;
+	host_dma_wc_bytes += size;
+
+	return cpu_addr;
+}
+
+static inline void dma_free_wc(struct device *dev,
+			       size_t size,
+			       void *cpu_addr,
+			       dma_addr_t dma_addr)
+{
+	BUG_ON(dma_addr != (dma_addr_t)(uintptr_t)cpu_addr);
+	--host_num_dma_wc_allocs;
+	host_dma_wc_bytes -= size;
+	free(cpu_addr);
+}
+
+static inline int dma_mmap_wc(struct device *dev,
+			      struct vm_area_struct *vma,
+			      void *cpu_addr,
+			      dma_addr_t dma_addr,
+			      size_t size)
+{
+	return 0;
+}
+
+#endif /* _HOST_LINUX_DMA_MAPPING_H_ */
@@ -0,0 +1,90 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/* Host stand-in for the kernel header of the same name */
+
+#ifndef _HOST_LINUX_IOMMU_H_
+#define _HOST_LINUX_IOMMU_H_
+
+#include "../host_kernel.h"
+
+/* Devices on this bus are behind an IOMMU */
+static struct bus_type host_iommu_bus;
+
+static inline bool iommu_present(struct bus_type *bus)
+{
+	return bus == &host_iommu_bus;
+}
+
+#define IOMMU_READ              (1 << 0)
+#define IOMMU_WRITE             (1 << 1)
+
+/* Fake domain, which counts what is mapped in it */
+struct iommu_domain {
+	long   num_maps;
+	long   num_unmaps;
+	u64    bytes_mapped;
+	u64    bytes_unmapped;
+	/* Size of the largest iommu_map() call */
+	size_t max_map_size;
+	/* Fail the nth call to iommu_map() from now, if not 0 */
+	long   map_fail_countdown;
+};
+
+/* Domain of every device on host_iommu_bus, if any */
+static struct iommu_domain *host_iommu_domain;
+
+static inline struct iommu_domain *iommu_get_domain_for_dev(
+	struct device *dev)
+{
+	return host_iommu_domain;
+}
+
+static inline int iommu_map(struct iommu_domain *domain,
+			    unsigned long iova,
+			    phys_addr_t paddr,
+			    size_t size,
+			    int prot)
+{
+	BUG_ON(!IS_ALIGNED(iova | paddr | size, PAGE_SIZE));
+
+	if (domain->map_fail_countdown && !--domain->map_fail_countdown)
+		return -ENOMEM;
+
+	++domain->num_maps;
+	domain->bytes_mapped += size;
+	domain->max_map_size = max(domain->max_map_size, size);
+
+	return 0;
+}
+
+static inline size_t iommu_unmap(struct iommu_domain *domain,
+				 unsigned long iova,
+				 size_t size)
+{
+	++domain->num_unmaps;
+	domain->bytes_unmapped += size;
+
+	return size;
+}
+
+#endif /* _HOST_LINUX_IOMMU_H_ */
@@ -0,0 +1,102 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/* Host stand-in for the kernel header of the same name: lookup3 by Bob
+ * Jenkins, as in the kernel.
+ */
+
+#ifndef _HOST_LINUX_JHASH_H_
+#define _HOST_LINUX_JHASH_H_
+
+#include <linux/types.h>
+
+#define JHASH_INITVAL           0xdeadbeef
+
+static inline u32 rol32(u32 word,
+			unsigned int shift)
+{
+	return (word << (shift & 31)) | (word >> ((-shift) & 31));
+}
+
+#define __jhash_mix(a, b, c)						\
+	do {								\
+		a -= c; a ^= rol32(c, 4);  c += b;			\
+		b -= a; b ^= rol32(a, 6);  a += c;			\
+		c -= b; c ^= rol32(b, 8);  b += a;			\
+		a -= c; a ^= rol32(c, 16); c += b;			\
+		b -= a; b ^= rol32(a, 19); a += c;			\
+		c -= b; c ^= rol32(b, 4);  b += a;			\
+	} while (0)
+
+#define __jhash_final(a, b, c)						\
+	do {								\
+		c ^= b; c -= rol32(b, 14);				\
+		a ^= c; a -= rol32(c, 11);				\
+		b ^= a; b -= rol32(a, 25);				\
+		c ^= b; c -= rol32(b, 16);				\
+		a ^= c; a -= rol32(c, 4);				\
+		b ^= a; b -= rol32(a, 14);				\
+		c ^= b; c -= rol32(b, 24);				\
+	} while (0)
+
+static inline u32 jhash(const void *key,
+			u32 length,
+			u32 initval)
+{
+	const u8 *k = key;
+	u32 a, b, c;
+
+	a = b = c = JHASH_INITVAL + length + initval;
+
+	while (length > 12) {
+		a += k[0] | (u32)k[1] << 8 | (u32)k[2] << 16 | (u32)k[3] << 24;
+		b += k[4] | (u32)k[5] << 8 | (u32)k[6] << 16 | (u32)k[7] << 24;
+		c += k[8] | (u32)k[9] << 8 | (u32)k[10] << 16 |
+		     (u32)k[11] << 24;
+		__jhash_mix(a, b, c);
+		length -= 12;
+		k += 12;
+	}
+
+	switch (length) {
+	case 12: c += (u32)k[11] << 24; /* fall through */
+	case 11: c += (u32)k[10] << 16; /* fall through */
+	case 10: c += (u32)k[9] << 8;   /* fall through */
+	case 9:  c += k[8];             /* fall through */
+	case 8:  b += (u32)k[7] << 24;  /* fall through */
+	case 7:  b += (u32)k[6] << 16;  /* fall through */
+	case 6:  b += (u32)k[5] << 8;   /* fall through */
+	case 5:  b += k[4];             /* fall through */
+	case 4:  a += (u32)k[3] << 24;  /* fall through */
+	case 3:  a += (u32)k[2] << 16;  /* fall through */
+	case 2:  a += (u32)k[1] << 8;   /* fall through */
+	case 1:  a += k[0];
+		__jhash_final(a, b, c);
+		break;
+	default:
+		break;
+	}
+
+	return c;
+}
+
+#endif /* _HOST_LINUX_JHASH_H_ */
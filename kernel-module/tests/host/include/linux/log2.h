@@ -0,0 +1,33 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/* Host stand-in for the kernel header of the same name */
+
+#ifndef _HOST_LINUX_LOG2_H_
+#define _HOST_LINUX_LOG2_H_
+
+#include "../host_kernel.h"
+
+#define ilog2(n)                (63 - __builtin_clzll((u64)(n)))
+#define is_power_of_2(n)        ((n) != 0 && (((n) & ((n) - 1)) == 0))
+
+#endif /* _HOST_LINUX_LOG2_H_ */
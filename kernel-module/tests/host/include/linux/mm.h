@@ -0,0 +1,139 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-in for the kernel header of the same name: a small physical
+ * memory of struct pages, allocated first fit so that the tests can control
+ * which pages are contiguous. The pages have no memory behind them.
+ */
+
+#ifndef _HOST_LINUX_MM_H_
+#define _HOST_LINUX_MM_H_
+
+#include "../host_kernel.h"
+
+#define PAGE_MASK               (~(PAGE_SIZE - 1))
+#define PAGE_KERNEL             0
+
+#define __GFP_COMP              0x200U
+#define __GFP_NOWARN            0x400U
+#define __GFP_NORETRY           0x800U
+
+#define HOST_NR_PAGES           8192
+
+struct page {
+	bool used;
+};
+
+static struct page host_pages[HOST_NR_PAGES];
+static long host_num_pages;
+/* Largest order alloc_pages() succeeds for */
+static unsigned int host_max_page_order = 31;
+
+static inline unsigned long page_to_pfn(const struct page *page)
+{
+	return page - host_pages;
+}
+
+static inline phys_addr_t page_to_phys(const struct page *page)
+{
+	return (phys_addr_t)page_to_pfn(page) << PAGE_SHIFT;
+}
+
+static inline struct page *alloc_pages(gfp_t gfp,
+				       unsigned int order)
+{
+	const unsigned long n = 1UL << order;
+	unsigned long pfn;
+	unsigned long i;
+
+	if (order > host_max_page_order)
+		return NULL;
+
+	if (host_alloc_fail_countdown && !--host_alloc_fail_countdown)
+		return NULL;
+
+	for (pfn = 0; pfn + n <= HOST_NR_PAGES; pfn += n) {
+		for (i = 0; i < n; ++i)
+			if (host_pages[pfn + i].used)
+				break;
+
+		if (i < n)
+			continue;
+
+		for (i = 0; i < n; ++i)
+			host_pages[pfn + i].used = true;
+
+		host_num_pages += n;
+
+		return &host_pages[pfn];
+	}
+
+	return NULL;
+}
+
+#define alloc_page(gfp)         alloc_pages(gfp, 0)
+
+/* The pages of a block are always freed one by one */
+static inline void split_page(struct page *page,
+			      unsigned int order)
+{
+}
+
+static inline void __free_page(struct page *page)
+{
+	BUG_ON(!page->used);
+	page->used = false;
+	--host_num_pages;
+}
+
+struct vm_area_struct {
+	unsigned long vm_start;
+	unsigned long vm_end;
+	unsigned long vm_pgoff;
+	unsigned long vm_page_prot;
+};
+
+static inline int remap_pfn_range(struct vm_area_struct *vma,
+				  unsigned long addr,
+				  unsigned long pfn,
+				  unsigned long size,
+				  unsigned long prot)
+{
+	return 0;
+}
+
+/* CPU mappings are separate host memory */
+static inline void *vmap(struct page **pages,
+			 unsigned int count,
+			 unsigned long flags,
+			 unsigned long prot)
+{
+	return kzalloc(count * PAGE_SIZE, GFP_KERNEL);
+}
+
+static inline void vunmap(const void *addr)
+{
+	kfree(addr);
+}
+
+#endif /* _HOST_LINUX_MM_H_ */
@@ -0,0 +1,77 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-in for the kernel header of the same name. Device tree nodes
+ * only have what the carveout allocator looks up: a reserved memory region
+ * and its address range.
+ */
+
+#ifndef _HOST_LINUX_OF_ADDRESS_H_
+#define _HOST_LINUX_OF_ADDRESS_H_
+
+#include "../host_kernel.h"
+
+struct resource {
+	resource_size_t start;
+	resource_size_t end;
+};
+
+static inline resource_size_t resource_size(const struct resource *res)
+{
+	return res->end - res->start + 1;
+}
+
+/**
+ * struct device_node - Device tree node
+ * @memory_region:	Node the "memory-region" phandle refers to, if any.
+ * @reg:		Address range of the node.
+ */
+struct device_node {
+	struct device_node *memory_region;
+	struct resource    reg;
+};
+
+static inline struct device_node *of_parse_phandle(
+	const struct device_node *np,
+	const char *phandle_name,
+	int index)
+{
+	if (!np || index || strcmp(phandle_name, "memory-region"))
+		return NULL;
+
+	return np->memory_region;
+}
+
+static inline int of_address_to_resource(struct device_node *np,
+					 int index,
+					 struct resource *r)
+{
+	if (!np || index)
+		return -EINVAL;
+
+	*r = np->reg;
+
+	return 0;
+}
+
+#endif /* _HOST_LINUX_OF_ADDRESS_H_ */
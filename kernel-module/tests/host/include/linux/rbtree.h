@@ -0,0 +1,202 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-in for the kernel header of the same name. The tree isn't
+ * balanced, which only matters for speed: the order of the nodes and the
+ * interface are the kernel's.
+ */
+
+#ifndef _HOST_LINUX_RBTREE_H_
+#define _HOST_LINUX_RBTREE_H_
+
+#include "../host_kernel.h"
+
+struct rb_node {
+	struct rb_node *parent;
+	struct rb_node *rb_left;
+	struct rb_node *rb_right;
+};
+
+struct rb_root {
+	struct rb_node *rb_node;
+};
+
+#define RB_ROOT                 ((struct rb_root) { NULL })
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+#define rb_entry_safe(ptr, type, member) \
+	((ptr) ? rb_entry(ptr, type, member) : NULL)
+
+static inline void rb_link_node(struct rb_node *node,
+				struct rb_node *parent,
+				struct rb_node **link)
+{
+	node->parent = parent;
+	node->rb_left = NULL;
+	node->rb_right = NULL;
+	*link = node;
+}
+
+static inline void rb_insert_color(struct rb_node *node,
+				   struct rb_root *root)
+{
+}
+
+static inline void host_rb_replace(struct rb_node *old,
+				   struct rb_node *new,
+				   struct rb_root *root)
+{
+	struct rb_node *parent = old->parent;
+
+	if (!parent)
+		root->rb_node = new;
+	else if (parent->rb_left == old)
+		parent->rb_left = new;
+	else
+		parent->rb_right = new;
+
+	if (new)
+		new->parent = parent;
+}
+
+static inline void rb_erase(struct rb_node *node,
+			    struct rb_root *root)
+{
+	struct rb_node *next;
+
+	if (!node->rb_left) {
+		host_rb_replace(node, node->rb_right, root);
+	} else if (!node->rb_right) {
+		host_rb_replace(node, node->rb_left, root);
+	} else {
+		/* Replace the node by its successor */
+		next = node->rb_right;
+		while (next->rb_left)
+			next = next->rb_left;
+
+		if (next->parent != node) {
+			host_rb_replace(next, next->rb_right, root);
+			next->rb_right = node->rb_right;
+			next->rb_right->parent = next;
+		}
+
+		host_rb_replace(node, next, root);
+		next->rb_left = node->rb_left;
+		next->rb_left->parent = next;
+	}
+}
+
+static inline struct rb_node *rb_first(const struct rb_root *root)
+{
+	struct rb_node *n = root->rb_node;
+
+	while (n && n->rb_left)
+		n = n->rb_left;
+
+	return n;
+}
+
+static inline struct rb_node *rb_last(const struct rb_root *root)
+{
+	struct rb_node *n = root->rb_node;
+
+	while (n && n->rb_right)
+		n = n->rb_right;
+
+	return n;
+}
+
+static inline struct rb_node *rb_next(const struct rb_node *node)
+{
+	struct rb_node *n;
+
+	if (node->rb_right) {
+		n = node->rb_right;
+		while (n->rb_left)
+			n = n->rb_left;
+
+		return n;
+	}
+
+	while (node->parent && node == node->parent->rb_right)
+		node = node->parent;
+
+	return node->parent;
+}
+
+static inline struct rb_node *rb_prev(const struct rb_node *node)
+{
+	struct rb_node *n;
+
+	if (node->rb_left) {
+		n = node->rb_left;
+		while (n->rb_right)
+			n = n->rb_right;
+
+		return n;
+	}
+
+	while (node->parent && node == node->parent->rb_left)
+		node = node->parent;
+
+	return node->parent;
+}
+
+static inline struct rb_node *host_rb_left_deepest(struct rb_node *node)
+{
+	for (;;) {
+		if (node->rb_left)
+			node = node->rb_left;
+		else if (node->rb_right)
+			node = node->rb_right;
+		else
+			return node;
+	}
+}
+
+static inline struct rb_node *rb_first_postorder(const struct rb_root *root)
+{
+	return root->rb_node ? host_rb_left_deepest(root->rb_node) : NULL;
+}
+
+static inline struct rb_node *rb_next_postorder(const struct rb_node *node)
+{
+	struct rb_node *parent;
+
+	if (!node)
+		return NULL;
+
+	parent = node->parent;
+	if (parent && node == parent->rb_left && parent->rb_right)
+		return host_rb_left_deepest(parent->rb_right);
+
+	return parent;
+}
+
+#define rbtree_postorder_for_each_entry_safe(pos, n, root, field)	\
+	for (pos = rb_entry_safe(rb_first_postorder(root),		\
+				 __typeof__(*pos), field);		\
+	     pos && ({ n = rb_entry_safe(rb_next_postorder(&pos->field), \
+					 __typeof__(*pos), field); 1; }); \
+	     pos = n)
+
+#endif /* _HOST_LINUX_RBTREE_H_ */
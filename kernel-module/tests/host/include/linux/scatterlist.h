@@ -0,0 +1,197 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Host stand-in for the kernel header of the same name, with the streaming
+ * DMA API on scatter-gather tables of linux/dma-mapping.h. DMA addresses are
+ * the physical addresses and syncs are only counted.
+ */
+
+#ifndef _HOST_LINUX_SCATTERLIST_H_
+#define _HOST_LINUX_SCATTERLIST_H_
+
+#include "mm.h"
+
+enum dma_data_direction {
+	DMA_BIDIRECTIONAL,
+	DMA_TO_DEVICE,
+	DMA_FROM_DEVICE,
+};
+
+struct scatterlist {
+	struct page  *page;
+	unsigned int offset;
+	unsigned int length;
+	dma_addr_t   dma_address;
+	unsigned int dma_length;
+	bool         last;
+};
+
+struct sg_table {
+	struct scatterlist *sgl;
+	unsigned int       nents;
+	unsigned int       orig_nents;
+};
+
+#define sg_dma_address(sg)      ((sg)->dma_address)
+#define sg_dma_len(sg)          ((sg)->dma_length)
+
+static inline struct scatterlist *sg_next(struct scatterlist *sg)
+{
+	return sg->last ? NULL : sg + 1;
+}
+
+#define for_each_sg(sglist, sg, nr, i)					\
+	for (i = 0, sg = (sglist); i < (nr); ++i, sg = sg_next(sg))
+
+/* Physically contiguous pages are merged in one entry, like the kernel does */
+static inline int sg_alloc_table_from_pages(struct sg_table *sgt,
+					    struct page **pages,
+					    unsigned int n_pages,
+					    unsigned int offset,
+					    unsigned long size,
+					    gfp_t gfp)
+{
+	struct scatterlist *sg = NULL;
+	unsigned int nents = 0;
+	unsigned int i;
+
+	BUG_ON(!n_pages || offset || size != n_pages * PAGE_SIZE);
+
+	sgt->sgl = kzalloc(n_pages * sizeof(*sgt->sgl), gfp);
+	if (!sgt->sgl)
+		return -ENOMEM;
+
+	for (i = 0; i < n_pages; ++i) {
+		if (sg && page_to_pfn(pages[i]) ==
+		    page_to_pfn(sg->page) + sg->length / PAGE_SIZE) {
+			sg->length += PAGE_SIZE;
+			continue;
+		}
+
+		sg = &sgt->sgl[nents++];
+		sg->page = pages[i];
+		sg->length = PAGE_SIZE;
+	}
+
+	sgt->sgl[nents - 1].last = true;
+	sgt->nents = nents;
+	sgt->orig_nents = nents;
+
+	return 0;
+}
+
+static inline void sg_free_table(struct sg_table *sgt)
+{
+	kfree(sgt->sgl);
+	sgt->sgl = NULL;
+}
+
+/* Counts of the syncs of scatter-gather entries and single mappings */
+struct host_dma_sg_stats {
+	long num_maps;
+	long num_unmaps;
+	long num_syncs_for_device;
+	long num_syncs_for_cpu;
+	u64  bytes_synced_for_device;
+	u64  bytes_synced_for_cpu;
+	/* DMA address of the last single mapping synced */
+	dma_addr_t last_sync_addr;
+};
+
+static struct host_dma_sg_stats host_dma_sg_stats;
+
+static inline int dma_map_sg(struct device *dev,
+			     struct scatterlist *sgl,
+			     int nents,
+			     enum dma_data_direction dir)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sgl, sg, nents, i) {
+		sg->dma_address = page_to_phys(sg->page) + sg->offset;
+		sg->dma_length = sg->length;
+	}
+
+	++host_dma_sg_stats.num_maps;
+
+	return nents;
+}
+
+static inline void dma_unmap_sg(struct device *dev,
+				struct scatterlist *sgl,
+				int nents,
+				enum dma_data_direction dir)
+{
+	++host_dma_sg_stats.num_unmaps;
+}
+
+static inline void dma_sync_sg_for_device(struct device *dev,
+					  struct scatterlist *sgl,
+					  int nents,
+					  enum dma_data_direction dir)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sgl, sg, nents, i) {
+		++host_dma_sg_stats.num_syncs_for_device;
+		host_dma_sg_stats.bytes_synced_for_device += sg->length;
+	}
+}
+
+static inline void dma_sync_sg_for_cpu(struct device *dev,
+				       struct scatterlist *sgl,
+				       int nents,
+				       enum dma_data_direction dir)
+{
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(sgl, sg, nents, i) {
+		++host_dma_sg_stats.num_syncs_for_cpu;
+		host_dma_sg_stats.bytes_synced_for_cpu += sg->length;
+	}
+}
+
+static inline void dma_sync_single_for_device(struct device *dev,
+					      dma_addr_t addr,
+					      size_t size,
+					      enum dma_data_direction dir)
+{
+	++host_dma_sg_stats.num_syncs_for_device;
+	host_dma_sg_stats.bytes_synced_for_device += size;
+	host_dma_sg_stats.last_sync_addr = addr;
+}
+
+static inline void dma_sync_single_for_cpu(struct device *dev,
+					   dma_addr_t addr,
+					   size_t size,
+					   enum dma_data_direction dir)
+{
+	++host_dma_sg_stats.num_syncs_for_cpu;
+	host_dma_sg_stats.bytes_synced_for_cpu += size;
+	host_dma_sg_stats.last_sync_addr = addr;
+}
+
+#endif /* _HOST_LINUX_SCATTERLIST_H_ */
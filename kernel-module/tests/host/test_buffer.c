@@ -0,0 +1,387 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the cache maintenance of buffers: the ownership state machine of
+ * ethosn_buffer.c is checked against a model of what the CPU and the device
+ * can see of the buffer, for random sequences of accesses.
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_dma.c"
+#include "../../ethosn_buffer.c"
+
+#include "fake_dma.h"
+
+#define BUF_SIZE        4096
+
+static const u32 access_rw = ETHOSN_CPU_ACCESS_READ | ETHOSN_CPU_ACCESS_WRITE;
+
+struct test_device {
+	struct ethosn_device ethosn;
+	struct device        dev;
+	struct ethosn_core   core;
+	struct ethosn_core   *cores[1];
+};
+
+int ethosn_log_uapi(struct ethosn_core *core,
+		    uint32_t ioctl,
+		    void *data,
+		    size_t length)
+{
+	return 0;
+}
+
+static void test_device_init(struct test_device *td)
+{
+	memset(td, 0, sizeof(*td));
+	td->dev.name = "ethosn";
+	td->ethosn.dev = &td->dev;
+	td->ethosn.num_cores = 1;
+	td->ethosn.core = td->cores;
+	td->ethosn.allocator = &fake_dma_allocator;
+	mutex_init(&td->ethosn.mutex);
+	td->core.parent = &td->ethosn;
+	td->core.dev = &td->dev;
+	td->core.allocator = &fake_dma_allocator;
+	td->cores[0] = &td->core;
+	memset(&fake_dma_stats, 0, sizeof(fake_dma_stats));
+}
+
+static struct ethosn_buffer *buffer_create(struct test_device *td,
+					   int *fd)
+{
+	struct ethosn_buffer_req req = { .size = BUF_SIZE, .flags = MB_RDWR };
+
+	*fd = ethosn_buffer_register(&td->ethosn, &req);
+	if (*fd < 0)
+		return NULL;
+
+	return host_fds[*fd]->private_data;
+}
+
+/* What user space does with the ioctls */
+static int cpu_access(int fd,
+		      unsigned int cmd,
+		      u32 flags)
+{
+	struct ethosn_buffer_cpu_access access = { .flags = flags };
+	struct file *file = host_fds[fd];
+
+	return file->f_op->unlocked_ioctl(file, cmd, (unsigned long)&access);
+}
+
+static int cpu_begin(int fd,
+		     u32 flags)
+{
+	return cpu_access(fd, ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN, flags);
+}
+
+static int cpu_end(int fd,
+		   u32 flags)
+{
+	return cpu_access(fd, ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END, flags);
+}
+
+static void expect_released(void)
+{
+	HOST_EXPECT(host_num_files == 0);
+	HOST_EXPECT(host_num_allocs == 0);
+	HOST_EXPECT(fake_dma_stats.num_allocs == fake_dma_stats.num_frees);
+	HOST_EXPECT(fake_dma_stats.num_maps == fake_dma_stats.num_unmaps);
+	HOST_EXPECT(host_num_warnings == 0);
+}
+
+/* Without brackets, the buffer is synced every time it changes hands */
+static void test_buffer_unbracketed(void)
+{
+	struct test_device td;
+	struct ethosn_buffer *buf;
+	int fd;
+
+	test_device_init(&td);
+	buf = buffer_create(&td, &fd);
+	HOST_ASSERT(buf);
+
+	ethosn_buffer_sync_for_device(buf);
+	ethosn_buffer_device_done(buf, true);
+	ethosn_buffer_sync_for_device(buf);
+	ethosn_buffer_device_done(buf, false);
+
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_device == 2);
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_cpu == 1);
+	HOST_EXPECT(buf->owner == ETHOSN_BUFFER_OWNER_DEVICE);
+
+	host_close(fd);
+	expect_released();
+}
+
+/* An output which is only read by the CPU is never cleaned again */
+static void test_buffer_bracketed_output(void)
+{
+	struct test_device td;
+	struct ethosn_buffer *buf;
+	int fd;
+	int i;
+
+	test_device_init(&td);
+	buf = buffer_create(&td, &fd);
+	HOST_ASSERT(buf);
+
+	for (i = 0; i < 3; ++i) {
+		HOST_EXPECT(cpu_begin(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+		HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+		ethosn_buffer_sync_for_device(buf);
+		ethosn_buffer_device_done(buf, true);
+	}
+
+	HOST_EXPECT(cpu_begin(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+
+	/* Only the initial clean, and one invalidate per inference */
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_device == 1);
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_cpu == 3);
+
+	HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+	host_close(fd);
+	expect_released();
+}
+
+/*
+ * User space began an access while the inference ran, then the device wrote
+ * the buffer. The next access must see what the device wrote.
+ */
+static void test_buffer_device_done_during_access(void)
+{
+	struct test_device td;
+	struct ethosn_buffer *buf;
+	int fd;
+
+	test_device_init(&td);
+	buf = buffer_create(&td, &fd);
+	HOST_ASSERT(buf);
+
+	HOST_EXPECT(cpu_begin(fd, access_rw) == 0);
+	HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_WRITE) == 0);
+	ethosn_buffer_sync_for_device(buf);
+
+	HOST_EXPECT(cpu_begin(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_cpu == 0);
+	ethosn_buffer_device_done(buf, true);
+	HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+
+	HOST_EXPECT(cpu_begin(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+	HOST_EXPECT(fake_dma_stats.num_syncs_for_cpu == 1);
+	HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_READ) == 0);
+
+	host_close(fd);
+	expect_released();
+}
+
+static void test_buffer_bad_access(void)
+{
+	struct test_device td;
+	struct ethosn_buffer *buf;
+	struct file *file;
+	int fd;
+
+	test_device_init(&td);
+	buf = buffer_create(&td, &fd);
+	HOST_ASSERT(buf);
+	file = host_fds[fd];
+
+	HOST_EXPECT(cpu_begin(fd, 0x4) == -EINVAL);
+	HOST_EXPECT(cpu_end(fd, 0x4) == -EINVAL);
+	HOST_EXPECT(file->f_op->unlocked_ioctl(
+			    file, ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN,
+			    (unsigned long)HOST_BAD_USER_PTR) == -EFAULT);
+
+	/* Ending an access the device owns the buffer for */
+	ethosn_buffer_sync_for_device(buf);
+	HOST_EXPECT(cpu_end(fd, ETHOSN_CPU_ACCESS_WRITE) == -EINVAL);
+	HOST_EXPECT(!buf->cpu_dirty);
+
+	host_close(fd);
+	expect_released();
+}
+
+/*
+ * Model of what each side can see. Stale data is data written by one side
+ * which hasn't been made visible to the other yet by cache maintenance.
+ */
+struct coherence {
+	bool cpu_stale;
+	bool device_stale;
+	bool running;
+	bool in_access;
+	bool cpu_wrote;
+	long num_syncs_for_cpu;
+	long num_syncs_for_device;
+	long num_redundant_syncs;
+};
+
+/* Account the cache maintenance done by the call which just returned */
+static void coherence_update(struct coherence *c,
+			     const struct ethosn_buffer *buf)
+{
+	if (fake_dma_stats.num_syncs_for_cpu != c->num_syncs_for_cpu) {
+		if (buf->explicit_sync && !c->cpu_stale)
+			++c->num_redundant_syncs;
+
+		c->cpu_stale = false;
+		c->num_syncs_for_cpu = fake_dma_stats.num_syncs_for_cpu;
+	}
+
+	if (fake_dma_stats.num_syncs_for_device != c->num_syncs_for_device) {
+		if (buf->explicit_sync && !c->device_stale)
+			++c->num_redundant_syncs;
+
+		c->device_stale = false;
+		c->num_syncs_for_device = fake_dma_stats.num_syncs_for_device;
+	}
+}
+
+/*
+ * One random step of a well behaved user of the buffer, which either brackets
+ * all its accesses or none of them.
+ */
+static void coherence_step(struct coherence *c,
+			   struct ethosn_buffer *buf,
+			   int fd,
+			   bool bracketed)
+{
+	u32 op = host_rand_below(5);
+
+	if (!bracketed && op < 3) {
+		/* Access the mapping, when the device isn't using it */
+		if (c->running)
+			return;
+
+		HOST_EXPECT(!c->cpu_stale);
+		if (op == 1)
+			c->device_stale = true;
+
+		return;
+	}
+
+	switch (op) {
+	case 0:
+		/* Begin an access, possibly while an inference runs */
+		if (c->in_access)
+			break;
+
+		HOST_EXPECT(cpu_begin(fd, host_rand_below(4)) == 0);
+		coherence_update(c, buf);
+		c->in_access = true;
+		c->cpu_wrote = false;
+
+		/* What the device wrote before now must be visible */
+		HOST_EXPECT(!c->cpu_stale);
+		break;
+	case 1:
+		/* Write inside the access, when the device isn't using it */
+		if (!c->in_access || c->running)
+			break;
+
+		c->cpu_wrote = true;
+		c->device_stale = true;
+		break;
+	case 2:
+		if (!c->in_access)
+			break;
+
+		HOST_EXPECT(cpu_end(fd, c->cpu_wrote ?
+				    ETHOSN_CPU_ACCESS_WRITE :
+				    host_rand_below(2)) == 0);
+		coherence_update(c, buf);
+		c->in_access = false;
+		break;
+	case 3:
+		/* Start an inference once the access has ended */
+		if (c->running || c->in_access)
+			break;
+
+		ethosn_buffer_sync_for_device(buf);
+		coherence_update(c, buf);
+		c->running = true;
+		HOST_EXPECT(!c->device_stale);
+		break;
+	case 4:
+		if (!c->running)
+			break;
+
+		/* The buffer is an output or an input of the inference */
+		if (host_rand_below(2)) {
+			c->cpu_stale = true;
+			ethosn_buffer_device_done(buf, true);
+		} else {
+			ethosn_buffer_device_done(buf, false);
+		}
+
+		coherence_update(c, buf);
+		c->running = false;
+		break;
+	}
+}
+
+static void test_buffer_coherence_fuzz(void)
+{
+	int iteration;
+
+	for (iteration = 0; iteration < 200; ++iteration) {
+		/* A new buffer counts as written by the CPU */
+		struct coherence c = { .device_stale = true };
+		bool bracketed = iteration % 4 != 0;
+		struct test_device td;
+		struct ethosn_buffer *buf;
+		int fd;
+		int step;
+
+		test_device_init(&td);
+		buf = buffer_create(&td, &fd);
+		HOST_ASSERT(buf);
+
+		for (step = 0; step < 500; ++step)
+			coherence_step(&c, buf, fd, bracketed);
+
+		HOST_EXPECT(buf->explicit_sync == bracketed);
+
+		/* Bracketed buffers are only synced when they have to be */
+		HOST_EXPECT(c.num_redundant_syncs == 0);
+
+		host_close(fd);
+		expect_released();
+	}
+}
+
+int main(void)
+{
+	host_srand();
+
+	HOST_RUN(test_buffer_unbracketed);
+	HOST_RUN(test_buffer_bracketed_output);
+	HOST_RUN(test_buffer_device_done_during_access);
+	HOST_RUN(test_buffer_bad_access);
+	HOST_RUN(test_buffer_coherence_fuzz);
+
+	return host_test_result();
+}
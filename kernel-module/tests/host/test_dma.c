@@ -0,0 +1,246 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the ranges ethosn_dma.c passes to the allocators, in particular for
+ * the ring buffers of the mailbox queues.
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_dma.c"
+
+#include "fake_dma.h"
+
+#define RING_OFFSET     16
+#define RING_SIZE       64
+#define BUF_SIZE        (RING_OFFSET + RING_SIZE)
+
+static struct ethosn_dma_info *dma_info;
+
+static void ranges_start(void)
+{
+	memset(fake_dma_ranges, 0, sizeof(fake_dma_ranges));
+	fake_dma_num_ranges = 0;
+}
+
+static bool range_is(int i,
+		     bool for_device,
+		     size_t offset,
+		     size_t size)
+{
+	return i < fake_dma_num_ranges &&
+	       fake_dma_ranges[i].for_device == for_device &&
+	       fake_dma_ranges[i].offset == offset &&
+	       fake_dma_ranges[i].size == size;
+}
+
+static void ring_sync(size_t start,
+		      size_t size,
+		      bool for_device)
+{
+	ranges_start();
+
+	if (for_device)
+		ethosn_dma_sync_ring_for_device(&fake_dma_allocator, dma_info,
+						RING_OFFSET, RING_SIZE, start,
+						size);
+	else
+		ethosn_dma_sync_ring_for_cpu(&fake_dma_allocator, dma_info,
+					     RING_OFFSET, RING_SIZE, start,
+					     size);
+}
+
+static void test_dma_sync_ring_unwrapped(void)
+{
+	ring_sync(8, 10, true);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + 8, 10));
+
+	ring_sync(8, 10, false);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, false, RING_OFFSET + 8, 10));
+
+	/* Ending exactly at the end of the ring doesn't wrap */
+	ring_sync(RING_SIZE - 10, 10, true);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + RING_SIZE - 10, 10));
+
+	/* Nor does the whole ring from its start */
+	ring_sync(0, RING_SIZE, true);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET, RING_SIZE));
+}
+
+static void test_dma_sync_ring_wrapped(void)
+{
+	ring_sync(RING_SIZE - 4, 10, true);
+	HOST_EXPECT(fake_dma_num_ranges == 2);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + RING_SIZE - 4, 4));
+	HOST_EXPECT(range_is(1, true, RING_OFFSET, 6));
+
+	ring_sync(RING_SIZE - 1, 2, false);
+	HOST_EXPECT(fake_dma_num_ranges == 2);
+	HOST_EXPECT(range_is(0, false, RING_OFFSET + RING_SIZE - 1, 1));
+	HOST_EXPECT(range_is(1, false, RING_OFFSET, 1));
+
+	/* The whole ring from its middle is synced once, in two ranges */
+	ring_sync(8, RING_SIZE, true);
+	HOST_EXPECT(fake_dma_num_ranges == 2);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + 8, RING_SIZE - 8));
+	HOST_EXPECT(range_is(1, true, RING_OFFSET, 8));
+
+	/* Indices are wrapped to the ring, like the queue indices */
+	ring_sync(RING_SIZE + 8, 10, true);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + 8, 10));
+}
+
+static void test_dma_sync_ring_limits(void)
+{
+	/* Nothing to sync */
+	ring_sync(8, 0, true);
+	HOST_EXPECT(fake_dma_num_ranges == 0);
+
+	/* More than the ring is the whole ring */
+	ring_sync(8, RING_SIZE + 1, true);
+	HOST_EXPECT(fake_dma_num_ranges == 2);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + 8, RING_SIZE - 8));
+	HOST_EXPECT(range_is(1, true, RING_OFFSET, 8));
+
+	/* An empty ring syncs nothing */
+	ranges_start();
+	ethosn_dma_sync_ring_for_device(&fake_dma_allocator, dma_info,
+					RING_OFFSET, 0, 8, 10);
+	HOST_EXPECT(fake_dma_num_ranges == 0);
+
+	/* Ranges are still clamped to the buffer */
+	ranges_start();
+	ethosn_dma_sync_ring_for_device(&fake_dma_allocator, dma_info,
+					RING_OFFSET, RING_SIZE * 2, 60, 10);
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, true, RING_OFFSET + 60, BUF_SIZE -
+			     (RING_OFFSET + 60)));
+}
+
+/* What the mailbox syncs of the data array of a queue between its indices */
+static void test_dma_sync_ring_queue(void)
+{
+	struct ethosn_dma_info *queue_info =
+		ethosn_dma_alloc(&fake_dma_allocator,
+				 sizeof(struct ethosn_queue) + RING_SIZE,
+				 GFP_KERNEL);
+	struct ethosn_queue *queue;
+	const size_t data = offsetof(struct ethosn_queue, data);
+
+	HOST_ASSERT(queue_info);
+	queue = queue_info->cpu_addr;
+	queue->capacity = RING_SIZE;
+
+	/* Empty, read == write */
+	queue->read = 24;
+	queue->write = 24;
+	ranges_start();
+	ethosn_dma_sync_ring_for_cpu(&fake_dma_allocator, queue_info, data,
+				     queue->capacity, queue->read,
+				     ethosn_queue_get_size(queue));
+	HOST_EXPECT(fake_dma_num_ranges == 0);
+
+	/* Full, the write index is just behind the read index */
+	queue->read = 24;
+	queue->write = 23;
+	ranges_start();
+	ethosn_dma_sync_ring_for_cpu(&fake_dma_allocator, queue_info, data,
+				     queue->capacity, queue->read,
+				     ethosn_queue_get_size(queue));
+	HOST_EXPECT(fake_dma_num_ranges == 2);
+	HOST_EXPECT(range_is(0, false, data + 24, RING_SIZE - 24));
+	HOST_EXPECT(range_is(1, false, data, 23));
+
+	/* The write index wrapped to 0 */
+	queue->read = 40;
+	queue->write = 0;
+	ranges_start();
+	ethosn_dma_sync_ring_for_cpu(&fake_dma_allocator, queue_info, data,
+				     queue->capacity, queue->read,
+				     ethosn_queue_get_size(queue));
+	HOST_EXPECT(fake_dma_num_ranges == 1);
+	HOST_EXPECT(range_is(0, false, data + 40, RING_SIZE - 40));
+
+	ethosn_dma_free(&fake_dma_allocator, queue_info);
+}
+
+/* Every byte asked for is synced exactly once, and no other */
+static void test_dma_sync_ring_fuzz(void)
+{
+	u8 synced[BUF_SIZE];
+	int iter;
+
+	for (iter = 0; iter < 10000; ++iter) {
+		bool for_device = iter & 1;
+		size_t start = host_rand_below(3 * RING_SIZE);
+		size_t size = host_rand_below(RING_SIZE + 2);
+		size_t expected = min_t(size_t, size, RING_SIZE);
+		size_t i;
+		int r;
+
+		ring_sync(start, size, for_device);
+		HOST_ASSERT(fake_dma_num_ranges <= 2);
+
+		memset(synced, 0, sizeof(synced));
+		for (r = 0; r < fake_dma_num_ranges; ++r) {
+			HOST_ASSERT(fake_dma_ranges[r].for_device == for_device);
+			HOST_ASSERT(fake_dma_ranges[r].size > 0);
+			for (i = 0; i < fake_dma_ranges[r].size; ++i)
+				++synced[fake_dma_ranges[r].offset + i];
+		}
+
+		for (i = 0; i < BUF_SIZE; ++i) {
+			size_t index = (i - RING_OFFSET - start % RING_SIZE +
+					RING_SIZE) % RING_SIZE;
+			bool wanted = i >= RING_OFFSET && index < expected;
+
+			HOST_ASSERT(synced[i] == wanted);
+		}
+	}
+}
+
+int main(void)
+{
+	host_srand();
+
+	memset(&fake_dma_stats, 0, sizeof(fake_dma_stats));
+	dma_info = ethosn_dma_alloc(&fake_dma_allocator, BUF_SIZE, GFP_KERNEL);
+	if (!dma_info)
+		return EXIT_FAILURE;
+
+	HOST_RUN(test_dma_sync_ring_unwrapped);
+	HOST_RUN(test_dma_sync_ring_wrapped);
+	HOST_RUN(test_dma_sync_ring_limits);
+	HOST_RUN(test_dma_sync_ring_queue);
+	HOST_RUN(test_dma_sync_ring_fuzz);
+
+	ethosn_dma_free(&fake_dma_allocator, dma_info);
+	HOST_EXPECT(host_num_allocs == 0);
+
+	return host_test_result();
+}
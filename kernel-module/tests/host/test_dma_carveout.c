@@ -0,0 +1,344 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the pool the carveout allocator sub-allocates small buffers from,
+ * on top of write-combined buffers which are host memory.
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_dma.c"
+#include "../../ethosn_dma_carveout.c"
+
+/* None of the devices of these tests are behind an IOMMU */
+struct ethosn_dma_allocator *ethosn_dma_iommu_allocator_create(
+	struct device *dev)
+{
+	return NULL;
+}
+
+#define CHUNK_PAGES     (CARVEOUT_CHUNK_SIZE / PAGE_SIZE)
+#define TRACE_MAX_LIVE  512
+
+struct test_carveout {
+	struct device_node          region;
+	struct device_node          node;
+	struct device               dev;
+	struct ethosn_dma_allocator *allocator;
+	struct carveout_pool        *pool;
+};
+
+static void carveout_create(struct test_carveout *t)
+{
+	memset(t, 0, sizeof(*t));
+	t->region.reg.start = 0x80000000;
+	t->region.reg.end = 0x80000000 + 256 * 1024 * 1024 - 1;
+	t->node.memory_region = &t->region;
+	t->dev.name = "ethosn";
+	t->dev.of_node = &t->node;
+	t->allocator = ethosn_dma_allocator_create(&t->dev);
+	if (!IS_ERR_OR_NULL(t->allocator))
+		t->pool = &container_of(t->allocator,
+					struct ethosn_allocator_internal,
+					allocator)->pool;
+}
+
+static void expect_released(void)
+{
+	HOST_EXPECT(host_num_dma_wc_allocs == 0);
+	HOST_EXPECT(host_num_allocs == 0);
+	HOST_EXPECT(host_num_warnings == 0);
+	HOST_EXPECT(host_num_dev_errors == 0);
+}
+
+/*
+ * Checks the blocks of every chunk tile it, that free blocks are always merged
+ * and are in the free list of their size class, and that the counters of the
+ * pool agree. Returns the largest free block.
+ */
+static size_t pool_check(struct carveout_pool *pool)
+{
+	struct carveout_chunk *chunk;
+	struct carveout_block *block;
+	unsigned int nr_chunks = 0;
+	unsigned int nr_empty_chunks = 0;
+	unsigned long nr_allocs = 0;
+	unsigned long nr_free_blocks = 0;
+	size_t pooled_bytes = 0;
+	size_t free_bytes = 0;
+	size_t largest_free = 0;
+	int k;
+
+	list_for_each_entry(chunk, &pool->chunks, node) {
+		unsigned int chunk_allocs = 0;
+		size_t offset = 0;
+		bool prev_free = false;
+
+		list_for_each_entry(block, &chunk->blocks, chunk_node) {
+			HOST_EXPECT(block->chunk == chunk);
+			HOST_EXPECT(block->offset == offset);
+			HOST_EXPECT(block->size &&
+				    IS_ALIGNED(block->size, PAGE_SIZE));
+			HOST_EXPECT(!(prev_free && block->free));
+
+			if (block->free) {
+				free_bytes += block->size;
+				largest_free = max(largest_free, block->size);
+			} else {
+				pooled_bytes += block->size;
+				++chunk_allocs;
+			}
+
+			offset += block->size;
+			prev_free = block->free;
+		}
+
+		HOST_EXPECT(offset == CARVEOUT_CHUNK_SIZE);
+		HOST_EXPECT(chunk->nr_allocs == chunk_allocs);
+		nr_allocs += chunk_allocs;
+		nr_empty_chunks += !chunk_allocs;
+		++nr_chunks;
+	}
+
+	for (k = 0; k < CARVEOUT_NR_SIZE_CLASSES; ++k) {
+		list_for_each_entry(block, &pool->free_lists[k], free_node) {
+			HOST_EXPECT(block->free);
+			HOST_EXPECT(ilog2(block->size >> PAGE_SHIFT) == k);
+			++nr_free_blocks;
+		}
+	}
+
+	HOST_EXPECT(pool->nr_chunks == nr_chunks);
+	HOST_EXPECT(pool->nr_empty_chunks == nr_empty_chunks);
+	HOST_EXPECT(nr_empty_chunks <= 1);
+	HOST_EXPECT(pool->nr_pooled_allocs == nr_allocs);
+	HOST_EXPECT(pool->pooled_bytes == pooled_bytes);
+	HOST_EXPECT(pool->free_bytes == free_bytes);
+	HOST_EXPECT(nr_free_blocks <= nr_chunks + nr_allocs);
+	HOST_EXPECT(host_dma_wc_bytes == nr_chunks * CARVEOUT_CHUNK_SIZE);
+
+	return largest_free;
+}
+
+/* Fragmentation in percent, as reported by the print_stats operation */
+static unsigned long stats_fragmentation(struct test_carveout *t)
+{
+	static struct seq_file s;
+	unsigned long fragmentation;
+	const char *p;
+
+	memset(&s, 0, sizeof(s));
+	ethosn_dma_print_stats(t->allocator, &s);
+	p = strstr(s.buf, "fragmentation=");
+	if (!p || sscanf(p, "fragmentation=%lu%%", &fragmentation) != 1)
+		return ~0UL;
+
+	return fragmentation;
+}
+
+/* Freeing every other page fragments a chunk, and freeing the rest heals it */
+static void test_dma_carveout_coalesce(void)
+{
+	static struct carveout_block *blocks[CHUNK_PAGES];
+	struct carveout_block *block;
+	struct test_carveout t;
+	int i;
+
+	carveout_create(&t);
+	HOST_ASSERT(!IS_ERR_OR_NULL(t.allocator));
+
+	for (i = 0; i < CHUNK_PAGES; ++i) {
+		blocks[i] = carveout_pool_alloc(t.allocator, PAGE_SIZE,
+						GFP_KERNEL);
+		HOST_ASSERT(blocks[i]);
+	}
+
+	HOST_EXPECT(t.pool->nr_chunks == 1);
+	HOST_EXPECT(t.pool->free_bytes == 0);
+
+	for (i = 0; i < CHUNK_PAGES; i += 2)
+		carveout_pool_free(t.allocator, blocks[i]);
+
+	HOST_EXPECT(pool_check(t.pool) == PAGE_SIZE);
+	HOST_EXPECT(stats_fragmentation(&t) ==
+		    100 - 100 / (CHUNK_PAGES / 2));
+
+	/* No two free pages are contiguous, so this takes a new chunk */
+	block = carveout_pool_alloc(t.allocator, 2 * PAGE_SIZE, GFP_KERNEL);
+	HOST_ASSERT(block);
+	HOST_EXPECT(t.pool->nr_chunks == 2);
+	carveout_pool_free(t.allocator, block);
+	HOST_EXPECT(t.pool->nr_chunks == 2);
+	HOST_EXPECT(t.pool->nr_empty_chunks == 1);
+
+	/* Freeing the rest merges the chunk back into one block */
+	for (i = 1; i < CHUNK_PAGES; i += 2)
+		carveout_pool_free(t.allocator, blocks[i]);
+
+	HOST_EXPECT(pool_check(t.pool) == CARVEOUT_CHUNK_SIZE);
+	HOST_EXPECT(t.pool->nr_chunks == 1);
+	HOST_EXPECT(stats_fragmentation(&t) == 0);
+
+	ethosn_dma_allocator_destroy(t.allocator);
+	expect_released();
+}
+
+/* The bookkeeping is allocated with the gfp of the buffer */
+static void test_dma_carveout_gfp(void)
+{
+	static const size_t sizes[] = {
+		PAGE_SIZE, PAGE_SIZE, CARVEOUT_MAX_POOLED_SIZE
+	};
+	struct carveout_block *blocks[ARRAY_SIZE(sizes)];
+	struct test_carveout t;
+	int i;
+
+	carveout_create(&t);
+	HOST_ASSERT(!IS_ERR_OR_NULL(t.allocator));
+
+	host_alloc_expected_gfp = GFP_ATOMIC;
+	for (i = 0; i < ARRAY_SIZE(blocks); ++i) {
+		blocks[i] = carveout_pool_alloc(t.allocator, sizes[i],
+						GFP_ATOMIC);
+		HOST_EXPECT(blocks[i]);
+	}
+
+	host_alloc_expected_gfp = 0;
+	HOST_EXPECT(host_num_warnings == 0);
+	HOST_EXPECT(host_num_dev_errors == 0);
+
+	/* Failing any allocation of a new chunk fails cleanly */
+	for (i = 1; i <= 4; ++i) {
+		host_alloc_fail_countdown = i;
+		HOST_EXPECT(!carveout_pool_alloc(t.allocator,
+						 CARVEOUT_MAX_POOLED_SIZE,
+						 GFP_KERNEL));
+		host_alloc_fail_countdown = 0;
+		pool_check(t.pool);
+		HOST_EXPECT(t.pool->nr_chunks == 1);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(blocks); ++i)
+		carveout_pool_free(t.allocator, blocks[i]);
+
+	ethosn_dma_allocator_destroy(t.allocator);
+	expect_released();
+}
+
+/* Mostly single pages, like headers and mailboxes, sometimes much larger */
+static size_t trace_size(void)
+{
+	const uint32_t r = host_rand_below(10);
+
+	if (r < 6)
+		return PAGE_SIZE;
+
+	if (r < 9)
+		return (2 + host_rand_below(31)) * PAGE_SIZE;
+
+	return (33 + host_rand_below(CHUNK_PAGES / 2 - 32)) * PAGE_SIZE;
+}
+
+/*
+ * Replays a synthetic trace of buffers being allocated and freed in a random
+ * order, while the number of live buffers rises and falls. The pool must keep
+ * its invariants throughout, and the fragmentation must never make it hold
+ * more than twice the peak of the live bytes, besides the empty chunk it
+ * keeps. Freeing everything must leave that chunk as a single free block.
+ */
+static void test_dma_carveout_trace(void)
+{
+	static struct carveout_block *live[TRACE_MAX_LIVE];
+	struct test_carveout t;
+	size_t live_bytes = 0;
+	size_t peak_bytes = 0;
+	size_t largest_free;
+	int num_live = 0;
+	int target = 0;
+	int iter;
+	int i;
+
+	carveout_create(&t);
+	HOST_ASSERT(!IS_ERR_OR_NULL(t.allocator));
+
+	for (iter = 0; iter < 50000; ++iter) {
+		const unsigned int failures = host_test_failures;
+
+		/* Grow and shrink the live set in phases */
+		if (iter % 2000 == 0)
+			target = host_rand_below(TRACE_MAX_LIVE + 1);
+
+		if (num_live < target ||
+		    (num_live < TRACE_MAX_LIVE && !host_rand_below(4))) {
+			const size_t size = trace_size();
+
+			live[num_live] = carveout_pool_alloc(t.allocator, size,
+							     GFP_KERNEL);
+			HOST_ASSERT(live[num_live]);
+			HOST_EXPECT(live[num_live]->size == size);
+			live_bytes += size;
+			++num_live;
+		} else if (num_live) {
+			i = host_rand_below(num_live);
+			live_bytes -= live[i]->size;
+			carveout_pool_free(t.allocator, live[i]);
+			live[i] = live[--num_live];
+		}
+
+		peak_bytes = max(peak_bytes, live_bytes);
+		largest_free = pool_check(t.pool);
+		HOST_EXPECT(t.pool->pooled_bytes == live_bytes);
+		if (t.pool->free_bytes)
+			HOST_EXPECT(stats_fragmentation(&t) ==
+				    100 - largest_free * 100 /
+				    t.pool->free_bytes);
+		HOST_EXPECT((t.pool->nr_chunks - 1) * CARVEOUT_CHUNK_SIZE <=
+			    2 * peak_bytes);
+		if (host_test_failures != failures) {
+			fprintf(stderr, "trace failed at iteration %d\n",
+				iter);
+			break;
+		}
+	}
+
+	while (num_live)
+		carveout_pool_free(t.allocator, live[--num_live]);
+
+	HOST_EXPECT(pool_check(t.pool) == CARVEOUT_CHUNK_SIZE);
+	HOST_EXPECT(t.pool->nr_chunks == 1);
+	HOST_EXPECT(stats_fragmentation(&t) == 0);
+
+	ethosn_dma_allocator_destroy(t.allocator);
+	expect_released();
+}
+
+int main(void)
+{
+	host_srand();
+
+	HOST_RUN(test_dma_carveout_coalesce);
+	HOST_RUN(test_dma_carveout_gfp);
+	HOST_RUN(test_dma_carveout_trace);
+
+	return host_test_result();
+}
@@ -0,0 +1,607 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the IOMMU allocator on top of a fake IOMMU domain, which counts
+ * what the allocator maps, and a small fake physical memory.
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_dma.c"
+#include "../../ethosn_dma_iommu.c"
+
+/* Every allocator of these tests is created on a bus with an IOMMU */
+struct ethosn_dma_allocator *ethosn_dma_carveout_allocator_create(
+	struct device *dev)
+{
+	return NULL;
+}
+
+#define STREAM_PAGES    (IOMMU_ADDR_SIZE / PAGE_SIZE)
+/* Streams which map their free IOVA space to a page, see iommu_stream_init */
+#define NUM_GUARDED_STREAMS     3
+
+struct test_iommu {
+	struct device               dev;
+	struct iommu_domain         domain;
+	struct ethosn_dma_allocator *allocator;
+};
+
+/* Pages made unavailable by pages_fragment() */
+static bool pages_reserved[HOST_NR_PAGES];
+
+static void iommu_create(struct test_iommu *t)
+{
+	memset(t, 0, sizeof(*t));
+	t->dev.name = "ethosn";
+	t->dev.bus = &host_iommu_bus;
+	host_iommu_domain = &t->domain;
+	t->allocator = ethosn_dma_allocator_create(&t->dev);
+	memset(&t->domain, 0, sizeof(t->domain));
+	memset(&host_dma_sg_stats, 0, sizeof(host_dma_sg_stats));
+}
+
+static void iommu_destroy(struct test_iommu *t)
+{
+	ethosn_dma_allocator_destroy(t->allocator);
+	host_iommu_domain = NULL;
+}
+
+/*
+ * Only the first run pages of every run + gap pages of physical memory can be
+ * allocated, so that no allocation of more than run pages is contiguous.
+ */
+static void pages_fragment(unsigned long run,
+			   unsigned long gap)
+{
+	unsigned long pfn;
+
+	for (pfn = 0; pfn < HOST_NR_PAGES; ++pfn) {
+		if (pfn % (run + gap) < run || host_pages[pfn].used)
+			continue;
+
+		host_pages[pfn].used = true;
+		pages_reserved[pfn] = true;
+	}
+
+	host_max_page_order = ilog2(run);
+}
+
+static void pages_unfragment(void)
+{
+	unsigned long pfn;
+
+	for (pfn = 0; pfn < HOST_NR_PAGES; ++pfn) {
+		if (!pages_reserved[pfn])
+			continue;
+
+		host_pages[pfn].used = false;
+		pages_reserved[pfn] = false;
+	}
+
+	host_max_page_order = 31;
+}
+
+static struct sg_table *dma_info_sgt(struct ethosn_dma_info *dma_info)
+{
+	return &container_of(dma_info, struct ethosn_dma_info_internal,
+			     info)->sgt;
+}
+
+static void expect_released(void)
+{
+	HOST_EXPECT(host_num_pages == 0);
+	HOST_EXPECT(host_num_allocs == 0);
+	HOST_EXPECT(host_num_warnings == 0);
+	HOST_EXPECT(host_num_dev_errors == 0);
+}
+
+/* The streams which aren't for buffers map their whole IOVA space */
+static void test_dma_iommu_create(void)
+{
+	struct iommu_domain domain = { 0 };
+	struct device dev = { .name = "ethosn", .bus = &host_iommu_bus };
+	struct ethosn_dma_allocator *allocator;
+
+	host_iommu_domain = &domain;
+	allocator = ethosn_dma_allocator_create(&dev);
+	HOST_ASSERT(!IS_ERR_OR_NULL(allocator));
+	HOST_EXPECT(domain.num_maps == NUM_GUARDED_STREAMS * STREAM_PAGES);
+	HOST_EXPECT(host_num_pages == NUM_GUARDED_STREAMS);
+
+	ethosn_dma_allocator_destroy(allocator);
+	HOST_EXPECT(domain.num_unmaps == NUM_GUARDED_STREAMS * STREAM_PAGES);
+	host_iommu_domain = NULL;
+
+	/* A failed map unwinds the streams created so far */
+	memset(&domain, 0, sizeof(domain));
+	host_iommu_domain = &domain;
+	domain.map_fail_countdown = STREAM_PAGES + 10;
+	HOST_EXPECT(IS_ERR(ethosn_dma_allocator_create(&dev)));
+	HOST_EXPECT(domain.num_unmaps == domain.num_maps);
+	HOST_EXPECT(host_num_dev_errors == 1);
+	host_iommu_domain = NULL;
+	host_num_dev_errors = 0;
+
+	expect_released();
+}
+
+/* Each physically contiguous run of pages is mapped with one call */
+static void test_dma_iommu_map_runs(void)
+{
+	static const struct {
+		unsigned long run;
+		unsigned long gap;
+		size_t        size;
+		long          num_maps;
+	} cases[] = {
+		/* A single block of the largest order */
+		{ 1UL << IOMMU_MAX_ALLOC_ORDER, 0, 2 * 1024 * 1024, 1 },
+		/* Not a multiple of the page size */
+		{ 1UL << IOMMU_MAX_ALLOC_ORDER, 0, 3 * PAGE_SIZE + 1, 1 },
+		{ 4, 4, 16 * PAGE_SIZE, 4 },
+		{ 4, 4, 14 * PAGE_SIZE, 4 },
+		{ 1, 1, 16 * PAGE_SIZE, 16 },
+	};
+	struct test_iommu t;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cases); ++i) {
+		const size_t map_size =
+			min_t(size_t, cases[i].run * PAGE_SIZE,
+			      PAGE_ALIGN(cases[i].size));
+		struct ethosn_dma_info *dma_info;
+
+		iommu_create(&t);
+		pages_fragment(cases[i].run, cases[i].gap);
+
+		dma_info = ethosn_dma_alloc_and_map(t.allocator, cases[i].size,
+						    ETHOSN_PROT_READ,
+						    ETHOSN_STREAM_DMA,
+						    GFP_KERNEL);
+		HOST_ASSERT(!IS_ERR_OR_NULL(dma_info));
+		HOST_EXPECT(t.domain.num_maps == cases[i].num_maps);
+		HOST_EXPECT(t.domain.bytes_mapped ==
+			    PAGE_ALIGN(cases[i].size));
+		HOST_EXPECT(t.domain.max_map_size == map_size);
+		HOST_EXPECT(dma_info_sgt(dma_info)->orig_nents ==
+			    cases[i].num_maps);
+
+		/* A buffer stream doesn't remap its free IOVA space */
+		ethosn_dma_unmap_and_free(t.allocator, dma_info,
+					  ETHOSN_STREAM_DMA);
+		HOST_EXPECT(t.domain.num_maps == cases[i].num_maps);
+		HOST_EXPECT(t.domain.num_unmaps == 1);
+
+		pages_unfragment();
+		iommu_destroy(&t);
+		expect_released();
+	}
+}
+
+/* Unmapping from a guarded stream maps its pages back to the guard page */
+static void test_dma_iommu_map_guarded(void)
+{
+	struct ethosn_dma_info *dma_info;
+	struct test_iommu t;
+
+	iommu_create(&t);
+	pages_fragment(1, 1);
+
+	dma_info = ethosn_dma_alloc_and_map(t.allocator, 8 * PAGE_SIZE,
+					    ETHOSN_PROT_READ,
+					    ETHOSN_STREAM_WORKING_DATA,
+					    GFP_KERNEL);
+	HOST_ASSERT(!IS_ERR_OR_NULL(dma_info));
+	HOST_EXPECT(t.domain.num_unmaps == 1);
+	HOST_EXPECT(t.domain.num_maps == 8);
+
+	ethosn_dma_unmap_and_free(t.allocator, dma_info,
+				  ETHOSN_STREAM_WORKING_DATA);
+	HOST_EXPECT(t.domain.num_unmaps == 2);
+	HOST_EXPECT(t.domain.num_maps == 16);
+
+	pages_unfragment();
+	iommu_destroy(&t);
+	expect_released();
+}
+
+struct sync_counts {
+	long entries;
+	u64  bytes;
+};
+
+static struct sync_counts range_sync(struct test_iommu *t,
+				     struct ethosn_dma_info *dma_info,
+				     size_t offset,
+				     size_t size,
+				     bool for_device)
+{
+	const struct host_dma_sg_stats before = host_dma_sg_stats;
+	struct sync_counts counts;
+
+	if (for_device) {
+		ethosn_dma_sync_range_for_device(t->allocator, dma_info, offset,
+						 size);
+		counts.entries = host_dma_sg_stats.num_syncs_for_device -
+				 before.num_syncs_for_device;
+		counts.bytes = host_dma_sg_stats.bytes_synced_for_device -
+			       before.bytes_synced_for_device;
+	} else {
+		ethosn_dma_sync_range_for_cpu(t->allocator, dma_info, offset,
+					      size);
+		counts.entries = host_dma_sg_stats.num_syncs_for_cpu -
+				 before.num_syncs_for_cpu;
+		counts.bytes = host_dma_sg_stats.bytes_synced_for_cpu -
+			       before.bytes_synced_for_cpu;
+	}
+
+	return counts;
+}
+
+/* A range syncs the part of each scatter-gather entry it overlaps, no more */
+static void test_dma_iommu_sync_range(void)
+{
+	const size_t entry = 4 * PAGE_SIZE;
+	struct ethosn_dma_info *dma_info;
+	struct scatterlist *sgl;
+	struct sync_counts c;
+	struct test_iommu t;
+
+	iommu_create(&t);
+	pages_fragment(4, 4);
+
+	dma_info = ethosn_dma_alloc_and_map(t.allocator, 4 * entry,
+					    ETHOSN_PROT_READ, ETHOSN_STREAM_DMA,
+					    GFP_KERNEL);
+	HOST_ASSERT(!IS_ERR_OR_NULL(dma_info));
+	HOST_ASSERT(dma_info_sgt(dma_info)->orig_nents == 4);
+	sgl = dma_info_sgt(dma_info)->sgl;
+
+	c = range_sync(&t, dma_info, 0, 1, true);
+	HOST_EXPECT(c.entries == 1 && c.bytes == 1);
+	HOST_EXPECT(host_dma_sg_stats.last_sync_addr == sg_dma_address(&sgl[0]));
+
+	c = range_sync(&t, dma_info, PAGE_SIZE, 2 * PAGE_SIZE, false);
+	HOST_EXPECT(c.entries == 1 && c.bytes == 2 * PAGE_SIZE);
+	HOST_EXPECT(host_dma_sg_stats.last_sync_addr ==
+		    sg_dma_address(&sgl[0]) + PAGE_SIZE);
+
+	/* Ending at the end of an entry doesn't touch the next one */
+	c = range_sync(&t, dma_info, entry - 8, 8, true);
+	HOST_EXPECT(c.entries == 1 && c.bytes == 8);
+
+	c = range_sync(&t, dma_info, entry - 8, 16, true);
+	HOST_EXPECT(c.entries == 2 && c.bytes == 16);
+	HOST_EXPECT(host_dma_sg_stats.last_sync_addr == sg_dma_address(&sgl[1]));
+
+	c = range_sync(&t, dma_info, 4 * entry - 1, 1, false);
+	HOST_EXPECT(c.entries == 1 && c.bytes == 1);
+	HOST_EXPECT(host_dma_sg_stats.last_sync_addr ==
+		    sg_dma_address(&sgl[3]) + entry - 1);
+
+	c = range_sync(&t, dma_info, 0, 4 * entry, true);
+	HOST_EXPECT(c.entries == 4 && c.bytes == 4 * entry);
+
+	/* Clamped to the buffer by ethosn_dma.c */
+	c = range_sync(&t, dma_info, 4 * entry, 1, true);
+	HOST_EXPECT(c.entries == 0);
+
+	c = range_sync(&t, dma_info, 3 * entry, 2 * entry, true);
+	HOST_EXPECT(c.entries == 1 && c.bytes == entry);
+	HOST_EXPECT(host_dma_sg_stats.last_sync_addr == sg_dma_address(&sgl[3]));
+
+	ethosn_dma_unmap_and_free(t.allocator, dma_info, ETHOSN_STREAM_DMA);
+	pages_unfragment();
+	iommu_destroy(&t);
+	expect_released();
+}
+
+/* Random ranges of buffers with random runs of contiguous pages */
+static void test_dma_iommu_sync_range_fuzz(void)
+{
+	struct test_iommu t;
+	int iter;
+
+	iommu_create(&t);
+
+	for (iter = 0; iter < 200; ++iter) {
+		const unsigned long run = 1UL << host_rand_below(4);
+		const size_t size = 1 + host_rand_below(64 * PAGE_SIZE);
+		struct ethosn_dma_info *dma_info;
+		struct scatterlist *sg;
+		int step;
+		int i;
+
+		pages_fragment(run, 1 + host_rand_below(3));
+		dma_info = ethosn_dma_alloc_and_map(t.allocator, size,
+						    ETHOSN_PROT_READ,
+						    ETHOSN_STREAM_DMA,
+						    GFP_KERNEL);
+		HOST_ASSERT(!IS_ERR_OR_NULL(dma_info));
+
+		for (step = 0; step < 20; ++step) {
+			const size_t offset = host_rand_below(size);
+			const size_t len = 1 + host_rand_below(size - offset);
+			const bool for_device = host_rand_below(2);
+			struct sync_counts expected = { 0, len };
+			struct sync_counts c;
+			size_t start = 0;
+
+			for_each_sg(dma_info_sgt(dma_info)->sgl, sg,
+				    dma_info_sgt(dma_info)->orig_nents, i) {
+				if (start < offset + len &&
+				    start + sg->length > offset)
+					++expected.entries;
+
+				start += sg->length;
+			}
+
+			c = range_sync(&t, dma_info, offset, len, for_device);
+			HOST_ASSERT(c.entries == expected.entries);
+			HOST_ASSERT(c.bytes == expected.bytes);
+		}
+
+		ethosn_dma_unmap_and_free(t.allocator, dma_info,
+					  ETHOSN_STREAM_DMA);
+		pages_unfragment();
+	}
+
+	iommu_destroy(&t);
+	expect_released();
+}
+
+/* IOVA allocator */
+
+#define IOVA_PAGES      2048
+#define IOVA_MAX_ALLOCS 64
+
+static void iova_stream_init(struct ethosn_iommu_stream *stream)
+{
+	struct ethosn_iova_range *range = kzalloc(sizeof(*range), GFP_KERNEL);
+
+	memset(stream, 0, sizeof(*stream));
+	stream->free_by_addr = RB_ROOT;
+	stream->free_by_size = RB_ROOT;
+	stream->allocated = RB_ROOT;
+	stream->addr_base = IOMMU_DMA_ADDR_BASE;
+	stream->nr_pages = IOVA_PAGES;
+	stream->nr_free_pages = IOVA_PAGES;
+	spin_lock_init(&stream->lock);
+
+	range->size = IOVA_PAGES;
+	iova_insert_free(stream, range);
+}
+
+static unsigned long iova_align(unsigned long nr_pages)
+{
+	return 1UL << min_t(unsigned int, ilog2(nr_pages),
+			    IOMMU_MAX_ALLOC_ORDER);
+}
+
+/*
+ * The trees agree with each other and with the pages the test allocated: free
+ * ranges are sorted, never overlap nor touch (they would have been merged),
+ * and together with the allocations cover the stream exactly once.
+ */
+static bool iova_check(struct ethosn_iommu_stream *stream,
+		       const bool *allocated)
+{
+	static u8 free_cover[IOVA_PAGES];
+	static u8 alloc_cover[IOVA_PAGES];
+	struct ethosn_iova_range *prev = NULL;
+	unsigned long nr_free_pages = 0;
+	unsigned long nr_ranges = 0;
+	struct rb_node *node;
+	unsigned long i;
+
+	memset(free_cover, 0, sizeof(free_cover));
+	memset(alloc_cover, 0, sizeof(alloc_cover));
+
+	for (node = rb_first(&stream->free_by_addr); node;
+	     node = rb_next(node)) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, addr_node);
+
+		if (!r->size || r->start + r->size > IOVA_PAGES)
+			return false;
+
+		if (prev && r->start <= prev->start + prev->size)
+			return false;
+
+		for (i = r->start; i < r->start + r->size; ++i)
+			++free_cover[i];
+
+		nr_free_pages += r->size;
+		++nr_ranges;
+		prev = r;
+	}
+
+	if (nr_free_pages != stream->nr_free_pages ||
+	    nr_ranges != stream->nr_free_ranges)
+		return false;
+
+	prev = NULL;
+	for (node = rb_first(&stream->free_by_size); node;
+	     node = rb_next(node)) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, size_node);
+
+		if (prev && (r->size < prev->size ||
+			     (r->size == prev->size && r->start < prev->start)))
+			return false;
+
+		--nr_ranges;
+		prev = r;
+	}
+
+	if (nr_ranges)
+		return false;
+
+	for (node = rb_first(&stream->allocated); node;
+	     node = rb_next(node)) {
+		struct ethosn_iova_range *r =
+			rb_entry(node, struct ethosn_iova_range, addr_node);
+
+		for (i = r->start; i < r->start + r->size; ++i)
+			++alloc_cover[i];
+	}
+
+	for (i = 0; i < IOVA_PAGES; ++i)
+		if (free_cover[i] + alloc_cover[i] != 1 ||
+		    alloc_cover[i] != allocated[i])
+			return false;
+
+	return true;
+}
+
+/* Whether any aligned range of free pages could hold nr_pages */
+static bool iova_fits(const bool *allocated,
+		      unsigned long nr_pages)
+{
+	const unsigned long align = iova_align(nr_pages);
+	unsigned long start;
+	unsigned long i;
+
+	for (start = 0; start + nr_pages <= IOVA_PAGES; start += align) {
+		for (i = 0; i < nr_pages; ++i)
+			if (allocated[start + i])
+				break;
+
+		if (i == nr_pages)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Random allocations and frees never hand out a page twice, fail only when no
+ * aligned free range is left, and freeing everything leaves the single free
+ * range the stream started with.
+ */
+static void test_dma_iommu_iova_fuzz(void)
+{
+	static bool allocated[IOVA_PAGES];
+	struct {
+		dma_addr_t    addr;
+		unsigned long nr_pages;
+	} allocs[IOVA_MAX_ALLOCS];
+	struct ethosn_iommu_stream stream;
+	struct ethosn_iova_range *range;
+	int num_allocs = 0;
+	int num_failed = 0;
+	int iter;
+	int i;
+
+	memset(allocated, 0, sizeof(allocated));
+	iova_stream_init(&stream);
+
+	for (iter = 0; iter < 20000; ++iter) {
+		bool do_alloc = num_allocs < IOVA_MAX_ALLOCS &&
+				(num_allocs == 0 || host_rand_below(2));
+
+		if (do_alloc) {
+			/* Mostly small, sometimes large */
+			unsigned long nr_pages = host_rand_below(8) ?
+						 1 + host_rand_below(32) :
+						 1 + host_rand_below(600);
+			dma_addr_t addr = iommu_alloc_iova(&stream, nr_pages);
+			unsigned long start;
+
+			if (!addr) {
+				HOST_ASSERT(!iova_fits(allocated, nr_pages));
+				++num_failed;
+				continue;
+			}
+
+			start = (addr - stream.addr_base) / PAGE_SIZE;
+			HOST_ASSERT(start + nr_pages <= IOVA_PAGES);
+			HOST_ASSERT(IS_ALIGNED(start, iova_align(nr_pages)));
+
+			for (i = 0; i < nr_pages; ++i) {
+				HOST_ASSERT(!allocated[start + i]);
+				allocated[start + i] = true;
+			}
+
+			allocs[num_allocs].addr = addr;
+			allocs[num_allocs].nr_pages = nr_pages;
+			++num_allocs;
+		} else {
+			int victim = host_rand_below(num_allocs);
+			unsigned long start = (allocs[victim].addr -
+					       stream.addr_base) / PAGE_SIZE;
+
+			iommu_free_iova(allocs[victim].addr, &stream);
+
+			for (i = 0; i < allocs[victim].nr_pages; ++i)
+				allocated[start + i] = false;
+
+			allocs[victim] = allocs[--num_allocs];
+		}
+
+		HOST_ASSERT(stream.nr_allocs == num_allocs);
+
+		if (iter % 16 == 0)
+			HOST_ASSERT(iova_check(&stream, allocated));
+	}
+
+	/* The stream is small enough for large allocations to fail at times */
+	HOST_EXPECT(num_failed > 0);
+	HOST_EXPECT(stream.nr_failed_allocs == num_failed);
+
+	while (num_allocs--) {
+		unsigned long start = (allocs[num_allocs].addr -
+				       stream.addr_base) / PAGE_SIZE;
+
+		iommu_free_iova(allocs[num_allocs].addr, &stream);
+		for (i = 0; i < allocs[num_allocs].nr_pages; ++i)
+			allocated[start + i] = false;
+
+		HOST_ASSERT(iova_check(&stream, allocated));
+	}
+
+	HOST_EXPECT(stream.nr_free_ranges == 1);
+	HOST_EXPECT(stream.nr_free_pages == IOVA_PAGES);
+	HOST_EXPECT(stream.allocated.rb_node == NULL);
+	range = rb_entry(stream.free_by_addr.rb_node, struct ethosn_iova_range,
+			 addr_node);
+	HOST_EXPECT(range->start == 0 && range->size == IOVA_PAGES);
+
+	iommu_stream_free_ranges(&stream);
+	expect_released();
+}
+
+int main(void)
+{
+	host_srand();
+
+	HOST_RUN(test_dma_iommu_create);
+	HOST_RUN(test_dma_iommu_map_runs);
+	HOST_RUN(test_dma_iommu_map_guarded);
+	HOST_RUN(test_dma_iommu_sync_range);
+	HOST_RUN(test_dma_iommu_sync_range_fuzz);
+	HOST_RUN(test_dma_iommu_iova_fuzz);
+
+	return host_test_result();
+}
@@ -0,0 +1,1053 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the dispatch of inferences to the cores, and a simulation of the
+ * idle gap between two inferences on a core for several inference depths.
+ *
+ * The network code runs unmodified on top of fake buffers, a fake DMA
+ * allocator and a model of the firmware, in virtual time. The costs of the
+ * steps outside the driver are assumptions of the model, see
+ * sim_default_costs().
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_completion_queue.c"
+#include "../../ethosn_dma.c"
+#include "../../ethosn_network.c"
+#include "../../ethosn_sched.c"
+
+#include "fake_device.h"
+
+#define US      NSEC_PER_USEC
+
+#define SIM_INPUT_SIZE          (64 * 1024)
+#define SIM_OUTPUT_SIZE         (16 * 1024)
+#define SIM_MAX_CLIENTS         4
+#define SIM_MAX_OUTSTANDING     4
+
+/* Buffers */
+
+static int fake_buffer_release(struct inode *inode,
+			       struct file *file)
+{
+	struct ethosn_buffer *buf = file->private_data;
+
+	ethosn_dma_free(buf->ethosn->allocator, buf->dma_info);
+	kfree(buf);
+
+	return 0;
+}
+
+static const struct file_operations fake_buffer_fops = {
+	.release = &fake_buffer_release,
+};
+
+static int fake_buffer_create(struct ethosn_device *ethosn,
+			      size_t size)
+{
+	struct ethosn_buffer *buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	int fd;
+
+	BUG_ON(!buf);
+
+	buf->ethosn = ethosn;
+	buf->dma_info = ethosn_dma_alloc(ethosn->allocator, size, GFP_KERNEL);
+	BUG_ON(IS_ERR_OR_NULL(buf->dma_info));
+
+	fd = anon_inode_getfd("ethosn-buffer", &fake_buffer_fops, buf, 0);
+	BUG_ON(fd < 0);
+	buf->file = host_fds[fd];
+
+	return fd;
+}
+
+struct ethosn_buffer *ethosn_buffer_get(int fd)
+{
+	struct file *file = fget(fd);
+
+	if (!file)
+		return ERR_PTR(-EBADF);
+
+	if (file->f_op != &fake_buffer_fops) {
+		fput(file);
+
+		return ERR_PTR(-EINVAL);
+	}
+
+	return file->private_data;
+}
+
+void put_ethosn_buffer(struct ethosn_buffer *buf)
+{
+	fput(buf->file);
+}
+
+/* Without explicit sync, buffers are synced every time they change hands */
+void ethosn_buffer_sync_for_device(struct ethosn_buffer *buf)
+{
+	ethosn_dma_sync_for_device(buf->ethosn->allocator, buf->dma_info);
+}
+
+void ethosn_buffer_device_done(struct ethosn_buffer *buf,
+			       bool written)
+{
+	if (written)
+		ethosn_dma_sync_for_cpu(buf->ethosn->allocator, buf->dma_info);
+}
+
+int ethosn_get_dma_view_fd(struct ethosn_device *ethosn,
+			   struct ethosn_dma_info *dma_info)
+{
+	return -EINVAL;
+}
+
+/* Networks */
+
+/* Binding ids of the test network */
+enum {
+	NET_BINDING_DMA,
+	NET_BINDING_CU,
+	NET_BINDING_INTERMEDIATE,
+	NET_BINDING_INPUT,
+	NET_BINDING_OUTPUT,
+};
+
+static const struct ethosn_buffer_info net_dma_info = {
+	NET_BINDING_DMA, 0, 256
+};
+static const struct ethosn_buffer_info net_cu_info = {
+	NET_BINDING_CU, 0, 128
+};
+static const struct ethosn_buffer_info net_intermediate_info = {
+	NET_BINDING_INTERMEDIATE, 0, 4096
+};
+static const struct ethosn_buffer_info net_input_info = {
+	NET_BINDING_INPUT, 0, SIM_INPUT_SIZE
+};
+static const struct ethosn_buffer_info net_output_info = {
+	NET_BINDING_OUTPUT, 0, SIM_OUTPUT_SIZE
+};
+
+/**
+ * net_register() - Register a network with one input and one output.
+ * @ethosn:	Device.
+ * @seed:	Networks with different seeds have different constants.
+ *
+ * Return: File descriptor of the network.
+ */
+static int net_register(struct ethosn_device *ethosn,
+			u8 seed)
+{
+	u8 dma_data[256];
+	u8 cu_data[128];
+	struct ethosn_network_req req = {
+		.dma_buffers = { 1, &net_dma_info },
+		.dma_data = { sizeof(dma_data), dma_data },
+		.cu_buffers = { 1, &net_cu_info },
+		.cu_data = { sizeof(cu_data), cu_data },
+		.intermediate_buffers = { 1, &net_intermediate_info },
+		.intermediate_data_size = net_intermediate_info.size,
+		.input_buffers = { 1, &net_input_info },
+		.output_buffers = { 1, &net_output_info },
+	};
+
+	memset(dma_data, seed, sizeof(dma_data));
+	memset(cu_data, seed + 1, sizeof(cu_data));
+
+	return ethosn_network_register(ethosn, &req);
+}
+
+static struct ethosn_network *net_from_fd(int fd)
+{
+	return host_fds[fd]->private_data;
+}
+
+static int net_schedule(int net_fd,
+			int input_fd,
+			int output_fd)
+{
+	struct file *file = host_fds[net_fd];
+	struct ethosn_inference_req req = {
+		.num_inputs = 1,
+		.input_fds = &input_fd,
+		.num_outputs = 1,
+		.output_fds = &output_fd,
+	};
+
+	return file->f_op->unlocked_ioctl(file,
+					  ETHOSN_IOCTL_SCHEDULE_INFERENCE,
+					  (unsigned long)&req);
+}
+
+/* Status of an inference, as read() on its file descriptor gives it */
+static int32_t inference_status(int fd)
+{
+	struct file *file = host_fds[fd];
+	int32_t status = -1;
+
+	if (file->f_op->read(file, (char *)&status, sizeof(status), NULL) !=
+	    sizeof(status))
+		return -1;
+
+	return status;
+}
+
+/* Checks that everything the tests created has been released */
+static void expect_no_leaks(void)
+{
+	HOST_EXPECT(host_num_files == 0);
+	HOST_EXPECT(host_num_allocs == 0);
+	HOST_EXPECT(fake_dma_stats.num_allocs == fake_dma_stats.num_frees);
+	HOST_EXPECT(fake_dma_stats.num_maps == fake_dma_stats.num_unmaps);
+	HOST_EXPECT(host_num_warnings == 0);
+	HOST_EXPECT(host_num_dev_errors == 0);
+}
+
+static void test_network_register_release(void)
+{
+	struct fake_device *fake = fake_device_create(2, 2, 0);
+	int fd = net_register(&fake->ethosn, 1);
+
+	HOST_ASSERT(fd >= 0);
+	HOST_EXPECT(net_from_fd(fd)->num_inputs == 1);
+	HOST_EXPECT(net_from_fd(fd)->num_outputs == 1);
+
+	host_close(fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* Networks registered with identical constants share a single copy of them */
+static void test_network_shared_constants(void)
+{
+	struct fake_device *fake = fake_device_create(2, 2, 0);
+	struct ethosn_device *ethosn = &fake->ethosn;
+	const size_t constants_size = net_dma_info.size + net_cu_info.size;
+	struct ethosn_network *net[3];
+	long num_allocs;
+	int fds[3];
+	int i;
+
+	num_allocs = fake_dma_stats.num_allocs;
+	fds[0] = net_register(ethosn, 1);
+	HOST_ASSERT(fds[0] >= 0);
+	num_allocs = fake_dma_stats.num_allocs - num_allocs;
+
+	/* The second network only allocates what isn't constant */
+	fds[1] = net_register(ethosn, 1);
+	HOST_ASSERT(fds[1] >= 0);
+	HOST_EXPECT(fake_dma_stats.num_allocs ==
+		    fake_dma_stats.num_frees + 2 * num_allocs - 2);
+
+	fds[2] = net_register(ethosn, 2);
+	HOST_ASSERT(fds[2] >= 0);
+
+	for (i = 0; i < ARRAY_SIZE(fds); ++i)
+		net[i] = net_from_fd(fds[i]);
+
+	HOST_EXPECT(net[0]->constant_dma_data == net[1]->constant_dma_data);
+	HOST_EXPECT(net[0]->constant_cu_data == net[1]->constant_cu_data);
+	HOST_EXPECT(kref_read(&net[0]->constant_dma_data->kref) == 2);
+	HOST_EXPECT(kref_read(&net[0]->constant_cu_data->kref) == 2);
+	HOST_EXPECT(net[2]->constant_dma_data != net[0]->constant_dma_data);
+	HOST_EXPECT(net[2]->constant_cu_data != net[0]->constant_cu_data);
+	HOST_EXPECT(kref_read(&net[2]->constant_dma_data->kref) == 1);
+	HOST_EXPECT(ethosn->constants_bytes == 2 * constants_size);
+	HOST_EXPECT(ethosn->constants_bytes_saved == constants_size);
+
+	/* The shared constants outlive the network which allocated them */
+	host_close(fds[0]);
+	HOST_EXPECT(kref_read(&net[1]->constant_dma_data->kref) == 1);
+	HOST_EXPECT(kref_read(&net[1]->constant_cu_data->kref) == 1);
+	HOST_EXPECT(ethosn->constants_bytes == 2 * constants_size);
+	HOST_EXPECT(ethosn->constants_bytes_saved == 0);
+
+	host_close(fds[1]);
+	host_close(fds[2]);
+	HOST_EXPECT(list_empty(&ethosn->constants));
+	HOST_EXPECT(ethosn->constants_bytes == 0);
+
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+static void test_network_refill_inflight(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 16);
+	struct ethosn_core *core = fake->core_ptrs[0];
+	int net_fds[3], ifr_fds[3];
+	int in_fd, out_fd;
+	int core_id;
+	int i;
+
+	fake->costs.exec_ns = 1000 * US;
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+
+	for (i = 0; i < 3; ++i) {
+		net_fds[i] = net_register(&fake->ethosn, i);
+		HOST_ASSERT(net_fds[i] >= 0);
+		ifr_fds[i] = net_schedule(net_fds[i], in_fd, out_fd);
+		HOST_ASSERT(ifr_fds[i] >= 0);
+	}
+
+	/* Two are posted, the third waits for a slot */
+	HOST_EXPECT(core->num_inflight_inferences == 2);
+	HOST_EXPECT(core->status == ETHOSN_CORE_BUSY);
+	HOST_EXPECT(fake->firmware[0].num_jobs == 2);
+	HOST_EXPECT(inference_status(ifr_fds[0]) == ETHOSN_INFERENCE_RUNNING);
+	HOST_EXPECT(inference_status(ifr_fds[1]) == ETHOSN_INFERENCE_RUNNING);
+	HOST_EXPECT(inference_status(ifr_fds[2]) ==
+		    ETHOSN_INFERENCE_SCHEDULED);
+
+	/* The second was posted before the first finished, so the firmware
+	 * goes straight from one to the other.
+	 */
+	HOST_EXPECT(fake->firmware[0].starts_ns[1] ==
+		    fake->firmware[0].finishes_ns[0]);
+
+	/* Completing the first posts the third */
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	HOST_EXPECT(inference_status(ifr_fds[0]) ==
+		    ETHOSN_INFERENCE_COMPLETED);
+	HOST_EXPECT(inference_status(ifr_fds[2]) == ETHOSN_INFERENCE_RUNNING);
+	HOST_EXPECT(core->num_inflight_inferences == 2);
+	HOST_EXPECT(ethosn_network_current_inference(core) ==
+		    host_fds[ifr_fds[1]]->private_data);
+
+	while (fake->firmware[0].num_jobs)
+		fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+
+	HOST_EXPECT(core->num_inflight_inferences == 0);
+	HOST_EXPECT(core->status == ETHOSN_CORE_FREE);
+	HOST_EXPECT(core->dispatch.inferences_completed == 3);
+
+	for (i = 0; i < 3; ++i) {
+		HOST_EXPECT(inference_status(ifr_fds[i]) ==
+			    ETHOSN_INFERENCE_COMPLETED);
+		host_close(ifr_fds[i]);
+		host_close(net_fds[i]);
+	}
+
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/*
+ * The inference header and the intermediate buffer of a network are per core,
+ * so a second inference of the same network waits for the first even when the
+ * core has a free slot.
+ */
+static void test_network_one_inflight_per_network(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 16);
+	struct ethosn_core *core = fake->core_ptrs[0];
+	int net_fd, ifr_fds[2];
+	int in_fd, out_fd;
+	int core_id;
+
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+	net_fd = net_register(&fake->ethosn, 1);
+	HOST_ASSERT(net_fd >= 0);
+
+	ifr_fds[0] = net_schedule(net_fd, in_fd, out_fd);
+	ifr_fds[1] = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fds[0] >= 0 && ifr_fds[1] >= 0);
+
+	HOST_EXPECT(core->num_inflight_inferences == 1);
+	HOST_EXPECT(core->status == ETHOSN_CORE_FREE);
+	HOST_EXPECT(inference_status(ifr_fds[1]) ==
+		    ETHOSN_INFERENCE_SCHEDULED);
+
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	HOST_EXPECT(inference_status(ifr_fds[1]) == ETHOSN_INFERENCE_RUNNING);
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	HOST_EXPECT(inference_status(ifr_fds[1]) ==
+		    ETHOSN_INFERENCE_COMPLETED);
+
+	host_close(ifr_fds[0]);
+	host_close(ifr_fds[1]);
+	host_close(net_fd);
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* Releasing an inference which is still in flight resets the core, which
+ * aborts every inference posted to it.
+ */
+static void test_network_release_inflight(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 16);
+	struct ethosn_core *core = fake->core_ptrs[0];
+	int net_fds[2], ifr_fds[2];
+	int in_fd, out_fd;
+	int i;
+
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+
+	for (i = 0; i < 2; ++i) {
+		net_fds[i] = net_register(&fake->ethosn, i);
+		HOST_ASSERT(net_fds[i] >= 0);
+		ifr_fds[i] = net_schedule(net_fds[i], in_fd, out_fd);
+		HOST_ASSERT(ifr_fds[i] >= 0);
+	}
+
+	HOST_EXPECT(core->num_inflight_inferences == 2);
+
+	host_close(ifr_fds[0]);
+	HOST_EXPECT(core->num_inflight_inferences == 0);
+	HOST_EXPECT(core->status == ETHOSN_CORE_FREE);
+	HOST_EXPECT(fake->firmware[0].num_jobs == 0);
+	HOST_EXPECT(inference_status(ifr_fds[1]) == ETHOSN_INFERENCE_ERROR);
+
+	host_close(ifr_fds[1]);
+
+	for (i = 0; i < 2; ++i)
+		host_close(net_fds[i]);
+
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* The dispatch counters don't need profiling and don't fit in 32 bits */
+static void test_network_read_counter(void)
+{
+	struct fake_device *fake = fake_device_create(2, 2, 16);
+	struct ethosn_core *core = fake->core_ptrs[1];
+	const u32 sent = ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_SENT;
+	const u32 received = ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED;
+	const u32 completed = ETHOSN_POLL_COUNTER_NAME_INFERENCES_COMPLETED;
+	const u32 busy_ms = ETHOSN_POLL_COUNTER_NAME_BUSY_TIME_MS;
+	const u32 hits = ETHOSN_POLL_COUNTER_NAME_AFFINITY_HITS;
+	u64 value = 0;
+	int net_fd, ifr_fd;
+	int in_fd, out_fd;
+	int core_id;
+
+	fake->costs.exec_ns = 3 * NSEC_PER_MSEC;
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+	net_fd = net_register(&fake->ethosn, 1);
+	HOST_ASSERT(net_fd >= 0);
+
+	/* Core 0 is loaded, so that the inference goes to core 1 */
+	fake->cores[0].status = ETHOSN_CORE_BUSY;
+	host_ktime_ns = 0;
+	ifr_fd = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fd >= 0);
+	HOST_EXPECT(core->num_inflight_inferences == 1);
+
+	/* Busy time includes the inference in flight */
+	host_ktime_ns += 2 * NSEC_PER_MSEC;
+	HOST_EXPECT(ethosn_network_read_counter(core, busy_ms, &value) == 0);
+	HOST_EXPECT(value == 2);
+
+	fake_device_irq(fake, 1, fake_device_next_irq(fake, &core_id));
+	HOST_EXPECT(ethosn_network_read_counter(core, completed, &value) == 0);
+	HOST_EXPECT(value == 1);
+	HOST_EXPECT(ethosn_network_read_counter(core, busy_ms, &value) == 0);
+	HOST_EXPECT(value == 3);
+
+	core->dispatch.affinity_hits = 1ULL << 40;
+	HOST_EXPECT(ethosn_network_read_counter(core, hits, &value) == 0);
+	HOST_EXPECT(value == 1ULL << 40);
+
+	/* The mailbox counters are only kept while profiling, which is
+	 * configured through core 0.
+	 */
+	core->profiling.mailbox_messages_sent = 5;
+	core->profiling.mailbox_messages_received = 6;
+	value = 0;
+	HOST_EXPECT(ethosn_network_read_counter(core, sent, &value) ==
+		    -ENODATA);
+	HOST_EXPECT(ethosn_network_read_counter(core, received, &value) ==
+		    -ENODATA);
+	HOST_EXPECT(value == 0);
+
+	core->profiling.config.enable_profiling = true;
+	HOST_EXPECT(ethosn_network_read_counter(core, sent, &value) ==
+		    -ENODATA);
+
+	fake->cores[0].profiling.config.enable_profiling = true;
+	HOST_EXPECT(ethosn_network_read_counter(core, sent, &value) == 0);
+	HOST_EXPECT(value == 5);
+	HOST_EXPECT(ethosn_network_read_counter(core, received, &value) == 0);
+	HOST_EXPECT(value == 6);
+
+	HOST_EXPECT(ethosn_network_read_counter(core, hits + 1, &value) ==
+		    -EINVAL);
+
+	host_close(ifr_fd);
+	host_close(net_fd);
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+static int net_set_completion_queue(int net_fd,
+				    int cq_fd)
+{
+	struct file *file = host_fds[net_fd];
+
+	return file->f_op->unlocked_ioctl(file,
+					  ETHOSN_IOCTL_SET_COMPLETION_QUEUE,
+					  (unsigned long)&cq_fd);
+}
+
+/*
+ * The completion record is reserved when the inference is scheduled, so a full
+ * queue or an allocation failure makes scheduling fail rather than the record
+ * be dropped on completion.
+ */
+static void test_network_completion_queue(void)
+{
+	static struct ethosn_completion_node
+	*reserved[ETHOSN_COMPLETION_QUEUE_MAX_RECORDS];
+	struct fake_device *fake = fake_device_create(1, 2, 16);
+	struct ethosn_completion records[2];
+	struct ethosn_completion_queue *cq;
+	struct file *cq_file;
+	int net_fd, cq_fd, ifr_fds[3];
+	int in_fd, out_fd;
+	int core_id;
+	int i;
+
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+	net_fd = net_register(&fake->ethosn, 1);
+	HOST_ASSERT(net_fd >= 0);
+	cq_fd = ethosn_completion_queue_register(&fake->ethosn);
+	HOST_ASSERT(cq_fd >= 0);
+	cq_file = host_fds[cq_fd];
+	cq_file->f_flags |= O_NONBLOCK;
+	cq = cq_file->private_data;
+	HOST_ASSERT(net_set_completion_queue(net_fd, cq_fd) == 0);
+
+	/* Fill the queue but for one record */
+	for (i = 0; i < ETHOSN_COMPLETION_QUEUE_MAX_RECORDS - 1; ++i) {
+		reserved[i] = ethosn_completion_queue_reserve(cq);
+		HOST_ASSERT(!IS_ERR(reserved[i]));
+	}
+
+	/* Nothing is dispatched when the record, the fourth allocation of
+	 * scheduling, fails.
+	 */
+	host_alloc_fail_countdown = 4;
+	HOST_EXPECT(net_schedule(net_fd, in_fd, out_fd) == -ENOMEM);
+	host_alloc_fail_countdown = 0;
+	HOST_EXPECT(fake->firmware[0].num_jobs == 0);
+
+	ifr_fds[0] = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fds[0] >= 0);
+	HOST_EXPECT(net_schedule(net_fd, in_fd, out_fd) == -EAGAIN);
+	HOST_EXPECT(cq->num_records == ETHOSN_COMPLETION_QUEUE_MAX_RECORDS);
+
+	/* Posting doesn't allocate */
+	host_alloc_fail_countdown = 1;
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	host_alloc_fail_countdown = 0;
+	HOST_EXPECT(inference_status(ifr_fds[0]) ==
+		    ETHOSN_INFERENCE_COMPLETED);
+
+	/* Reading the record makes room for another */
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) ==
+		    sizeof(records[0]));
+	HOST_EXPECT(records[0].inference_fd == ifr_fds[0]);
+	HOST_EXPECT(records[0].status == ETHOSN_INFERENCE_COMPLETED);
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) == -EAGAIN);
+
+	for (i = 0; i < ETHOSN_COMPLETION_QUEUE_MAX_RECORDS - 1; ++i)
+		ethosn_completion_queue_cancel(reserved[i]);
+
+	HOST_EXPECT(cq->num_records == 0);
+
+	/* The second inference waits for the first, as they are of the same
+	 * network.
+	 */
+	ifr_fds[1] = net_schedule(net_fd, in_fd, out_fd);
+	ifr_fds[2] = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fds[1] >= 0 && ifr_fds[2] >= 0);
+	HOST_EXPECT(inference_status(ifr_fds[2]) ==
+		    ETHOSN_INFERENCE_SCHEDULED);
+	HOST_EXPECT(cq->num_records == 2);
+
+	/* The reservation of an inference released before it ran is given
+	 * back, one released while running is reported as an error.
+	 */
+	host_close(ifr_fds[2]);
+	HOST_EXPECT(cq->num_records == 1);
+	host_close(ifr_fds[1]);
+	HOST_EXPECT(cq->num_records == 1);
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) ==
+		    sizeof(records[0]));
+	HOST_EXPECT(records[0].inference_fd == ifr_fds[1]);
+	HOST_EXPECT(records[0].status == ETHOSN_INFERENCE_ERROR);
+	HOST_EXPECT(cq->num_records == 0);
+
+	host_close(ifr_fds[0]);
+	host_close(cq_fd);
+	host_close(net_fd);
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* Simulation of the idle gap */
+
+struct sim_config {
+	const char *name;
+	u32        depth;
+	int        num_clients;
+	/* Inferences each client keeps submitted */
+	int        outstanding;
+};
+
+/*
+ * A client is a thread of a user space application which runs one network in
+ * a loop: it schedules an inference, waits for it and schedules the next one.
+ */
+struct sim_client {
+	int net_fd;
+	int in_fd;
+	int out_fd;
+	int ifr_fds[SIM_MAX_OUTSTANDING];
+	int num_ifrs;
+	/* Time at which the client wakes up to schedule inferences */
+	u64 wakeup_ns;
+	int to_schedule;
+};
+
+struct sim_result {
+	struct fake_gaps gaps;
+	/* Completed inferences per second */
+	double           throughput;
+};
+
+/* Wake-up of a user space thread once its inference has completed */
+#define SIM_WAKEUP_NS   (30 * US)
+
+/*
+ * Cost model. The execution time is that of a small network, the others are
+ * typical of an interrupt and of a user space wake-up on an application
+ * processor, and of cleaning or invalidating the caches at 2 GB/s.
+ */
+static void sim_default_costs(struct fake_device *fake)
+{
+	fake->costs.mailbox_ns = 5 * US;
+	fake->costs.exec_ns = 900 * US;
+	fake->costs.exec_jitter_ns = 200 * US;
+	fake->costs.irq_ns = 30 * US;
+	fake->costs.irq_jitter_ns = 40 * US;
+	fake_dma_sync_ps_per_byte = 500;
+}
+
+static void sim_collect(struct sim_client *client)
+{
+	int i = 0;
+
+	while (i < client->num_ifrs) {
+		if (inference_status(client->ifr_fds[i]) <
+		    ETHOSN_INFERENCE_COMPLETED) {
+			++i;
+			continue;
+		}
+
+		host_close(client->ifr_fds[i]);
+		client->ifr_fds[i] = client->ifr_fds[--client->num_ifrs];
+
+		if (!client->to_schedule)
+			client->wakeup_ns = host_ktime_ns + SIM_WAKEUP_NS;
+
+		++client->to_schedule;
+	}
+}
+
+static struct sim_result sim_run(const struct sim_config *config,
+				 size_t num_inferences)
+{
+	struct fake_device *fake = fake_device_create(1, config->depth,
+						      num_inferences);
+	struct sim_client clients[SIM_MAX_CLIENTS];
+	struct sim_result result;
+	u64 begin_ns;
+	int c;
+
+	BUG_ON(config->num_clients > SIM_MAX_CLIENTS ||
+	       config->outstanding > SIM_MAX_OUTSTANDING);
+
+	sim_default_costs(fake);
+	host_ktime_ns = 0;
+
+	for (c = 0; c < config->num_clients; ++c) {
+		struct sim_client *client = &clients[c];
+
+		memset(client, 0, sizeof(*client));
+		client->net_fd = net_register(&fake->ethosn, c);
+		client->in_fd = fake_buffer_create(&fake->ethosn,
+						   SIM_INPUT_SIZE);
+		client->out_fd = fake_buffer_create(&fake->ethosn,
+						    SIM_OUTPUT_SIZE);
+		client->to_schedule = config->outstanding;
+		BUG_ON(client->net_fd < 0);
+	}
+
+	begin_ns = host_ktime_ns;
+
+	while (fake->firmware[0].num_started < num_inferences) {
+		struct sim_client *first = NULL;
+		int core_id = 0;
+		u64 irq_ns = fake_device_next_irq(fake, &core_id);
+
+		for (c = 0; c < config->num_clients; ++c)
+			if (clients[c].to_schedule &&
+			    (!first || clients[c].wakeup_ns < first->wakeup_ns))
+				first = &clients[c];
+
+		if (first && first->wakeup_ns <= irq_ns) {
+			host_ktime_ns = max(host_ktime_ns, first->wakeup_ns);
+
+			while (first->to_schedule) {
+				int fd = net_schedule(first->net_fd,
+						      first->in_fd,
+						      first->out_fd);
+
+				BUG_ON(fd < 0);
+				first->ifr_fds[first->num_ifrs++] = fd;
+				--first->to_schedule;
+			}
+
+			continue;
+		}
+
+		BUG_ON(irq_ns == U64_MAX);
+		fake_device_irq(fake, core_id, irq_ns);
+
+		for (c = 0; c < config->num_clients; ++c)
+			sim_collect(&clients[c]);
+	}
+
+	result.gaps = fake_device_gaps(fake, 0);
+	result.throughput = 1e9 * fake->firmware[0].num_started /
+			    (fake->firmware[0].busy_until_ns - begin_ns);
+
+	/* Drain the device before releasing everything */
+	while (fake->firmware[0].num_jobs) {
+		int core_id = 0;
+		u64 irq_ns = fake_device_next_irq(fake, &core_id);
+
+		fake_device_irq(fake, core_id, irq_ns);
+	}
+
+	for (c = 0; c < config->num_clients; ++c) {
+		struct sim_client *client = &clients[c];
+
+		while (client->num_ifrs)
+			host_close(client->ifr_fds[--client->num_ifrs]);
+
+		host_close(client->net_fd);
+		host_close(client->in_fd);
+		host_close(client->out_fd);
+	}
+
+	/* Inferences still queued are released with their fds */
+	HOST_EXPECT(list_empty(&fake->ethosn.queue.inference_queue));
+	fake_device_destroy(fake);
+
+	return result;
+}
+
+static const struct sim_config sim_configs[] = {
+	{ "1 network, depth 1", 1, 1, 1 },
+	{ "1 network, depth 2", 2, 1, 2 },
+	{ "2 networks, depth 1", 1, 2, 1 },
+	{ "2 networks, depth 2", 2, 2, 1 },
+	{ "4 networks, depth 4", 4, 4, 1 },
+};
+
+/* An inference completed without an interrupt since it was posted, e.g. when
+ * the core is polled, spends all its time executing.
+ */
+static void test_network_latency_irq(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 0);
+	struct ethosn_core *core = fake->core_ptrs[0];
+	const struct ethosn_stage_latency *stages;
+	struct ethosn_inference *inference;
+	int net_fds[2], ifr_fds[2];
+	int in_fd, out_fd;
+	int core_id;
+	u64 posted_ns;
+
+	fake->costs.exec_ns = 1000 * US;
+	fake->costs.irq_ns = 50 * US;
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+	net_fds[0] = net_register(&fake->ethosn, 1);
+	net_fds[1] = net_register(&fake->ethosn, 2);
+	HOST_ASSERT(net_fds[0] >= 0 && net_fds[1] >= 0);
+
+	/* The first inference completes with an interrupt */
+	ifr_fds[0] = net_schedule(net_fds[0], in_fd, out_fd);
+	HOST_ASSERT(ifr_fds[0] >= 0);
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	stages = net_from_fd(net_fds[0])->latency.stages;
+	HOST_EXPECT(stages[ETHOSN_LATENCY_STAGE_EXECUTE].total_ns ==
+		    1050 * US);
+
+	/* The second one is polled, so the last interrupt is stale */
+	host_ktime_ns += 100 * US;
+	ifr_fds[1] = net_schedule(net_fds[1], in_fd, out_fd);
+	HOST_ASSERT(ifr_fds[1] >= 0);
+	inference = ethosn_network_current_inference(core);
+	HOST_ASSERT(inference);
+	posted_ns = inference->times.posted_ns;
+	host_ktime_ns += 700 * US;
+
+	mutex_lock(&core->mutex);
+	ethosn_network_poll(core, inference, ETHOSN_INFERENCE_COMPLETED);
+	mutex_unlock(&core->mutex);
+
+	stages = net_from_fd(net_fds[1])->latency.stages;
+	HOST_EXPECT(stages[ETHOSN_LATENCY_STAGE_EXECUTE].total_ns ==
+		    host_ktime_ns - posted_ns);
+	HOST_EXPECT(stages[ETHOSN_LATENCY_STAGE_IRQ].count == 1);
+	HOST_EXPECT(stages[ETHOSN_LATENCY_STAGE_IRQ].total_ns == 0);
+
+	host_close(ifr_fds[0]);
+	host_close(ifr_fds[1]);
+	host_close(net_fds[0]);
+	host_close(net_fds[1]);
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* Reads only take the records they copy, from queues of the same device */
+static void test_network_completion_queue_read(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 0);
+	struct device other_dev = { .name = "ethosn" };
+	struct ethosn_device other = { .dev = &other_dev };
+	struct ethosn_completion records[3];
+	struct ethosn_completion_queue *cq;
+	struct file *cq_file;
+	int net_fd, cq_fd, other_fd;
+	int i;
+
+	net_fd = net_register(&fake->ethosn, 1);
+	HOST_ASSERT(net_fd >= 0);
+	cq_fd = ethosn_completion_queue_register(&fake->ethosn);
+	HOST_ASSERT(cq_fd >= 0);
+	cq_file = host_fds[cq_fd];
+	cq_file->f_flags |= O_NONBLOCK;
+	cq = cq_file->private_data;
+
+	/* A queue of another device is rejected */
+	other_fd = ethosn_completion_queue_register(&other);
+	HOST_ASSERT(other_fd >= 0);
+	HOST_EXPECT(net_set_completion_queue(net_fd, other_fd) == -EINVAL);
+	HOST_EXPECT(net_set_completion_queue(net_fd, cq_fd) == 0);
+	host_close(other_fd);
+	HOST_EXPECT(other_dev.refcount == 0);
+
+	for (i = 0; i < ARRAY_SIZE(records); ++i) {
+		struct ethosn_completion record = { .inference_fd = 10 + i };
+
+		ethosn_completion_queue_post(ethosn_completion_queue_reserve(cq),
+					     &record);
+	}
+
+	/* A fault on the first record loses nothing */
+	host_copy_to_user_fail_countdown = 1;
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) == -EFAULT);
+	HOST_EXPECT(cq->num_records == 3);
+
+	/* A fault on the second record returns the first one only */
+	host_copy_to_user_fail_countdown = 2;
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) ==
+		    sizeof(records[0]));
+	host_copy_to_user_fail_countdown = 0;
+	HOST_EXPECT(records[0].inference_fd == 10);
+	HOST_EXPECT(cq->num_records == 2);
+
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)records,
+					sizeof(records), NULL) ==
+		    2 * sizeof(records[0]));
+	HOST_EXPECT(records[0].inference_fd == 11);
+	HOST_EXPECT(records[1].inference_fd == 12);
+	HOST_EXPECT(cq->num_records == 0);
+
+	host_close(cq_fd);
+	host_close(net_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+/* An inference which can't be posted ends with an error and is notified */
+static void test_network_send_failure(void)
+{
+	struct fake_device *fake = fake_device_create(1, 2, 16);
+	struct ethosn_core *core = fake->core_ptrs[0];
+	struct ethosn_completion record;
+	struct file *cq_file;
+	int net_fd, cq_fd, ifr_fd;
+	int in_fd, out_fd;
+	int core_id;
+
+	in_fd = fake_buffer_create(&fake->ethosn, SIM_INPUT_SIZE);
+	out_fd = fake_buffer_create(&fake->ethosn, SIM_OUTPUT_SIZE);
+	net_fd = net_register(&fake->ethosn, 1);
+	HOST_ASSERT(net_fd >= 0);
+	cq_fd = ethosn_completion_queue_register(&fake->ethosn);
+	HOST_ASSERT(cq_fd >= 0);
+	cq_file = host_fds[cq_fd];
+	cq_file->f_flags |= O_NONBLOCK;
+	HOST_ASSERT(net_set_completion_queue(net_fd, cq_fd) == 0);
+
+	fake->send_error = -ENOSPC;
+	ifr_fd = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fd >= 0);
+	HOST_EXPECT(host_num_dev_errors == 1);
+	host_num_dev_errors = 0;
+	fake->send_error = 0;
+
+	HOST_EXPECT(inference_status(ifr_fd) == ETHOSN_INFERENCE_ERROR);
+	HOST_EXPECT(core->num_inflight_inferences == 0);
+	HOST_EXPECT(core->status == ETHOSN_CORE_FREE);
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)&record,
+					sizeof(record), NULL) ==
+		    sizeof(record));
+	HOST_EXPECT(record.inference_fd == ifr_fd);
+	HOST_EXPECT(record.status == ETHOSN_INFERENCE_ERROR);
+	host_close(ifr_fd);
+
+	/* The slot wasn't taken, so the next inference runs */
+	ifr_fd = net_schedule(net_fd, in_fd, out_fd);
+	HOST_ASSERT(ifr_fd >= 0);
+	HOST_EXPECT(core->num_inflight_inferences == 1);
+	fake_device_irq(fake, 0, fake_device_next_irq(fake, &core_id));
+	HOST_EXPECT(inference_status(ifr_fd) == ETHOSN_INFERENCE_COMPLETED);
+	HOST_EXPECT(cq_file->f_op->read(cq_file, (char *)&record,
+					sizeof(record), NULL) ==
+		    sizeof(record));
+	HOST_EXPECT(record.status == ETHOSN_INFERENCE_COMPLETED);
+
+	host_close(ifr_fd);
+	host_close(cq_fd);
+	host_close(net_fd);
+	host_close(in_fd);
+	host_close(out_fd);
+	expect_no_leaks();
+	fake_device_destroy(fake);
+}
+
+static void test_network_idle_gap(void)
+{
+	struct sim_result single_1 = sim_run(&sim_configs[0], 500);
+	struct sim_result single_2 = sim_run(&sim_configs[1], 500);
+	struct sim_result multi_1 = sim_run(&sim_configs[2], 500);
+	struct sim_result multi_2 = sim_run(&sim_configs[3], 500);
+
+	/* With one network the core idles for the interrupt, the wake-up of
+	 * the client and the setup of the next inference.
+	 */
+	HOST_EXPECT(single_1.gaps.p50_ns > SIM_WAKEUP_NS);
+
+	/* A second network is posted while the first runs, which hides the
+	 * whole gap.
+	 */
+	HOST_EXPECT(multi_2.gaps.p99_ns == 0);
+	HOST_EXPECT(multi_2.gaps.utilisation > 99.9);
+	HOST_EXPECT(multi_2.throughput > multi_1.throughput);
+	HOST_EXPECT(multi_1.gaps.mean_ns < single_1.gaps.mean_ns);
+
+	/* Inferences of one network don't overlap, so a deeper queue only
+	 * saves it the wake-up of the client.
+	 */
+	HOST_EXPECT(single_2.gaps.mean_ns < single_1.gaps.mean_ns);
+	HOST_EXPECT(single_2.gaps.mean_ns + SIM_WAKEUP_NS / 2 >
+		    multi_1.gaps.mean_ns);
+
+	expect_no_leaks();
+}
+
+static void bench_network_idle_gap(void)
+{
+	size_t i;
+
+	printf("\nIdle gap of a core between two inferences of 1 ms:\n");
+	printf("%-22s %10s %10s %10s %8s %10s\n", "", "mean us", "p50 us",
+	       "p99 us", "busy %", "inf/s");
+
+	for (i = 0; i < ARRAY_SIZE(sim_configs); ++i) {
+		struct sim_result r = sim_run(&sim_configs[i], 20000);
+
+		printf("%-22s %10.1f %10.1f %10.1f %8.2f %10.1f\n",
+		       sim_configs[i].name, r.gaps.mean_ns / 1e3,
+		       r.gaps.p50_ns / 1e3, r.gaps.p99_ns / 1e3,
+		       r.gaps.utilisation, r.throughput);
+	}
+}
+
+int main(int argc,
+	 char **argv)
+{
+	host_srand();
+
+	if (host_bench_requested(argc, argv)) {
+		bench_network_idle_gap();
+
+		return host_test_result();
+	}
+
+	HOST_RUN(test_network_register_release);
+	HOST_RUN(test_network_shared_constants);
+	HOST_RUN(test_network_refill_inflight);
+	HOST_RUN(test_network_one_inflight_per_network);
+	HOST_RUN(test_network_release_inflight);
+	HOST_RUN(test_network_read_counter);
+	HOST_RUN(test_network_latency_irq);
+	HOST_RUN(test_network_completion_queue);
+	HOST_RUN(test_network_completion_queue_read);
+	HOST_RUN(test_network_send_failure);
+	HOST_RUN(test_network_idle_gap);
+
+	return host_test_result();
+}
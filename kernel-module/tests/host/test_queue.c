@@ -0,0 +1,525 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests and benchmarks of the ethosn_queue helpers shared with the firmware.
+ */
+
+#include "host_test.h"
+
+#include "ethosn_firmware.h"
+
+#define GUARD_SIZE      64
+#define GUARD_BYTE      0xa5
+#define MAX_CAPACITY    4096
+
+/* Queue with a guard area after its data array to catch overruns */
+static struct ethosn_queue *queue_alloc(uint32_t capacity,
+					uint32_t index)
+{
+	struct ethosn_queue *queue =
+		malloc(sizeof(*queue) + capacity + GUARD_SIZE);
+
+	if (!queue)
+		abort();
+
+	memset(queue, 0, sizeof(*queue));
+	memset(queue->data, 0, capacity);
+	memset(queue->data + capacity, GUARD_BYTE, GUARD_SIZE);
+	queue->capacity = capacity;
+	queue->read = index;
+	queue->write = index;
+
+	return queue;
+}
+
+static bool queue_guard_intact(const struct ethosn_queue *queue)
+{
+	uint32_t i;
+
+	for (i = 0; i < GUARD_SIZE; ++i)
+		if (queue->data[queue->capacity + i] != GUARD_BYTE)
+			return false;
+
+	return true;
+}
+
+static void fill(uint8_t *buf,
+		 uint32_t size,
+		 uint8_t first)
+{
+	uint32_t i;
+
+	for (i = 0; i < size; ++i)
+		buf[i] = (uint8_t)(first + i);
+}
+
+static void test_queue_empty(void)
+{
+	const uint32_t capacity = 64;
+	const uint32_t indices[] = { 0, 1, capacity / 2, capacity - 1 };
+	uint8_t buf[1];
+	uint32_t i;
+
+	for (i = 0; i < sizeof(indices) / sizeof(indices[0]); ++i) {
+		struct ethosn_queue *queue = queue_alloc(capacity, indices[i]);
+		uint32_t read_pending = 0xdead;
+
+		HOST_EXPECT(ethosn_queue_get_size(queue) == 0);
+		HOST_EXPECT(ethosn_queue_get_free_space(queue) == capacity - 1);
+		HOST_EXPECT(!ethosn_queue_read(queue, buf, 1, &read_pending));
+		HOST_EXPECT(read_pending == 0xdead);
+		HOST_EXPECT(!ethosn_queue_skip(queue, 1));
+		HOST_EXPECT(ethosn_queue_read(queue, buf, 0, &read_pending));
+		HOST_EXPECT(read_pending == indices[i]);
+		HOST_EXPECT(queue->read == indices[i]);
+		free(queue);
+	}
+}
+
+static void test_queue_full(void)
+{
+	const uint32_t capacity = 64;
+	uint8_t src[64];
+	uint8_t dst[64];
+	const struct ethosn_queue_segment one = { src, 1 };
+	const struct ethosn_queue_segment none = { src, 0 };
+	struct ethosn_queue *queue = queue_alloc(capacity, capacity - 1);
+	uint32_t write_pending = queue->write;
+	uint32_t read_pending = queue->read;
+
+	HOST_EXPECT(ethosn_queue_can_ever_fit(queue, capacity - 1));
+	HOST_EXPECT(!ethosn_queue_can_ever_fit(queue, capacity));
+
+	/* A whole capacity never fits, one byte less fills the queue */
+	fill(src, sizeof(src), 1);
+	HOST_EXPECT(!ethosn_queue_write(queue, src, capacity, &write_pending));
+	HOST_EXPECT(ethosn_queue_write(queue, src, capacity - 1,
+				       &write_pending));
+	queue->write = write_pending;
+	HOST_EXPECT(queue->write == capacity - 2);
+	HOST_EXPECT(ethosn_queue_get_size(queue) == capacity - 1);
+	HOST_EXPECT(ethosn_queue_get_free_space(queue) == 0);
+
+	/* Nothing else fits, and failing writes leave the queue alone */
+	HOST_EXPECT(!ethosn_queue_write(queue, src, 1, &write_pending));
+	HOST_EXPECT(!ethosn_queue_write_batch(queue, &one, 1, &write_pending));
+	HOST_EXPECT(write_pending == queue->write);
+	HOST_EXPECT(ethosn_queue_write_batch(queue, &none, 1, &write_pending));
+	HOST_EXPECT(write_pending == queue->write);
+
+	HOST_EXPECT(ethosn_queue_read(queue, dst, capacity - 1, &read_pending));
+	queue->read = read_pending;
+	HOST_EXPECT(!memcmp(src, dst, capacity - 1));
+	HOST_EXPECT(ethosn_queue_get_size(queue) == 0);
+	HOST_EXPECT(queue_guard_intact(queue));
+	free(queue);
+}
+
+static void test_queue_wrap_around(void)
+{
+	const uint32_t capacity = 64;
+	uint8_t header[4];
+	uint8_t payload[6];
+	uint8_t dst[10];
+	const struct ethosn_queue_segment segments[] = {
+		{ header, sizeof(header) },
+		{ payload, sizeof(payload) },
+	};
+	struct ethosn_queue *queue = queue_alloc(capacity, capacity - 3);
+	uint32_t write_pending = queue->write;
+	uint32_t read_pending = queue->read;
+	uint32_t i;
+
+	fill(header, sizeof(header), 1);
+	fill(payload, sizeof(payload), 5);
+
+	/* The header straddles the end of the data array */
+	HOST_EXPECT(ethosn_queue_write_batch(queue, segments, 2,
+					     &write_pending));
+	HOST_EXPECT(write_pending == 7);
+
+	/* Nothing is readable until the batch is committed */
+	HOST_EXPECT(ethosn_queue_get_size(queue) == 0);
+	queue->write = write_pending;
+	HOST_EXPECT(ethosn_queue_get_size(queue) == 10);
+
+	for (i = 0; i < 3; ++i)
+		HOST_EXPECT(queue->data[capacity - 3 + i] == i + 1);
+
+	for (i = 0; i < 7; ++i)
+		HOST_EXPECT(queue->data[i] == i + 4);
+
+	HOST_EXPECT(queue_guard_intact(queue));
+
+	HOST_EXPECT(ethosn_queue_read(queue, dst, sizeof(dst), &read_pending));
+	HOST_EXPECT(read_pending == 7);
+	for (i = 0; i < sizeof(dst); ++i)
+		HOST_EXPECT(dst[i] == i + 1);
+
+	/* Skipping wraps around in the same way */
+	HOST_EXPECT(ethosn_queue_skip(queue, 4));
+	HOST_EXPECT(queue->read == 1);
+	free(queue);
+}
+
+static void test_queue_batch_counts_pending(void)
+{
+	const uint32_t capacity = 64;
+	uint8_t src[40] = { 0 };
+	const struct ethosn_queue_segment first = { src, 40 };
+	const struct ethosn_queue_segment second = { src, 30 };
+	struct ethosn_queue *queue = queue_alloc(capacity, 0);
+	uint32_t write_pending = queue->write;
+
+	HOST_EXPECT(ethosn_queue_write_batch(queue, &first, 1, &write_pending));
+
+	/*
+	 * The second batch would fit in the committed free space, but not
+	 * together with the first one, which hasn't been committed yet.
+	 */
+	HOST_EXPECT(ethosn_queue_get_free_space(queue) >= second.size);
+	HOST_EXPECT(!ethosn_queue_write_batch(queue, &second, 1,
+					      &write_pending));
+	HOST_EXPECT(write_pending == 40);
+	HOST_EXPECT(queue_guard_intact(queue));
+	free(queue);
+}
+
+/*
+ * Reference model of a queue: the committed bytes followed by the written but
+ * uncommitted ones.
+ */
+struct model {
+	uint8_t  bytes[MAX_CAPACITY];
+	uint32_t committed;
+	uint32_t pending;
+};
+
+static uint32_t rand_size(uint32_t capacity)
+{
+	/* Mostly message sized, sometimes up to and past the capacity */
+	if (host_rand_below(4))
+		return host_rand_below(64);
+
+	return host_rand_below(capacity + 2);
+}
+
+static bool fuzz_write(struct ethosn_queue *queue,
+		       struct model *model,
+		       uint32_t *write_pending,
+		       uint8_t *seq)
+{
+	uint8_t src[MAX_CAPACITY + 1];
+	const uint32_t size = rand_size(queue->capacity);
+	const bool fits = size + model->committed < queue->capacity;
+	bool ret;
+
+	fill(src, size, *seq);
+	ret = ethosn_queue_write(queue, src, size, write_pending);
+	if (ret != fits)
+		return false;
+
+	if (ret) {
+		memcpy(model->bytes + model->committed, src, size);
+		model->committed += size;
+		*seq = (uint8_t)(*seq + size);
+		queue->write = *write_pending;
+	}
+
+	return *write_pending == queue->write;
+}
+
+static bool fuzz_write_batch(struct ethosn_queue *queue,
+			     struct model *model,
+			     uint32_t *write_pending,
+			     uint8_t *seq)
+{
+	static uint8_t src[4][MAX_CAPACITY + 1];
+	struct ethosn_queue_segment segments[4];
+	const uint32_t num_segments = host_rand_below(5);
+	const uint32_t used = model->committed + model->pending;
+	const uint32_t old_pending = *write_pending;
+	uint64_t total = 0;
+	bool fits = true;
+	uint8_t next = *seq;
+	uint32_t i;
+	bool ret;
+
+	for (i = 0; i < num_segments; ++i) {
+		segments[i].size = rand_size(queue->capacity);
+		segments[i].data = src[i];
+		fill(src[i], segments[i].size, next);
+		next = (uint8_t)(next + segments[i].size);
+		total += segments[i].size;
+		if (segments[i].size >= queue->capacity)
+			fits = false;
+	}
+
+	if (used + total >= queue->capacity)
+		fits = false;
+
+	ret = ethosn_queue_write_batch(queue, segments, num_segments,
+				       write_pending);
+	if (ret != fits)
+		return false;
+
+	if (!ret)
+		return *write_pending == old_pending;
+
+	for (i = 0; i < num_segments; ++i) {
+		memcpy(model->bytes + model->committed + model->pending,
+		       segments[i].data, segments[i].size);
+		model->pending += segments[i].size;
+	}
+
+	*seq = next;
+
+	/* Leave some batches uncommitted so that the next one is appended */
+	if (host_rand_below(2)) {
+		queue->write = *write_pending;
+		model->committed += model->pending;
+		model->pending = 0;
+	}
+
+	return *write_pending == ((old_pending + total) &
+				  (queue->capacity - 1));
+}
+
+static void model_consume(struct model *model,
+			  uint32_t size)
+{
+	memmove(model->bytes, model->bytes + size,
+		model->committed + model->pending - size);
+	model->committed -= size;
+}
+
+static bool fuzz_read(struct ethosn_queue *queue,
+		      struct model *model)
+{
+	uint8_t dst[MAX_CAPACITY + 1];
+	const uint32_t size = rand_size(queue->capacity);
+	const uint32_t old_read = queue->read;
+	uint32_t read_pending = old_read;
+	bool ret;
+
+	ret = ethosn_queue_read(queue, dst, size, &read_pending);
+	if (ret != (size <= model->committed))
+		return false;
+
+	/* Reading doesn't consume anything until it is committed */
+	if (queue->read != old_read)
+		return false;
+
+	if (!ret)
+		return read_pending == old_read;
+
+	if (memcmp(dst, model->bytes, size))
+		return false;
+
+	if (read_pending != ((old_read + size) & (queue->capacity - 1)))
+		return false;
+
+	queue->read = read_pending;
+	model_consume(model, size);
+
+	return true;
+}
+
+static bool fuzz_skip(struct ethosn_queue *queue,
+		      struct model *model)
+{
+	const uint8_t size = (uint8_t)host_rand_below(256);
+	const uint32_t old_read = queue->read;
+	bool ret;
+
+	ret = ethosn_queue_skip(queue, size);
+	if (ret != (size <= model->committed))
+		return false;
+
+	if (!ret)
+		return queue->read == old_read;
+
+	model_consume(model, size);
+
+	return queue->read == ((old_read + size) & (queue->capacity - 1));
+}
+
+/*
+ * Random writes, batches, reads and skips against the reference model, from
+ * random starting indices so that most operations wrap around at some point.
+ */
+static void test_queue_fuzz(void)
+{
+	const uint32_t num_ops = 50000;
+	uint32_t capacity;
+
+	for (capacity = 16; capacity <= MAX_CAPACITY; capacity *= 2) {
+		struct ethosn_queue *queue =
+			queue_alloc(capacity, host_rand_below(capacity));
+		struct model model = { .committed = 0 };
+		uint32_t write_pending = queue->write;
+		uint32_t num_empty = 0;
+		uint32_t num_full = 0;
+		uint8_t seq = 0;
+		uint32_t op;
+
+		for (op = 0; op < num_ops; ++op) {
+			bool ok;
+
+			switch (host_rand_below(4)) {
+			case 0:
+				/* Doesn't count uncommitted bytes */
+				ok = model.pending ||
+				     fuzz_write(queue, &model, &write_pending,
+						&seq);
+				break;
+			case 1:
+				ok = fuzz_write_batch(queue, &model,
+						      &write_pending, &seq);
+				break;
+			case 2:
+				ok = fuzz_read(queue, &model);
+				break;
+			default:
+				ok = fuzz_skip(queue, &model);
+				break;
+			}
+
+			HOST_ASSERT(ok);
+			HOST_ASSERT(ethosn_queue_get_size(queue) ==
+				    model.committed);
+			HOST_ASSERT(ethosn_queue_get_free_space(queue) ==
+				    capacity - 1 - model.committed);
+			HOST_ASSERT(queue->read < capacity);
+			HOST_ASSERT(queue->write < capacity);
+			HOST_ASSERT(queue_guard_intact(queue));
+
+			num_empty += model.committed == 0;
+			num_full += model.committed + model.pending >=
+				    capacity - 8;
+		}
+
+		/* Both ends of the queue have been exercised */
+		HOST_EXPECT(num_empty > 0);
+		HOST_EXPECT(num_full > 0);
+		free(queue);
+	}
+}
+
+static void bench_write(struct ethosn_queue *queue,
+			const struct ethosn_queue_segment *segments,
+			bool batched,
+			uint32_t *write_pending)
+{
+	if (batched) {
+		ethosn_queue_write_batch(queue, segments, 2, write_pending);
+
+		return;
+	}
+
+	ethosn_queue_write(queue, segments[0].data, segments[0].size,
+			   write_pending);
+	ethosn_queue_write(queue, segments[1].data, segments[1].size,
+			   write_pending);
+}
+
+/*
+ * Round trips of mailbox sized messages, written either as a header and a
+ * payload with two ethosn_queue_write() calls or as one batch.
+ */
+static void bench_queue(void)
+{
+	const uint32_t capacity = 4096;
+	const uint32_t payload_sizes[] = { 16, 256, 1024 };
+	struct ethosn_message_header header = { 0 };
+	static uint8_t payload[1024];
+	static uint8_t dst[2048];
+	uint32_t i;
+
+	printf("%-10s %-8s %12s %12s\n", "payload", "write", "ns/msg",
+	       "MB/s");
+
+	for (i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); ++i) {
+		const uint32_t size = payload_sizes[i];
+		const uint32_t msg_size = sizeof(header) + size;
+		const uint32_t num_msgs = 64 * 1024 * 1024 / msg_size;
+		int batched;
+
+		header.length = size;
+		for (batched = 0; batched < 2; ++batched) {
+			struct ethosn_queue *queue = queue_alloc(capacity, 0);
+			const struct ethosn_queue_segment segments[] = {
+				{ (const uint8_t *)&header, sizeof(header) },
+				{ payload, size },
+			};
+			uint64_t checksum = 0;
+			uint64_t start = host_time_ns();
+			uint64_t elapsed;
+			uint32_t n;
+
+			for (n = 0; n < num_msgs; ++n) {
+				uint32_t write_pending = queue->write;
+				uint32_t read_pending = queue->read;
+
+				bench_write(queue, segments, batched,
+					    &write_pending);
+				queue->write = write_pending;
+				ethosn_queue_read(queue, dst, msg_size,
+						  &read_pending);
+				queue->read = read_pending;
+				checksum += dst[msg_size - 1];
+			}
+
+			elapsed = host_time_ns() - start;
+			printf("%-10u %-8s %12.1f %12.1f\n", size,
+			       batched ? "batch" : "2x write",
+			       (double)elapsed / num_msgs,
+			       (double)num_msgs * msg_size * 1000.0 / elapsed);
+
+			/* Keeps the copies from being optimised away */
+			if (checksum == 1)
+				printf("\n");
+
+			free(queue);
+		}
+	}
+}
+
+int main(int argc,
+	 char **argv)
+{
+	if (host_bench_requested(argc, argv)) {
+		bench_queue();
+
+		return EXIT_SUCCESS;
+	}
+
+	host_srand();
+	HOST_RUN(test_queue_empty);
+	HOST_RUN(test_queue_full);
+	HOST_RUN(test_queue_wrap_around);
+	HOST_RUN(test_queue_batch_counts_pending);
+	HOST_RUN(test_queue_fuzz);
+
+	return host_test_result();
+}
@@ -0,0 +1,480 @@
+/*
+ *
+ * (C) COPYRIGHT 2020 Arm Limited. All rights reserved.
+ *
+ * This program is free software and is provided to you under the terms of the
+ * GNU General Public License version 2 as published by the Free Software
+ * Foundation, and any use by you of this program is subject to the terms
+ * of such GNU licence.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, you can access it online at
+ * http://www.gnu.org/licenses/gpl-2.0.html.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ */
+
+/*
+ * Tests of the scheduling policy, and a simulation of an inference queue
+ * served by several cores which reports the tail latencies of each priority
+ * class under the policy.
+ */
+
+#include "host_test.h"
+
+#include "../../ethosn_sched.c"
+
+#include <math.h>
+
+#define MS      NSEC_PER_MSEC
+
+static struct ethosn_sched_entry entry(u32 priority,
+				       u64 enqueue_ns,
+				       u64 deadline_ns)
+{
+	struct ethosn_sched_entry e = {
+		.priority = priority,
+		.enqueue_ns = enqueue_ns,
+		.deadline_ns = deadline_ns,
+	};
+
+	return e;
+}
+
+static void test_sched_entry_init(void)
+{
+	struct ethosn_sched_params params = {
+		.priority = ETHOSN_PRIORITY_MEDIUM,
+		.deadline_us = 5,
+		.core_mask = 0x2,
+	};
+	struct ethosn_sched_entry e;
+
+	ethosn_sched_entry_init(&e, &params, 1000);
+	HOST_EXPECT(e.priority == ETHOSN_PRIORITY_MEDIUM);
+	HOST_EXPECT(e.enqueue_ns == 1000);
+	HOST_EXPECT(e.deadline_ns == 6000);
+	HOST_EXPECT(e.core_mask == 0x2);
+
+	/* Out of range priorities are clamped, and 0 means no deadline */
+	params.priority = 7;
+	params.deadline_us = 0;
+	ethosn_sched_entry_init(&e, &params, 1000);
+	HOST_EXPECT(e.priority == ETHOSN_PRIORITY_HIGH);
+	HOST_EXPECT(e.deadline_ns == 0);
+
+	/* The largest deadline doesn't overflow */
+	params.deadline_us = UINT32_MAX;
+	ethosn_sched_entry_init(&e, &params, 1000);
+	HOST_EXPECT(e.deadline_ns == 1000 + (u64)UINT32_MAX * NSEC_PER_USEC);
+}
+
+static void test_sched_effective_priority(void)
+{
+	const u64 aging = 100 * MS;
+	struct ethosn_sched_entry e = entry(ETHOSN_PRIORITY_LOW, 50 * MS, 0);
+
+	/* No aging */
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 10000 * MS, 0) ==
+		    ETHOSN_PRIORITY_LOW);
+
+	/* One class per full aging period waited, up to the highest class */
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 50 * MS, aging) ==
+		    ETHOSN_PRIORITY_LOW);
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 149 * MS, aging) ==
+		    ETHOSN_PRIORITY_LOW);
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 150 * MS, aging) ==
+		    ETHOSN_PRIORITY_MEDIUM);
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 250 * MS, aging) ==
+		    ETHOSN_PRIORITY_HIGH);
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, UINT64_MAX, aging) ==
+		    ETHOSN_PRIORITY_HIGH);
+
+	/* A clock behind the enqueue time doesn't promote nor wrap */
+	HOST_EXPECT(ethosn_sched_effective_priority(&e, 0, aging) ==
+		    ETHOSN_PRIORITY_LOW);
+}
+
+static void test_sched_before(void)
+{
+	const u64 now = 1000 * MS;
+	struct ethosn_sched_entry high = entry(ETHOSN_PRIORITY_HIGH, now, 0);
+	struct ethosn_sched_entry low = entry(ETHOSN_PRIORITY_LOW, now, 0);
+	struct ethosn_sched_entry early =
+		entry(ETHOSN_PRIORITY_LOW, now, now + 5 * MS);
+	struct ethosn_sched_entry late =
+		entry(ETHOSN_PRIORITY_LOW, now - 1, now + 9 * MS);
+	struct ethosn_sched_entry older = entry(ETHOSN_PRIORITY_LOW, 1, 0);
+
+	/* Priority class first, whatever the deadlines */
+	HOST_EXPECT(ethosn_sched_before(&high, &early, now, 0));
+	HOST_EXPECT(!ethosn_sched_before(&early, &high, now, 0));
+
+	/* Then the earliest deadline, and deadlines before none */
+	HOST_EXPECT(ethosn_sched_before(&early, &late, now, 0));
+	HOST_EXPECT(!ethosn_sched_before(&late, &early, now, 0));
+	HOST_EXPECT(ethosn_sched_before(&late, &low, now, 0));
+	HOST_EXPECT(!ethosn_sched_before(&low, &late, now, 0));
+
+	/* Then queueing order, and an entry doesn't go before itself */
+	HOST_EXPECT(ethosn_sched_before(&older, &low, now, 0));
+	HOST_EXPECT(!ethosn_sched_before(&low, &older, now, 0));
+	HOST_EXPECT(!ethosn_sched_before(&low, &low, now, 0));
+
+	/* With aging, the old low priority entry has become high priority */
+	HOST_EXPECT(!ethosn_sched_before(&older, &high, now, 0));
+	HOST_EXPECT(ethosn_sched_before(&older, &high, now, 100 * MS));
+}
+
+static void test_sched_core(void)
+{
+	struct ethosn_sched_core a = { .core_id = 0, .num_inflight = 1 };
+	struct ethosn_sched_core b = { .core_id = 1, .num_inflight = 0 };
+
+	HOST_EXPECT(ethosn_sched_core_allowed(0, 0));
+	HOST_EXPECT(ethosn_sched_core_allowed(0, 31));
+	HOST_EXPECT(ethosn_sched_core_allowed(0x2, 1));
+	HOST_EXPECT(!ethosn_sched_core_allowed(0x2, 0));
+	HOST_EXPECT(!ethosn_sched_core_allowed(0xffffffff, 32));
+
+	/* Least loaded first */
+	HOST_EXPECT(ethosn_sched_core_before(&b, &a));
+	HOST_EXPECT(!ethosn_sched_core_before(&a, &b));
+
+	/* Then the core which last ran the network */
+	a.num_inflight = 0;
+	b.last_ran_network = true;
+	HOST_EXPECT(ethosn_sched_core_before(&b, &a));
+	HOST_EXPECT(!ethosn_sched_core_before(&a, &b));
+
+	/* Then the lowest index */
+	b.last_ran_network = false;
+	HOST_EXPECT(ethosn_sched_core_before(&a, &b));
+	HOST_EXPECT(!ethosn_sched_core_before(&b, &a));
+}
+
+/*
+ * Simulation of the inference queue of a device. Inferences arrive as a
+ * Poisson process and are queued. Whenever a core is free, the queued
+ * inference which goes first according to ethosn_sched_before() is dispatched
+ * to the free core which goes first according to ethosn_sched_core_before(),
+ * as schedule_queued_inference() and get_free_core() do.
+ */
+
+#define SIM_NUM_CORES   2
+
+struct sim_class {
+	const char *name;
+	double     share;
+	u32        deadline_us;
+};
+
+/* Mostly high priority traffic, which starves the lower classes */
+static const struct sim_class sim_classes[ETHOSN_PRIORITY_MAX] = {
+	[ETHOSN_PRIORITY_LOW] = { "low", 0.15, 0 },
+	[ETHOSN_PRIORITY_MEDIUM] = { "medium", 0.25, 20000 },
+	[ETHOSN_PRIORITY_HIGH] = { "high", 0.60, 0 },
+};
+
+struct sim_policy {
+	const char *name;
+	bool       fifo;
+	u64        aging_ns;
+};
+
+struct sim_job {
+	struct ethosn_sched_entry sched;
+	u64                       service_ns;
+};
+
+struct sim_result {
+	uint64_t p50[ETHOSN_PRIORITY_MAX];
+	uint64_t p99[ETHOSN_PRIORITY_MAX];
+	uint64_t p999[ETHOSN_PRIORITY_MAX];
+	uint64_t max[ETHOSN_PRIORITY_MAX];
+	uint32_t missed[ETHOSN_PRIORITY_MAX];
+	uint32_t num[ETHOSN_PRIORITY_MAX];
+};
+
+static u64 sim_exponential(double mean_ns)
+{
+	/* Uniform in (0, 1] */
+	double u = ((double)host_rand() + 1.0) / 4294967296.0;
+
+	return (u64)(-mean_ns * log(u));
+}
+
+static bool sim_before(const struct sim_policy *policy,
+		       const struct sim_job *a,
+		       const struct sim_job *b,
+		       u64 now)
+{
+	if (policy->fifo)
+		return a->sched.enqueue_ns < b->sched.enqueue_ns;
+
+	return ethosn_sched_before(&a->sched, &b->sched, now,
+				   policy->aging_ns);
+}
+
+/* Queues a new job */
+static void sim_arrive(struct sim_job *job,
+		       u64 now,
+		       u64 mean_service_ns)
+{
+	const double r = (double)host_rand() / 4294967296.0;
+	struct ethosn_sched_params params = { 0 };
+	double cumulative = 0;
+	u32 i;
+
+	for (i = 0; i < ETHOSN_PRIORITY_MAX; ++i) {
+		cumulative += sim_classes[i].share;
+		if (r < cumulative || i == ETHOSN_PRIORITY_MAX - 1)
+			break;
+	}
+
+	params.priority = i;
+	params.deadline_us = sim_classes[i].deadline_us;
+	ethosn_sched_entry_init(&job->sched, &params, now);
+	job->service_ns = sim_exponential((double)mean_service_ns);
+}
+
+/* Picks the free core to dispatch to, or returns -1 if they are all busy */
+static int sim_free_core(const u64 *busy_until,
+			 u64 now)
+{
+	struct ethosn_sched_core best = { 0 };
+	struct ethosn_sched_core candidate = { 0 };
+	int core = -1;
+	int i;
+
+	for (i = 0; i < SIM_NUM_CORES; ++i) {
+		if (busy_until[i] > now)
+			continue;
+
+		candidate.core_id = i;
+		if (core < 0 || ethosn_sched_core_before(&candidate, &best)) {
+			core = i;
+			best = candidate;
+		}
+	}
+
+	return core;
+}
+
+/**
+ * sim_run() - Simulate a number of inferences.
+ * @policy:		Scheduling policy.
+ * @num_jobs:		Number of inferences.
+ * @load:		Fraction of the capacity of the cores needed by the
+ *			inferences on average.
+ * @mean_service_ns:	Average time to run an inference.
+ * @result:		Latencies from queueing to completion, per class.
+ */
+static void sim_run(const struct sim_policy *policy,
+		    u32 num_jobs,
+		    double load,
+		    u64 mean_service_ns,
+		    struct sim_result *result)
+{
+	const double mean_arrival_ns =
+		(double)mean_service_ns / (load * SIM_NUM_CORES);
+	struct sim_job *queue = calloc(num_jobs, sizeof(*queue));
+	uint64_t *latencies[ETHOSN_PRIORITY_MAX];
+	u64 busy_until[SIM_NUM_CORES] = { 0 };
+	u32 num_queued = 0;
+	u32 num_arrived = 0;
+	u32 num_done = 0;
+	u64 next_arrival = 0;
+	u64 now = 0;
+	u32 i;
+
+	memset(result, 0, sizeof(*result));
+	for (i = 0; i < ETHOSN_PRIORITY_MAX; ++i)
+		latencies[i] = calloc(num_jobs, sizeof(uint64_t));
+
+	while (num_done < num_jobs) {
+		int core;
+
+		if (num_arrived < num_jobs && next_arrival <= now) {
+			sim_arrive(&queue[num_queued++], now, mean_service_ns);
+			++num_arrived;
+			next_arrival = now + sim_exponential(mean_arrival_ns);
+		}
+
+		/* Dispatch to the free cores */
+		while (num_queued &&
+		       (core = sim_free_core(busy_until, now)) >= 0) {
+			struct sim_job job;
+			u32 best = 0;
+			u32 prio;
+			u64 latency;
+
+			for (i = 1; i < num_queued; ++i)
+				if (sim_before(policy, &queue[i], &queue[best],
+					       now))
+					best = i;
+
+			job = queue[best];
+			memmove(&queue[best], &queue[best + 1],
+				(num_queued - best - 1) * sizeof(*queue));
+			--num_queued;
+
+			busy_until[core] = now + job.service_ns;
+			latency = busy_until[core] - job.sched.enqueue_ns;
+			prio = job.sched.priority;
+			latencies[prio][result->num[prio]++] = latency;
+			if (job.sched.deadline_ns &&
+			    busy_until[core] > job.sched.deadline_ns)
+				++result->missed[prio];
+
+			++num_done;
+		}
+
+		/* Move on to the next arrival or core becoming free */
+		{
+			u64 next = num_arrived < num_jobs ? next_arrival :
+				   UINT64_MAX;
+
+			for (i = 0; i < SIM_NUM_CORES; ++i)
+				if (busy_until[i] > now && busy_until[i] < next)
+					next = busy_until[i];
+
+			if (next != UINT64_MAX)
+				now = next;
+		}
+	}
+
+	for (i = 0; i < ETHOSN_PRIORITY_MAX; ++i) {
+		const size_t n = result->num[i];
+
+		result->p50[i] = host_percentile(latencies[i], n, 50);
+		result->p99[i] = host_percentile(latencies[i], n, 99);
+		result->p999[i] = host_percentile(latencies[i], n, 99.9);
+		result->max[i] = n ? latencies[i][n - 1] : 0;
+		free(latencies[i]);
+	}
+
+	free(queue);
+}
+
+static void sim_print(const struct sim_policy *policy,
+		      const struct sim_result *result)
+{
+	int i;
+
+	for (i = ETHOSN_PRIORITY_MAX - 1; i >= 0; --i)
+		printf("%-16s %-7s %7u %9.1f %9.1f %9.1f %9.1f %7u\n",
+		       policy->name, sim_classes[i].name, result->num[i],
+		       (double)result->p50[i] / MS,
+		       (double)result->p99[i] / MS,
+		       (double)result->p999[i] / MS,
+		       (double)result->max[i] / MS,
+		       result->missed[i]);
+}
+
+static void sim_print_header(u32 num_jobs,
+			     double load)
+{
+	printf("%u inferences on %d cores at %.0f%% load, latencies in ms\n",
+	       num_jobs, SIM_NUM_CORES, load * 100);
+	printf("%-16s %-7s %7s %9s %9s %9s %9s %7s\n", "policy", "class",
+	       "num", "p50", "p99", "p99.9", "max", "missed");
+}
+
+static const struct sim_policy sim_fifo = { "fifo", true, 0 };
+static const struct sim_policy sim_priority = { "priority", false, 0 };
+static const struct sim_policy sim_aging = {
+	"priority+aging", false, 100 * MS
+};
+
+/*
+ * Checks the properties the policy is meant to have, in the default
+ * configuration of the driver: 100ms aging.
+ */
+static void test_sched_simulation(void)
+{
+	const u32 num_jobs = 50000;
+	const double load = 0.95;
+	const u64 mean_service_ns = 5 * MS;
+	struct sim_result fifo;
+	struct sim_result priority;
+	struct sim_result aging;
+
+	sim_run(&sim_fifo, num_jobs, load, mean_service_ns, &fifo);
+	sim_run(&sim_priority, num_jobs, load, mean_service_ns, &priority);
+	sim_run(&sim_aging, num_jobs, load, mean_service_ns, &aging);
+
+	/* High priority inferences aren't held up by the rest */
+	HOST_EXPECT(priority.p99[ETHOSN_PRIORITY_HIGH] * 2 <
+		    fifo.p99[ETHOSN_PRIORITY_HIGH]);
+
+	/*
+	 * Less so with aging, as the promoted inferences go before the newer
+	 * high priority ones. Close to saturation this takes the high priority
+	 * tail latency back to about that of FIFO.
+	 */
+	HOST_EXPECT(aging.p99[ETHOSN_PRIORITY_HIGH] >
+		    priority.p99[ETHOSN_PRIORITY_HIGH]);
+
+	/* Deadlines order the medium class */
+	HOST_EXPECT(priority.missed[ETHOSN_PRIORITY_MEDIUM] <
+		    fifo.missed[ETHOSN_PRIORITY_MEDIUM]);
+
+	/* Aging bounds the starvation of the low priority class */
+	HOST_EXPECT(aging.max[ETHOSN_PRIORITY_LOW] <
+		    priority.max[ETHOSN_PRIORITY_LOW]);
+	HOST_EXPECT(aging.p999[ETHOSN_PRIORITY_LOW] <
+		    priority.p999[ETHOSN_PRIORITY_LOW]);
+
+	if (host_test_failures) {
+		sim_print_header(num_jobs, load);
+		sim_print(&sim_fifo, &fifo);
+		sim_print(&sim_priority, &priority);
+		sim_print(&sim_aging, &aging);
+	}
+}
+
+static void bench_sched(void)
+{
+	const double loads[] = { 0.5, 0.8, 0.95 };
+	const u32 num_jobs = 200000;
+	struct sim_result result;
+	u32 i;
+
+	for (i = 0; i < ARRAY_SIZE(loads); ++i) {
+		sim_print_header(num_jobs, loads[i]);
+		sim_run(&sim_fifo, num_jobs, loads[i], 5 * MS, &result);
+		sim_print(&sim_fifo, &result);
+		sim_run(&sim_priority, num_jobs, loads[i], 5 * MS, &result);
+		sim_print(&sim_priority, &result);
+		sim_run(&sim_aging, num_jobs, loads[i], 5 * MS, &result);
+		sim_print(&sim_aging, &result);
+		printf("\n");
+	}
+}
+
+int main(int argc,
+	 char **argv)
+{
+	host_srand();
+
+	if (host_bench_requested(argc, argv)) {
+		bench_sched();
+
+		return EXIT_SUCCESS;
+	}
+
+	HOST_RUN(test_sched_entry_init);
+	HOST_RUN(test_sched_effective_priority);
+	HOST_RUN(test_sched_before);
+	HOST_RUN(test_sched_core);
+	HOST_RUN(test_sched_simulation);
+
+	return host_test_result();
+}
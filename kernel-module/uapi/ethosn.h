@@ -155,11 +155,152 @@ struct ethosn_inference_req {
 	const int __user *output_fds;
 };
 
+/**
+ * enum ethosn_priority - Scheduling priority class of inferences.
+ *
+ * Inferences of a higher class are scheduled first. Queued inferences are
+ * promoted to the next class as they wait, so lower classes still make
+ * progress.
+ */
+enum ethosn_priority {
+	ETHOSN_PRIORITY_LOW    = 0,
+	ETHOSN_PRIORITY_MEDIUM = 1,
+	ETHOSN_PRIORITY_HIGH   = 2,
+	ETHOSN_PRIORITY_MAX
+};
+
+/**
+ * struct ethosn_sched_params - Scheduling parameters of inferences.
+ * @priority:		Priority class, see enum ethosn_priority.
+ * @deadline_us:	Deadline in microseconds, relative to the time the
+ *			inference is scheduled. Within a priority class,
+ *			inferences with the earliest deadline run first.
+ *			0 means no deadline.
+ * @core_mask:		Bit mask of the cores the inferences may run on.
+ *			0 means any core.
+ */
+struct ethosn_sched_params {
+	__u32 priority;
+	__u32 deadline_us;
+	__u32 core_mask;
+};
+
+/**
+ * struct ethosn_inference_sched_req - Inference request with scheduling
+ * parameters, passed to ETHOSN_IOCTL_SCHEDULE_INFERENCE_SCHED.
+ * @request:	Inference description.
+ * @sched:	Scheduling parameters overriding the network's defaults.
+ */
+struct ethosn_inference_sched_req {
+	struct ethosn_inference_req request;
+	struct ethosn_sched_params  sched;
+};
+
 struct ethosn_buffer_req {
 	__u32 size;
 	__u32 flags;
 };
 
+/**
+ * struct ethosn_completion - Record read from a completion queue file
+ * descriptor.
+ * @inference_fd:	File descriptor returned when the inference was
+ *			scheduled. The inference file descriptor must be kept
+ *			open until its record has been read.
+ * @status:		ETHOSN_INFERENCE_COMPLETED or ETHOSN_INFERENCE_ERROR.
+ *
+ * A completion queue is created with ETHOSN_IOCTL_CREATE_COMPLETION_QUEUE and
+ * attached to networks of the same device with
+ * ETHOSN_IOCTL_SET_COMPLETION_QUEUE. Every inference of an attached network
+ * appends a record when it finishes. The queue file descriptor can be polled,
+ * and a single read returns as many records as fit in the buffer. Records
+ * which can't be copied to the buffer stay in the queue.
+ *
+ * Room for the record is reserved when the inference is scheduled. Scheduling
+ * fails with EAGAIN while the queue holds as many pending and unread records
+ * as it can, until some are read.
+ */
+struct ethosn_completion {
+	__s32 inference_fd;
+	__u32 status;
+};
+
+#define ETHOSN_CPU_ACCESS_READ  (1 << 0)
+#define ETHOSN_CPU_ACCESS_WRITE (1 << 1)
+
+/**
+ * struct ethosn_buffer_cpu_access - CPU access to a mapped buffer, passed to
+ * ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN and ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END
+ * on a buffer file descriptor.
+ * @flags:	ETHOSN_CPU_ACCESS_READ and/or ETHOSN_CPU_ACCESS_WRITE.
+ *
+ * Once a buffer's CPU accesses are bracketed, the kernel only performs cache
+ * maintenance when ownership of the data changes between the CPU and the
+ * device. Accesses outside a begin/end pair are then not coherent.
+ */
+struct ethosn_buffer_cpu_access {
+	__u32 flags;
+};
+
+/**
+ * enum ethosn_latency_stage - Stages of an inference's life, timed by the
+ * kernel for every inference.
+ * @ETHOSN_LATENCY_STAGE_SUBMIT:	Ioctl entry until queued for a core.
+ * @ETHOSN_LATENCY_STAGE_QUEUE:		Queued until dequeued to a core.
+ * @ETHOSN_LATENCY_STAGE_BIND:		Binding table update and cache
+ *					maintenance of the input/output buffers.
+ * @ETHOSN_LATENCY_STAGE_POST:		Posting the request to the mailbox.
+ * @ETHOSN_LATENCY_STAGE_EXECUTE:	Posted until the core raised the
+ *					interrupt reporting completion.
+ * @ETHOSN_LATENCY_STAGE_IRQ:		Interrupt until the bottom half
+ *					completed the inference.
+ * @ETHOSN_LATENCY_STAGE_WAKEUP:	Completed until user space read the
+ *					inference status.
+ * @ETHOSN_LATENCY_STAGE_TOTAL:		Ioctl entry until completion.
+ */
+enum ethosn_latency_stage {
+	ETHOSN_LATENCY_STAGE_SUBMIT,
+	ETHOSN_LATENCY_STAGE_QUEUE,
+	ETHOSN_LATENCY_STAGE_BIND,
+	ETHOSN_LATENCY_STAGE_POST,
+	ETHOSN_LATENCY_STAGE_EXECUTE,
+	ETHOSN_LATENCY_STAGE_IRQ,
+	ETHOSN_LATENCY_STAGE_WAKEUP,
+	ETHOSN_LATENCY_STAGE_TOTAL,
+	ETHOSN_LATENCY_STAGE_MAX
+};
+
+/*
+ * Bucket 0 of a latency histogram counts durations below 2 us, bucket i
+ * counts durations in [2^i, 2^(i+1)) us and the last bucket also counts
+ * everything longer.
+ */
+#define ETHOSN_LATENCY_NUM_BUCKETS 20
+
+/**
+ * struct ethosn_stage_latency - Latency of one stage, aggregated over the
+ * inferences of a network.
+ * @count:	Number of inferences which went through the stage.
+ * @total_ns:	Sum of the durations.
+ * @max_ns:	Longest duration.
+ * @histogram:	Number of inferences per duration bucket.
+ */
+struct ethosn_stage_latency {
+	__u64 count;
+	__u64 total_ns;
+	__u64 max_ns;
+	__u32 histogram[ETHOSN_LATENCY_NUM_BUCKETS];
+};
+
+/**
+ * struct ethosn_latency_stats - Per-stage latencies of a network's inferences,
+ * returned by ETHOSN_IOCTL_GET_LATENCY_STATS on a network file descriptor.
+ * @stages:	Indexed by enum ethosn_latency_stage.
+ */
+struct ethosn_latency_stats {
+	struct ethosn_stage_latency stages[ETHOSN_LATENCY_STAGE_MAX];
+};
+
 /*****************************************************************************
  * Capabilities
  *****************************************************************************/
@@ -298,6 +439,35 @@ struct ethosn_profiling_config {
 enum ethosn_poll_counter_name {
 	ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_SENT,
 	ETHOSN_POLL_COUNTER_NAME_MAILBOX_MESSAGES_RECEIVED,
+	ETHOSN_POLL_COUNTER_NAME_INFERENCES_COMPLETED,
+	ETHOSN_POLL_COUNTER_NAME_BUSY_TIME_MS,
+	ETHOSN_POLL_COUNTER_NAME_AFFINITY_HITS,
+};
+
+/*
+ * Bits 8 to 15 of the counter name passed to ETHOSN_IOCTL_GET_COUNTER_VALUE
+ * select the core the counter is read from. Core 0 is used by default.
+ */
+#define ETHOSN_POLL_COUNTER_NAME_MASK   0xff
+#define ETHOSN_POLL_COUNTER_CORE_SHIFT  8
+#define ETHOSN_POLL_COUNTER_FOR_CORE(name, core) \
+	((name) | ((core) << ETHOSN_POLL_COUNTER_CORE_SHIFT))
+
+/**
+ * struct ethosn_counter_value - Counter read with
+ *      ETHOSN_IOCTL_GET_COUNTER_VALUE_U64.
+ * @counter_name:	enum ethosn_poll_counter_name, with the core in the
+ *			upper bits as for ETHOSN_IOCTL_GET_COUNTER_VALUE.
+ * @reserved:		Must be zero.
+ * @value:		Returns the value of the counter.
+ *
+ * The dispatch counters (inferences completed, busy time and affinity hits)
+ * are always available. The mailbox counters need profiling to be enabled.
+ */
+struct ethosn_counter_value {
+	__u32 counter_name;
+	__u32 reserved;
+	__u64 value;
 };
 
 /**
@@ -336,6 +506,22 @@ struct ethosn_log_firmware_header {
 	ETHOSN_IO(0x08)
 #define ETHOSN_IOCTL_GET_INTERMEDIATE_BUFFER \
 	ETHOSN_IO(0x09)
+#define ETHOSN_IOCTL_SET_SCHEDULING \
+	ETHOSN_IOW(0x0a, struct ethosn_sched_params)
+#define ETHOSN_IOCTL_SCHEDULE_INFERENCE_SCHED \
+	ETHOSN_IOW(0x0b, struct ethosn_inference_sched_req)
+#define ETHOSN_IOCTL_BUFFER_CPU_ACCESS_BEGIN \
+	ETHOSN_IOW(0x0c, struct ethosn_buffer_cpu_access)
+#define ETHOSN_IOCTL_BUFFER_CPU_ACCESS_END \
+	ETHOSN_IOW(0x0d, struct ethosn_buffer_cpu_access)
+#define ETHOSN_IOCTL_CREATE_COMPLETION_QUEUE \
+	ETHOSN_IO(0x0e)
+#define ETHOSN_IOCTL_SET_COMPLETION_QUEUE \
+	ETHOSN_IOW(0x0f, int)
+#define ETHOSN_IOCTL_GET_LATENCY_STATS \
+	ETHOSN_IOR(0x10, struct ethosn_latency_stats)
+#define ETHOSN_IOCTL_GET_COUNTER_VALUE_U64 \
+	ETHOSN_IOWR(0x11, struct ethosn_counter_value)
 
 /*
  * Results from reading an inference file descriptor.